@@ -2,8 +2,14 @@
 
 #extension GL_GOOGLE_include_directive : enable
 #include "../computeshader/common.glsl"
+#include "sdf.glsl"
 
-layout (binding = 1) uniform sampler3D s_VoxelGrid;
+layout (binding = 1) uniform sampler3D s_SdfIndirection;
+layout (binding = 2) uniform sampler3D s_SdfAtlas;
+layout (binding = 3) uniform UboSdf
+{
+	SparseSdf sdf;
+} uboSdf;
 
 layout (location = 0) in vec3 inNormal;
 layout (location = 1) in vec2 inUV;
@@ -14,13 +20,6 @@ layout (location = 4) in vec3 inCamPosition;
 
 layout (location = 0) out vec4 outFragColor;
 
-vec3 worldToUV(vec3 p)
-{
-	vec3 minBound = vec3(-3.0, -3.0, -3.0); 
-	vec3 maxBound = vec3(3.0, 3.0, 3.0); 
-	return (p-minBound)/(maxBound-minBound);
-}
-
 float computeShadow(vec3 fragPos)
 {
 	float maxDist = 30.0;
@@ -33,8 +32,7 @@ float computeShadow(vec3 fragPos)
 	for(int i =0;i<64;i++)
 	{
 		vec3 curPos = fragPos + rayDir * travelDist;
-		vec3 texCoord = worldToUV(curPos);
-		float dist = texture(s_VoxelGrid, texCoord).r;
+		float dist = sampleSparseSdf(s_SdfIndirection, s_SdfAtlas, uboSdf.sdf, curPos);
 		if(dist < minStep)
 			return 0.0;
 		//res = min(res, dist);//50 * dist/travelDist);
@@ -49,7 +47,7 @@ float computeShadow(vec3 fragPos)
 
 void main() 
 {
-	vec4 vcolor = vec4(1.0,1.0,1.0,1.0);//texture(s_VoxelGrid, worldToUV(inPosition));//vec3(inUV, 0.5));
+	vec4 vcolor = vec4(1.0,1.0,1.0,1.0);
 	vec3 lightDir = normalize(inLightPos - inPosition);  
 	float diff = max(dot(normalize(inNormal), lightDir), 0.0);
 	float s = computeShadow(inPosition + inNormal * 0.05);
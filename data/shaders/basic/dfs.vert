@@ -13,6 +13,12 @@ layout (binding = 0) uniform UboView
 	vec3 camera_pos;
 } ubo;
 
+//moves the objects the distance field follows
+layout (binding = 4) uniform UboModel
+{
+	mat4 model;
+} uboModel;
+
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec2 outUV;
 layout (location = 2) out vec3 outPos;
@@ -26,12 +32,13 @@ out gl_PerVertex {
 
 void main() 
 {
-	outNormal = inNormal;
+	vec4 worldPos = uboModel.model * vec4(inPos.xyz, 1.0);
+	outNormal = mat3(uboModel.model) * inNormal;
 	outUV = inUV;
-	outPos = inPos;
+	outPos = worldPos.xyz;
 	outLightPos = ubo.light_pos.xyz;
 	outCamPos = ubo.camera_pos;
 	//outShadowCoord = (  ubo.lightSpace ) * vec4(inPos, 1.0);	
 	
-	gl_Position = ubo.projection * ubo.view * vec4(inPos.xyz, 1.0);
+	gl_Position = ubo.projection * ubo.view * worldPos;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ layout (binding = 1) uniform UBO
 {
 	mat4 view_proj;
 	vec4 bias_near_far_pow;
+	vec4 grid_scale;//froxels in use over the size of the volume
 } ubo;
 
 layout (binding = 2) uniform sampler2D samplerColor;
@@ -29,7 +30,7 @@ vec3 add_inscattered_light(vec3 color, vec3 world_pos)
 {
     vec3 uv = world_to_uv(world_pos, ubo.bias_near_far_pow.y, ubo.bias_near_far_pow.z, ubo.bias_near_far_pow.w, ubo.view_proj);
 
-    vec4  scattered_light = texture(s_VoxelGrid, uv);
+    vec4  scattered_light = texture(s_VoxelGrid, uv_to_grid_texcoord(uv, ubo.grid_scale.xyz, vec3(textureSize(s_VoxelGrid, 0))));
     float transmittance   = scattered_light.a;
 
     return color * transmittance * 1.0 + scattered_light.rgb;
@@ -0,0 +1,51 @@
+#version 450
+
+//VERTEX_COMPONENT_POSITION_SNORM16, VERTEX_COMPONENT_NORMAL_OCT16, VERTEX_COMPONENT_UV_HALF
+layout (location = 0) in vec4 inPos;
+layout (location = 1) in vec2 inNormal;
+layout (location = 2) in vec2 inUV;
+
+layout (binding = 0) uniform UboView 
+{
+	mat4 projection;
+	mat4 view; 
+	vec4 light_pos;
+	vec3 camera_pos;
+} ubo;
+
+layout(push_constant) uniform Dequantization
+{
+	vec4 positionOffset;
+	vec4 positionScale;
+} dequant;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) out vec3 outPos;
+layout (location = 3) out vec3 outLightPos;
+layout (location = 4) out vec3 outCamPos;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() 
+{
+	vec3 pos = inPos.xyz * dequant.positionScale.xyz + dequant.positionOffset.xyz;
+	outNormal = octDecode(inNormal);
+	outUV = inUV;
+	outPos = pos;
+	outLightPos = ubo.light_pos.xyz;
+	outCamPos = ubo.camera_pos;
+	
+	gl_Position = ubo.projection * ubo.view * vec4(pos, 1.0);
+}
@@ -0,0 +1,29 @@
+//sparse distance field baked on the CPU (engine/scene/SparseSdf.h)
+//the indirection texture has a texel per cell: xyz the first atlas texel of its brick or -1 without one, w the distance at the cell center
+//neighbouring bricks share their border samples, so filtering inside a brick never reads another one
+
+struct SparseSdf
+{
+	vec4 boundsMin;//w cell size
+	vec4 cellCount;//w voxels per brick side
+	vec4 atlasSize;//texels, w max distance
+};
+
+float sampleSparseSdf(sampler3D indirection, sampler3D atlas, SparseSdf sdf, vec3 p)
+{
+	vec3 boundsMax = sdf.boundsMin.xyz + sdf.cellCount.xyz * sdf.boundsMin.w;
+	vec3 q = clamp(p, sdf.boundsMin.xyz, boundsMax);
+	float outside = length(p - q);
+	vec3 local = (q - sdf.boundsMin.xyz) / sdf.boundsMin.w;
+	vec3 cell = min(floor(local), sdf.cellCount.xyz - 1.0);
+	vec4 entry = texelFetch(indirection, ivec3(cell), 0);
+	if (entry.x < 0.0)
+	{
+		//the surface is at least this far from anywhere in the cell
+		vec3 center = sdf.boundsMin.xyz + (cell + 0.5) * sdf.boundsMin.w;
+		float bound = max(abs(entry.w) - length(q - center), 0.0);
+		return (entry.w < 0.0 ? -bound : bound) + outside;
+	}
+	vec3 f = clamp(local - cell, 0.0, 1.0) * sdf.cellCount.w;
+	return texture(atlas, (entry.xyz + 0.5 + f) / sdf.atlasSize.xyz).r + outside;
+}
@@ -1,4 +1,5 @@
 //https://github.com/diharaw/volumetric-fog/blob/main/src/shaders/common.glsl
+//size of the volume textures, the froxels in use can be fewer and fill their first texels
 #define VOXEL_GRID_SIZE_X 160
 #define VOXEL_GRID_SIZE_Y 80
 #define VOXEL_GRID_SIZE_Z 128
@@ -26,6 +27,30 @@ float linear_01_to_exp_01_depth(float z, float n, float f)
 
 // ------------------------------------------------------------------
 
+// slices are spread exponentially between the near and far planes, a depth power above 1 moves more of them close to the camera
+float slice_to_view_z(float slice, float n, float f, float depth_power)
+{
+    return n * pow(f / n, pow(slice, depth_power > 0.0f ? depth_power : 1.0f));
+}
+
+// ------------------------------------------------------------------
+
+float view_z_to_slice(float view_z, float n, float f, float depth_power)
+{
+    float slice = max(log2(view_z / n) / log2(f / n), 0.0f);
+    return pow(slice, 1.0f / (depth_power > 0.0f ? depth_power : 1.0f));
+}
+
+// ------------------------------------------------------------------
+
+vec3 uv_to_grid_texcoord(vec3 uv, vec3 grid_scale, vec3 texture_size)
+{
+    vec3 half_texel = 0.5f / texture_size;
+    return clamp(uv * grid_scale, half_texel, grid_scale - half_texel);
+}
+
+// ------------------------------------------------------------------
+
 vec3 world_to_ndc(vec3 world_pos, mat4 vp)
 {
     vec4 p = vp * vec4(world_pos, 1.0f);
@@ -51,10 +76,8 @@ vec3 ndc_to_uv(vec3 ndc, float n, float f, float depth_power)
     uv.z = exp_01_to_linear_01_depth(ndc.z * 0.5f + 0.5f, n, f);
 
     // Exponential View-Z
-    vec2 params = vec2(float(VOXEL_GRID_SIZE_Z) / log2(f / n), -(float(VOXEL_GRID_SIZE_Z) * log2(n) / log2(f / n)));
-
     float view_z = uv.z * f;
-    uv.z = (max(log2(view_z) * params.x + params.y, 0.0f)) / VOXEL_GRID_SIZE_Z;
+    uv.z = view_z_to_slice(view_z, n, f, depth_power);
      
     return uv;
 }
@@ -95,44 +118,51 @@ vec3 ndc_to_world(vec3 ndc, mat4 inv_vp)
 
 // ------------------------------------------------------------------
 
-vec3 id_to_uv(ivec3 id, float n, float f)
+vec3 id_to_uv(ivec3 id, vec3 grid_size, float jitter, float n, float f, float depth_power)
 {
     // Exponential View-Z
-    float view_z = n * pow(f / n, (float(id.z) + 0.5f) / float(VOXEL_GRID_SIZE_Z));
+    float view_z = slice_to_view_z((float(id.z) + 0.5f + jitter) / grid_size.z, n, f, depth_power);
 
-    return vec3((float(id.x) + 0.5f) / float(VOXEL_GRID_SIZE_X),
-                (float(id.y) + 0.5f) / float(VOXEL_GRID_SIZE_Y),
+    return vec3((float(id.x) + 0.5f) / grid_size.x,
+                (float(id.y) + 0.5f) / grid_size.y,
                 view_z / f);
 }
 
 // ------------------------------------------------------------------
 
-vec3 id_to_uv_with_jitter(ivec3 id, float n, float f, float jitter)
+vec3 id_to_uv(ivec3 id, float n, float f)
 {
-    // Exponential View-Z
-    float view_z = n * pow(f / n, (float(id.z) + 0.5f + jitter) / float(VOXEL_GRID_SIZE_Z));
+    return id_to_uv(id, vec3(VOXEL_GRID_SIZE_X, VOXEL_GRID_SIZE_Y, VOXEL_GRID_SIZE_Z), 0.0f, n, f, 1.0f);
+}
 
-    return vec3((float(id.x) + 0.5f) / float(VOXEL_GRID_SIZE_X),
-                (float(id.y) + 0.5f) / float(VOXEL_GRID_SIZE_Y),
-                view_z / f);
+// ------------------------------------------------------------------
+
+vec3 id_to_uv_with_jitter(ivec3 id, float n, float f, float jitter)
+{
+    return id_to_uv(id, vec3(VOXEL_GRID_SIZE_X, VOXEL_GRID_SIZE_Y, VOXEL_GRID_SIZE_Z), jitter, n, f, 1.0f);
 }
 
 // ------------------------------------------------------------------
 
-vec3 id_to_world(ivec3 id, float n, float f, float depth_power, mat4 inv_vp)
+vec3 id_to_world(ivec3 id, vec3 grid_size, float jitter, float n, float f, float depth_power, mat4 inv_vp)
 {
-    vec3 uv = id_to_uv(id, n, f);
+    vec3 uv = id_to_uv(id, grid_size, jitter, n, f, depth_power);
     vec3 ndc = uv_to_ndc(uv, n, f, depth_power);
     return ndc_to_world(ndc, inv_vp);
 }
 
 // ------------------------------------------------------------------
 
+vec3 id_to_world(ivec3 id, float n, float f, float depth_power, mat4 inv_vp)
+{
+    return id_to_world(id, vec3(VOXEL_GRID_SIZE_X, VOXEL_GRID_SIZE_Y, VOXEL_GRID_SIZE_Z), 0.0f, n, f, depth_power, inv_vp);
+}
+
+// ------------------------------------------------------------------
+
 vec3 id_to_world_with_jitter(ivec3 id, float jitter, float n, float f, float depth_power, mat4 inv_vp)
 {
-    vec3 uv = id_to_uv_with_jitter(id, n, f, jitter);
-    vec3 ndc = uv_to_ndc(uv, n, f, depth_power);
-    return ndc_to_world(ndc, inv_vp);
+    return id_to_world(id, vec3(VOXEL_GRID_SIZE_X, VOXEL_GRID_SIZE_Y, VOXEL_GRID_SIZE_Z), jitter, n, f, depth_power, inv_vp);
 }
 
 // ------------------------------------------------------------------
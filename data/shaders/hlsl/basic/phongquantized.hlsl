@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma pack_matrix(row_major)
+
+//VERTEX_COMPONENT_POSITION_SNORM16, VERTEX_COMPONENT_NORMAL_OCT16, VERTEX_COMPONENT_UV_HALF
+struct VSInput
+{
+    float4 position    : POSITION;
+    float2 normal    : NORMAL;
+    float2 uv        : TEXCOORD0;
+};
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float3 positionw : POSITION;
+    float3 normal : NORMAL;
+    float2 uv : TEXCOORD;
+	float3 lightPos : LIGHT;
+    float3 camPos : CAMERA;
+};
+
+cbuffer cb0 : register(b0)
+{
+	float4x4 projection;
+	float4x4 view; 
+	float4 light_pos;
+	float3 camera_pos;
+};
+
+cbuffer dequant : register(b1)
+{
+	float4 positionOffset;
+	float4 positionScale;
+};
+
+Texture2D g_texture : register(t0);
+SamplerState g_sampler : register(s0);
+
+
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+PSInput VSMain(VSInput input)
+{
+    PSInput result;
+
+	float3 position = input.position.xyz * positionScale.xyz + positionOffset.xyz;
+    float4x4 g_mWorldViewProj =  mul(view, projection);
+    result.position = mul(float4(position, 1.0f), g_mWorldViewProj);
+	result.positionw = position;
+    result.uv = input.uv;
+	result.normal = OctDecode(input.normal);
+	result.lightPos = light_pos;
+	result.camPos = camera_pos;
+
+    return result;
+}
+
+float4 PSMainTextured(PSInput input) : SV_TARGET
+{
+	float3 lightDir = normalize(input.lightPos - input.positionw);  
+	float3 N = normalize(input.normal);
+	float diff = max(dot(N, lightDir), 0.0);
+	float3 viewDir = normalize(input.camPos - input.positionw);
+	float3 reflectDir = reflect(-lightDir, N); 
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+	
+    return ( diff + spec ) * g_texture.Sample(g_sampler, input.uv);
+}
@@ -8,6 +8,9 @@ struct VSInput
     float3 position    : POSITION;
     float3 normal    : NORMAL;
     float2 uv        : TEXCOORD0;
+#if NORMAL_MAP
+    float4 tangent        : TANGENT;
+#endif
 };
 
 struct PSInput
@@ -15,6 +18,9 @@ struct PSInput
     float4 position : SV_POSITION;
     float3 positionw : POSITION;
     float3 normal : NORMAL;
+#if NORMAL_MAP
+    float3 tangent : TANGENT;
+#endif
     float2 uv : TEXCOORD;
 	float3 lightPos : LIGHT;
     float3 camPos : CAMERA;
@@ -45,7 +51,11 @@ cbuffer frag_ubo : register(b2)
 
 Texture2D albedoSampler             : register(t0);
 Texture2D roughnessMetallicSampler  : register(t1);
-Texture2D sampleShadow				: register(t2);
+#if NORMAL_MAP
+Texture2D normalsSampler            : register(t2);
+#endif
+//without NORMAL_MAP t2 holds the placeholder normal map, the layout is the same for both variants
+Texture2D sampleShadow				: register(t3);
 SamplerState samLinear              : register(s0);
 
 
@@ -58,6 +68,9 @@ PSInput VSMain(VSInput input)
 	result.positionw = input.position;
     result.uv = input.uv;
 	result.normal = input.normal;
+#if NORMAL_MAP
+	result.tangent = input.tangent.xyz;
+#endif
 	result.lightPos = light_pos.xyz;
 	result.camPos = camera_pos;
 	result.shadowCoord = mul(float4(input.position, 1.0f), lightSpace);
@@ -65,6 +78,20 @@ PSInput VSMain(VSInput input)
     return result;
 }
 
+#if NORMAL_MAP
+float3 CalculateNormal(PSInput input)
+{
+    float3 tangentNormal = normalsSampler.Sample(samLinear, input.uv).xyz * 2.0f - 1.0f;
+
+    float3 N = normalize(input.normal);
+    float3 T = normalize(input.tangent.xyz);
+    float3 B = normalize(cross(N, T)); // or cross(N, T) * input.tangent.w if handedness is needed
+    float3x3 TBN = float3x3(T, B, N);
+
+    return normalize(mul(tangentNormal, TBN)); // note: mul(vector, matrix) in HLSL
+}
+#endif
+
 float textureProj(float4 shadowCoord, float2 off)
 {
     float shadow = 1.0f;
@@ -99,7 +126,11 @@ float4 PSMain(PSInput input) : SV_TARGET
 	
 	 // View direction & normal
     float3 viewDir = normalize(input.camPos - input.positionw);
+#if NORMAL_MAP
+    float3 N = CalculateNormal(input);
+#else
     float3 N = normalize(input.normal);
+#endif
 	
 	float3 Lo = 0.0f.xxx;
 	
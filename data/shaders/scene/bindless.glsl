@@ -0,0 +1,47 @@
+//the bindless table of the device, every texture and storage buffer is indexed with its slot
+#extension GL_EXT_nonuniform_qualifier : enable
+
+#define BINDLESS_INVALID 0xFFFFFFFFu
+
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+
+layout (set = 0, binding = 1) readonly buffer SceneBuffer
+{
+	mat4 projection;
+	mat4 view;
+	mat4 lightSpace;
+	vec4 light_pos;
+	vec3 camera_pos;
+} sceneBuffers[];
+
+layout (set = 0, binding = 1) readonly buffer LightBuffer
+{
+	vec4 light0Color;
+} lightBuffers[];
+
+struct Material
+{
+	uint baseColorTexture;
+	uint metallicRoughnessTexture;
+	uint normalTexture;
+	uint padding;
+	float baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float aoFactor;
+};
+
+layout (set = 0, binding = 1) readonly buffer MaterialBuffer
+{
+	Material materials[];
+} materialBuffers[];
+
+//the same for every geometry of a draw, so the indices are uniform
+layout (push_constant) uniform BindlessConstants
+{
+	uint material;
+	uint sceneBuffer;
+	uint lightBuffer;
+	uint materialsBuffer;
+	uint shadowmap;
+} constants;
@@ -0,0 +1,77 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : enable
+#include "bindless.glsl"
+#include "../pbr/common.glsl"
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec3 inPosition;
+layout (location = 3) in vec3 inLightPos;
+layout (location = 4) in vec3 inCamPosition;
+layout (location = 5) in vec4 inShadowCoord;
+layout (location = 6) in vec4 inTangent;
+
+layout (location = 0) out vec4 outFragColor;
+
+float textureProj(vec4 shadowCoord, vec2 off, float aoFactor)
+{
+	float shadow = 1.0;
+	if ( constants.shadowmap != BINDLESS_INVALID && shadowCoord.z > -1.0 && shadowCoord.z < 1.0 ) 
+	{
+		float dist = texture( textures[constants.shadowmap], shadowCoord.st + off ).r;
+		if ( shadowCoord.w > 0.0 && dist < shadowCoord.z ) 
+		{
+			shadow = aoFactor;
+		}
+	}
+	return shadow;
+}
+
+vec3 calculateNormal(uint normalTexture)
+{
+	vec3 N = normalize(inNormal);
+	if (normalTexture == BINDLESS_INVALID)
+		return N;
+	vec3 tangentNormal = texture(textures[normalTexture], inUV).xyz * 2.0 - 1.0;
+
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+	return normalize(TBN * tangentNormal);
+}
+
+void main() 
+{
+	Material material = materialBuffers[constants.materialsBuffer].materials[constants.material];
+
+	vec3 albedo = pow(texture(textures[material.baseColorTexture], inUV).rgb, vec3(2.2)) * material.baseColorFactor;
+	vec4 rm = texture(textures[material.metallicRoughnessTexture], inUV);
+	float roughness = rm.g * material.roughnessFactor;
+	float metallic = rm.b * material.metallicFactor;
+	
+	vec3 viewDir = normalize(inCamPosition - inPosition);
+	vec3 N = calculateNormal(material.normalTexture);
+	
+	vec3 Lo = vec3(0.0);
+	
+	//for each light
+	vec3 lightDir = normalize(inLightPos - inPosition);  
+	float distance = length(inLightPos - inPosition);
+	float attenuation = 1.0 / (distance * distance);
+	vec3 radiance = lightBuffers[constants.lightBuffer].light0Color.rgb * attenuation;
+	Lo += BRDF(lightDir, viewDir, N, albedo, metallic, roughness) * radiance;
+	
+	float shadow = textureProj(inShadowCoord / inShadowCoord.w, vec2(0.0), material.aoFactor);
+	//ambient
+	vec3 ambient = albedo * shadow;
+
+	vec3 color = ambient + Lo;
+
+	// HDR tonemapping
+	color = color / (color + vec3(1.0));
+	// gamma correct
+	color = pow(color, vec3(1.0/2.2)); 
+	
+	outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : enable
+#include "bindless.glsl"
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec4 inTangent;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) out vec3 outPos;
+layout (location = 3) out vec3 outLightPos;
+layout (location = 4) out vec3 outCamPos;
+layout (location = 5) out vec4 outShadowCoord;
+layout (location = 6) out vec4 outTangent;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	outNormal = inNormal;
+	outUV = inUV;
+	outPos = inPos;
+	outLightPos = sceneBuffers[constants.sceneBuffer].light_pos.xyz;
+	outCamPos = sceneBuffers[constants.sceneBuffer].camera_pos;
+	outShadowCoord = sceneBuffers[constants.sceneBuffer].lightSpace * vec4(inPos, 1.0);
+	outTangent = inTangent;
+	
+	gl_Position = sceneBuffers[constants.sceneBuffer].projection * sceneBuffers[constants.sceneBuffer].view * vec4(inPos.xyz, 1.0);
+}
@@ -14,11 +14,13 @@ layout (binding = 0) uniform UboView
 } ubo;
 
 layout (location = 0) out vec3 outNormal;
-layout (location = 1) out vec2 outUV;
-layout (location = 2) out vec3 outPos;
-layout (location = 3) out vec3 outLightPos;
-layout (location = 4) out vec3 outCamPos;
-layout (location = 5) out vec4 outShadowCoord;
+//no tangents, the fragment shader has the interface of the normal mapped variant
+layout (location = 1) out vec4 outTangent;
+layout (location = 2) out vec2 outUV;
+layout (location = 3) out vec3 outPos;
+layout (location = 4) out vec3 outLightPos;
+layout (location = 5) out vec3 outCamPos;
+layout (location = 6) out vec4 outShadowCoord;
 
 out gl_PerVertex {
 	vec4 gl_Position;
@@ -27,6 +29,7 @@ out gl_PerVertex {
 void main() 
 {
 	outNormal = inNormal;
+	outTangent = vec4(0.0);
 	outUV = inUV;
 	outPos = inPos;
 	outLightPos = ubo.light_pos.xyz;
@@ -3,6 +3,9 @@
 #extension GL_GOOGLE_include_directive : enable
 #include "../pbr/common.glsl"
 
+//the variants of the material, set by the pipeline
+layout (constant_id = 0) const uint NORMAL_MAP = 0u;
+
 layout(set = 0, binding = 1) uniform GlobalFragUniformBufferObject {
 	vec4 light0Color;
 } global_frag_ubo;
@@ -16,15 +19,29 @@ layout(set = 0, binding = 2) uniform FragUniformBufferObject {
 
 layout (binding = 3) uniform sampler2D albedoSampler;
 layout (binding = 4) uniform sampler2D roughnessMetalicSampler;
+//a placeholder without NORMAL_MAP
+layout (binding = 5) uniform sampler2D normalsSampler;
 
 layout (location = 0) in vec3 inNormal;
-layout (location = 1) in vec2 inUV;
-layout (location = 2) in vec3 inPosition;
-layout (location = 3) in vec3 inLightPos;
-layout (location = 4) in vec3 inCamPosition;
+layout (location = 1) in vec4 inTangent;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inPosition;
+layout (location = 4) in vec3 inLightPos;
+layout (location = 5) in vec3 inCamPosition;
 
 layout (location = 0) out vec4 outFragColor;
 
+vec3 calculateNormal()
+{
+	vec3 tangentNormal = texture(normalsSampler, inUV).xyz * 2.0 - 1.0;
+
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = normalize(cross(N, T));//cross(N, T) * inTangent.w;//normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+	return normalize(TBN * tangentNormal);
+}
+
 void main() 
 {
 	vec3 albedo = pow(texture(albedoSampler, inUV).rgb, vec3(2.2)) * frag_ubo.baseColorFactor;
@@ -33,7 +50,7 @@ void main()
 	float metallic = rm.b * frag_ubo.metallicFactor;
 	
 	vec3 viewDir = normalize(inCamPosition - inPosition);
-	vec3 N = normalize(inNormal);
+	vec3 N = NORMAL_MAP != 0 ? calculateNormal() : normalize(inNormal);
 	
 	vec3 Lo = vec3(0.0);
 	
@@ -41,7 +58,7 @@ void main()
 	vec3 lightDir = normalize(inLightPos - inPosition);  
 	float distance = length(inLightPos - inPosition);
 	float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = vec3(3.0,3.0,3.0) * attenuation;
+    vec3 radiance = (NORMAL_MAP != 0 ? global_frag_ubo.light0Color.rgb : vec3(3.0,3.0,3.0)) * attenuation;
 	Lo += BRDF(lightDir, viewDir, N, albedo, metallic, roughness) * radiance;
 	
 	//ambient
@@ -3,6 +3,9 @@
 #extension GL_GOOGLE_include_directive : enable
 #include "../pbr/common.glsl"
 
+//the variants of the material, set by the pipeline
+layout (constant_id = 0) const uint NORMAL_MAP = 0u;
+
 layout(set = 0, binding = 1) uniform GlobalFragUniformBufferObject {
 	vec4 light0Color;
 } global_frag_ubo;
@@ -16,14 +19,17 @@ layout(set = 0, binding = 2) uniform FragUniformBufferObject {
 
 layout (binding = 3) uniform sampler2D albedoSampler;
 layout (binding = 4) uniform sampler2D roughnessMetalicSampler;
-layout (binding = 5) uniform sampler2D sampleShadow;
+//a placeholder without NORMAL_MAP
+layout (binding = 5) uniform sampler2D normalsSampler;
+layout (binding = 6) uniform sampler2D sampleShadow;
 
 layout (location = 0) in vec3 inNormal;
-layout (location = 1) in vec2 inUV;
-layout (location = 2) in vec3 inPosition;
-layout (location = 3) in vec3 inLightPos;
-layout (location = 4) in vec3 inCamPosition;
-layout (location = 5) in vec4 inShadowCoord;
+layout (location = 1) in vec4 inTangent;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inPosition;
+layout (location = 4) in vec3 inLightPos;
+layout (location = 5) in vec3 inCamPosition;
+layout (location = 6) in vec4 inShadowCoord;
 
 layout (location = 0) out vec4 outFragColor;
 
@@ -41,6 +47,17 @@ float textureProj(vec4 shadowCoord, vec2 off)
 	return shadow;
 }
 
+vec3 calculateNormal()
+{
+	vec3 tangentNormal = texture(normalsSampler, inUV).xyz * 2.0 - 1.0;
+
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = normalize(cross(N, T));//cross(N, T) * inTangent.w;//normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+	return normalize(TBN * tangentNormal);
+}
+
 void main() 
 {
 	vec3 albedo = pow(texture(albedoSampler, inUV).rgb, vec3(2.2)) * frag_ubo.baseColorFactor;
@@ -49,7 +66,7 @@ void main()
 	float metallic = rm.b * frag_ubo.metallicFactor;
 	
 	vec3 viewDir = normalize(inCamPosition - inPosition);
-	vec3 N = normalize(inNormal);
+	vec3 N = NORMAL_MAP != 0 ? calculateNormal() : normalize(inNormal);
 	
 	vec3 Lo = vec3(0.0);
 	
@@ -57,12 +74,13 @@ void main()
 	vec3 lightDir = normalize(inLightPos - inPosition);  
 	float distance = length(inLightPos - inPosition);
 	float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = vec3(3.0,3.0,3.0) * attenuation;
+    vec3 radiance = (NORMAL_MAP != 0 ? global_frag_ubo.light0Color.rgb : vec3(3.0,3.0,3.0)) * attenuation;
 	Lo += BRDF(lightDir, viewDir, N, albedo, metallic, roughness) * radiance;
 	
-	float shadow = textureProj(inShadowCoord / inShadowCoord.w, vec2(0.0));
+	vec4 shadowCoord = inShadowCoord / inShadowCoord.w;
+	float shadow = textureProj(shadowCoord, vec2(0.0));
 	//ambient
-	vec3 ambient =  albedo * shadow;
+	vec3 ambient = albedo * shadow;
 
     vec3 color = ambient + Lo;
 
@@ -72,5 +90,6 @@ void main()
     color = pow(color, vec3(1.0/2.2)); 
 	
 	outFragColor = vec4(color, 1.0);
-	//outFragColor = vec4(roughness);
+	//outFragColor = vec4(inTangent.xyz, 1.0);
+	//outFragColor = vec4(inPosition, 1.0);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #version 450
 
+//the variants of the material, set by the pipeline
+layout (constant_id = 0) const uint NORMAL_MAP = 0u;
+
 layout(set = 0, binding = 1) uniform FragUniformBufferObject {
 	float baseColorFactor;
 	float metallicFactor;
@@ -9,16 +12,30 @@ layout(set = 0, binding = 1) uniform FragUniformBufferObject {
 
 layout (binding = 2) uniform sampler2D albedoSampler;
 layout (binding = 3) uniform sampler2D roughnessMetalicSampler;
+//a placeholder without NORMAL_MAP
+layout (binding = 4) uniform sampler2D normalsSampler;
 
 layout (location = 0) in vec3 inNormal;
 layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec3 inPosition;
+layout (location = 3) in vec4 inTangent;
 
 layout (location = 0) out vec4 outFragColor;
 layout (location = 1) out vec4 outFragPositions;
 layout (location = 2) out vec4 outFragNormals;
 layout (location = 3) out vec4 outFragRoughMetallic;
 
+vec3 calculateNormal()
+{
+	vec3 tangentNormal = texture(normalsSampler, inUV).xyz * 2.0 - 1.0;
+
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = normalize(cross(N, T));//cross(N, T) * inTangent.w;//normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+	return normalize(TBN * tangentNormal);
+}
+
 void main() 
 {
 	vec3 albedo = pow(texture(albedoSampler, inUV).rgb, vec3(2.2)) * frag_ubo.baseColorFactor;
@@ -26,7 +43,7 @@ void main()
 	float roughness = rm.g * frag_ubo.roughnessFactor;
 	float metallic = rm.b * frag_ubo.metallicFactor;
 	
-	vec3 N = normalize(inNormal);
+	vec3 N = NORMAL_MAP != 0 ? calculateNormal() : normalize(inNormal);
 	
 	outFragColor = vec4(albedo, 1.0);
 	outFragPositions = vec4(inPosition, 1.0);
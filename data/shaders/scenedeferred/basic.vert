@@ -14,6 +14,8 @@ layout (binding = 0) uniform UboView
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec2 outUV;
 layout (location = 2) out vec3 outPos;
+//no tangents, the fragment shader has the interface of the normal mapped variant
+layout (location = 3) out vec4 outTangent;
 
 out gl_PerVertex {
 	vec4 gl_Position;
@@ -24,6 +26,7 @@ void main()
 	outNormal = inNormal;
 	outUV = inUV;
 	outPos = inPos;
+	outTangent = vec4(0.0);
 	
 	gl_Position = ubo.projection * ubo.view * vec4(inPos.xyz, 1.0);
 }
\ No newline at end of file
@@ -1,29 +1,71 @@
 #version 450
 
-layout (binding = 1) uniform sampler2D shadowMap;
+#define SHADOW_CASCADES 4
+
+layout (binding = 1) uniform sampler2D shadowMap0;
+layout (binding = 2) uniform sampler2D shadowMap1;
+layout (binding = 3) uniform sampler2D shadowMap2;
+layout (binding = 4) uniform sampler2D shadowMap3;
+//the depth and the squared depth of every cascade, for the variance technique
+layout (binding = 6) uniform sampler2D momentsMap0;
+layout (binding = 7) uniform sampler2D momentsMap1;
+layout (binding = 8) uniform sampler2D momentsMap2;
+layout (binding = 9) uniform sampler2D momentsMap3;
 
 layout (location = 0) in vec3 inNormal;
 layout (location = 1) in vec3 inColor;
 layout (location = 2) in vec3 inViewVec;
 layout (location = 3) in vec3 inLightVec;
-layout (location = 4) in vec4 inShadowCoord;
+layout (location = 4) in vec3 inWorldPos;
 layout (location = 5) in vec2 inuv;
+layout (location = 6) in float inViewDepth;
 
-layout (binding = 2) uniform UboView 
+layout (binding = 5) uniform UboView 
 {
+	mat4 cascadeViewProj[SHADOW_CASCADES];
+	vec4 cascadeSplits;
 	int technique;
+	int showCascades;
 } ubo;
 
 layout (location = 0) out vec4 outFragColor;
 
 #define ambient 0.1
 
-float textureProj(vec4 shadowCoord, vec2 off)
+const mat4 biasMat = mat4( 
+	0.5, 0.0, 0.0, 0.0,
+	0.0, 0.5, 0.0, 0.0,
+	0.0, 0.0, 1.0, 0.0,
+	0.5, 0.5, 0.0, 1.0 );
+
+float shadowDepth(int cascade, vec2 uv)
+{
+	if (cascade == 0)
+		return texture(shadowMap0, uv).r;
+	if (cascade == 1)
+		return texture(shadowMap1, uv).r;
+	if (cascade == 2)
+		return texture(shadowMap2, uv).r;
+	return texture(shadowMap3, uv).r;
+}
+
+vec2 shadowMoments(int cascade, vec2 uv)
+{
+	if (cascade == 0)
+		return texture(momentsMap0, uv).xy;
+	if (cascade == 1)
+		return texture(momentsMap1, uv).xy;
+	if (cascade == 2)
+		return texture(momentsMap2, uv).xy;
+	return texture(momentsMap3, uv).xy;
+}
+
+float textureProj(int cascade, vec4 shadowCoord, vec2 off)
 {
 	float shadow = 1.0;
 	//if ( shadowCoord.z > -1.0 && shadowCoord.z < 1.0 ) 
 	//{
-		float dist = texture( shadowMap, shadowCoord.st + off ).r;
+		float dist = shadowDepth(cascade, shadowCoord.st + off);
 		if ( shadowCoord.w > 0.0 && dist < shadowCoord.z ) 
 		{
 			shadow = ambient;
@@ -32,29 +74,10 @@ float textureProj(vec4 shadowCoord, vec2 off)
 	return shadow;
 }
 
-float linstep(float low, float high, float v)
-{
-	return clamp((v-low)/(high-low), 0.0, 1.0);
-}
-
-float varianceshadow(vec4 shadowCoord, vec2 off)
-{
-	float lightBleedReductionAmount = 0.2;
-	float varianceMin = 0.0000002;
-	vec2 moments = texture(shadowMap, shadowCoord.st + off).xy;
-	
-	float p = step(shadowCoord.z, moments.x);
-	float variance = max(moments.y - moments.x * moments.x, varianceMin);
-	
-	float d = shadowCoord.z - moments.x;
-	float pMax = linstep(lightBleedReductionAmount, 1.0, variance / (variance + d*d));
-	
-	return min(max(p, pMax), 1.0);
-}
-
-float filterPCF(vec4 sc)
+float filterPCF(int cascade, vec4 sc)
 {
-	ivec2 texDim = textureSize(shadowMap, 0);
+	//every cascade has the same size
+	ivec2 texDim = textureSize(shadowMap0, 0);
 	float scale = 0.5;
 	float dx = scale * 1.0 / float(texDim.x);
 	float dy = scale * 1.0 / float(texDim.y);
@@ -67,7 +90,7 @@ float filterPCF(vec4 sc)
 	{
 		for (int y = -range; y <= range; y++)
 		{
-			shadowFactor += textureProj(sc, vec2(dx*x, dy*y));
+			shadowFactor += textureProj(cascade, sc, vec2(dx*x, dy*y));
 			count++;
 		}
 	
@@ -75,22 +98,55 @@ float filterPCF(vec4 sc)
 	return shadowFactor / count;
 }
 
+float linstep(float low, float high, float v)
+{
+	return clamp((v-low)/(high-low), 0.0, 1.0);
+}
+
+float varianceShadow(int cascade, vec4 shadowCoord)
+{
+	float lightBleedReductionAmount = 0.2;
+	float varianceMin = 0.0000002;
+	vec2 moments = shadowMoments(cascade, shadowCoord.st);
+	
+	float p = step(shadowCoord.z, moments.x);
+	float variance = max(moments.y - moments.x * moments.x, varianceMin);
+	
+	float d = shadowCoord.z - moments.x;
+	float pMax = linstep(lightBleedReductionAmount, 1.0, variance / (variance + d*d));
+	
+	return max(min(max(p, pMax), 1.0), ambient);
+}
+
 void main() 
 {	
-	float shadow = 0.0;
-	if(ubo.technique == 0)
+	//beyond the last cascade nothing is shadowed
+	int cascade = SHADOW_CASCADES;
+	for (int i = SHADOW_CASCADES - 1; i >= 0; i--)
 	{
-		shadow = textureProj(inShadowCoord / inShadowCoord.w, vec2(0.0));
+		if (inViewDepth < ubo.cascadeSplits[i])
+			cascade = i;
 	}
-	else
-	if(ubo.technique == 1)
-	{
-		shadow = filterPCF(inShadowCoord / inShadowCoord.w);
-	}
-	else
-	if(ubo.technique == 2)
+
+	float shadow = 1.0;
+	if (cascade < SHADOW_CASCADES)
 	{
-		shadow = varianceshadow(inShadowCoord / inShadowCoord.w, vec2(0.0));
+		//an orthographic projection, w is 1
+		vec4 shadowCoord = biasMat * ubo.cascadeViewProj[cascade] * vec4(inWorldPos, 1.0);
+		if(ubo.technique == 0)
+		{
+			shadow = textureProj(cascade, shadowCoord, vec2(0.0));
+		}
+		else
+		if(ubo.technique == 1)
+		{
+			shadow = filterPCF(cascade, shadowCoord);
+		}
+		else
+		if(ubo.technique == 2)
+		{
+			shadow = varianceShadow(cascade, shadowCoord);
+		}
 	}
 
 	vec3 N = normalize(inNormal);
@@ -99,5 +155,11 @@ void main()
 	vec3 R = normalize(-reflect(L, N));
 	vec3 diffuse = max(dot(N, L), ambient) * inColor;
 
+	if (ubo.showCascades == 1 && cascade < SHADOW_CASCADES)
+	{
+		const vec3 tints[SHADOW_CASCADES] = vec3[](vec3(1.0, 0.25, 0.25), vec3(0.25, 1.0, 0.25), vec3(0.25, 0.25, 1.0), vec3(1.0, 1.0, 0.25));
+		diffuse *= tints[cascade];
+	}
+
 	outFragColor = vec4(diffuse * shadow, 1.0);
 }
@@ -10,41 +10,37 @@ layout (binding = 0) uniform UBO
 	mat4 projection;
 	mat4 view;
 	mat4 model;
-	mat4 lightSpace;
-	vec3 lightPos;
+	vec4 lightDir;
 } ubo;
 
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec3 outViewVec;
 layout (location = 3) out vec3 outLightVec;
-layout (location = 4) out vec4 outShadowCoord;
+layout (location = 4) out vec3 outWorldPos;
 layout (location = 5) out vec2 outuv;
+layout (location = 6) out float outViewDepth;
 
 out gl_PerVertex 
 {
     vec4 gl_Position;   
 };
 
-const mat4 biasMat = mat4( 
-	0.5, 0.0, 0.0, 0.0,
-	0.0, 0.5, 0.0, 0.0,
-	0.0, 0.0, 1.0, 0.0,
-	0.5, 0.5, 0.0, 1.0 );
-
 void main() 
 {
 	outColor = inColor;
 	outNormal = inNormal;
 	outuv = inUV;
 
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPos.xyz, 1.0);
+	vec4 pos = ubo.model * vec4(inPos, 1.0);
+	vec4 viewPos = ubo.view * pos;
+	gl_Position = ubo.projection * viewPos;
 	
-    vec4 pos = ubo.model * vec4(inPos, 1.0);
     outNormal = mat3(ubo.model) * inNormal;
-    outLightVec = normalize(ubo.lightPos - inPos);
+    outLightVec = ubo.lightDir.xyz;
     outViewVec = -pos.xyz;			
 
-	outShadowCoord = ( biasMat * ubo.lightSpace * ubo.model ) * vec4(inPos, 1.0);	
+	//the cascade is picked per fragment, by the distance from the camera
+	outWorldPos = pos.xyz;
+	outViewDepth = -viewPos.z;
 }
-
@@ -8,6 +8,8 @@
 
 #include "ApplicationBase.h"
 #include "../external/imgui/imgui.h"
+#include "threadpool.hpp"
+#include <cstring>
 
 ApplicationBase::ApplicationBase(bool enableValidation)
 {
@@ -294,6 +296,8 @@ void ApplicationBase::HandleMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 	{
 		short wheelDelta = GET_WHEEL_DELTA_WPARAM(wParam);
 		zoom += (float)wheelDelta * 0.005f * zoomSpeed;
+		if (IsReplaying())
+			break;
 		if (camera.type == scene::Camera::surface)
 			camera.TranslateOnSphere(glm::vec3((float)wheelDelta * 0.0001f * camera.movementSpeed, 0.0f, 0.0f));
 		else
@@ -345,6 +349,12 @@ void ApplicationBase::HandleMouseMove(int32_t x, int32_t y)
 		return;
 	}
 
+	//the replayed path places the camera
+	if (IsReplaying()) {
+		mousePos = glm::vec2((float)x, (float)y);
+		return;
+	}
+
 	if (mouseButtons.left) {
 		rotation.x += dy * 1.25f * rotationSpeed;
 		rotation.y -= dx * 1.25f * rotationSpeed;
@@ -404,6 +414,16 @@ void ApplicationBase::UpdateOverlay()
 	ImGui::TextUnformatted(title.c_str());
 	ImGui::TextUnformatted(m_device->GetDeviceName());
 	ImGui::Text("%.2f ms/frame (%.1d fps)", (1000.0f / lastFPS), lastFPS);
+	if (!m_presentModeName.empty())
+		ImGui::Text("present mode %s", m_presentModeName.c_str());
+	ImGui::Text("%.2f ms input to present (max %.2f)", m_framePacer.GetAverageLatency(), m_framePacer.GetMaxLatency());
+	render::DescriptorStatistics descriptors = m_device->GetDescriptorStatistics();
+	if (descriptors.pools + descriptors.transientPools > 0)
+		ImGui::Text("descriptors %u pools %u sets, %u transient, %u shared", descriptors.pools + descriptors.transientPools, descriptors.sets, descriptors.transientSets, descriptors.cachedSets);
+	if (m_pipelinePrewarm.pipelines > 0)
+		ImGui::Text("%u pipelines in %.0f ms on %u threads", m_pipelinePrewarm.pipelines, m_pipelinePrewarm.milliseconds, m_pipelinePrewarm.threads);
+	if (m_simulation.IsRunning())
+		ImGui::Text("%.0f Hz simulation %s, %.2f ms/tick", 1.0f / m_simulation.GetStep(), m_simulation.IsThreaded() ? "thread" : "in frame", m_simulation.GetTickCost());
 
 	ImGui::PushItemWidth(110.0f * UIOverlay.m_scale);
 	OnUpdateUIOverlay(&UIOverlay);
@@ -422,19 +442,40 @@ void ApplicationBase::UpdateFrame()
 		viewUpdated = false;
 		ViewChanged();
 	}
+	auto tView = std::chrono::high_resolution_clock::now();
 
 	Render();
+	m_framePacer.FramePresented();
 	frameCounter++;
 	auto tEnd = std::chrono::high_resolution_clock::now();
 	auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
-	frameTimer = (float)tDiff / 1000.0f;
-	camera.Update(frameTimer);
+	//headless runs advance by the same step every frame so the frames are the same on every machine
+	frameTimer = settings.headless ? settings.benchmarkTimestep : (float)tDiff / 1000.0f;
+	if (IsReplaying())
+	{
+		//the recorded camera and the fixed step instead of the input and the measured time
+		const scene::CameraPathFrame& replayed = m_cameraReplay.m_frames[m_replayFrame];
+		frameTimer = settings.replayRecordedTime ? replayed.frameTime : settings.benchmarkTimestep;
+		paused = (replayed.flags & scene::CAMERA_PATH_PAUSED) != 0;
+		scene::CameraState previous = camera.GetState();
+		m_cameraReplay.Apply(m_replayFrame++, camera);
+		scene::CameraState current = camera.GetState();
+		if (memcmp(&previous, &current, sizeof(scene::CameraState)) != 0)
+			viewUpdated = true;
+		if (!IsReplaying())
+			std::cout << "Replay of " << settings.replayPath << " finished after " << m_replayFrame << " frames" << std::endl;
+	}
+	else
+		camera.Update(frameTimer);
+	if (!settings.recordPath.empty())
+		m_cameraRecording.Record(camera, frameTimer, paused);
 
 	if (camera.moving())
 	{
 		viewUpdated = true;
 	}
 	// Convert to clamped timer value
+	m_simulation.SetPaused(paused);
 	if (!paused)
 	{
 		timer += timerSpeed * frameTimer;
@@ -442,13 +483,15 @@ void ApplicationBase::UpdateFrame()
 		{
 			timer -= 1.0f;
 		}
+		m_simulation.Advance(frameTimer);
 		update(frameTimer);
 	}
+	auto tUpdate = std::chrono::high_resolution_clock::now();
 	float fpsTimer = (float)(std::chrono::duration<double, std::milli>(tEnd - lastTimestamp).count());
 	if (fpsTimer > 1000.0f)
 	{
 		lastFPS = static_cast<uint32_t>((float)frameCounter * (1000.0f / fpsTimer));
-		if (!settings.overlay)
+		if (!settings.overlay && !settings.headless)
 		{
 			std::string windowTitle = title + " - " + std::to_string(frameCounter) + " fps";
 			SetWindowText(window, windowTitle.c_str());
@@ -458,6 +501,19 @@ void ApplicationBase::UpdateFrame()
 	}
 	// TODO: Cap UI overlay update rates
 	UpdateOverlay();
+
+	if (settings.headless)
+	{
+		auto tOverlay = std::chrono::high_resolution_clock::now();
+		scene::FrameRecord record;
+		record.frameTime = (float)std::chrono::duration<double, std::milli>(tOverlay - tStart).count();
+		record.phases[scene::PHASE_VIEW] = (float)std::chrono::duration<double, std::milli>(tView - tStart).count();
+		record.phases[scene::PHASE_RENDER] = (float)std::chrono::duration<double, std::milli>(tEnd - tView).count();
+		record.phases[scene::PHASE_UPDATE] = (float)std::chrono::duration<double, std::milli>(tUpdate - tEnd).count();
+		record.phases[scene::PHASE_OVERLAY] = (float)std::chrono::duration<double, std::milli>(tOverlay - tUpdate).count();
+		record.commands = m_frameCommandStatistics;
+		m_profiler.AddFrame(record);
+	}
 }
 
 void ApplicationBase::DrawUI(render::CommandBuffer* commandBuffer)
@@ -473,10 +529,13 @@ void ApplicationBase::MainLoop()
 	destWidth = width;
 	destHeight = height;
 	lastTimestamp = std::chrono::high_resolution_clock::now();
+	m_framePacer.SetTargetRate(settings.frameRateLimit);
 #if defined(_WIN32)
 	MSG msg;
 	bool quitMessageReceived = false;
 	while (!quitMessageReceived) {
+		//sleep before reading the input so the frame is recorded with the newest one
+		m_framePacer.Wait();
 		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
@@ -486,9 +545,177 @@ void ApplicationBase::MainLoop()
 			}
 		}
 		if (!IsIconic(window)) {
+			m_framePacer.InputSampled();
 			UpdateFrame();
 		}
 	}
 #endif
+	m_simulation.Stop();
 	WaitForDevice();
-}
\ No newline at end of file
+	SaveCameraRecording();
+}
+
+void ApplicationBase::ParseCommandLine(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-validation")
+			settings.validation = true;
+		else if (arg == "-fullscreen")
+			settings.fullscreen = true;
+		else if (arg == "-vsync")
+		{
+			settings.vsync = true;
+			settings.presentPolicy = scene::PRESENT_POLICY_VSYNC;
+		}
+		else if (arg == "-present" && hasValue)
+		{
+			std::string policy = argv[++i];
+			if (policy == "vsync")
+				settings.presentPolicy = scene::PRESENT_POLICY_VSYNC;
+			else if (policy == "balanced")
+				settings.presentPolicy = scene::PRESENT_POLICY_BALANCED;
+			else if (policy == "lowlatency")
+				settings.presentPolicy = scene::PRESENT_POLICY_LOW_LATENCY;
+			else
+				std::cerr << "Unknown present policy " << policy << std::endl;
+			settings.vsync = settings.presentPolicy == scene::PRESENT_POLICY_VSYNC;
+		}
+		else if (arg == "-fpslimit" && hasValue)
+			settings.frameRateLimit = std::max((float)atof(argv[++i]), 0.0f);
+		else if (arg == "-width" && hasValue)
+			width = std::max(atoi(argv[++i]), 1);
+		else if (arg == "-height" && hasValue)
+			height = std::max(atoi(argv[++i]), 1);
+		else if (arg == "-framesinflight" && hasValue)
+			settings.framesInFlight = std::max(atoi(argv[++i]), 1);
+		else if (arg == "-headless")
+			settings.headless = true;
+		else if (arg == "-frames" && hasValue)
+			settings.benchmarkFrames = std::max(atoi(argv[++i]), 1);
+		else if (arg == "-warmup" && hasValue)
+			settings.benchmarkWarmup = std::max(atoi(argv[++i]), 0);
+		else if (arg == "-timestep" && hasValue)
+			settings.benchmarkTimestep = (float)atof(argv[++i]);
+		else if (arg == "-report" && hasValue)
+			settings.benchmarkReport = argv[++i];
+		else if (arg == "-record" && hasValue)
+			settings.recordPath = argv[++i];
+		else if (arg == "-replay" && hasValue)
+			settings.replayPath = argv[++i];
+		else if (arg == "-recordedtime")
+			settings.replayRecordedTime = true;
+		else if (arg == "-simsync")
+			settings.simulationThread = false;
+		else if (arg == "-bindless")
+			settings.bindless = true;
+		else
+			std::cerr << "Unknown command line argument " << arg << std::endl;
+	}
+	if (settings.headless)
+	{
+		//the same frames on every run, nothing is presented
+		settings.fullscreen = false;
+		settings.vsync = false;
+	}
+	if (!settings.replayPath.empty())
+	{
+		if (!m_cameraReplay.Load(settings.replayPath))
+			std::cerr << "Could not read the camera path " << settings.replayPath << std::endl;
+		else if (m_cameraReplay.m_cameraType != camera.type)
+		{
+			//its frames would place this camera wrong, the run goes on without a replay
+			std::cerr << "The camera path " << settings.replayPath << " was recorded with another camera type, it is not replayed" << std::endl;
+			m_cameraReplay.Clear();
+		}
+	}
+	if (settings.benchmarkTimestep <= 0.0f)
+		settings.benchmarkTimestep = 1.0f / 60.0f;
+	destWidth = width;
+	destHeight = height;
+	camera.UpdateAspectRatio((float)width / (float)height);
+}
+
+void ApplicationBase::UpdateBenchmarkCamera(uint32_t frame, uint32_t frameCount)
+{
+	float turn = 360.0f * (float)frame / (float)std::max(frameCount, 1u);
+	camera.SetRotation(m_benchmarkStartRotation + glm::vec3(0.0f, turn, 0.0f));
+	viewUpdated = true;
+}
+
+void ApplicationBase::BenchmarkLoop()
+{
+	prepared = true;
+	destWidth = width;
+	destHeight = height;
+	lastTimestamp = std::chrono::high_resolution_clock::now();
+	m_benchmarkStartRotation = camera.GetRotation();
+
+	//a replayed path is the whole run, its first frames are the warmup
+	bool replaying = IsReplaying();
+	uint32_t frameCount = settings.benchmarkWarmup + settings.benchmarkFrames;
+	uint32_t warmup = settings.benchmarkWarmup;
+	if (replaying)
+	{
+		frameCount = m_cameraReplay.GetFrameCount();
+		warmup = std::min(warmup, frameCount - 1);
+	}
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		if (frame == warmup)
+			m_profiler.Clear();
+		if (!replaying)
+			UpdateBenchmarkCamera(frame, frameCount);
+		UpdateFrame();
+	}
+	m_simulation.Stop();
+	WaitForDevice();
+	SaveCameraRecording();
+
+	if (!m_profiler.WriteReport(settings.benchmarkReport, title, m_device->GetDeviceName(), width, height, settings.benchmarkTimestep))
+	{
+		std::cerr << "Could not write the benchmark report " << settings.benchmarkReport << std::endl;
+		return;
+	}
+	std::vector<float> frameTimes;
+	for (const scene::FrameRecord& record : m_profiler.m_frames)
+		frameTimes.push_back(record.frameTime);
+	std::cout << title << ": " << frameTimes.size() << " frames, p50 " << scene::FrameProfiler::Percentile(frameTimes, 50.0f)
+		<< " ms, p99 " << scene::FrameProfiler::Percentile(frameTimes, 99.0f) << " ms, report written to " << settings.benchmarkReport << std::endl;
+}
+
+void ApplicationBase::StartSimulation(float ticksPerSecond)
+{
+	//the thread follows the wall clock, the benchmark and the replay have to advance by the frame times
+	bool threaded = settings.simulationThread && !settings.headless && !IsReplaying();
+	m_simulation.Start(1.0f / std::max(ticksPerSecond, 1.0f), [this](float dt, double time) { simulate(dt, time); }, threaded);
+}
+
+void ApplicationBase::CompilePipelines()
+{
+	ThreadPool threadPool;
+	threadPool.setThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+	uint32_t lastPercent = 0;
+	//called from the threads of the pool, one at a time
+	m_pipelinePrewarm = m_device->CompilePipelines(&threadPool, [&lastPercent](uint32_t compiled, uint32_t count) {
+		uint32_t percent = compiled * 100 / count;
+		if (percent / 10 != lastPercent / 10 || compiled == count)
+			std::cout << "\rCompiling pipelines " << compiled << "/" << count << std::flush;
+		lastPercent = percent;
+	});
+	if (m_pipelinePrewarm.pipelines > 0)
+		std::cout << "\r" << m_pipelinePrewarm.pipelines << " pipelines compiled in " << m_pipelinePrewarm.milliseconds << " ms on " << m_pipelinePrewarm.threads
+			<< " threads, " << m_pipelinePrewarm.compileMilliseconds << " ms of compiling" << std::endl;
+}
+
+void ApplicationBase::SaveCameraRecording()
+{
+	if (settings.recordPath.empty())
+		return;
+	if (m_cameraRecording.Save(settings.recordPath))
+		std::cout << "Camera path of " << m_cameraRecording.GetFrameCount() << " frames written to " << settings.recordPath << std::endl;
+	else
+		std::cerr << "Could not write the camera path " << settings.recordPath << std::endl;
+}
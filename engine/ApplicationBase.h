@@ -19,10 +19,15 @@
 #include <string>
 #include <array>
 #include <numeric>
+#include <assert.h>
 
 #include "render/GraphicsDevice.h"
 #include "scene/Camera.h"
 #include "scene/UIOverlay.h"
+#include "scene/FrameProfiler.h"
+#include "scene/CameraPath.h"
+#include "scene/FramePacer.h"
+#include "scene/SimulationLoop.h"
 
 using namespace engine;
 
@@ -60,6 +65,35 @@ protected:
 	//std::vector<Geometry *> m_geometries;
 	// Active frame buffer index
 	uint32_t currentBuffer = 0;
+	// Slot of the frame being recorded, the resources of a slot are reused once its previous frame finished on the GPU
+	uint32_t m_currentFrame = 0;
+	uint32_t m_framesInFlight = 1;
+
+	// Commands of the buffers submitted by the last Render, for the benchmark report
+	render::CommandStatistics m_frameCommandStatistics;
+	scene::FrameProfiler m_profiler;
+	glm::vec3 m_benchmarkStartRotation = glm::vec3(0.0f);
+
+	// Camera path written by -record and the one played back by -replay
+	scene::CameraPath m_cameraRecording;
+	scene::CameraPath m_cameraReplay;
+	uint32_t m_replayFrame = 0;
+
+	// Frame limiter and input to present latency, the backends set the name of the present mode they picked
+	scene::FramePacer m_framePacer;
+	std::string m_presentModeName;
+
+	// Fixed step simulation started by the examples that override simulate
+	scene::SimulationLoop m_simulation;
+
+	/** @brief Runs simulate at a fixed rate, on its own thread unless -simsync is set or the run has to be the same every time (headless, replay) */
+	void StartSimulation(float ticksPerSecond);
+
+	// Pipelines the loaders recorded after BeginPipelinePrewarm and compiled together by CompilePipelines
+	render::PipelinePrewarmStatistics m_pipelinePrewarm;
+
+	/** @brief Compiles the recorded pipelines with one thread per core into the pipeline cache, the progress goes to the console */
+	void CompilePipelines();
 public: 
 	bool prepared = false;
 	uint32_t width = 1280;
@@ -78,8 +112,34 @@ public:
 		bool fullscreen = false;
 		/** @brief Set to true if v-sync will be forced for the swapchain */
 		bool vsync = false;
+		/** @brief Latency against tearing when picking the present mode, set by -present vsync|balanced|lowlatency, -vsync picks vsync */
+		scene::PresentPolicy presentPolicy = scene::PRESENT_POLICY_BALANCED;
+		/** @brief Frames per second the main loop sleeps to, 0 for no limit, set by -fpslimit */
+		float frameRateLimit = 0.0f;
 		/** @brief Enable UI overlay */
 		bool overlay = false;
+		/** @brief Frames the CPU can record while the GPU renders the previous ones, set by -framesinflight */
+		uint32_t framesInFlight = 2;
+		/** @brief Set by the projects that keep one copy per frame slot of every buffer and set they write each frame,
+		 *  the others render one frame at a time so the GPU never reads a uniform buffer the CPU is writing */
+		bool frameResourcesPerSlot = false;
+		/** @brief Render offscreen without a window, run a fixed number of frames and write a report, set by -headless */
+		bool headless = false;
+		/** @brief Frames of the headless run, the warmup frames are not in the report */
+		uint32_t benchmarkFrames = 600;
+		uint32_t benchmarkWarmup = 10;
+		/** @brief Simulation step of every headless frame in seconds, instead of the measured frame time */
+		float benchmarkTimestep = 1.0f / 60.0f;
+		std::string benchmarkReport = "benchmark.json";
+		/** @brief Camera path files, -record writes the camera and the frame times of the run, -replay plays them back with the fixed timestep */
+		std::string recordPath;
+		std::string replayPath;
+		/** @brief Replay with the recorded frame times instead of the fixed timestep, set by -recordedtime */
+		bool replayRecordedTime = false;
+		/** @brief Simulate on a thread next to the render loop, -simsync runs the ticks on the render thread before update */
+		bool simulationThread = true;
+		/** @brief Create the device with one global table of textures and storage buffers that the materials index, set by -bindless */
+		bool bindless = false;
 	} settings;
 
 	float zoom = 0;
@@ -121,8 +181,8 @@ public:
 
 	// OS specific 
 #if defined(_WIN32)
-	HWND window;
-	HINSTANCE windowInstance;
+	HWND window = NULL;
+	HINSTANCE windowInstance = NULL;
 #endif
 
 	// Default ctor
@@ -130,6 +190,10 @@ public:
 
 	virtual bool InitAPI() = 0;
 
+	/** @brief -validation, -fullscreen, -vsync, -present POLICY, -fpslimit FPS, -width N, -height N, -framesinflight N, the headless benchmark: -headless, -frames N, -warmup N, -timestep SECONDS, -report PATH
+	 *  the camera paths: -record PATH, -replay PATH, -recordedtime, the simulation thread: -simsync, the bindless table: -bindless */
+	void ParseCommandLine(int argc, char** argv);
+
 #if defined(_WIN32)
 	void SetupConsole(std::string title);
 	HWND SetupWindow(HINSTANCE hinstance, WNDPROC wndproc);
@@ -145,6 +209,9 @@ public:
 	virtual void Render() = 0;
 
 	virtual void update(float dt) = 0;
+	/** @brief (Virtual) One fixed step of the simulation started by StartSimulation, called from the simulation thread when there is one,
+	 *  time is the simulation time at the end of the step. The state is handed to the renderer with scene::SimulationSnapshots */
+	virtual void simulate(float dt, double time) {};
 	// Called when view change occurs
 	// Can be overriden in derived class to e.g. update uniform buffers 
 	// Containing view dependant matrices
@@ -173,9 +240,32 @@ public:
 	// Start the main render loop
 	void MainLoop();
 
+	// Render the headless frames with the fixed timestep and write the report
+	void BenchmarkLoop();
+
+	/** @brief (Virtual) Camera of a headless frame, by default one turn around the up axis from the starting rotation over the run */
+	virtual void UpdateBenchmarkCamera(uint32_t frame, uint32_t frameCount);
+
+	/** @brief True while the frames of the -replay path are played, the live input does not move the camera */
+	bool IsReplaying() const { return m_replayFrame < m_cameraReplay.GetFrameCount(); }
+
+	// Write the -record path at the end of the run
+	void SaveCameraRecording();
+
 	// Render one frame of a render loop on platforms that sync rendering
 	virtual void UpdateFrame();
 
+	/** @brief Slot of the frame being recorded and the number of slots, resources written every frame need one copy per slot */
+	uint32_t GetFrameIndex() const { return m_currentFrame; }
+	uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+	/** @brief The copy of a per frame resource that belongs to the frame being recorded */
+	template <class T>
+	T& GetFrameResource(std::vector<T>& resources) const
+	{
+		assert(resources.size() == m_framesInFlight);
+		return resources[m_currentFrame];
+	}
+
 	virtual void UpdateOverlay();
 
 	virtual void WaitForDevice() = 0;
@@ -218,10 +308,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int)									\
 {																									\
 	vulkanExample = new VulkanExample();															\
-	vulkanExample->SetupWindow(hInstance, WndProc);													\
-	vulkanExample->InitAPI();																	\
+	vulkanExample->ParseCommandLine(__argc, __argv);												\
+	if (vulkanExample->settings.headless)															\
+	{																								\
+		if (!vulkanExample->settings.validation)													\
+			vulkanExample->SetupConsole(vulkanExample->title);										\
+		vulkanExample->windowInstance = hInstance;													\
+	}																								\
+	else																							\
+		vulkanExample->SetupWindow(hInstance, WndProc);												\
+	if (!vulkanExample->InitAPI())																	\
+		return 1;																					\
 	vulkanExample->Prepare();																		\
-	vulkanExample->MainLoop();																	\
+	if (vulkanExample->settings.headless)															\
+		vulkanExample->BenchmarkLoop();																\
+	else																							\
+		vulkanExample->MainLoop();																	\
 	delete(vulkanExample);																			\
 	_CrtDumpMemoryLeaks();																			\
 	return 0;																						\
@@ -122,6 +122,11 @@ bool D3D12Application::InitAPI()
 
 	ComPtr<IDXGIAdapter1> hardwareAdapter;
 	GetHardwareAdapter(factory.Get(), &hardwareAdapter);
+	if (hardwareAdapter.Get() == nullptr && settings.headless)
+	{
+		//machines without a gpu render the headless runs with the software adapter
+		ThrowIfFailed(factory->EnumWarpAdapter(IID_PPV_ARGS(&hardwareAdapter)));
+	}
 
 	ThrowIfFailed(D3D12CreateDevice(
 		hardwareAdapter.Get(),
@@ -148,21 +153,45 @@ bool D3D12Application::InitAPI()
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 	swapChainDesc.SampleDesc.Count = 1;
 
-	ComPtr<IDXGISwapChain1> swapChain;
-	ThrowIfFailed(factory->CreateSwapChainForHwnd(
-		m_commandQueue.Get(),        // Swap chain needs the queue so that it can force a flush on it.
-		window,
-		&swapChainDesc,
-		nullptr,
-		nullptr,
-		&swapChain
-	));
+	//flip model presents with sync interval 0 replace the queued frame without tearing, tearing needs the flag on the swap chain too
+	BOOL allowTearing = FALSE;
+	ComPtr<IDXGIFactory5> factory5;
+	if (SUCCEEDED(factory.As(&factory5)) && FAILED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))))
+		allowTearing = FALSE;
+	m_syncInterval = settings.presentPolicy == scene::PRESENT_POLICY_VSYNC ? 1 : 0;
+	m_presentModeName = m_syncInterval == 1 ? "VSYNC" : "SYNC INTERVAL 0";
+	if (allowTearing)
+	{
+		swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+		if (settings.presentPolicy == scene::PRESENT_POLICY_LOW_LATENCY)
+		{
+			m_presentFlags = DXGI_PRESENT_ALLOW_TEARING;
+			m_presentModeName = "ALLOW TEARING";
+		}
+	}
 
-	// This sample does not support fullscreen transitions.
-	ThrowIfFailed(factory->MakeWindowAssociation(window, DXGI_MWA_NO_ALT_ENTER));
+	if (!settings.headless)
+	{
+		ComPtr<IDXGISwapChain1> swapChain;
+		ThrowIfFailed(factory->CreateSwapChainForHwnd(
+			m_commandQueue.Get(),        // Swap chain needs the queue so that it can force a flush on it.
+			window,
+			&swapChainDesc,
+			nullptr,
+			nullptr,
+			&swapChain
+		));
 
-	ThrowIfFailed(swapChain.As(&m_swapChain));
-	currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
+		// This sample does not support fullscreen transitions.
+		ThrowIfFailed(factory->MakeWindowAssociation(window, DXGI_MWA_NO_ALT_ENTER));
+
+		ThrowIfFailed(swapChain.As(&m_swapChain));
+		currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
+	}
+	else
+	{
+		currentBuffer = 0;
+	}
 
 	// Create descriptor heaps.
 	{
@@ -191,7 +220,23 @@ bool D3D12Application::InitAPI()
 		// Create a RTV for each frame.
 		for (UINT n = 0; n < FrameCount; n++)
 		{
-			ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
+			if (settings.headless)
+			{
+				//offscreen targets in the state the main pass expects the back buffers in
+				D3D12_CLEAR_VALUE clearValue = {};
+				clearValue.Format = swapChainDesc.Format;
+				clearValue.Color[0] = clearValue.Color[1] = clearValue.Color[2] = 0.5f;//the clear color of the main pass
+				ThrowIfFailed(m_d3ddevice->CreateCommittedResource(
+					&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+					D3D12_HEAP_FLAG_NONE,
+					&CD3DX12_RESOURCE_DESC::Tex2D(swapChainDesc.Format, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET),
+					D3D12_RESOURCE_STATE_PRESENT,
+					&clearValue,
+					IID_PPV_ARGS(&m_renderTargets[n])
+				));
+			}
+			else
+				ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
 			m_d3ddevice->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
 			frameBuffersHandles.push_back(rtvHandle);
 			rtvHandle.Offset(1, m_rtvDescriptorSize);
@@ -323,7 +368,8 @@ void D3D12Application::WaitForPreviousFrame()
 		WaitForSingleObject(m_fenceEvent, INFINITE);
 	}
 
-	currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
+	if (!settings.headless)
+		currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
 }
 
 void D3D12Application::Render()
@@ -338,10 +384,16 @@ void D3D12Application::Render()
 	//ID3D12CommandList* ppCommandLists[] = { ((render::D3D12CommandBuffer*)m_drawCommandBuffers[currentBuffer])->m_commandList.Get()};
 	//m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 	
+	m_frameCommandStatistics = render::CommandStatistics();
+	for (auto commandBuffer : m_allDrawCommandBuffers[currentBuffer])
+		m_frameCommandStatistics += commandBuffer->m_statistics;
 	m_commandQueue->ExecuteCommandLists(alld3dDrawCommandLists[currentBuffer].size(), alld3dDrawCommandLists[currentBuffer].data());
 
 	// Present the frame.
-	ThrowIfFailed(m_swapChain->Present(1, 0));
+	if (settings.headless)
+		currentBuffer = (currentBuffer + 1) % FrameCount;
+	else
+		ThrowIfFailed(m_swapChain->Present(m_syncInterval, m_presentFlags));
 
 	WaitForPreviousFrame();
 
@@ -402,6 +454,8 @@ std::vector<render::CommandBuffer*> D3D12Application::CreateCommandBuffers()
 {
 	if (alld3dDrawCommandLists.size() == 0)
 		alld3dDrawCommandLists.resize(FrameCount);
+	if (m_allDrawCommandBuffers.size() == 0)
+		m_allDrawCommandBuffers.resize(FrameCount);
 	
 	std::vector<render::CommandBuffer*> returnvec;
 	returnvec.resize(FrameCount);
@@ -409,6 +463,7 @@ std::vector<render::CommandBuffer*> D3D12Application::CreateCommandBuffers()
 	{
 		returnvec[i] = m_device->GetCommandBuffer(primaryCmdPool);
 		alld3dDrawCommandLists[i].push_back(((D3D12CommandBuffer*)returnvec[i])->m_commandList.Get());
+		m_allDrawCommandBuffers[i].push_back(returnvec[i]);
 	}
 	return returnvec;
 }
@@ -507,12 +562,14 @@ void D3D12Application::DrawFullScreenQuad(render::CommandBuffer* commandBuffer)
 {
 	ID3D12GraphicsCommandList* cmdList = ((render::D3D12CommandBuffer*)commandBuffer)->m_commandList.Get();
 	cmdList->DrawInstanced(3, 1, 0, 0);
+	commandBuffer->m_statistics.draws++;
 }
 
 void D3D12Application::DispatchCompute(render::CommandBuffer* commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
 	ID3D12GraphicsCommandList* cmdList = ((render::D3D12CommandBuffer*)commandBuffer)->m_commandList.Get();
 	cmdList->Dispatch(groupCountX, groupCountY, groupCountZ);
+	commandBuffer->m_statistics.dispatches++;
 }
 
 const std::string D3D12Application::GetShadersPath()
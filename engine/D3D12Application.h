@@ -23,6 +23,9 @@ private:
 protected:
 	static const UINT FrameCount = 2;
 	Microsoft::WRL::ComPtr<IDXGISwapChain3> m_swapChain;
+	// Present arguments of the present policy
+	UINT m_syncInterval = 1;
+	UINT m_presentFlags = 0;
 	Microsoft::WRL::ComPtr<ID3D12Device> m_d3ddevice;
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_depthStencil;
@@ -15,12 +15,16 @@ VkResult VulkanApplication::CreateInstance(bool enableValidation)
 	appInfo.pEngineName = name.c_str();
 	appInfo.apiVersion = apiVersion;
 
-	std::vector<const char*> instanceExtensions = { VK_KHR_SURFACE_EXTENSION_NAME };
+	std::vector<const char*> instanceExtensions;
 
-	// Enable surface extensions depending on os
+	// Enable surface extensions depending on os, headless runs have no surface
+	if (!settings.headless)
+	{
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #if defined(_WIN32)
-	instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #endif
+	}
 
 	if (enabledInstanceExtensions.size() > 0) {
 		for (auto enabledExtension : enabledInstanceExtensions) {
@@ -32,12 +36,12 @@ VkResult VulkanApplication::CreateInstance(bool enableValidation)
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pNext = NULL;
 	instanceCreateInfo.pApplicationInfo = &appInfo;
+	if (settings.validation)
+	{
+		instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	}
 	if (instanceExtensions.size() > 0)
 	{
-		if (settings.validation)
-		{
-			instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-		}
 		instanceCreateInfo.enabledExtensionCount = (uint32_t)instanceExtensions.size();
 		instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions.data();
 	}
@@ -71,7 +75,40 @@ VkResult VulkanApplication::CreateInstance(bool enableValidation)
 
 void VulkanApplication::SetupSwapChain()
 {
-	swapChain.Create(vulkanDevice->physicalDevice, vulkanDevice->logicalDevice, &width, &height, vulkanDevice->queueFamilyIndices.graphicsFamily, vulkanDevice->queueFamilyIndices.presentFamily, settings.vsync);
+	if (settings.headless)
+	{
+		SetupHeadlessTargets();
+		return;
+	}
+	//FIFO is the fallback of every policy
+	std::vector<VkPresentModeKHR> presentModes;
+	if (settings.presentPolicy == scene::PRESENT_POLICY_BALANCED)
+		presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+	else if (settings.presentPolicy == scene::PRESENT_POLICY_LOW_LATENCY)
+		presentModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+	swapChain.Create(vulkanDevice->physicalDevice, vulkanDevice->logicalDevice, &width, &height, vulkanDevice->queueFamilyIndices.graphicsFamily, vulkanDevice->queueFamilyIndices.presentFamily, presentModes);
+	m_presentModeName = engine::tools::presentModeString(swapChain.m_presentMode);
+}
+
+void VulkanApplication::SetupHeadlessTargets()
+{
+	//offscreen images stand in for the swap chain images, the render pass and the frame buffers use their views the same way
+	for (auto target : m_headlessTargets)
+		vulkanDevice->DestroyTexture(target);
+	m_headlessTargets.clear();
+	swapChain.m_surfaceFormat.format = VK_FORMAT_B8G8R8A8_UNORM;
+	swapChain.m_surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+	swapChain.swapChainExtent = { width, height };
+	swapChain.swapChainImageViews.clear();
+	swapChain.m_images.clear();
+	for (uint32_t i = 0; i < HEADLESS_FRAMES; i++)
+	{
+		render::VulkanTexture* target = vulkanDevice->GetRenderTarget(width, height, swapChain.m_surfaceFormat.format,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		m_headlessTargets.push_back(target);
+		swapChain.swapChainImageViews.push_back(target->m_descriptor.imageView);
+		swapChain.m_images.push_back(target->m_vkImage);
+	}
 }
 
 void VulkanApplication::CreateCommandPool()
@@ -91,6 +128,8 @@ std::vector<render::CommandBuffer*> VulkanApplication::CreateCommandBuffers()
 		return returnvec;
 	if (allvkDrawCommandBuffers.size() == 0)
 		allvkDrawCommandBuffers.resize(swapChain.swapChainImageViews.size());
+	if (m_allDrawCommandBuffers.size() == 0)
+		m_allDrawCommandBuffers.resize(swapChain.swapChainImageViews.size());
 
 	//drawCommandBuffers = vulkanDevice->CreatedrawCommandBuffers(swapChain.swapChainImageViews.size(), vulkanDevice->queueFamilyIndices.graphicsFamily);
 	for (int i = 0; i < swapChain.swapChainImageViews.size(); i++)
@@ -99,6 +138,7 @@ std::vector<render::CommandBuffer*> VulkanApplication::CreateCommandBuffers()
 		//drawCommandBuffers.push_back(vulkanBuffer->m_vkCommandBuffer);
 		returnvec.push_back(vulkanBuffer);
 		allvkDrawCommandBuffers[i].push_back(vulkanBuffer->m_vkCommandBuffer);
+		m_allDrawCommandBuffers[i].push_back(vulkanBuffer);
 	}
 	return returnvec;
 }
@@ -131,13 +171,16 @@ void VulkanApplication::SetupFrameBuffer()
 
 void VulkanApplication::SetupRenderPass()
 {
-	mainRenderPass = vulkanDevice->GetRenderPass({ {swapChain.m_surfaceFormat.format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR}, {depthFormat, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL} });
+	//the headless targets are left ready to be copied out
+	VkImageLayout finalLayout = settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	mainRenderPass = vulkanDevice->GetRenderPass({ {swapChain.m_surfaceFormat.format, finalLayout}, {depthFormat, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL} });
 	m_mainRenderPass = mainRenderPass;
 }
 
 void VulkanApplication::CreatePipelineCache()
 {
-	pipelineCache = vulkanDevice->CreatePipelineCache();
+	//kept between runs, the pipelines of the last run are not compiled again
+	pipelineCache = vulkanDevice->CreatePipelineCache(name + ".pipelinecache");
 }
 
 bool VulkanApplication::InitAPI()
@@ -162,7 +205,8 @@ bool VulkanApplication::InitAPI()
 	}
 
 	//initSwapchain();
-	swapChain.InitSurface(instance, windowInstance, window);
+	if (!settings.headless)
+		swapChain.InitSurface(instance, windowInstance, window);
 
 	// Derived examples can override this to set actual features (based on above readings) to enable for logical device creation
 	GetEnabledFeatures();
@@ -170,8 +214,9 @@ bool VulkanApplication::InitAPI()
 	// Vulkan device creation
 	// This is handled by a separate class that gets a logical device representation
 	// and encapsulates functions related to a device
-	enabledDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-	vulkanDevice = new engine::render::VulkanDevice(instance, &enabledFeatures, enabledDeviceExtensions, swapChain.surface, deviceCreatepNextChain);
+	if (!settings.headless)
+		enabledDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	vulkanDevice = new engine::render::VulkanDevice(instance, &enabledFeatures, enabledDeviceExtensions, swapChain.surface, deviceCreatepNextChain, settings.bindless);
 	m_device = vulkanDevice;
 
 	device = vulkanDevice->logicalDevice;
@@ -225,22 +270,34 @@ bool VulkanApplication::InitAPI()
 	SetupRenderPass();
 	CreatePipelineCache();
 	SetupFrameBuffer();
+	SetupFrameSync();
 
-	presentCompleteSemaphores.resize(swapChain.swapChainImageViews.size());
-	renderCompleteSemaphores.resize(swapChain.swapChainImageViews.size());
-	for (int i = 0; i < swapChain.swapChainImageViews.size(); i++)
+	return true;
+}
+
+void VulkanApplication::SetupFrameSync()
+{
+	//the frame slots do not depend on how many images the swap chain has
+	if (submitFences.empty())
 	{
-		presentCompleteSemaphores[i] = vulkanDevice->GetSemaphore();
-		renderCompleteSemaphores[i] = vulkanDevice->GetSemaphore();
+		m_framesInFlight = settings.frameResourcesPerSlot ? settings.framesInFlight : 1;
+		for (uint32_t i = 0; i < m_framesInFlight; i++)
+		{
+			presentCompleteSemaphores.push_back(vulkanDevice->GetSemaphore());
+			submitFences.push_back(vulkanDevice->GetSignaledFence());
+			m_frameCommandBuffers.push_back(vulkanDevice->GetCommandBuffer(primaryCmdPool));
+		}
 	}
 
-	submitFences.resize(swapChain.swapChainImageViews.size());
-	for (int i = 0; i < submitFences.size(); i++)
+	size_t imageCount = swapChain.swapChainImageViews.size();
+	while (renderCompleteSemaphores.size() > imageCount)
 	{
-		submitFences[i] = vulkanDevice->GetSignaledFence();
+		vulkanDevice->DestroySemaphore(renderCompleteSemaphores.back());
+		renderCompleteSemaphores.pop_back();
 	}
-
-	return true;
+	while (renderCompleteSemaphores.size() < imageCount)
+		renderCompleteSemaphores.push_back(vulkanDevice->GetSemaphore());
+	m_imageFences.assign(imageCount, VK_NULL_HANDLE);
 }
 
 //void VulkanApplication::PrepareUI()
@@ -297,7 +354,7 @@ void VulkanApplication::UpdateOverlay()
 	ApplicationBase::UpdateOverlay();
 
 	if(UIOverlay.shouldRecreateBuffers())
-		vkWaitForFences(device, submitFences.size(), submitFences.data(), VK_TRUE, UINT64_MAX);
+		WaitForFramesInFlight();
 
 	if (UIOverlay.update() || UIOverlay.m_updated) {		
 		BuildCommandBuffers();
@@ -317,46 +374,111 @@ void VulkanApplication::Render()
 	if (!prepared)
 		return;
 
-	vkWaitForFences(device, 1, &submitFences[currentBuffer], VK_TRUE, UINT64_MAX);
+	if (!BeginFrame())
+		return;
+
+	//std::vector<VkCommandBuffer> submitCommandBuffers(allDrawCommandBuffers.size());//TODO make them [cb][i]
+	//for (int i = 0; i < allDrawCommandBuffers.size(); i++)
+	//{
+	//	submitCommandBuffers[i] = allDrawCommandBuffers[i][currentBuffer];
+	//}
+
+	CountSubmittedCommands(m_allDrawCommandBuffers[currentBuffer]);
+	EndFrame(allvkDrawCommandBuffers[currentBuffer].data(), allvkDrawCommandBuffers[currentBuffer].size());
+}
+
+bool VulkanApplication::BeginFrame()
+{
+	vkWaitForFences(device, 1, &submitFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+	//the sets the slot used last time are not read anymore
+	vulkanDevice->ResetTransientDescriptorSets(m_currentFrame);
 
-	//VulkanApplication::PrepareFrame();
 	// Acquire the next image from the swap chain
-	VkResult result = swapChain.acquireNextImage(presentCompleteSemaphores[currentBuffer], &currentBuffer);
-	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
-	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
+	VkResult result = AcquireNextImage(presentCompleteSemaphores[m_currentFrame], &currentBuffer);
+	// Recreate the swapchain if it's no longer compatible with the surface, a suboptimal one is still presented
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		WindowResize();
+		return false;
 	}
-	else {
+	else if (result != VK_SUBOPTIMAL_KHR) {
 		VK_CHECK_RESULT(result);
 	}
 
-	vkResetFences(device, 1, &submitFences[currentBuffer]);
+	//another slot can still render to the image when the images come out of order or there are fewer images than slots
+	if (m_imageFences[currentBuffer] != VK_NULL_HANDLE && m_imageFences[currentBuffer] != submitFences[m_currentFrame])
+		vkWaitForFences(device, 1, &m_imageFences[currentBuffer], VK_TRUE, UINT64_MAX);
+	m_imageFences[currentBuffer] = submitFences[m_currentFrame];
 
-	//std::vector<VkCommandBuffer> submitCommandBuffers(allDrawCommandBuffers.size());//TODO make them [cb][i]
-	//for (int i = 0; i < allDrawCommandBuffers.size(); i++)
-	//{
-	//	submitCommandBuffers[i] = allDrawCommandBuffers[i][currentBuffer];
-	//}
+	vkResetFences(device, 1, &submitFences[m_currentFrame]);
+	return true;
+}
 
-	submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentBuffer];
-	submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentBuffer];
-	submitInfo.commandBufferCount = allvkDrawCommandBuffers[currentBuffer].size();
-	submitInfo.pCommandBuffers = allvkDrawCommandBuffers[currentBuffer].data();
-	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, submitFences[currentBuffer]));
+void VulkanApplication::EndFrame(const VkCommandBuffer* commandBuffers, uint32_t commandBufferCount)
+{
+	SubmitFrame(commandBuffers, commandBufferCount, presentCompleteSemaphores[m_currentFrame], renderCompleteSemaphores[currentBuffer], submitFences[m_currentFrame]);
 
-	//VulkanApplication::PresentFrame();
-	result = swapChain.queuePresent(presentationQueue, currentBuffer, renderCompleteSemaphores[currentBuffer]);
+	VkResult result = QueuePresent(currentBuffer, renderCompleteSemaphores[currentBuffer]);
+	m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
 	if (!((result == VK_SUCCESS) || (result == VK_SUBOPTIMAL_KHR))) {
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			// Swap chain is no longer compatible with the surface and needs to be recreated
 			WindowResize();
-			return;
 		}
 		else {
 			VK_CHECK_RESULT(result);
 		}
 	}
-	currentBuffer = (currentBuffer + 1) % swapChain.swapChainImageViews.size();
+}
+
+void VulkanApplication::WaitForFramesInFlight()
+{
+	if (submitFences.empty())
+		return;
+	vkWaitForFences(device, static_cast<uint32_t>(submitFences.size()), submitFences.data(), VK_TRUE, UINT64_MAX);
+}
+
+VkResult VulkanApplication::AcquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t* imageIndex)
+{
+	//the offscreen targets are used in order
+	if (settings.headless)
+	{
+		*imageIndex = (*imageIndex + 1) % static_cast<uint32_t>(swapChain.swapChainImageViews.size());
+		return VK_SUCCESS;
+	}
+	return swapChain.acquireNextImage(presentCompleteSemaphore, imageIndex);
+}
+
+void VulkanApplication::SubmitFrame(const VkCommandBuffer* commandBuffers, uint32_t commandBufferCount, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence)
+{
+	VkSubmitInfo frameSubmitInfo = submitInfo;
+	frameSubmitInfo.commandBufferCount = commandBufferCount;
+	frameSubmitInfo.pCommandBuffers = commandBuffers;
+	if (settings.headless)
+	{
+		//nothing was acquired and nothing will be presented
+		frameSubmitInfo.waitSemaphoreCount = 0;
+		frameSubmitInfo.signalSemaphoreCount = 0;
+	}
+	else
+	{
+		frameSubmitInfo.pWaitSemaphores = &waitSemaphore;
+		frameSubmitInfo.pSignalSemaphores = &signalSemaphore;
+	}
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &frameSubmitInfo, fence));
+}
+
+VkResult VulkanApplication::QueuePresent(uint32_t imageIndex, VkSemaphore waitSemaphore)
+{
+	if (settings.headless)
+		return VK_SUCCESS;
+	return swapChain.queuePresent(presentationQueue, imageIndex, waitSemaphore);
+}
+
+void VulkanApplication::CountSubmittedCommands(const std::vector<render::CommandBuffer*>& commandBuffers, size_t first)
+{
+	m_frameCommandStatistics = render::CommandStatistics();
+	for (size_t i = first; i < commandBuffers.size(); i++)
+		m_frameCommandStatistics += commandBuffers[i]->m_statistics;
 }
 
 void VulkanApplication::ViewChanged() {}
@@ -394,6 +516,7 @@ void VulkanApplication::WindowResize()
 	width = destWidth;
 	height = destHeight;
 	SetupSwapChain();
+	SetupFrameSync();
 
 	// Recreate the frame buffers
 	vulkanDevice->DestroyTexture(depthStencil);
@@ -432,6 +555,7 @@ void VulkanApplication::DrawFullScreenQuad(render::CommandBuffer* commandBuffer)
 {
 	VkCommandBuffer vkbuffer = ((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer;
 	vkCmdDraw(vkbuffer, 3, 1, 0, 0);
+	commandBuffer->m_statistics.draws++;
 }
 
 const std::string VulkanApplication::GetShadersPath()
@@ -462,7 +586,7 @@ void VulkanApplication::PipelineBarrier(render::CommandBuffer* commandBuffer, st
 	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;//buffers written by compute can be vertices, indirect draws or the input of the next dispatch
 	bufferBarrier.size = VK_WHOLE_SIZE;
 	std::vector<VkBufferMemoryBarrier> bufferBarriers(buffers.size());
 	for (int i = 0; i < buffers.size(); i++)
@@ -474,26 +598,64 @@ void VulkanApplication::PipelineBarrier(render::CommandBuffer* commandBuffer, st
 	bufferBarriers.push_back(bufferBarrier);
 	bufferBarrier.buffer = ((render::VulkanBuffer*)clothcompute.storageBuffers.outbuffer)->GetVkBuffer();
 	bufferBarriers.push_back(bufferBarrier);*/
-	vkCmdPipelineBarrier(
-		vkcmd->m_vkCommandBuffer,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-		VK_FLAGS_NONE,
-		0, nullptr,
-		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
-		0, nullptr);
+	if (!bufferBarriers.empty())
+		vkCmdPipelineBarrier(
+			vkcmd->m_vkCommandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_FLAGS_NONE,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			0, nullptr);
+
+	//textures are render targets read by compute after their pass, the layout stays the one the pass left them in
+	std::vector<VkImageMemoryBarrier> imageBarriers(textures.size());
+	for (int i = 0; i < textures.size(); i++)
+	{
+		render::VulkanTexture* vktexture = static_cast<render::VulkanTexture*>(textures[i]);
+		VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageBarrier.oldLayout = vktexture->m_descriptor.imageLayout;
+		imageBarrier.newLayout = vktexture->m_descriptor.imageLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = vktexture->m_vkImage;
+		VkImageAspectFlags aspect = vktexture->m_aspect;
+		if (vktexture->m_format == VK_FORMAT_D32_SFLOAT_S8_UINT || vktexture->m_format == VK_FORMAT_D24_UNORM_S8_UINT || vktexture->m_format == VK_FORMAT_D16_UNORM_S8_UINT)
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;//both aspects of a combined depth stencil image are barriered together
+		imageBarrier.subresourceRange = { aspect, 0, vktexture->m_mipLevelsCount, 0, vktexture->m_layerCount };
+	}
+	if (!imageBarriers.empty())
+		vkCmdPipelineBarrier(
+			vkcmd->m_vkCommandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_FLAGS_NONE,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
 }
 
 void VulkanApplication::DispatchCompute(render::CommandBuffer* commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
 	render::VulkanCommandBuffer* vkcmd = static_cast<render::VulkanCommandBuffer*>(commandBuffer);
 	vkCmdDispatch(vkcmd->m_vkCommandBuffer, groupCountX, groupCountY, groupCountZ);
+	vkcmd->m_statistics.dispatches++;
 }
 
 VulkanApplication::~VulkanApplication()
 {
 	// Clean up Vulkan resources
-	swapChain.CleanUp();
+	if (settings.headless)
+	{
+		//owned by the headless targets
+		swapChain.swapChainImageViews.clear();
+		swapChain.m_images.clear();
+	}
+	else
+		swapChain.CleanUp();
 	DestroyCommandBuffers();
 	vulkanDevice->DestroyPipelineCache();
 	for(int i=0;i<presentCompleteSemaphores.size();i++)
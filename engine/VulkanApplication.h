@@ -12,6 +12,9 @@
 
 using namespace engine;
 
+// Offscreen color targets cycled by a headless run in place of the swap chain images
+#define HEADLESS_FRAMES 2
+
 class VulkanApplication : public ApplicationBase
 {
 private:	
@@ -60,13 +63,21 @@ protected:
 	render::VulkanSwapChain swapChain;
 	// Synchronization semaphores
 	//struct {
-		// Swap chain image presentation
+		// Swap chain image presentation, one per frame in flight
 	std::vector < VkSemaphore> presentCompleteSemaphores;
-		// Command buffer submission and execution
+		// Command buffer submission and execution, one per swap chain image
 	std::vector < VkSemaphore> renderCompleteSemaphores;
 	//} semaphores;
 
+	// Signaled when the frame of a slot finished on the GPU
 	std::vector<VkFence> submitFences;
+	// Fence of the frame that last rendered to each swap chain image
+	std::vector<VkFence> m_imageFences;
+	// Primary command buffers of every frame slot, for examples that record their commands every frame
+	std::vector<render::CommandBuffer*> m_frameCommandBuffers;
+
+	// Stand in for the swap chain images when running headless
+	std::vector<render::VulkanTexture*> m_headlessTargets;
 
 	//graphical resources
 	//std::vector<Geometry *> m_geometries;
@@ -91,6 +102,10 @@ public:
 
 	// Create swap chain images
 	void SetupSwapChain();
+	// Create the synchronization of the frame slots and size the per image objects to the swap chain
+	void SetupFrameSync();
+	// Create the offscreen targets of a headless run and expose their views as the swap chain image views
+	void SetupHeadlessTargets();
 	// Creates a new (graphics) command pool object storing command buffers
 	void CreateCommandPool();
 	// Create command buffers for drawing commands
@@ -117,6 +132,18 @@ public:
 
 	// Pure virtual render function (override in derived class)
 	virtual void Render();
+	// Wait for the frame slot, acquire the next image into currentBuffer and wait for the frame still rendering to it, false if the frame is skipped
+	bool BeginFrame();
+	// Submit with the sync objects of the frame slot, present and move to the next slot
+	void EndFrame(const VkCommandBuffer* commandBuffers, uint32_t commandBufferCount);
+	// Wait for every frame in flight, before changing resources all of them use
+	void WaitForFramesInFlight();
+	// Swap chain acquire, submit and present, a headless run only submits
+	VkResult AcquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t* imageIndex);
+	void SubmitFrame(const VkCommandBuffer* commandBuffers, uint32_t commandBufferCount, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence);
+	VkResult QueuePresent(uint32_t imageIndex, VkSemaphore waitSemaphore);
+	// Sum the commands recorded in the submitted buffers for the frame statistics
+	void CountSubmittedCommands(const std::vector<render::CommandBuffer*>& commandBuffers, size_t first = 0);
 
 	// Called when view change occurs
 	// Can be overriden in derived class to e.g. update uniform buffers 
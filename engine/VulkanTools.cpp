@@ -48,6 +48,21 @@ namespace engine
 			}
 		}
 
+		std::string presentModeString(VkPresentModeKHR presentMode)
+		{
+			switch (presentMode)
+			{
+#define STR(r) case VK_PRESENT_MODE_ ##r##_KHR: return #r
+				STR(IMMEDIATE);
+				STR(MAILBOX);
+				STR(FIFO);
+				STR(FIFO_RELAXED);
+#undef STR
+			default:
+				return "UNKNOWN";
+			}
+		}
+
 		/**
 		* Get the index of a memory type that has all the requested property bits set
 		*
@@ -74,6 +74,9 @@ namespace engine
 		/** @brief Returns an error code as a string */
 		std::string errorString(VkResult errorCode);
 
+		/** @brief Returns a present mode as a string */
+		std::string presentModeString(VkPresentModeKHR presentMode);
+
 		uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkPhysicalDeviceMemoryProperties *memoryProperties, VkBool32 *memTypeFound = nullptr);
 
 		// Display error message and exit on fatal error
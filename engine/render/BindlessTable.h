@@ -0,0 +1,40 @@
+#pragma once
+#include <DescriptorSet.h>
+#include <DescriptorSetLayout.h>
+#include "Buffer.h"
+#include "Texture.h"
+#include <stdint.h>
+
+namespace engine
+{
+	namespace render
+	{
+		/** @brief One descriptor set with every texture and storage buffer of the device, the shaders index them with the handles
+		 *  kept in Texture::m_bindlessIndex and Buffer::m_bindlessIndex. Binding 0 holds the sampled textures, binding 1 the storage buffers */
+		class BindlessTable : public DescriptorSet
+		{
+		protected:
+			uint32_t m_textureCapacity = 0;
+			uint32_t m_bufferCapacity = 0;
+			uint32_t m_textureCount = 0;
+			uint32_t m_bufferCount = 0;
+
+		public:
+			/** @brief Layout of the set, pipelines that read the table are created with it */
+			virtual DescriptorSetLayout* GetLayout() = 0;
+
+			/** @brief Writes the resource in a free slot and returns its index, UINT32_MAX when the table is full */
+			virtual uint32_t AddTexture(Texture* texture) = 0;
+			virtual uint32_t AddBuffer(Buffer* buffer) = 0;
+
+			/** @brief Frees the slot of the resource, it is reused by the next one that is added */
+			virtual void RemoveTexture(Texture* texture) = 0;
+			virtual void RemoveBuffer(Buffer* buffer) = 0;
+
+			uint32_t GetTextureCapacity() const { return m_textureCapacity; }
+			uint32_t GetBufferCapacity() const { return m_bufferCapacity; }
+			uint32_t GetTextureCount() const { return m_textureCount; }
+			uint32_t GetBufferCount() const { return m_bufferCount; }
+		};
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <stdint.h>
 
 namespace engine
 {
@@ -12,6 +13,9 @@ namespace engine
 			size_t m_size = 0;
 			void* m_mapped = nullptr;
 		public:
+			/** @brief Index of the buffer in the bindless table of the device, UINT32_MAX when it is not in one */
+			uint32_t m_bindlessIndex = UINT32_MAX;
+
 			size_t GetSize() { return m_size; }
 			virtual ~Buffer() {};
 			void MemCopy(void* data, size_t size, size_t offset = 0);
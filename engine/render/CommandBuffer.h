@@ -1,15 +1,38 @@
 #pragma once
 #include <vector>
+#include <stdint.h>
 #include "CommandPool.h"
 
 namespace engine
 {
 	namespace render
 	{
+		/** @brief Commands recorded since the last Begin, used by the frame statistics */
+		struct CommandStatistics
+		{
+			uint32_t draws = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t descriptorSetBinds = 0;
+			uint32_t vertexBufferBinds = 0;
+			uint32_t dispatches = 0;
+
+			CommandStatistics& operator+=(const CommandStatistics& other)
+			{
+				draws += other.draws;
+				pipelineBinds += other.pipelineBinds;
+				descriptorSetBinds += other.descriptorSetBinds;
+				vertexBufferBinds += other.vertexBufferBinds;
+				dispatches += other.dispatches;
+				return *this;
+			}
+		};
+
 		class CommandBuffer
 		{
 			CommandPool* m_pool = nullptr;
 		public:
+			CommandStatistics m_statistics;
+
 			virtual ~CommandBuffer() {}
 			CommandBuffer(CommandPool* pool) : m_pool(pool) {};
 			virtual void Begin() = 0;
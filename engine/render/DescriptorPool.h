@@ -12,6 +12,17 @@ namespace engine
 			uint32_t size;
 		};
 
+		/** @brief Descriptors the device allocated on its own, without a pool sized by the caller */
+		struct DescriptorStatistics
+		{
+			uint32_t pools = 0;
+			uint32_t sets = 0;
+			uint32_t transientPools = 0;
+			uint32_t transientSets = 0;//allocated since the last reset of their frame
+			uint32_t cachedSets = 0;
+			uint64_t cacheHits = 0;
+		};
+
 		class DescriptorPool
 		{
 		protected:
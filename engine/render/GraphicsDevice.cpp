@@ -36,6 +36,8 @@ namespace engine
             it = find(m_buffers.begin(), m_buffers.end(), buffer);
             if (it != m_buffers.end())
             {
+                if (m_bindlessTable)
+                    m_bindlessTable->RemoveBuffer(buffer);
                 delete buffer;
                 m_buffers.erase(it);
                 return;
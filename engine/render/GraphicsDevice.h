@@ -9,10 +9,14 @@
 #include "Pipeline.h"
 #include "CommandPool.h"
 #include "Mesh.h"
+#include "BindlessTable.h"
 #include <vector>
+#include <functional>
 
 namespace engine
 {
+	class ThreadPool;
+
 	namespace render
 	{
 		class GraphicsDevice
@@ -30,6 +34,7 @@ namespace engine
 			std::vector<Pipeline*> m_pipelines;
 			std::vector<CommandPool*> m_primaryCommandPools;
 			std::vector<CommandPool*> m_secondaryCommandPools;
+			BindlessTable* m_bindlessTable = nullptr;
 			
 		public:
 
@@ -42,6 +47,13 @@ namespace engine
 
 			virtual Buffer* GetStorageVertexBuffer(size_t size, void* data, size_t vertexSize, DescriptorPool* descriptorPool, bool onCPU, CommandBuffer* commandBuffer) = 0;
 
+			/** @brief Storage buffer that is also the source of indirect draws, filled on the GPU. Only the Vulkan device draws
+			 *  indirectly, nullptr means the device doesn't support it */
+			virtual Buffer* GetIndirectBuffer(size_t size, void* data, DescriptorPool* descriptorPool, CommandBuffer* commandBuffer)
+			{
+				return nullptr;
+			}
+
 			virtual Texture* GetTexture(TextureData* data, DescriptorPool *descriptorPool, CommandBuffer* commandBuffer, bool generateMipmaps = false) = 0;
 
 			virtual Texture* GetRenderTarget(uint32_t width, uint32_t height, GfxFormat format, DescriptorPool* srvDescriptorPool, DescriptorPool* rtvDescriptorPool, CommandBuffer* commandBuffer, float* clearValues = nullptr) = 0;
@@ -54,12 +66,37 @@ namespace engine
 
 			virtual DescriptorSetLayout* GetDescriptorSetLayout(std::vector<LayoutBinding> bindings) = 0;
 
+			/** @brief The Vulkan device allocates the set from pools it grows on its own, pool can be nullptr there. Sets with the same layout and
+			 *  resources share their descriptors until one of them is updated, that one gets a copy first */
 			virtual DescriptorSet* GetDescriptorSet(DescriptorSetLayout* layout, DescriptorPool* pool, std::vector<Buffer*> buffers, std::vector <Texture*> textures, size_t dynamicAlignment = 0) = 0;
 
+			/** @brief Vulkan only, the other devices return nullptr. A set used only by the frame slot it was made for, all sets of the slot are
+			 *  freed by ResetTransientDescriptorSets when the slot comes around again, so it can't be used by command buffers recorded once */
+			virtual DescriptorSet* GetTransientDescriptorSet(DescriptorSetLayout* layout, std::vector<Buffer*> buffers, std::vector <Texture*> textures, uint32_t frame)
+			{
+				return nullptr;
+			}
+
+			/** @brief Called when the GPU finished the previous frame of the slot */
+			virtual void ResetTransientDescriptorSets(uint32_t frame) {}
+
+			virtual DescriptorStatistics GetDescriptorStatistics() { return DescriptorStatistics(); }
+
 			virtual RenderPass* GetRenderPass(uint32_t width, uint32_t height, std::vector<Texture*> colorTextures, Texture* depthTexture, std::vector<RenderSubpass> subpasses = {}) = 0;
 
 			virtual Pipeline* GetPipeline(std::string vertexFileName, std::string vertexEntry, std::string fragmentFilename, std::string fragmentEntry, VertexLayout* vertexLayout, DescriptorSetLayout* descriptorSetlayout, PipelineProperties properties, RenderPass* renderPass) = 0;
 			
+			/** @brief Until CompilePipelines the graphics pipelines given by GetPipeline are only recorded, they can be handed out but not drawn with.
+			 *  Only the Vulkan device records them, the DirectX 12 device compiles every pipeline in GetPipeline */
+			virtual void BeginPipelinePrewarm() {}
+
+			/** @brief Compiles the pipelines recorded since BeginPipelinePrewarm on the threads of the pool, progress is called from them after every pipeline.
+			 *  Devices that compile eagerly have nothing recorded and return empty statistics */
+			virtual PipelinePrewarmStatistics CompilePipelines(ThreadPool* threadPool, const std::function<void(uint32_t compiled, uint32_t count)>& progress = nullptr)
+			{
+				return PipelinePrewarmStatistics();
+			}
+
 			virtual Pipeline* GetComputePipeline(std::string computeFileName, std::string computeEntry, DescriptorSetLayout* descriptorSetlayout, uint32_t constanBlockSize = 0) = 0;
 
 			virtual CommandPool* GetCommandPool(uint32_t queueIndex, bool primary = true) = 0;
@@ -70,7 +107,11 @@ namespace engine
 
 			virtual void UpdateHostVisibleMesh(MeshData* data, Mesh* mesh) = 0;
 
-			void DestroyBuffer(Buffer* buffer);
+			/** @brief The global table of textures and storage buffers. Only the Vulkan device can create it, with -bindless and
+			 *  descriptor indexing, nullptr means the device doesn't support it or was created without it */
+			BindlessTable* GetBindlessTable() { return m_bindlessTable; }
+
+			virtual void DestroyBuffer(Buffer* buffer);
 
 			void FreeLoadStaggingBuffers();
 
@@ -5,6 +5,28 @@ namespace engine
 {
 	namespace render
 	{
+		bool MeshData::FitsShortIndices() const
+		{
+			if (m_indexSize != 4 || m_indices == nullptr)
+				return false;
+			//0xFFFF is the 16 bit restart value so it can only come from a 32 bit restart index
+			for (uint32_t i = 0; i < m_indexCount; i++)
+			{
+				if (m_indices[i] >= 0xFFFF && m_indices[i] != 0xFFFFFFFF)
+					return false;
+			}
+			return true;
+		}
+
+		uint16_t* MeshData::GetShortIndices() const
+		{
+			assert(FitsShortIndices());
+			uint16_t* indices = new uint16_t[m_indexCount];
+			for (uint32_t i = 0; i < m_indexCount; i++)
+				indices[i] = static_cast<uint16_t>(m_indices[i]);
+			return indices;
+		}
+
 		MeshData::~MeshData()
 		{
 			if (m_vertices)
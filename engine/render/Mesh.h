@@ -24,6 +24,11 @@ namespace engine
 			size_t m_instanceBufferSize = 0;
 			bool m_instanceFrequentUpdate = true;
 
+			/** @brief True if the 32 bit indices can be uploaded as 16 bit ones, primitive restart indices are kept */
+			bool FitsShortIndices() const;
+			/** @brief Returns a new[] allocated copy of the indices packed to 16 bit */
+			uint16_t* GetShortIndices() const;
+
 			~MeshData();
 		};
 
@@ -55,6 +60,9 @@ namespace engine
 			virtual void SetVertexBuffer(class Buffer* buffer) = 0;
 			virtual ~Mesh() {}
 			virtual void Draw(CommandBuffer *commandBuffer, const std::vector<MeshPart>& parts = std::vector<MeshPart>()) = 0;
+			/** @brief Draws drawCount MeshPart commands read from indirectBuffer. Only Vulkan meshes draw indirectly, the buffer
+			 *  comes from GraphicsDevice::GetIndirectBuffer and the other devices never give one */
+			virtual void DrawIndirect(CommandBuffer* commandBuffer, class Buffer* indirectBuffer, uint32_t drawCount, uint32_t firstDraw = 0) {};
 		};
 	}
 }
\ No newline at end of file
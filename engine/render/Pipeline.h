@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <stdint.h>
 
 namespace engine
 {
@@ -27,11 +28,28 @@ namespace engine
 			bool additive = false;
 		};
 
+#define MAX_SHADER_CONSTANTS 8
+
+		/** @brief Specialization constants of the fragment shader, value i is constant_id i of the SPIR-V and a define with the name in HLSL */
+		struct ShaderConstants
+		{
+			uint32_t count = 0;
+			uint32_t values[MAX_SHADER_CONSTANTS] = {};
+			const char* names[MAX_SHADER_CONSTANTS] = {};
+
+			void Set(uint32_t id, uint32_t value, const char* name = nullptr)
+			{
+				values[id] = value;
+				names[id] = name;
+				count = id + 1 > count ? id + 1 : count;
+			}
+		};
+
 		struct PipelineProperties
 		{
 			PrimitiveTopolgy topology = TRIANGLE_LIST;
 			uint32_t vertexConstantBlockSize = 0;
-			uint32_t* fragmentConstants = nullptr;
+			ShaderConstants fragmentConstants;
 			bool blendEnable = false;
 			bool depthBias = false;
 			bool depthTestEnable = true;
@@ -46,6 +64,15 @@ namespace engine
 			uint32_t subpass = 0;
 		};
 
+		/** @brief Pipelines recorded after BeginPipelinePrewarm and compiled together by CompilePipelines */
+		struct PipelinePrewarmStatistics
+		{
+			uint32_t pipelines = 0;
+			uint32_t threads = 0;
+			float milliseconds = 0.0f;
+			float compileMilliseconds = 0.0f;//sum of the compile times, about what one thread would have taken
+		};
+
 		class Pipeline
 		{
 		protected:
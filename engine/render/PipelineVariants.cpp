@@ -0,0 +1,40 @@
+#include "PipelineVariants.h"
+
+namespace engine
+{
+	namespace render
+	{
+		void PipelineVariants::Init(GraphicsDevice* device, const std::string& fragmentFile, const std::string& fragmentEntry, const std::vector<std::string>& switches,
+			const PipelineProperties& properties, RenderPass* renderPass)
+		{
+			_device = device;
+			_renderPass = renderPass;
+			m_fragmentFile = fragmentFile;
+			m_fragmentEntry = fragmentEntry;
+			m_switches = switches;
+			m_switches.resize(std::min<size_t>(m_switches.size(), MAX_SHADER_CONSTANTS));
+			m_properties = properties;
+			//the blend states of the caller can be gone when a later variant is created
+			m_attachments.assign(properties.pAttachments, properties.pAttachments + (properties.pAttachments ? properties.attachmentCount : 0));
+			m_properties.pAttachments = m_attachments.empty() ? nullptr : m_attachments.data();
+			m_pipelines.clear();
+			m_requests = 0;
+		}
+
+		Pipeline* PipelineVariants::Get(uint32_t features, const std::string& vertexFile, const std::string& vertexEntry, VertexLayout* vertexLayout, DescriptorSetLayout* descriptorSetLayout)
+		{
+			m_requests++;
+			Key key(features, vertexFile, vertexLayout, descriptorSetLayout);
+			auto found = m_pipelines.find(key);
+			if (found != m_pipelines.end())
+				return found->second;
+
+			PipelineProperties properties = m_properties;
+			for (uint32_t i = 0; i < m_switches.size(); i++)
+				properties.fragmentConstants.Set(i, (features >> i) & 1, m_switches[i].c_str());
+			Pipeline* pipeline = _device->GetPipeline(vertexFile, vertexEntry, m_fragmentFile, m_fragmentEntry, vertexLayout, descriptorSetLayout, properties, _renderPass);
+			m_pipelines[key] = pipeline;
+			return pipeline;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace render
+	{
+		/** @brief The pipelines of one fragment shader whose feature switches are specialization constants, switch i is
+		 *  constant_id i and bit i of the features. Every variant is created once, on its first request, and kept */
+		class PipelineVariants
+		{
+		public:
+			/** @brief The switches are also the names of the defines of the HLSL shaders */
+			void Init(GraphicsDevice* device, const std::string& fragmentFile, const std::string& fragmentEntry, const std::vector<std::string>& switches,
+				const PipelineProperties& properties, RenderPass* renderPass);
+
+			/** @brief The pipeline of the features with a vertex shader and layouts, the same arguments give the same pipeline */
+			Pipeline* Get(uint32_t features, const std::string& vertexFile, const std::string& vertexEntry, VertexLayout* vertexLayout, DescriptorSetLayout* descriptorSetLayout);
+
+			uint32_t GetVariantCount() const { return static_cast<uint32_t>(m_pipelines.size()); }
+			uint32_t GetRequestCount() const { return m_requests; }
+
+		private:
+			typedef std::tuple<uint32_t, std::string, VertexLayout*, DescriptorSetLayout*> Key;
+
+			GraphicsDevice* _device = nullptr;
+			RenderPass* _renderPass = nullptr;
+			std::string m_fragmentFile;
+			std::string m_fragmentEntry;
+			std::vector<std::string> m_switches;
+			PipelineProperties m_properties;
+			std::vector<BlendAttachmentState> m_attachments;
+			std::map<Key, Pipeline*> m_pipelines;
+			uint32_t m_requests = 0;
+		};
+	}
+}
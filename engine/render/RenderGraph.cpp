@@ -0,0 +1,383 @@
+#include "RenderGraph.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace render
+	{
+		uint32_t RenderGraph::AddTexture(const std::string& name, uint32_t width, uint32_t height, GfxFormat format, const float* clearValue)
+		{
+			RenderGraphResource resource;
+			resource.name = name;
+			resource.width = width;
+			resource.height = height;
+			resource.format = format;
+			if (clearValue)
+				std::copy(clearValue, clearValue + 4, resource.clearValue);
+			if (format == GfxFormat::D24_UNORM_S8_UINT || format == GfxFormat::D32_FLOAT)
+				resource.clearValue[0] = 1.0f;
+			m_resources.push_back(resource);
+			return static_cast<uint32_t>(m_resources.size() - 1);
+		}
+
+		uint32_t RenderGraph::ImportTexture(const std::string& name, uint32_t width, uint32_t height, GfxFormat format, RenderGraphLayout layout)
+		{
+			uint32_t index = AddTexture(name, width, height, format);
+			m_resources[index].imported = true;
+			m_resources[index].importedLayout = layout;
+			return index;
+		}
+
+		uint32_t RenderGraph::ImportBuffer(const std::string& name)
+		{
+			RenderGraphResource resource;
+			resource.name = name;
+			resource.texture = false;
+			resource.imported = true;
+			m_resources.push_back(resource);
+			return static_cast<uint32_t>(m_resources.size() - 1);
+		}
+
+		uint32_t RenderGraph::AddPass(const std::string& name, const std::function<void(CommandBuffer* commandBuffer, uint32_t frameBufferIndex)>& execute)
+		{
+			RenderGraphPass pass;
+			pass.name = name;
+			pass.execute = execute;
+			m_passes.push_back(pass);
+			return static_cast<uint32_t>(m_passes.size() - 1);
+		}
+
+		void RenderGraph::Read(uint32_t pass, uint32_t resource, RenderGraphAccess access, uint32_t stages)
+		{
+			RenderGraphUse use;
+			use.resource = resource;
+			use.access = access;
+			use.stages = stages;
+			m_passes[pass].uses.push_back(use);
+		}
+
+		void RenderGraph::Write(uint32_t pass, uint32_t resource, RenderGraphAccess access, uint32_t stages)
+		{
+			Read(pass, resource, access, stages);
+		}
+
+		bool RenderGraph::IsWrite(RenderGraphAccess access)
+		{
+			return access == RENDER_GRAPH_COLOR_ATTACHMENT || access == RENDER_GRAPH_DEPTH_ATTACHMENT || access == RENDER_GRAPH_STORAGE_WRITE || access == RENDER_GRAPH_TRANSFER_WRITE;
+		}
+
+		bool RenderGraph::IsAttachment(RenderGraphAccess access)
+		{
+			return access == RENDER_GRAPH_COLOR_ATTACHMENT || access == RENDER_GRAPH_DEPTH_ATTACHMENT || access == RENDER_GRAPH_DEPTH_READ;
+		}
+
+		RenderGraphLayout RenderGraph::GetLayout(RenderGraphAccess access)
+		{
+			switch (access) {
+			case RENDER_GRAPH_COLOR_ATTACHMENT: return RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT;
+			case RENDER_GRAPH_DEPTH_ATTACHMENT: return RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT;
+			case RENDER_GRAPH_DEPTH_READ: return RENDER_GRAPH_LAYOUT_DEPTH_READ_ONLY;
+			case RENDER_GRAPH_SAMPLED: return RENDER_GRAPH_LAYOUT_SHADER_READ;
+			case RENDER_GRAPH_STORAGE_READ: return RENDER_GRAPH_LAYOUT_GENERAL;
+			case RENDER_GRAPH_STORAGE_WRITE: return RENDER_GRAPH_LAYOUT_GENERAL;
+			case RENDER_GRAPH_TRANSFER_READ: return RENDER_GRAPH_LAYOUT_TRANSFER_SRC;
+			case RENDER_GRAPH_TRANSFER_WRITE: return RENDER_GRAPH_LAYOUT_TRANSFER_DST;
+			default: return RENDER_GRAPH_LAYOUT_UNDEFINED;
+			}
+		}
+
+		uint32_t RenderGraph::GetBytesPerPixel(GfxFormat format)
+		{
+			switch (format) {
+			case GfxFormat::R8_UNORM: return 1;
+			case GfxFormat::R16G16B16A16_UNORM: return 8;
+			case GfxFormat::R16G16B16A16_SFLOAT: return 8;
+			case GfxFormat::R32G32B32A32_SFLOAT: return 16;
+			case GfxFormat::BC3_UNORM_BLOCK: return 1;
+			case GfxFormat::ASTC_8x8_UNORM_BLOCK: return 1;
+			case GfxFormat::ETC2_R8G8B8_UNORM_BLOCK: return 1;
+			default: return 4;
+			}
+		}
+
+		void RenderGraph::Cull()
+		{
+			//the imported resources outlive the frame, what is written in them is kept
+			std::vector<bool> needed(m_resources.size());
+			for (size_t i = 0; i < m_resources.size(); i++)
+				needed[i] = m_resources[i].output || m_resources[i].imported;
+
+			//a write after the first one loads the contents, so the passes before it are needed too
+			for (size_t p = m_passes.size(); p-- > 0;)
+			{
+				RenderGraphPass& pass = m_passes[p];
+				bool live = pass.sideEffects;
+				for (const RenderGraphUse& use : pass.uses)
+					live = live || (IsWrite(use.access) && needed[use.resource]);
+				pass.culled = !live;
+				if (live)
+				{
+					for (const RenderGraphUse& use : pass.uses)
+						needed[use.resource] = true;
+				}
+			}
+		}
+
+		void RenderGraph::AddBarriers(uint32_t pass, std::vector<ResourceState>& states)
+		{
+			RenderGraphPass& renderPass = m_passes[pass];
+
+			//the uses of the same resource in a pass are one state, an attachment decides the layout
+			std::vector<uint32_t> resources;
+			for (const RenderGraphUse& use : renderPass.uses)
+			{
+				if (std::find(resources.begin(), resources.end(), use.resource) == resources.end())
+					resources.push_back(use.resource);
+			}
+
+			for (uint32_t resourceIndex : resources)
+			{
+				RenderGraphAccess access = RENDER_GRAPH_NONE;
+				uint32_t stages = 0;
+				bool write = false;
+				for (const RenderGraphUse& use : renderPass.uses)
+				{
+					if (use.resource != resourceIndex)
+						continue;
+					if (access == RENDER_GRAPH_NONE || (IsAttachment(use.access) && !IsAttachment(access)) || (IsWrite(use.access) && !IsWrite(access) && !IsAttachment(access)))
+						access = use.access;
+					stages |= use.stages;
+					write = write || IsWrite(use.access);
+				}
+
+				const RenderGraphResource& resource = m_resources[resourceIndex];
+				ResourceState& state = states[resourceIndex];
+				RenderGraphLayout layout = resource.texture ? GetLayout(access) : RENDER_GRAPH_LAYOUT_UNDEFINED;
+
+				RenderGraphBarrier barrier;
+				barrier.resource = resourceIndex;
+				barrier.dstAccess = access;
+				barrier.dstStages = stages;
+				barrier.oldLayout = state.layout;
+				barrier.newLayout = layout;
+				bool needed = false;
+				bool readers = state.readStages != 0;
+
+				if (!state.written)
+				{
+					//first use, only images need the transition out of the undefined layout
+					needed = resource.texture;
+					barrier.discard = true;
+					barrier.oldLayout = RENDER_GRAPH_LAYOUT_UNDEFINED;
+				}
+				else if (state.layout != layout || write)
+				{
+					//waits for the readers before changing or overwriting what they read, the writer otherwise
+					needed = true;
+					barrier.srcAccess = readers ? state.lastRead : state.producer;
+					barrier.srcStages = readers ? state.readStages : state.producerStages;
+				}
+				else if ((stages & ~state.readStages) != 0 && state.producer != RENDER_GRAPH_NONE)
+				{
+					//a read in stages that didn't wait for the writer yet
+					needed = true;
+					barrier.srcAccess = state.producer;
+					barrier.srcStages = state.producerStages;
+				}
+
+				if (needed)
+					renderPass.barriers.push_back(barrier);
+
+				if (write)
+				{
+					state.producer = access;
+					state.producerStages = stages;
+					state.readStages = 0;
+					state.lastRead = RENDER_GRAPH_NONE;
+				}
+				else if (needed && state.layout != layout)
+				{
+					//the readers after the transition wait for it
+					state.producer = access;
+					state.producerStages = stages;
+					state.readStages = stages;
+					state.lastRead = access;
+				}
+				else
+				{
+					state.readStages |= stages;
+					state.lastRead = access;
+				}
+				state.layout = layout;
+				state.written = state.written || write;
+
+				m_resources[resourceIndex].lastAccess = access;
+				m_resources[resourceIndex].lastStages = write ? stages : state.readStages;
+			}
+		}
+
+		void RenderGraph::Compile()
+		{
+			m_schedule.clear();
+			m_finalBarriers.clear();
+			m_statistics = RenderGraphStatistics();
+			for (RenderGraphPass& pass : m_passes)
+				pass.barriers.clear();
+
+			Cull();
+
+			for (uint32_t p = 0; p < m_passes.size(); p++)
+			{
+				if (!m_passes[p].culled)
+					m_schedule.push_back(p);
+			}
+
+			for (RenderGraphResource& resource : m_resources)
+			{
+				resource.used = false;
+				resource.offset = 0;
+			}
+			for (uint32_t s = 0; s < m_schedule.size(); s++)
+			{
+				for (const RenderGraphUse& use : m_passes[m_schedule[s]].uses)
+				{
+					RenderGraphResource& resource = m_resources[use.resource];
+					if (!resource.used)
+						resource.firstUse = s;
+					resource.used = true;
+					resource.lastUse = s;
+				}
+			}
+
+			std::vector<ResourceState> states(m_resources.size());
+			for (size_t i = 0; i < m_resources.size(); i++)
+			{
+				if (m_resources[i].imported)
+				{
+					states[i].layout = m_resources[i].texture ? m_resources[i].importedLayout : RENDER_GRAPH_LAYOUT_UNDEFINED;
+					states[i].written = true;
+				}
+			}
+
+			for (uint32_t s = 0; s < m_schedule.size(); s++)
+			{
+				RenderGraphPass& pass = m_passes[m_schedule[s]];
+
+				//the load and store of the attachments, from the states before the barriers of the pass
+				for (RenderGraphUse& use : pass.uses)
+				{
+					const RenderGraphResource& resource = m_resources[use.resource];
+					use.clear = !states[use.resource].written && IsWrite(use.access);
+					use.store = resource.output || resource.imported || resource.lastUse > s;
+				}
+
+				AddBarriers(m_schedule[s], states);
+				m_statistics.barriers += static_cast<uint32_t>(pass.barriers.size());
+			}
+
+			for (size_t i = 0; i < m_resources.size(); i++)
+			{
+				const RenderGraphResource& resource = m_resources[i];
+				const ResourceState& state = states[i];
+				if (!resource.imported || !resource.texture || !resource.used || resource.importedLayout == RENDER_GRAPH_LAYOUT_UNDEFINED || state.layout == resource.importedLayout)
+					continue;
+				RenderGraphBarrier barrier;
+				barrier.resource = static_cast<uint32_t>(i);
+				barrier.srcAccess = resource.lastAccess;
+				barrier.srcStages = resource.lastStages;
+				barrier.oldLayout = state.layout;
+				barrier.newLayout = resource.importedLayout;
+				m_finalBarriers.push_back(barrier);
+			}
+			m_statistics.barriers += static_cast<uint32_t>(m_finalBarriers.size());
+
+			m_statistics.passes = static_cast<uint32_t>(m_schedule.size());
+			m_statistics.culledPasses = static_cast<uint32_t>(m_passes.size() - m_schedule.size());
+		}
+
+		void RenderGraph::PlanMemory()
+		{
+			std::vector<uint32_t> transient;
+			for (uint32_t i = 0; i < m_resources.size(); i++)
+			{
+				RenderGraphResource& resource = m_resources[i];
+				if (!resource.used || resource.imported || !resource.texture)
+					continue;
+				if (resource.size == 0)
+					resource.size = uint64_t(resource.width) * resource.height * GetBytesPerPixel(resource.format);
+				resource.alignment = std::max<uint64_t>(resource.alignment, 1);
+				transient.push_back(i);
+			}
+			//the largest first, the smaller ones fill the gaps between them
+			std::stable_sort(transient.begin(), transient.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].size > m_resources[b].size; });
+
+			auto lifetimesOverlap = [this](uint32_t a, uint32_t b) {
+				return m_resources[a].firstUse <= m_resources[b].lastUse && m_resources[b].firstUse <= m_resources[a].lastUse;
+			};
+			auto memoryOverlaps = [this](uint32_t a, uint64_t offset, uint64_t size) {
+				return m_resources[a].offset < offset + size && offset < m_resources[a].offset + m_resources[a].size;
+			};
+
+			m_statistics.transientTextures = static_cast<uint32_t>(transient.size());
+			m_statistics.transientMemory = 0;
+			m_statistics.aliasedMemory = 0;
+
+			std::vector<uint32_t> placed;
+			for (uint32_t index : transient)
+			{
+				RenderGraphResource& resource = m_resources[index];
+				std::vector<uint64_t> candidates{ 0 };
+				for (uint32_t other : placed)
+				{
+					if (lifetimesOverlap(index, other))
+						candidates.push_back(m_resources[other].offset + m_resources[other].size);
+				}
+				std::sort(candidates.begin(), candidates.end());
+
+				for (uint64_t candidate : candidates)
+				{
+					uint64_t offset = (candidate + resource.alignment - 1) / resource.alignment * resource.alignment;
+					bool free = true;
+					for (uint32_t other : placed)
+						free = free && !(lifetimesOverlap(index, other) && memoryOverlaps(other, offset, resource.size));
+					if (free)
+					{
+						resource.offset = offset;
+						break;
+					}
+				}
+				placed.push_back(index);
+
+				m_statistics.transientMemory += resource.size;
+				m_statistics.aliasedMemory = std::max(m_statistics.aliasedMemory, resource.offset + resource.size);
+			}
+
+			//the first use of an aliased texture waits for the last use of the one that had the memory before
+			for (uint32_t passIndex : m_schedule)
+			{
+				for (RenderGraphBarrier& barrier : m_passes[passIndex].barriers)
+				{
+					if (!barrier.discard)
+						continue;
+					const RenderGraphResource& resource = m_resources[barrier.resource];
+					barrier.srcAccess = RENDER_GRAPH_NONE;
+					barrier.srcStages = 0;
+					int32_t previous = -1;
+					for (uint32_t other : placed)
+					{
+						const RenderGraphResource& candidate = m_resources[other];
+						if (other == barrier.resource || candidate.lastUse >= resource.firstUse || !memoryOverlaps(other, resource.offset, resource.size))
+							continue;
+						if (previous < 0 || candidate.lastUse > m_resources[previous].lastUse)
+							previous = static_cast<int32_t>(other);
+					}
+					if (previous >= 0)
+					{
+						barrier.srcAccess = m_resources[previous].lastAccess;
+						barrier.srcStages = m_resources[previous].lastStages;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include "Texture.h"
+#include "CommandBuffer.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace render
+	{
+		enum RenderGraphAccess
+		{
+			RENDER_GRAPH_NONE,
+			RENDER_GRAPH_COLOR_ATTACHMENT,
+			RENDER_GRAPH_DEPTH_ATTACHMENT,//depth test and write
+			RENDER_GRAPH_DEPTH_READ,//depth test without writing, it can be sampled in the same pass
+			RENDER_GRAPH_SAMPLED,//textures through samplers, buffers as uniform buffers
+			RENDER_GRAPH_STORAGE_READ,
+			RENDER_GRAPH_STORAGE_WRITE,
+			RENDER_GRAPH_TRANSFER_READ,
+			RENDER_GRAPH_TRANSFER_WRITE
+		};
+
+		enum RenderGraphStage
+		{
+			RENDER_GRAPH_STAGE_VERTEX = 1 << 0,
+			RENDER_GRAPH_STAGE_FRAGMENT = 1 << 1,
+			RENDER_GRAPH_STAGE_COMPUTE = 1 << 2
+		};
+
+		enum RenderGraphLayout
+		{
+			RENDER_GRAPH_LAYOUT_UNDEFINED,
+			RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT,
+			RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT,
+			RENDER_GRAPH_LAYOUT_DEPTH_READ_ONLY,
+			RENDER_GRAPH_LAYOUT_SHADER_READ,
+			RENDER_GRAPH_LAYOUT_GENERAL,
+			RENDER_GRAPH_LAYOUT_TRANSFER_SRC,
+			RENDER_GRAPH_LAYOUT_TRANSFER_DST
+		};
+
+		struct RenderGraphResource
+		{
+			std::string name;
+			bool texture = true;
+			bool imported = false;//not created by the graph, it keeps its contents and its layout between frames
+			bool output = false;//read after the graph, the passes that write it are not culled
+			uint32_t width = 0;
+			uint32_t height = 0;
+			GfxFormat format = GfxFormat::UNKNOWN;
+			float clearValue[4] = { 0.0f, 0.0f, 0.0f, 1.0f };//the depth is the first value
+			RenderGraphLayout importedLayout = RENDER_GRAPH_LAYOUT_UNDEFINED;
+
+			//memory of a transient texture, estimated from the format when the backend doesn't set it before PlanMemory
+			uint64_t size = 0;
+			uint64_t alignment = 256;
+
+			//compiled, the positions in the schedule of the first and last pass that use it
+			bool used = false;
+			uint32_t firstUse = 0;
+			uint32_t lastUse = 0;
+			RenderGraphAccess lastAccess = RENDER_GRAPH_NONE;
+			uint32_t lastStages = 0;
+			uint64_t offset = 0;//in the shared memory of the transient textures
+		};
+
+		struct RenderGraphUse
+		{
+			uint32_t resource = 0;
+			RenderGraphAccess access = RENDER_GRAPH_NONE;
+			uint32_t stages = 0;//RenderGraphStage bits of the shader accesses
+
+			//compiled, for the attachments
+			bool clear = false;//first write of the frame, otherwise the contents are loaded
+			bool store = false;//a later pass or the frame after reads it
+		};
+
+		/** @brief The resource goes from the access of an earlier pass to the access of its pass, src is RENDER_GRAPH_NONE on the first use */
+		struct RenderGraphBarrier
+		{
+			uint32_t resource = 0;
+			RenderGraphAccess srcAccess = RENDER_GRAPH_NONE;
+			uint32_t srcStages = 0;
+			RenderGraphAccess dstAccess = RENDER_GRAPH_NONE;
+			uint32_t dstStages = 0;
+			RenderGraphLayout oldLayout = RENDER_GRAPH_LAYOUT_UNDEFINED;
+			RenderGraphLayout newLayout = RENDER_GRAPH_LAYOUT_UNDEFINED;
+			bool discard = false;//the contents before don't matter, the memory can come from an aliased texture
+		};
+
+		struct RenderGraphPass
+		{
+			std::string name;
+			std::vector<RenderGraphUse> uses;
+			std::function<void(CommandBuffer* commandBuffer, uint32_t frameBufferIndex)> execute;
+			bool sideEffects = false;//draws outside of the graph, to the swapchain for example, it is never culled
+			bool enabled = true;//a disabled pass only records its barriers, the layouts stay the same and its attachments keep their contents
+
+			//compiled
+			bool culled = false;
+			std::vector<RenderGraphBarrier> barriers;//recorded before the pass
+		};
+
+		struct RenderGraphStatistics
+		{
+			uint32_t passes = 0;
+			uint32_t culledPasses = 0;
+			uint32_t barriers = 0;
+			uint32_t transientTextures = 0;
+			uint64_t transientMemory = 0;//the transient textures with their own memory
+			uint64_t aliasedMemory = 0;//the same textures sharing the memory of the ones they don't overlap with
+		};
+
+		/** @brief Passes that declare the textures and buffers they read and write. Compile orders them, culls the ones nothing
+		 *  uses, finds the barriers and layouts between them and the load and store of their attachments, PlanMemory places the
+		 *  transient textures that are not alive at the same time in the same memory. Both run on the CPU only, a backend creates
+		 *  the resources and records the passes from the result */
+		class RenderGraph
+		{
+		public:
+			std::vector<RenderGraphResource> m_resources;
+			std::vector<RenderGraphPass> m_passes;
+			std::vector<uint32_t> m_schedule;//the passes that are not culled, in the order they run
+			std::vector<RenderGraphBarrier> m_finalBarriers;//back to the layouts of the imported textures at the end of the frame
+			RenderGraphStatistics m_statistics;
+
+			virtual ~RenderGraph() {}
+
+			/** @brief A texture created by the graph that only lives inside a frame */
+			uint32_t AddTexture(const std::string& name, uint32_t width, uint32_t height, GfxFormat format, const float* clearValue = nullptr);
+			/** @brief A texture that is in the layout before and after the frame */
+			uint32_t ImportTexture(const std::string& name, uint32_t width, uint32_t height, GfxFormat format, RenderGraphLayout layout);
+			uint32_t ImportBuffer(const std::string& name);
+			void MarkOutput(uint32_t resource) { m_resources[resource].output = true; }
+
+			/** @brief The passes run in the order they are added, a read depends on the last pass added before that writes the resource */
+			uint32_t AddPass(const std::string& name, const std::function<void(CommandBuffer* commandBuffer, uint32_t frameBufferIndex)>& execute);
+			void Read(uint32_t pass, uint32_t resource, RenderGraphAccess access, uint32_t stages = RENDER_GRAPH_STAGE_FRAGMENT);
+			void Write(uint32_t pass, uint32_t resource, RenderGraphAccess access, uint32_t stages = RENDER_GRAPH_STAGE_FRAGMENT);
+			void SetSideEffects(uint32_t pass) { m_passes[pass].sideEffects = true; }
+			/** @brief Skips a pass from the next frame on without compiling again, for work that isn't needed every frame */
+			void SetEnabled(uint32_t pass, bool enabled) { m_passes[pass].enabled = enabled; }
+
+			void Compile();
+			/** @brief After Compile, with the sizes and alignments of the used transient textures */
+			void PlanMemory();
+
+			static bool IsWrite(RenderGraphAccess access);
+			static bool IsAttachment(RenderGraphAccess access);
+			static RenderGraphLayout GetLayout(RenderGraphAccess access);
+			static uint32_t GetBytesPerPixel(GfxFormat format);
+
+		private:
+			struct ResourceState
+			{
+				RenderGraphAccess producer = RENDER_GRAPH_NONE;//the last write or layout transition, what a new reader waits for
+				uint32_t producerStages = 0;
+				RenderGraphAccess lastRead = RENDER_GRAPH_NONE;
+				uint32_t readStages = 0;//readers since the producer, they wait for it already
+				RenderGraphLayout layout = RENDER_GRAPH_LAYOUT_UNDEFINED;
+				bool written = false;
+			};
+
+			void Cull();
+			void AddBarriers(uint32_t pass, std::vector<ResourceState>& states);
+		};
+	}
+}
@@ -15,9 +15,19 @@ namespace engine
 			std::vector<uint32_t> outputAttachmanets;
 		};
 
+		/** @brief The attachments that never leave the pass, they are neither stored nor loaded */
+		struct RenderPassStatistics
+		{
+			uint32_t transientAttachments = 0;
+			uint32_t lazilyAllocatedAttachments = 0;//without memory of their own on tile based GPUs
+			uint64_t savedBytesPerFrame = 0;//the stores of the transient attachments every time the pass runs
+		};
+
 		class RenderPass
 		{
 		public:
+			RenderPassStatistics m_statistics;
+
 			virtual ~RenderPass() {};
 			virtual void Begin(CommandBuffer *commandBuffer, uint32_t frameBufferIndex = 0) = 0;
 			virtual void End(CommandBuffer *commandBuffer, uint32_t frameBufferIndex = 0) = 0;
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdlib.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -69,6 +70,13 @@ namespace engine
 			uint32_t m_mipLevelsCount = 1;
 			uint32_t m_layerCount = 1;
 
+			/** @brief Index of the texture in the bindless table of the device, UINT32_MAX when it is not in one */
+			uint32_t m_bindlessIndex = UINT32_MAX;
+
+			/** @brief Lets the Vulkan GetRenderPass create the attachment again as a transient one when its contents never leave the pass.
+			 *  Only set it on attachments that are not sampled or copied after the pass, their views and descriptors are replaced */
+			bool m_allowTransient = false;
+
 			virtual Texture::~Texture() { Destroy(); }
 
 			/*void Create(VkDevice device, VkPhysicalDeviceMemoryProperties* memoryProperties, VkExtent3D extent, VkFormat format,
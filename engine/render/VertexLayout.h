@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 
 namespace engine
 {
@@ -22,7 +23,13 @@ namespace engine
 			VERTEX_COMPONENT_BITANGENT,
 			VERTEX_COMPONENT_DUMMY_FLOAT,
 			VERTEX_COMPONENT_DUMMY_INT,
-			VERTEX_COMPONENT_DUMMY_VEC4
+			VERTEX_COMPONENT_DUMMY_VEC4,
+			//quantized components, see scene::MeshOptimizer::Quantize
+			VERTEX_COMPONENT_POSITION_SNORM16,//xyz + padding, dequantized with a per mesh offset and scale
+			VERTEX_COMPONENT_NORMAL_OCT16,//octahedral encoded
+			VERTEX_COMPONENT_TANGENT_OCT16,//octahedral encoded
+			VERTEX_COMPONENT_UV_HALF,
+			VERTEX_COMPONENT_UV_UNORM16//only for uvs in the [0,1] range
 		} Component;
 
 		/** @brief Stores vertex layout components for model loading and Vulkan vertex input and atribute bindings  */
@@ -67,6 +74,13 @@ namespace engine
 
 				case VERTEX_COMPONENT_DUMMY_VEC4:	return 4 * sizeof(float);
 
+				case VERTEX_COMPONENT_POSITION_SNORM16:	return 4 * sizeof(int16_t);
+
+				case VERTEX_COMPONENT_NORMAL_OCT16:
+				case VERTEX_COMPONENT_TANGENT_OCT16:
+				case VERTEX_COMPONENT_UV_HALF:
+				case VERTEX_COMPONENT_UV_UNORM16:	return 2 * sizeof(int16_t);
+
 				default:							return 3 * sizeof(float);
 				}
 			}
@@ -77,16 +91,21 @@ namespace engine
 				{
 					case VERTEX_COMPONENT_POSITION2D:
 					case VERTEX_COMPONENT_POSITION4D:
+					case VERTEX_COMPONENT_POSITION_SNORM16:
 					case VERTEX_COMPONENT_POSITION:	return "POSITION";
 
+					case VERTEX_COMPONENT_UV_HALF:
+					case VERTEX_COMPONENT_UV_UNORM16:
 					case VERTEX_COMPONENT_UV:			return "TEXCOORD";
 				
+					case VERTEX_COMPONENT_NORMAL_OCT16:
 					case VERTEX_COMPONENT_NORMAL:	return "NORMAL";
 
 					case VERTEX_COMPONENT_COLOR:
 					case VERTEX_COMPONENT_COLOR4:
 					case VERTEX_COMPONENT_COLOR_UINT:		return "COLOR";
 
+					case VERTEX_COMPONENT_TANGENT_OCT16:
 					case VERTEX_COMPONENT_TANGENT4:
 					case VERTEX_COMPONENT_TANGENT:	return "TANGENT";
 
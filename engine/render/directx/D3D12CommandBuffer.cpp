@@ -19,6 +19,7 @@ namespace engine
 
 		void D3D12CommandBuffer::Begin()
 		{
+			m_statistics = CommandStatistics();
 			ThrowIfFailed(m_commandAllocator->Reset());
 			ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
 		}
@@ -42,6 +42,7 @@ namespace engine
 		{
 			D3D12CommandBuffer* d3dcommandBuffer = static_cast<D3D12CommandBuffer*>(commandBuffer);
 			Draw(d3dcommandBuffer->m_commandList.Get());
+			commandBuffer->m_statistics.descriptorSetBinds++;
 		}
 	}
 }
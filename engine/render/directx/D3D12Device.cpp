@@ -274,18 +274,21 @@ namespace engine
 				m_buffers.push_back(mesh->_vertexBuffer);
 			}
 
-			const UINT indexBufferSize = data->m_indexCount * sizeof(UINT);
+			//upload 16 bit indices whenever the mesh allows it
+			uint16_t* shortIndices = data->FitsShortIndices() ? data->GetShortIndices() : nullptr;
+			const UINT indexBufferSize = data->m_indexCount * (shortIndices ? sizeof(uint16_t) : data->m_indexSize);
 			if (indexBufferSize)
 			{
 				D3D12Buffer* staggingBuffer = new D3D12Buffer();
 				staggingBuffer->Create(m_device.Get(), indexBufferSize, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
 				m_loadStaggingBuffers.push_back(staggingBuffer);
-				mesh->m_indexSize = data->m_indexSize;
+				mesh->m_indexSize = shortIndices ? sizeof(uint16_t) : data->m_indexSize;
 				mesh->_indexBuffer = new D3D12IndexBuffer();
-				mesh->_indexBuffer->CreateGPUVisible(m_device.Get(), staggingBuffer->GetD3DBuffer(), d3dcommandBuffer->m_commandList.Get(), indexBufferSize, data->m_indices, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+				mesh->_indexBuffer->CreateGPUVisible(m_device.Get(), staggingBuffer->GetD3DBuffer(), d3dcommandBuffer->m_commandList.Get(), indexBufferSize, shortIndices ? (void*)shortIndices : (void*)data->m_indices, D3D12_RESOURCE_STATE_INDEX_BUFFER);
 				mesh->_indexBuffer->CreateView(mesh->m_indexSize);
 				m_buffers.push_back(mesh->_indexBuffer);
 			}
+			delete[] shortIndices;
 
 			if (data->m_instanceBufferSize > 0)
 			{
@@ -71,6 +71,9 @@ namespace engine
         {
             D3D12CommandBuffer* d3dcommandBuffer = static_cast<D3D12CommandBuffer*>(commandBuffer);
             Draw(d3dcommandBuffer->m_commandList.Get(), parts);
+            bool buffers = _vertexBuffer != nullptr || _indexBuffer != nullptr;
+            commandBuffer->m_statistics.draws += (buffers && parts.size() > 0) ? static_cast<uint32_t>(parts.size()) : 1;
+            commandBuffer->m_statistics.vertexBufferBinds += buffers ? 1 : 0;
         }
     }
 }
\ No newline at end of file
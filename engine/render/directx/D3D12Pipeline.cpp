@@ -43,6 +43,15 @@ namespace engine
             case VERTEX_COMPONENT_TANGENT4:
             case VERTEX_COMPONENT_DUMMY_VEC4:	return DXGI_FORMAT_R32G32B32A32_FLOAT;
 
+            case VERTEX_COMPONENT_POSITION_SNORM16:	return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+            case VERTEX_COMPONENT_NORMAL_OCT16:
+            case VERTEX_COMPONENT_TANGENT_OCT16:	return DXGI_FORMAT_R16G16_SNORM;
+
+            case VERTEX_COMPONENT_UV_HALF:		return DXGI_FORMAT_R16G16_FLOAT;
+
+            case VERTEX_COMPONENT_UV_UNORM16:	return DXGI_FORMAT_R16G16_UNORM;
+
             default:							return DXGI_FORMAT_R32G32B32_FLOAT;
             }
         }
@@ -161,7 +170,21 @@ namespace engine
 
                 HRESULT hr;
 
-                hr = D3DCompileFromFile(fileName.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, vertexEntry.c_str(), "vs_5_0", compileFlags, 0, &vertexShader, &errors);
+                //the named specialization constants are defines of both stages, they come from the same file and have to agree on their interface
+                std::vector<std::string> values;
+                std::vector<D3D_SHADER_MACRO> defines;
+                values.reserve(properties.fragmentConstants.count);
+                for (uint32_t i = 0; i < properties.fragmentConstants.count; i++)
+                {
+                    if (properties.fragmentConstants.names[i])
+                    {
+                        values.push_back(std::to_string(properties.fragmentConstants.values[i]));
+                        defines.push_back({ properties.fragmentConstants.names[i], values.back().c_str() });
+                    }
+                }
+                defines.push_back({ nullptr, nullptr });
+
+                hr = D3DCompileFromFile(fileName.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, vertexEntry.c_str(), "vs_5_0", compileFlags, 0, &vertexShader, &errors);
                 if (errors != nullptr)
                 {
                     OutputDebugStringA((char*)errors->GetBufferPointer());
@@ -170,7 +193,7 @@ namespace engine
 
                 if (!fragmentEntry.empty())
                 {
-                    hr = D3DCompileFromFile(fileName.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, fragmentEntry.c_str(), "ps_5_0", compileFlags, 0, &pixelShader, &errors);
+                    hr = D3DCompileFromFile(fileName.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, fragmentEntry.c_str(), "ps_5_0", compileFlags, 0, &pixelShader, &errors);
                     if (errors != nullptr)
                     {
                         OutputDebugStringA((char*)errors->GetBufferPointer());
@@ -394,6 +417,7 @@ namespace engine
             d3dcommandBuffer->m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
             else
             d3dcommandBuffer->m_commandList->SetComputeRootSignature(m_rootSignature.Get());
+            commandBuffer->m_statistics.pipelineBinds++;
         }
 
         void D3D12Pipeline::PushConstants(CommandBuffer* commandBuffer, void* constantsData)
@@ -0,0 +1,363 @@
+#include "VulkanAccelerationStructures.h"
+#include "VulkanDevice.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace render
+	{
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		void VulkanAccelerationStructures::Create(VulkanDevice* device, uint32_t slots)
+		{
+			_device = device;
+			m_slots = std::max(slots, 1u);
+			VkDevice logicalDevice = _device->logicalDevice;
+			vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR"));
+			vkCreateAccelerationStructureKHR = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCreateAccelerationStructureKHR"));
+			vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkDestroyAccelerationStructureKHR"));
+			vkGetAccelerationStructureBuildSizesKHR = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureBuildSizesKHR"));
+			vkGetAccelerationStructureDeviceAddressKHR = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureDeviceAddressKHR"));
+			vkCmdBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdBuildAccelerationStructuresKHR"));
+			vkCmdWriteAccelerationStructuresPropertiesKHR = reinterpret_cast<PFN_vkCmdWriteAccelerationStructuresPropertiesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdWriteAccelerationStructuresPropertiesKHR"));
+			vkCmdCopyAccelerationStructureKHR = reinterpret_cast<PFN_vkCmdCopyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdCopyAccelerationStructureKHR"));
+
+			VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+			accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+			VkPhysicalDeviceProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties.pNext = &accelerationStructureProperties;
+			vkGetPhysicalDeviceProperties2(_device->physicalDevice, &properties);
+			m_scratchAlignment = std::max<VkDeviceSize>(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+		}
+
+		uint64_t VulkanAccelerationStructures::GetBufferAddress(VkBuffer buffer) const
+		{
+			VkBufferDeviceAddressInfoKHR addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+			addressInfo.buffer = buffer;
+			return vkGetBufferDeviceAddressKHR(_device->logicalDevice, &addressInfo);
+		}
+
+		VulkanAccelerationStructure VulkanAccelerationStructures::CreateStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size)
+		{
+			VulkanAccelerationStructure structure;
+			structure.size = size;
+			structure.buffer = _device->GetBuffer(VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size);
+
+			VkAccelerationStructureCreateInfoKHR createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+			createInfo.buffer = structure.buffer->GetVkBuffer();
+			createInfo.size = size;
+			createInfo.type = type;
+			VK_CHECK_RESULT(vkCreateAccelerationStructureKHR(_device->logicalDevice, &createInfo, nullptr, &structure.handle));
+
+			VkAccelerationStructureDeviceAddressInfoKHR addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+			addressInfo.accelerationStructure = structure.handle;
+			structure.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(_device->logicalDevice, &addressInfo);
+			return structure;
+		}
+
+		void VulkanAccelerationStructures::DestroyStructure(VulkanAccelerationStructure& structure)
+		{
+			if (structure.handle != VK_NULL_HANDLE)
+				vkDestroyAccelerationStructureKHR(_device->logicalDevice, structure.handle, nullptr);
+			if (structure.buffer)
+				_device->DestroyBuffer(structure.buffer);
+			structure = VulkanAccelerationStructure();
+		}
+
+		VulkanBuffer* VulkanAccelerationStructures::CreateScratchBuffer(VkDeviceSize size, uint64_t& address)
+		{
+			VulkanBuffer* buffer = _device->GetBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size + m_scratchAlignment);
+			address = AlignUp(GetBufferAddress(buffer->GetVkBuffer()), m_scratchAlignment);
+			return buffer;
+		}
+
+		void VulkanAccelerationStructures::BuildBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		uint32_t VulkanAccelerationStructures::AddBottomLevel(const Triangles& triangles)
+		{
+			m_pending.push_back(triangles);
+			return static_cast<uint32_t>(m_bottomLevels.size() + m_pending.size() - 1);
+		}
+
+		void VulkanAccelerationStructures::BuildBottomLevels(VkQueue queue)
+		{
+			uint32_t count = static_cast<uint32_t>(m_pending.size());
+			if (count == 0)
+				return;
+
+			std::vector<VkAccelerationStructureGeometryKHR> geometries(count);
+			std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(count);
+			std::vector<VkAccelerationStructureBuildRangeInfoKHR> ranges(count);
+			std::vector<VulkanAccelerationStructure> built(count);
+			std::vector<VkDeviceSize> scratchOffsets(count);
+			//the builds of a batch run together, each in its part of the scratch buffer, the next batch reuses it from the start
+			std::vector<uint32_t> batchStarts;
+			VkDeviceSize scratchSize = 0, batchScratch = 0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Triangles& triangles = m_pending[i];
+				VkAccelerationStructureGeometryKHR& geometry = geometries[i];
+				geometry = {};
+				geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+				geometry.flags = triangles.flags;
+				geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+				geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+				geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+				geometry.geometry.triangles.vertexData.deviceAddress = GetBufferAddress(triangles.vertices->GetVkBuffer());
+				//the highest index, not the count
+				geometry.geometry.triangles.maxVertex = triangles.vertexCount > 0 ? triangles.vertexCount - 1 : 0;
+				geometry.geometry.triangles.vertexStride = triangles.vertexStride;
+				geometry.geometry.triangles.indexType = triangles.indexSize > 2 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+				geometry.geometry.triangles.indexData.deviceAddress = GetBufferAddress(triangles.indices->GetVkBuffer());
+
+				VkAccelerationStructureBuildGeometryInfoKHR& buildInfo = buildInfos[i];
+				buildInfo = {};
+				buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+				buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+				buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | (m_compact ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR : 0);
+				buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+				buildInfo.geometryCount = 1;
+				buildInfo.pGeometries = &geometry;
+
+				ranges[i] = {};
+				ranges[i].primitiveCount = triangles.indexCount / 3;
+
+				VkAccelerationStructureBuildSizesInfoKHR sizes{};
+				sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+				vkGetAccelerationStructureBuildSizesKHR(_device->logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &ranges[i].primitiveCount, &sizes);
+				built[i] = CreateStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, sizes.accelerationStructureSize);
+				buildInfo.dstAccelerationStructure = built[i].handle;
+				m_statistics.builtSize += sizes.accelerationStructureSize;
+
+				VkDeviceSize scratch = AlignUp(sizes.buildScratchSize, m_scratchAlignment);
+				if (i == 0 || batchScratch + scratch > m_scratchBudget)
+				{
+					batchStarts.push_back(i);
+					batchScratch = 0;
+				}
+				scratchOffsets[i] = batchScratch;
+				batchScratch += scratch;
+				scratchSize = std::max(scratchSize, batchScratch);
+			}
+			batchStarts.push_back(count);
+
+			uint64_t scratchAddress;
+			VulkanBuffer* scratchBuffer = CreateScratchBuffer(scratchSize, scratchAddress);
+			for (uint32_t i = 0; i < count; i++)
+				buildInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffsets[i];
+
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			if (m_compact)
+			{
+				VkQueryPoolCreateInfo queryPoolInfo{};
+				queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+				queryPoolInfo.queryCount = count;
+				VK_CHECK_RESULT(vkCreateQueryPool(_device->logicalDevice, &queryPoolInfo, nullptr, &queryPool));
+			}
+
+			VkCommandBuffer commandBuffer = _device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+			if (queryPool != VK_NULL_HANDLE)
+				vkCmdResetQueryPool(commandBuffer, queryPool, 0, count);
+			std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> rangePointers(count);
+			for (uint32_t i = 0; i < count; i++)
+				rangePointers[i] = &ranges[i];
+			for (size_t batch = 0; batch + 1 < batchStarts.size(); batch++)
+			{
+				if (batch > 0)
+					BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+						VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+				uint32_t first = batchStarts[batch];
+				vkCmdBuildAccelerationStructuresKHR(commandBuffer, batchStarts[batch + 1] - first, &buildInfos[first], &rangePointers[first]);
+			}
+			if (queryPool != VK_NULL_HANDLE)
+			{
+				std::vector<VkAccelerationStructureKHR> handles(count);
+				for (uint32_t i = 0; i < count; i++)
+					handles[i] = built[i].handle;
+				BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+					VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+				vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, count, handles.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
+			}
+			_device->FlushCommandBuffer(commandBuffer, queue);
+			_device->DestroyBuffer(scratchBuffer);
+			m_statistics.scratchSize = std::max(m_statistics.scratchSize, scratchSize);
+			m_statistics.batches += static_cast<uint32_t>(batchStarts.size() - 1);
+
+			if (queryPool != VK_NULL_HANDLE)
+			{
+				std::vector<VkDeviceSize> compactedSizes(count);
+				VK_CHECK_RESULT(vkGetQueryPoolResults(_device->logicalDevice, queryPool, 0, count, count * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize),
+					VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+				vkDestroyQueryPool(_device->logicalDevice, queryPool, nullptr);
+
+				//the compacted copies are made in one more submit, the built structures are freed after it
+				std::vector<VulkanAccelerationStructure> compacted(count);
+				commandBuffer = _device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					compacted[i] = CreateStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, compactedSizes[i]);
+					VkCopyAccelerationStructureInfoKHR copyInfo{};
+					copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+					copyInfo.src = built[i].handle;
+					copyInfo.dst = compacted[i].handle;
+					copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+					vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+				}
+				_device->FlushCommandBuffer(commandBuffer, queue);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					DestroyStructure(built[i]);
+					built[i] = compacted[i];
+				}
+			}
+
+			for (auto& structure : built)
+				m_statistics.compactedSize += structure.size;
+			m_statistics.bottomLevels += count;
+			m_bottomLevels.insert(m_bottomLevels.end(), built.begin(), built.end());
+			m_pending.clear();
+		}
+
+		uint32_t VulkanAccelerationStructures::AddInstance(uint32_t bottomLevel, const glm::mat4& transform, uint32_t customIndex, uint8_t mask)
+		{
+			VkAccelerationStructureInstanceKHR instance{};
+			instance.instanceCustomIndex = customIndex;
+			instance.mask = mask;
+			instance.instanceShaderBindingTableRecordOffset = 0;
+			instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+			instance.accelerationStructureReference = m_bottomLevels[bottomLevel].deviceAddress;
+			m_instances.push_back(instance);
+			SetTransform(static_cast<uint32_t>(m_instances.size() - 1), transform);
+			return static_cast<uint32_t>(m_instances.size() - 1);
+		}
+
+		void VulkanAccelerationStructures::SetTransform(uint32_t instance, const glm::mat4& transform)
+		{
+			//three rows of the matrix, glm stores columns
+			for (int row = 0; row < 3; row++)
+				for (int column = 0; column < 4; column++)
+					m_instances[instance].transform.matrix[row][column] = transform[column][row];
+		}
+
+		void VulkanAccelerationStructures::WriteInstances(uint32_t slot)
+		{
+			if (!m_instanceBuffer || m_instances.empty())
+				return;
+			VkDeviceSize slotSize = sizeof(VkAccelerationStructureInstanceKHR) * m_topLevelInstances;
+			m_instanceBuffer->MemCopy(m_instances.data(), slotSize, slot * slotSize);
+		}
+
+		void VulkanAccelerationStructures::GetTopLevelGeometry(uint32_t slot, VkAccelerationStructureGeometryKHR& geometry) const
+		{
+			geometry = {};
+			geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+			geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+			geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+			geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+			geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+			geometry.geometry.instances.data.deviceAddress = GetBufferAddress(m_instanceBuffer->GetVkBuffer()) + slot * sizeof(VkAccelerationStructureInstanceKHR) * m_topLevelInstances;
+		}
+
+		void VulkanAccelerationStructures::BuildTopLevel(VkQueue queue)
+		{
+			DestroyStructure(m_topLevel);
+			if (m_instanceBuffer)
+				_device->DestroyBuffer(m_instanceBuffer);
+			if (m_topLevelScratch)
+				_device->DestroyBuffer(m_topLevelScratch);
+
+			m_topLevelInstances = static_cast<uint32_t>(m_instances.size());
+			m_instanceBuffer = _device->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(VkAccelerationStructureInstanceKHR) * std::max(m_topLevelInstances, 1u) * m_slots);
+			VK_CHECK_RESULT(m_instanceBuffer->Map());
+			for (uint32_t slot = 0; slot < m_slots; slot++)
+				WriteInstances(slot);
+
+			VkAccelerationStructureGeometryKHR geometry;
+			GetTopLevelGeometry(0, geometry);
+			VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+			buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+			buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+			buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+			buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+			buildInfo.geometryCount = 1;
+			buildInfo.pGeometries = &geometry;
+
+			VkAccelerationStructureBuildSizesInfoKHR sizes{};
+			sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+			vkGetAccelerationStructureBuildSizesKHR(_device->logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &m_topLevelInstances, &sizes);
+			m_topLevel = CreateStructure(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, sizes.accelerationStructureSize);
+
+			//kept for the updates
+			uint64_t scratchAddress;
+			m_topLevelScratch = CreateScratchBuffer(std::max(sizes.buildScratchSize, sizes.updateScratchSize), scratchAddress);
+			buildInfo.dstAccelerationStructure = m_topLevel.handle;
+			buildInfo.scratchData.deviceAddress = scratchAddress;
+
+			VkAccelerationStructureBuildRangeInfoKHR range{};
+			range.primitiveCount = m_topLevelInstances;
+			const VkAccelerationStructureBuildRangeInfoKHR* rangePointer = &range;
+			VkCommandBuffer commandBuffer = _device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+			vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &rangePointer);
+			_device->FlushCommandBuffer(commandBuffer, queue);
+		}
+
+		void VulkanAccelerationStructures::RecordTopLevelUpdate(VkCommandBuffer commandBuffer, uint32_t slot)
+		{
+			if (m_topLevel.handle == VK_NULL_HANDLE)
+				return;
+			//the rays of the last frame still read the structure the update writes
+			BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+				VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+
+			VkAccelerationStructureGeometryKHR geometry;
+			GetTopLevelGeometry(slot, geometry);
+			VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+			buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+			buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+			buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+			buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+			buildInfo.srcAccelerationStructure = m_topLevel.handle;
+			buildInfo.dstAccelerationStructure = m_topLevel.handle;
+			buildInfo.geometryCount = 1;
+			buildInfo.pGeometries = &geometry;
+			buildInfo.scratchData.deviceAddress = AlignUp(GetBufferAddress(m_topLevelScratch->GetVkBuffer()), m_scratchAlignment);
+
+			VkAccelerationStructureBuildRangeInfoKHR range{};
+			range.primitiveCount = m_topLevelInstances;
+			const VkAccelerationStructureBuildRangeInfoKHR* rangePointer = &range;
+			vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &rangePointer);
+
+			BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+				VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+		}
+
+		VulkanAccelerationStructures::~VulkanAccelerationStructures()
+		{
+			if (!_device)
+				return;
+			for (auto& structure : m_bottomLevels)
+				DestroyStructure(structure);
+			DestroyStructure(m_topLevel);
+			if (m_instanceBuffer)
+				_device->DestroyBuffer(m_instanceBuffer);
+			if (m_topLevelScratch)
+				_device->DestroyBuffer(m_topLevelScratch);
+		}
+	}
+}
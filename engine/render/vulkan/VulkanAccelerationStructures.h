@@ -0,0 +1,108 @@
+#pragma once
+#include <VulkanTools.h>
+#include "VulkanBuffer.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace engine
+{
+	namespace render
+	{
+		class VulkanDevice;
+
+		struct VulkanAccelerationStructure
+		{
+			VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+			uint64_t deviceAddress = 0;
+			VulkanBuffer* buffer = nullptr;
+			VkDeviceSize size = 0;
+		};
+
+		struct AccelerationStructureStatistics
+		{
+			uint32_t bottomLevels = 0;
+			uint32_t batches = 0;//builds that waited for the scratch memory of the ones before them
+			VkDeviceSize builtSize = 0;
+			VkDeviceSize compactedSize = 0;
+			VkDeviceSize scratchSize = 0;
+		};
+
+		/** @brief Bottom level structures built together in one command buffer from one scratch buffer and compacted after,
+		 *  and a top level structure over their instances that is updated in place when the instances move.
+		 *  The device needs the acceleration structure and buffer device address extensions */
+		class VulkanAccelerationStructures
+		{
+		public:
+			/** @brief Triangles of a bottom level structure, the buffers need the device address and build input usages */
+			struct Triangles
+			{
+				VulkanBuffer* vertices = nullptr;
+				VulkanBuffer* indices = nullptr;
+				uint32_t vertexCount = 0;
+				uint32_t vertexStride = 0;//the position is the first component
+				uint32_t indexCount = 0;
+				uint16_t indexSize = 4;//in bytes, the m_indexSize of the mesh, meshes whose indices fit upload them in 16 bits
+				VkGeometryFlagsKHR flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+			};
+
+			//the builds over this much scratch memory reuse it after the ones before them finished
+			VkDeviceSize m_scratchBudget = 128 * 1024 * 1024;
+			bool m_compact = true;
+
+			std::vector<VulkanAccelerationStructure> m_bottomLevels;
+			VulkanAccelerationStructure m_topLevel;
+			AccelerationStructureStatistics m_statistics;
+
+			/** @brief Every slot has its own copy of the instances, so a frame can write them while another one updates the top level */
+			void Create(VulkanDevice* device, uint32_t slots);
+
+			/** @brief The structure is built by the next BuildBottomLevels, the returned index is its place in m_bottomLevels */
+			uint32_t AddBottomLevel(const Triangles& triangles);
+			/** @brief Builds every bottom level structure added since the last call and waits for them */
+			void BuildBottomLevels(VkQueue queue);
+
+			/** @brief Instances added after BuildTopLevel need another BuildTopLevel */
+			uint32_t AddInstance(uint32_t bottomLevel, const glm::mat4& transform, uint32_t customIndex = 0, uint8_t mask = 0xFF);
+			void SetTransform(uint32_t instance, const glm::mat4& transform);
+
+			/** @brief Builds the top level structure from the instances of every slot and waits for it */
+			void BuildTopLevel(VkQueue queue);
+			/** @brief Copies the instances to the slot, only once the commands that updated from it finished */
+			void WriteInstances(uint32_t slot);
+			/** @brief Records a refit of the top level structure from the instances of the slot, outside of render passes.
+			 *  Ray tracing shaders after it see the new transforms */
+			void RecordTopLevelUpdate(VkCommandBuffer commandBuffer, uint32_t slot);
+
+			uint64_t GetBufferAddress(VkBuffer buffer) const;
+
+			~VulkanAccelerationStructures();
+
+		private:
+			VulkanDevice* _device = nullptr;
+			uint32_t m_slots = 1;
+			VkDeviceSize m_scratchAlignment = 256;
+
+			std::vector<Triangles> m_pending;
+			std::vector<VkAccelerationStructureInstanceKHR> m_instances;
+			VulkanBuffer* m_instanceBuffer = nullptr;
+			VulkanBuffer* m_topLevelScratch = nullptr;
+			uint32_t m_topLevelInstances = 0;
+
+			PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR = nullptr;
+			PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR = nullptr;
+			PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR = nullptr;
+			PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR = nullptr;
+			PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR = nullptr;
+			PFN_vkCmdBuildAccelerationStructuresKHR vkCmdBuildAccelerationStructuresKHR = nullptr;
+			PFN_vkCmdWriteAccelerationStructuresPropertiesKHR vkCmdWriteAccelerationStructuresPropertiesKHR = nullptr;
+			PFN_vkCmdCopyAccelerationStructureKHR vkCmdCopyAccelerationStructureKHR = nullptr;
+
+			VulkanAccelerationStructure CreateStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+			void DestroyStructure(VulkanAccelerationStructure& structure);
+			/** @brief A device local buffer with room to align the start of the scratch memory */
+			VulkanBuffer* CreateScratchBuffer(VkDeviceSize size, uint64_t& address);
+			void GetTopLevelGeometry(uint32_t slot, VkAccelerationStructureGeometryKHR& geometry) const;
+			static void BuildBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+		};
+	}
+}
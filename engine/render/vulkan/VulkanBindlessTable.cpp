@@ -0,0 +1,180 @@
+#include "VulkanBindlessTable.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanPipeline.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace render
+	{
+		void VulkanBindlessTable::Create(VkDevice device, const VkPhysicalDeviceDescriptorIndexingProperties& limits, uint32_t textureCapacity, uint32_t bufferCapacity)
+		{
+			_device = device;
+
+			//the table is visible to every stage so the limits of one stage apply to it
+			m_textureCapacity = std::min(textureCapacity, std::min(limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages));
+			m_bufferCapacity = std::min(bufferCapacity, std::min(limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers));
+			if (m_textureCapacity + m_bufferCapacity > limits.maxPerStageUpdateAfterBindResources)
+				m_textureCapacity = limits.maxPerStageUpdateAfterBindResources - m_bufferCapacity;
+
+			m_layout = new VulkanDescriptorSetLayout({ { IMAGE_SAMPLER, FRAGMENT }, { INPUT_STORAGE_BUFFER, FRAGMENT } });
+			m_layout->_device = device;
+
+			VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+			VkDescriptorSetLayoutBinding textures{};
+			textures.binding = TEXTURES_BINDING;
+			textures.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			textures.descriptorCount = m_textureCapacity;
+			textures.stageFlags = stages;
+			VkDescriptorSetLayoutBinding buffers{};
+			buffers.binding = BUFFERS_BINDING;
+			buffers.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			buffers.descriptorCount = m_bufferCapacity;
+			buffers.stageFlags = stages;
+			m_layout->m_setLayoutBindings = { textures, buffers };
+
+			//slots that were never written are not read, so the arrays don't have to be full
+			VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+			VkDescriptorBindingFlags bindingFlags[2] = { flags, flags };
+			VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+			bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+			bindingFlagsCI.bindingCount = 2;
+			bindingFlagsCI.pBindingFlags = bindingFlags;
+
+			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
+			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			descriptorLayoutCI.pNext = &bindingFlagsCI;
+			descriptorLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+			descriptorLayoutCI.bindingCount = static_cast<uint32_t>(m_layout->m_setLayoutBindings.size());
+			descriptorLayoutCI.pBindings = m_layout->m_setLayoutBindings.data();
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(_device, &descriptorLayoutCI, nullptr, &m_layout->m_descriptorSetLayout));
+
+			VkDescriptorPoolSize poolSizes[2] = {
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_textureCapacity },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_bufferCapacity }
+			};
+			VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+			descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+			descriptorPoolInfo.poolSizeCount = 2;
+			descriptorPoolInfo.pPoolSizes = poolSizes;
+			descriptorPoolInfo.maxSets = 1;
+			VK_CHECK_RESULT(vkCreateDescriptorPool(_device, &descriptorPoolInfo, nullptr, &m_pool));
+
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = m_pool;
+			allocateInfo.descriptorSetCount = 1;
+			allocateInfo.pSetLayouts = &m_layout->m_descriptorSetLayout;
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(_device, &allocateInfo, &m_vkDescriptorSet));
+		}
+
+		uint32_t VulkanBindlessTable::AllocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& slots, uint32_t capacity)
+		{
+			if (!freeSlots.empty())
+			{
+				uint32_t slot = freeSlots.back();
+				freeSlots.pop_back();
+				return slot;
+			}
+			if (slots == capacity)
+				return UINT32_MAX;
+			return slots++;
+		}
+
+		uint32_t VulkanBindlessTable::AddTexture(Texture* texture)
+		{
+			VulkanTexture* vktexture = dynamic_cast<VulkanTexture*>(texture);
+			if (!vktexture || vktexture->m_bindlessIndex != UINT32_MAX)
+				return texture ? texture->m_bindlessIndex : UINT32_MAX;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			uint32_t slot = AllocateSlot(m_freeTextures, m_textureSlots, m_textureCapacity);
+			if (slot == UINT32_MAX)
+				return UINT32_MAX;
+
+			VkWriteDescriptorSet writeDescriptorSet{};
+			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet.dstSet = m_vkDescriptorSet;
+			writeDescriptorSet.dstBinding = TEXTURES_BINDING;
+			writeDescriptorSet.dstArrayElement = slot;
+			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeDescriptorSet.descriptorCount = 1;
+			writeDescriptorSet.pImageInfo = &vktexture->m_descriptor;
+			vkUpdateDescriptorSets(_device, 1, &writeDescriptorSet, 0, nullptr);
+
+			vktexture->m_bindlessIndex = slot;
+			m_textureCount++;
+			return slot;
+		}
+
+		uint32_t VulkanBindlessTable::AddBuffer(Buffer* buffer)
+		{
+			VulkanBuffer* vkbuffer = dynamic_cast<VulkanBuffer*>(buffer);
+			if (!vkbuffer || vkbuffer->m_bindlessIndex != UINT32_MAX)
+				return buffer ? buffer->m_bindlessIndex : UINT32_MAX;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			uint32_t slot = AllocateSlot(m_freeBuffers, m_bufferSlots, m_bufferCapacity);
+			if (slot == UINT32_MAX)
+				return UINT32_MAX;
+
+			VkWriteDescriptorSet writeDescriptorSet{};
+			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet.dstSet = m_vkDescriptorSet;
+			writeDescriptorSet.dstBinding = BUFFERS_BINDING;
+			writeDescriptorSet.dstArrayElement = slot;
+			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSet.descriptorCount = 1;
+			writeDescriptorSet.pBufferInfo = &vkbuffer->m_descriptor;
+			vkUpdateDescriptorSets(_device, 1, &writeDescriptorSet, 0, nullptr);
+
+			vkbuffer->m_bindlessIndex = slot;
+			m_bufferCount++;
+			return slot;
+		}
+
+		//the descriptor is left in the slot, it is partially bound and the shaders don't read it after the resource is gone
+		void VulkanBindlessTable::RemoveTexture(Texture* texture)
+		{
+			if (!texture || texture->m_bindlessIndex == UINT32_MAX)
+				return;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_freeTextures.push_back(texture->m_bindlessIndex);
+			texture->m_bindlessIndex = UINT32_MAX;
+			m_textureCount--;
+		}
+
+		void VulkanBindlessTable::RemoveBuffer(Buffer* buffer)
+		{
+			if (!buffer || buffer->m_bindlessIndex == UINT32_MAX)
+				return;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_freeBuffers.push_back(buffer->m_bindlessIndex);
+			buffer->m_bindlessIndex = UINT32_MAX;
+			m_bufferCount--;
+		}
+
+		void VulkanBindlessTable::Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkPipelineBindPoint pipelineBindpoint)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, pipelineBindpoint, pipelineLayout, 0, 1, &m_vkDescriptorSet, 0, nullptr);
+		}
+
+		void VulkanBindlessTable::Draw(class CommandBuffer* commandBuffer, Pipeline* pipeline, uint32_t indexInDynamicUniformBuffer)
+		{
+			VulkanCommandBuffer* cb = static_cast<VulkanCommandBuffer*>(commandBuffer);
+			VulkanPipeline* p = static_cast<VulkanPipeline*>(pipeline);
+			Draw(cb->m_vkCommandBuffer, p->getPipelineLayout(), p->getBindPoint());
+			cb->m_statistics.descriptorSetBinds++;
+		}
+
+		VulkanBindlessTable::~VulkanBindlessTable()
+		{
+			if (m_pool != VK_NULL_HANDLE)
+				vkDestroyDescriptorPool(_device, m_pool, nullptr);
+			delete m_layout;
+		}
+	}
+}
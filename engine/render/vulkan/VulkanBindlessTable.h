@@ -0,0 +1,50 @@
+#pragma once
+#include <VulkanTools.h>
+#include "BindlessTable.h"
+#include "VulkanDescriptorSetLayout.h"
+#include <vector>
+#include <mutex>
+
+namespace engine
+{
+	namespace render
+	{
+		/** @brief Bindless table on descriptor indexing, the arrays are partially bound and written after bind,
+		 *  so resources can be added while recorded command buffers use the set */
+		class VulkanBindlessTable : public BindlessTable
+		{
+			VkDevice _device = VK_NULL_HANDLE;
+			VkDescriptorPool m_pool = VK_NULL_HANDLE;
+			VkDescriptorSet m_vkDescriptorSet = VK_NULL_HANDLE;
+			VulkanDescriptorSetLayout* m_layout = nullptr;
+
+			//slots written so far, freed slots are reused before the table grows
+			uint32_t m_textureSlots = 0;
+			uint32_t m_bufferSlots = 0;
+			std::vector<uint32_t> m_freeTextures;
+			std::vector<uint32_t> m_freeBuffers;
+			std::mutex m_mutex;
+
+			uint32_t AllocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& slots, uint32_t capacity);
+
+		public:
+			static const uint32_t TEXTURES_BINDING = 0;
+			static const uint32_t BUFFERS_BINDING = 1;
+
+			/** @brief Creates the layout, the pool and the set, the capacities are clamped to the update after bind limits of the device */
+			void Create(VkDevice device, const VkPhysicalDeviceDescriptorIndexingProperties& limits, uint32_t textureCapacity = 16384, uint32_t bufferCapacity = 4096);
+
+			virtual DescriptorSetLayout* GetLayout() { return m_layout; }
+
+			virtual uint32_t AddTexture(Texture* texture);
+			virtual uint32_t AddBuffer(Buffer* buffer);
+			virtual void RemoveTexture(Texture* texture);
+			virtual void RemoveBuffer(Buffer* buffer);
+
+			void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkPipelineBindPoint pipelineBindpoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+			virtual void Draw(class CommandBuffer* commandBuffer, Pipeline* pipeline = nullptr, uint32_t indexInDynamicUniformBuffer = 0);
+
+			~VulkanBindlessTable();
+		};
+	}
+}
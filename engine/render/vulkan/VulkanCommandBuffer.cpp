@@ -11,6 +11,7 @@ namespace engine
 
 		void VulkanCommandBuffer::Begin()
 		{
+			m_statistics = CommandStatistics();
 			VkCommandBufferBeginInfo cmdBufInfo{};
 			cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 			VK_CHECK_RESULT(vkBeginCommandBuffer(m_vkCommandBuffer, &cmdBufInfo));
@@ -0,0 +1,213 @@
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanDescriptorSet.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace render
+	{
+		const uint32_t VulkanDescriptorAllocator::MIN_SETS_PER_POOL;
+		const uint32_t VulkanDescriptorAllocator::MAX_SETS_PER_POOL;
+
+		size_t VulkanDescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const
+		{
+			size_t hash = std::hash<uint64_t>()((uint64_t)key.layout);
+			hash ^= std::hash<uint32_t>()(key.dynamicAlignment) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			for (auto descriptor : key.descriptors)
+				hash ^= std::hash<const void*>()(descriptor) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+
+		VulkanDescriptorAllocator::CacheKey VulkanDescriptorAllocator::MakeKey(VkDescriptorSetLayout layout, const std::vector<VkDescriptorBufferInfo*>& buffers, const std::vector<VkDescriptorImageInfo*>& textures, uint32_t dynamicAlignment)
+		{
+			CacheKey key;
+			key.layout = layout;
+			key.dynamicAlignment = dynamicAlignment;
+			key.descriptors.reserve(buffers.size() + textures.size());
+			key.descriptors.insert(key.descriptors.end(), buffers.begin(), buffers.end());
+			key.descriptors.insert(key.descriptors.end(), textures.begin(), textures.end());
+			return key;
+		}
+
+		VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t maxSets)
+		{
+			//descriptors per set, the layouts of the projects rarely go over them and a set that does only fills its pool sooner
+			VkDescriptorPoolSize poolSizes[] = {
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * maxSets },
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, maxSets },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * maxSets },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * maxSets },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxSets },
+				{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, maxSets }
+			};
+			VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+			descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(sizeof(poolSizes) / sizeof(poolSizes[0]));
+			descriptorPoolInfo.pPoolSizes = poolSizes;
+			descriptorPoolInfo.maxSets = maxSets;
+
+			VkDescriptorPool pool = VK_NULL_HANDLE;
+			VK_CHECK_RESULT(vkCreateDescriptorPool(_device, &descriptorPoolInfo, nullptr, &pool));
+			return pool;
+		}
+
+		VkDescriptorSet VulkanDescriptorAllocator::Allocate(PoolChain& chain, VkDescriptorSetLayout layout)
+		{
+			while (true)
+			{
+				bool fresh = false;
+				if (chain.current == chain.pools.size())
+				{
+					chain.pools.push_back(CreatePool(chain.setsPerPool));
+					chain.setsPerPool = std::min(chain.setsPerPool * 2, MAX_SETS_PER_POOL);
+					fresh = true;
+				}
+
+				VkDescriptorSetAllocateInfo allocateInfo{};
+				allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+				allocateInfo.descriptorPool = chain.pools[chain.current];
+				allocateInfo.descriptorSetCount = 1;
+				allocateInfo.pSetLayouts = &layout;
+				VkDescriptorSet set = VK_NULL_HANDLE;
+				VkResult result = vkAllocateDescriptorSets(_device, &allocateInfo, &set);
+				if (result == VK_SUCCESS)
+				{
+					chain.sets++;
+					return set;
+				}
+				//a set that doesn't fit in an empty pool will not fit in the next one either
+				if (fresh || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+				{
+					VK_CHECK_RESULT(result);
+					return VK_NULL_HANDLE;
+				}
+				chain.current++;
+			}
+		}
+
+		VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return Allocate(m_persistent, layout);
+		}
+
+		VulkanDescriptorSet* VulkanDescriptorAllocator::GetTransient(uint32_t frame, VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding> layoutBindings,
+			std::vector<VkDescriptorBufferInfo*> buffersDescriptors, std::vector<VkDescriptorImageInfo*> texturesDescriptors)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (frame >= m_transient.size())
+			{
+				m_transient.resize(frame + 1);
+				m_transientSets.resize(frame + 1);
+				m_transientUsed.resize(frame + 1, 0);
+			}
+
+			VkDescriptorSet vkset = Allocate(m_transient[frame], layout);
+
+			//the set objects of the slot are reused, only the vulkan sets are allocated again
+			std::vector<VulkanDescriptorSet*>& sets = m_transientSets[frame];
+			if (m_transientUsed[frame] == sets.size())
+				sets.push_back(new VulkanDescriptorSet());
+			VulkanDescriptorSet* set = sets[m_transientUsed[frame]++];
+			set->ClearDescriptors();
+			set->AddBufferDescriptors(buffersDescriptors);
+			for (auto tex : texturesDescriptors)
+				set->AddTextureDescriptor(tex);
+			set->SetupDescriptors(_device, vkset, layout, layoutBindings);
+			return set;
+		}
+
+		void VulkanDescriptorAllocator::ResetTransient(uint32_t frame)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (frame >= m_transient.size())
+				return;
+			PoolChain& chain = m_transient[frame];
+			for (auto pool : chain.pools)
+				vkResetDescriptorPool(_device, pool, 0);
+			chain.current = 0;
+			chain.sets = 0;
+			m_transientUsed[frame] = 0;
+		}
+
+		VulkanDescriptorSet* VulkanDescriptorAllocator::Share(VkDescriptorSetLayout layout, const std::vector<VkDescriptorBufferInfo*>& buffersDescriptors, const std::vector<VkDescriptorImageInfo*>& texturesDescriptors, uint32_t dynamicAlignment)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_cache.find(MakeKey(layout, buffersDescriptors, texturesDescriptors, dynamicAlignment));
+			if (it == m_cache.end())
+				return nullptr;
+			m_cacheHits++;
+			VulkanDescriptorSet* set = new VulkanDescriptorSet();
+			set->Share(it->second);
+			set->_allocator = this;
+			return set;
+		}
+
+		void VulkanDescriptorAllocator::Cache(VulkanDescriptorSet* set, VkDescriptorSetLayout layout)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cache[MakeKey(layout, set->GetBufferDescriptors(), set->GetTextureDescriptors(), set->GetDynamicAlignment())] = set;
+			set->_allocator = this;
+			set->m_cached = true;
+		}
+
+		//updates and destroys are rare, the cache is walked instead of keeping a second map
+		void VulkanDescriptorAllocator::Uncache(VulkanDescriptorSet* set)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+			{
+				if (it->second == set)
+				{
+					m_cache.erase(it);
+					break;
+				}
+			}
+			set->m_cached = false;
+		}
+
+		void VulkanDescriptorAllocator::Forget(const void* descriptor)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto it = m_cache.begin(); it != m_cache.end();)
+			{
+				const std::vector<const void*>& descriptors = it->first.descriptors;
+				if (std::find(descriptors.begin(), descriptors.end(), descriptor) != descriptors.end())
+				{
+					it->second->m_cached = false;
+					it = m_cache.erase(it);
+				}
+				else
+					++it;
+			}
+		}
+
+		DescriptorStatistics VulkanDescriptorAllocator::GetStatistics()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			DescriptorStatistics statistics;
+			statistics.pools = static_cast<uint32_t>(m_persistent.pools.size());
+			statistics.sets = m_persistent.sets;
+			for (auto& chain : m_transient)
+			{
+				statistics.transientPools += static_cast<uint32_t>(chain.pools.size());
+				statistics.transientSets += chain.sets;
+			}
+			statistics.cachedSets = static_cast<uint32_t>(m_cache.size());
+			statistics.cacheHits = m_cacheHits;
+			return statistics;
+		}
+
+		VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+		{
+			for (auto& sets : m_transientSets)
+				for (auto set : sets)
+					delete set;
+			for (auto& chain : m_transient)
+				for (auto pool : chain.pools)
+					vkDestroyDescriptorPool(_device, pool, nullptr);
+			for (auto pool : m_persistent.pools)
+				vkDestroyDescriptorPool(_device, pool, nullptr);
+		}
+	}
+}
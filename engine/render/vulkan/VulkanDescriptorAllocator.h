@@ -0,0 +1,86 @@
+#pragma once
+#include <VulkanTools.h>
+#include "DescriptorPool.h"
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+namespace engine
+{
+	namespace render
+	{
+		class VulkanDescriptorSet;
+
+		/** @brief Allocates descriptor sets from pools it grows on its own. Persistent sets live until the device is destroyed and requests with
+		 *  the same layout and resources share one vulkan set until one of their set objects is updated. Transient sets belong to a frame slot
+		 *  and their pools are reset together */
+		class VulkanDescriptorAllocator
+		{
+			//pools of one lifetime, the ones before current are full
+			struct PoolChain
+			{
+				std::vector<VkDescriptorPool> pools;
+				uint32_t current = 0;
+				uint32_t setsPerPool = MIN_SETS_PER_POOL;
+				uint32_t sets = 0;
+			};
+
+			struct CacheKey
+			{
+				VkDescriptorSetLayout layout;
+				std::vector<const void*> descriptors;
+				uint32_t dynamicAlignment;
+				bool operator==(const CacheKey& other) const { return layout == other.layout && dynamicAlignment == other.dynamicAlignment && descriptors == other.descriptors; }
+			};
+
+			struct CacheKeyHash
+			{
+				size_t operator()(const CacheKey& key) const;
+			};
+
+			VkDevice _device = VK_NULL_HANDLE;
+			PoolChain m_persistent;
+			std::vector<PoolChain> m_transient;
+			//set objects of every frame slot, the first m_transientUsed of them hold this frame's sets
+			std::vector<std::vector<VulkanDescriptorSet*>> m_transientSets;
+			std::vector<uint32_t> m_transientUsed;
+			std::unordered_map<CacheKey, VulkanDescriptorSet*, CacheKeyHash> m_cache;
+			uint64_t m_cacheHits = 0;
+			std::mutex m_mutex;
+
+			VkDescriptorPool CreatePool(uint32_t maxSets);
+			VkDescriptorSet Allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+			static CacheKey MakeKey(VkDescriptorSetLayout layout, const std::vector<VkDescriptorBufferInfo*>& buffers, const std::vector<VkDescriptorImageInfo*>& textures, uint32_t dynamicAlignment);
+
+		public:
+			static const uint32_t MIN_SETS_PER_POOL = 64;
+			static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+			void Create(VkDevice device) { _device = device; }
+
+			/** @brief Allocates a persistent set, a new pool twice the size of the last one is created when the pools are full */
+			VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+			/** @brief A set that is valid until ResetTransient is called for the same frame slot, it is never shared */
+			VulkanDescriptorSet* GetTransient(uint32_t frame, VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding> layoutBindings,
+				std::vector<VkDescriptorBufferInfo*> buffersDescriptors, std::vector<VkDescriptorImageInfo*> texturesDescriptors);
+
+			/** @brief Frees every transient set of the frame slot at once, the GPU must be done with them */
+			void ResetTransient(uint32_t frame);
+
+			/** @brief A new set object using the vulkan set of the cached one with these resources, nullptr when there is none yet */
+			VulkanDescriptorSet* Share(VkDescriptorSetLayout layout, const std::vector<VkDescriptorBufferInfo*>& buffersDescriptors, const std::vector<VkDescriptorImageInfo*>& texturesDescriptors, uint32_t dynamicAlignment);
+			/** @brief The set must have been allocated by this allocator */
+			void Cache(VulkanDescriptorSet* set, VkDescriptorSetLayout layout);
+
+			/** @brief Stops handing out a set, called when one of its descriptors is rewritten */
+			void Uncache(VulkanDescriptorSet* set);
+			/** @brief Stops sharing the sets that point to the descriptor of a destroyed buffer or texture */
+			void Forget(const void* descriptor);
+
+			DescriptorStatistics GetStatistics();
+
+			~VulkanDescriptorAllocator();
+		};
+	}
+}
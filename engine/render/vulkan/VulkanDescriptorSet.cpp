@@ -1,6 +1,7 @@
 #include "VulkanDescriptorSet.h"
 #include "VulkanCommandBuffer.h"
 #include "VulkanPipeline.h"
+#include "VulkanDescriptorAllocator.h"
 
 namespace engine
 {
@@ -16,16 +17,25 @@ namespace engine
 			if (m_vkDescriptorSet != VK_NULL_HANDLE)
 				return;
 
-			_device = device;
 			_descriptorPool = pool;
-			_layout = layout;
 			// Allocates an empty descriptor set without actual descriptors from the pool using the set layout
 			VkDescriptorSetAllocateInfo allocateInfo{};
 			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 			allocateInfo.descriptorPool = _descriptorPool;
 			allocateInfo.descriptorSetCount = 1;
 			allocateInfo.pSetLayouts = &layout;
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(_device, &allocateInfo, &m_vkDescriptorSet));
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocateInfo, &set));
+
+			SetupDescriptors(device, set, layout, layoutBindings);
+		}
+
+		void VulkanDescriptorSet::SetupDescriptors(VkDevice device, VkDescriptorSet set, VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding> layoutBindings)
+		{
+			_device = device;
+			_layout = layout;
+			m_vkDescriptorSet = set;
+			m_layoutBindings = layoutBindings;
 
 			std::vector <VkWriteDescriptorSet> writeDescriptorSets;
 			writeDescriptorSets.resize(layoutBindings.size());
@@ -60,8 +70,39 @@ namespace engine
 			vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 		}
 
+		void VulkanDescriptorSet::ClearDescriptors()
+		{
+			m_vkDescriptorSet = VK_NULL_HANDLE;
+			m_layoutBindings.clear();
+			_BuffersDescriptors.clear();
+			_TexturesDescriptors.clear();
+			m_dynamicAlignment = 0;
+			m_shared = false;
+		}
+
+		void VulkanDescriptorSet::Share(VulkanDescriptorSet* set)
+		{
+			_device = set->_device;
+			_layout = set->_layout;
+			m_vkDescriptorSet = set->m_vkDescriptorSet;
+			m_layoutBindings = set->m_layoutBindings;
+			_BuffersDescriptors = set->_BuffersDescriptors;
+			_TexturesDescriptors = set->_TexturesDescriptors;
+			m_dynamicAlignment = set->m_dynamicAlignment;
+			m_shared = true;
+			set->m_shared = true;
+		}
+
 		void VulkanDescriptorSet::Update(uint32_t binding, VkDescriptorType descType, VkDescriptorBufferInfo *bufferInfo, VkDescriptorImageInfo *imageInfo)
 		{
+			if (m_cached)
+				_allocator->Uncache(this);
+			//the other owners keep the old descriptors, this object writes into its own copy from now on
+			if (m_shared)
+			{
+				m_shared = false;
+				SetupDescriptors(_device, _allocator->Allocate(_layout), _layout, m_layoutBindings);
+			}
 			VkWriteDescriptorSet writeDescriptorSet{};
 			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			writeDescriptorSet.dstSet = m_vkDescriptorSet;
@@ -86,6 +127,7 @@ namespace engine
 			VulkanCommandBuffer* cb = static_cast<VulkanCommandBuffer*>(commandBuffer);
 			VulkanPipeline* p = static_cast<VulkanPipeline*>(pipeline);
 			Draw(cb->m_vkCommandBuffer, p->getPipelineLayout(), indexInDynamicUniformBuffer, p->getBindPoint());
+			cb->m_statistics.descriptorSetBinds++;
 		}
 	}
 }
@@ -17,17 +17,32 @@ namespace engine
 			VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
 			VkDescriptorSetLayout _layout = VK_NULL_HANDLE;
 			VkDescriptorSet m_vkDescriptorSet = VK_NULL_HANDLE;
+			std::vector<VkDescriptorSetLayoutBinding> m_layoutBindings;
 			std::vector<VkDescriptorBufferInfo*> _BuffersDescriptors;
 			std::vector<VkDescriptorImageInfo*> _TexturesDescriptors;
 			uint32_t m_dynamicAlignment = 0;
+			//other set objects may use m_vkDescriptorSet too, it is copied before a write
+			bool m_shared = false;
 
 		public:
+			//the allocator the set came from, a shared set gets its copy from it
+			class VulkanDescriptorAllocator* _allocator = nullptr;
+			//handed out by the allocator to equal requests, set under its lock
+			bool m_cached = false;
+
 			~VulkanDescriptorSet();
 
 			void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t indexInDynamicUniformBuffer, VkPipelineBindPoint pipelineBindpoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
 			void SetDynamicAlignment(uint32_t value) { m_dynamicAlignment = value; }
+			uint32_t GetDynamicAlignment() const { return m_dynamicAlignment; }
 
 			void SetupDescriptors(VkDevice, VkDescriptorPool, VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>);
+			/** @brief Writes the descriptors into a set that was already allocated */
+			void SetupDescriptors(VkDevice, VkDescriptorSet, VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>);
+			/** @brief Forgets the set and its descriptors so the object can be set up again */
+			void ClearDescriptors();
+			/** @brief Uses the vulkan set of the other object, both copy it before their next Update */
+			void Share(VulkanDescriptorSet* set);
 
 			void Update(uint32_t binding, VkDescriptorType descType, VkDescriptorBufferInfo* bufferInfo, VkDescriptorImageInfo* imageInfo);
 
@@ -36,6 +51,8 @@ namespace engine
 
 			void AddBufferDescriptor(VkDescriptorBufferInfo* desc) { _BuffersDescriptors.push_back(desc); };
 			void AddBufferDescriptors(std::vector<VkDescriptorBufferInfo*> inputArray) { _BuffersDescriptors.insert(_BuffersDescriptors.end(), inputArray.begin(), inputArray.end()); };
+			const std::vector<VkDescriptorBufferInfo*>& GetBufferDescriptors() const { return _BuffersDescriptors; }
+			const std::vector<VkDescriptorImageInfo*>& GetTextureDescriptors() const { return _TexturesDescriptors; }
 
 			virtual void Draw(class CommandBuffer* commandBuffer, Pipeline* pipeline = nullptr, uint32_t indexInDynamicUniformBuffer = 0);
 		};
@@ -5,16 +5,26 @@
 #include "VulkanCommandBuffer.h"
 #include "VulkanCommandPool.h"
 #include <set>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
 
 namespace engine
 {
     namespace render
     {
-        VulkanDevice::VulkanDevice(VkInstance instance, VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface, void* pNextChain)
+        VulkanDevice::VulkanDevice(VkInstance instance, VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface, void* pNextChain, bool bindless)
         {
             _instance = instance;
             GetPhysicalDevice(wantedFeatures, wantedExtensions, surface);
+            if (bindless)
+                pNextChain = EnableBindless(pNextChain);
             CreateLogicalDevice({ "VK_LAYER_KHRONOS_validation" }, pNextChain);//TODO DEBUG
+            m_descriptorAllocator = new VulkanDescriptorAllocator;
+            m_descriptorAllocator->Create(logicalDevice);
+            if (m_descriptorIndexingFeatures.runtimeDescriptorArray)
+                CreateBindlessTable();
         }
 
         void VulkanDevice::GetPhysicalDevice(VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface)
@@ -25,6 +35,8 @@ namespace engine
 
             std::vector<VkPhysicalDevice> devices(deviceCount);
             vkEnumeratePhysicalDevices(_instance, &deviceCount, devices.data());
+            //a discrete gpu first, then any device with the features (integrated gpus, software drivers like lavapipe on ci machines)
+            for (int pass = 0; pass < 2 && physicalDevice == VK_NULL_HANDLE; pass++)
             for (const auto& device : devices)
             {
                 VkPhysicalDeviceProperties deviceProperties;
@@ -59,7 +71,7 @@ namespace engine
 
                 allExtensionsOk = requiredExtensions.empty();
 
-                if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && allFeaturesOk)
+                if ((pass > 0 || deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) && allFeaturesOk)
                 {
                     uint32_t queueFamilyCount = 0;
                     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
@@ -87,6 +99,8 @@ namespace engine
                     }
 
                     queueFamilyIndices.presentFamily = queueFamilyIndices.graphicsFamily;//George - for now it's faster on the gpu to use only one queue
+                    if (surface == VK_NULL_HANDLE)
+                        queueFamilyIndices.hasPresentValue = queueFamilyIndices.hasGraphivsValue;//headless, nothing is presented
 
                     if (!queueFamilyIndices.isComplete())
                         continue;
@@ -95,6 +109,8 @@ namespace engine
 
                     m_properties = deviceProperties;
                     m_enabledFeatures = deviceFeatures;
+                    //optional, wanted or not it is enabled whenever the device has it: the meshlets of a mesh are drawn with one indirect call
+                    m_enabledFeatures.multiDrawIndirect = deviceFeatures.multiDrawIndirect;
                     m_enabledExtensions = wantedExtensions;
                     physicalDevice = device;
                     return;
@@ -157,6 +173,67 @@ namespace engine
             }
         }
 
+        void* VulkanDevice::EnableBindless(void* pNextChain)
+        {
+            //descriptor indexing is core since 1.2, older devices need the extension
+            bool core = m_properties.apiVersion >= VK_API_VERSION_1_2;
+            if (!core)
+            {
+                uint32_t extensionCount;
+                vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+                std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+                vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+                bool found = false;
+                for (const auto& extension : availableExtensions)
+                    found |= strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+                if (!found)
+                {
+                    std::cerr << "The device has no descriptor indexing, the bindless table is disabled" << std::endl;
+                    return pNextChain;
+                }
+            }
+
+            VkPhysicalDeviceDescriptorIndexingFeatures supported{};
+            supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            VkPhysicalDeviceFeatures2 deviceFeatures2{};
+            deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            deviceFeatures2.pNext = &supported;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+            if (!supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound || !supported.shaderSampledImageArrayNonUniformIndexing
+                || !supported.descriptorBindingSampledImageUpdateAfterBind || !supported.descriptorBindingStorageBufferUpdateAfterBind || !supported.descriptorBindingUpdateUnusedWhilePending)
+            {
+                std::cerr << "The device has no descriptor indexing, the bindless table is disabled" << std::endl;
+                return pNextChain;
+            }
+
+            m_descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            m_descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            m_descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            m_descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            m_descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            m_descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            m_descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            m_descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing = supported.shaderStorageBufferArrayNonUniformIndexing;
+            m_descriptorIndexingFeatures.pNext = pNextChain;
+            if (!core)
+                m_enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            return &m_descriptorIndexingFeatures;
+        }
+
+        void VulkanDevice::CreateBindlessTable()
+        {
+            VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+            indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+            VkPhysicalDeviceProperties2 deviceProperties2{};
+            deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            deviceProperties2.pNext = &indexingProperties;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
+
+            VulkanBindlessTable* table = new VulkanBindlessTable;
+            table->Create(logicalDevice, indexingProperties);
+            m_bindlessTable = table;
+        }
+
         VkBool32 VulkanDevice::GetSupportedDepthFormat(VkFormat* depthFormat)
         {
             // Since all depth formats may be optional, we need to find a suitable depth format to use
@@ -220,6 +297,8 @@ namespace engine
             }
 
             m_buffers.push_back(buffer);
+            if (m_bindlessTable && (usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+                m_bindlessTable->AddBuffer(buffer);
 
             return buffer;
         }
@@ -227,11 +306,15 @@ namespace engine
         VulkanBuffer* VulkanDevice::GetUniformBuffer(VkDeviceSize size, bool frequentUpdate, VkQueue queue, void* data)
         {
             VulkanBuffer* buffer = nullptr;
+            //in the bindless table the uniform buffers are read as storage buffers, their std140 members have to keep the same offsets in std430
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            if (m_bindlessTable)
+                usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 
             if (frequentUpdate)
             {
                 buffer = GetBuffer(
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    usage,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                     size);
             }
@@ -240,7 +323,7 @@ namespace engine
                 assert(queue);
                 assert(data);
 
-                buffer = GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                buffer = GetBuffer(usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                     size);
                 VulkanBuffer* staging = CreateStagingBuffer(size, data);
@@ -329,6 +412,8 @@ namespace engine
                 m_enabledFeatures.samplerAnisotropy ? m_properties.limits.maxSamplerAnisotropy : 1.0f);
 
             m_textures.push_back(tex);
+            if (m_bindlessTable && (imageUsageFlags & VK_IMAGE_USAGE_SAMPLED_BIT))
+                m_bindlessTable->AddTexture(tex);
 
             return tex;
         }
@@ -340,7 +425,8 @@ namespace engine
         {
             VulkanTexture* tex = new VulkanTexture;
 
-            tex->Create(logicalDevice, &memoryProperties, extent, format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, imageLayout, VK_IMAGE_ASPECT_COLOR_BIT, mipLevelsCount, layersCount);
+            //transfer dst so volumes baked on the CPU can be uploaded into them
+            tex->Create(logicalDevice, &memoryProperties, extent, format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageLayout, VK_IMAGE_ASPECT_COLOR_BIT, mipLevelsCount, layersCount);
 
             VkCommandBuffer layoutCmd = CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
             tex->m_descriptor.imageLayout = imageLayout;//TODO maybe also shader read only optimal
@@ -353,6 +439,8 @@ namespace engine
             tex->CreateDescriptor(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, viewType, m_enabledFeatures.samplerAnisotropy ? m_properties.limits.maxSamplerAnisotropy : 1.0f);
 
             m_textures.push_back(tex);
+            if (m_bindlessTable)
+                m_bindlessTable->AddTexture(tex);
 
             return tex;
         }
@@ -363,9 +451,35 @@ namespace engine
             tex->Create(logicalDevice, &memoryProperties, { width, height, 1 }, format, usage, imageLayout, aspect);
             tex->CreateDescriptor(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_IMAGE_VIEW_TYPE_2D);
             m_textures.push_back(tex);
+            //a view with the stencil aspect can't be sampled
+            if (m_bindlessTable && (usage & VK_IMAGE_USAGE_SAMPLED_BIT) && !(aspect & VK_IMAGE_ASPECT_STENCIL_BIT))
+                m_bindlessTable->AddTexture(tex);
             return tex;
         }
 
+        VulkanTimestampQueries* VulkanDevice::GetTimestampQueries(uint32_t queriesPerSlot, uint32_t slots)
+        {
+            VulkanTimestampQueries* queries = new VulkanTimestampQueries;
+            queries->Create(logicalDevice, m_properties, m_queueFamilyProperties[queueFamilyIndices.graphicsFamily], queriesPerSlot, slots);
+            m_timestampQueries.push_back(queries);
+            return queries;
+        }
+
+        VulkanAccelerationStructures* VulkanDevice::GetAccelerationStructures(uint32_t slots)
+        {
+            VulkanAccelerationStructures* structures = new VulkanAccelerationStructures;
+            structures->Create(this, slots);
+            m_accelerationStructures.push_back(structures);
+            return structures;
+        }
+
+        VulkanRenderGraph* VulkanDevice::GetRenderGraph()
+        {
+            VulkanRenderGraph* graph = new VulkanRenderGraph;
+            m_renderGraphs.push_back(graph);
+            return graph;
+        }
+
         VulkanTexture* VulkanDevice::GetColorRenderTarget(uint32_t width, uint32_t height, VkFormat format)
         {
             return GetRenderTarget(width, height, format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
@@ -410,6 +524,9 @@ namespace engine
             {
                 if (*it == texture)
                 {
+                    if (m_bindlessTable)
+                        m_bindlessTable->RemoveTexture(texture);
+                    m_descriptorAllocator->Forget(&texture->m_descriptor);
                     delete texture;
                     m_textures.erase(it);
                     return;
@@ -417,16 +534,65 @@ namespace engine
             }
         }
 
-        VkPipelineCache VulkanDevice::CreatePipelineCache()
+        void VulkanDevice::DestroyBuffer(Buffer* buffer)
         {
+            VulkanBuffer* vkbuffer = dynamic_cast<VulkanBuffer*>(buffer);
+            if (vkbuffer)
+                m_descriptorAllocator->Forget(&vkbuffer->m_descriptor);
+            GraphicsDevice::DestroyBuffer(buffer);
+        }
+
+        VkPipelineCache VulkanDevice::CreatePipelineCache(const std::string& file)
+        {
+            m_pipelineCacheFile = file;
+            std::vector<char> data;
+            if (!file.empty())
+            {
+                std::ifstream is(file, std::ios::binary | std::ios::in | std::ios::ate);
+                if (is.is_open())
+                {
+                    data.resize(static_cast<size_t>(is.tellg()));
+                    is.seekg(0, std::ios::beg);
+                    is.read(data.data(), data.size());
+                }
+            }
+
+            //the header names the device and driver the data was saved by, data of another one is dropped
+            VkPipelineCacheHeaderVersionOne header;
+            if (data.size() < sizeof(header))
+                data.clear();
+            else
+            {
+                memcpy(&header, data.data(), sizeof(header));
+                if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.vendorID != m_properties.vendorID || header.deviceID != m_properties.deviceID ||
+                    memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+                    data.clear();
+            }
+
             VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
             pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            pipelineCacheCreateInfo.initialDataSize = data.size();
+            pipelineCacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
             VK_CHECK_RESULT(vkCreatePipelineCache(logicalDevice, &pipelineCacheCreateInfo, nullptr, &pipelineCache));
             return pipelineCache;
         }
 
         void VulkanDevice::DestroyPipelineCache()
         {
+            if (!m_pipelineCacheFile.empty())
+            {
+                size_t size = 0;
+                std::vector<char> data;
+                if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &size, nullptr) == VK_SUCCESS && size > 0)
+                {
+                    data.resize(size);
+                    if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &size, data.data()) == VK_SUCCESS)
+                    {
+                        std::ofstream os(m_pipelineCacheFile, std::ios::binary | std::ios::out | std::ios::trunc);
+                        os.write(data.data(), size);
+                    }
+                }
+            }
             vkDestroyPipelineCache(logicalDevice, pipelineCache, nullptr);
         }
 
@@ -470,7 +636,15 @@ namespace engine
             PipelineProperties properties)
         {
             VulkanPipeline* pipeline = new VulkanPipeline;
-            pipeline->Create(logicalDevice, descriptorSetLayout, vertexInputBindings, vertexInputAttributes, vertexFile, fragmentFile, renderPass, cache, properties);
+            if (m_prewarmPipelines)
+            {
+                pipeline->Describe(logicalDevice, descriptorSetLayout, vertexInputBindings, vertexInputAttributes, vertexFile, fragmentFile, renderPass, cache, properties);
+                m_pendingPipelines.push_back(pipeline);
+            }
+            else
+            {
+                pipeline->Create(logicalDevice, descriptorSetLayout, vertexInputBindings, vertexInputAttributes, vertexFile, fragmentFile, renderPass, cache, properties);
+            }
             m_pipelines.push_back(pipeline);
             return pipeline;
         }
@@ -521,7 +695,6 @@ namespace engine
             std::vector<VkDescriptorImageInfo*> texturesDescriptors,
             VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding> layoutBindings, uint32_t dynamicAllingment)
         {
-            //TODO add a fast function that checks if we already have a descriptor like this
             VulkanDescriptorSet* set = new VulkanDescriptorSet();
 
             set->AddBufferDescriptors(buffersDescriptors);
@@ -529,7 +702,22 @@ namespace engine
             for (auto tex : texturesDescriptors)
                 set->AddTextureDescriptor(tex);
 
-            set->SetupDescriptors(logicalDevice, pool, layout, layoutBindings);
+            //a pool sized too small by the caller spills into the pools of the device instead of failing
+            VkDescriptorSet vkset = VK_NULL_HANDLE;
+            if (pool != VK_NULL_HANDLE)
+            {
+                VkDescriptorSetAllocateInfo allocateInfo{};
+                allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocateInfo.descriptorPool = pool;
+                allocateInfo.descriptorSetCount = 1;
+                allocateInfo.pSetLayouts = &layout;
+                if (vkAllocateDescriptorSets(logicalDevice, &allocateInfo, &vkset) != VK_SUCCESS)
+                    vkset = VK_NULL_HANDLE;
+            }
+            if (vkset == VK_NULL_HANDLE)
+                vkset = m_descriptorAllocator->Allocate(layout);
+
+            set->SetupDescriptors(logicalDevice, vkset, layout, layoutBindings);
             m_descriptorSets.push_back(set);
             return set;
         }
@@ -559,11 +747,32 @@ namespace engine
             std::vector <std::pair<VkFormat, VkImageLayout>> layouts;
             VulkanRenderPass* pass = new VulkanRenderPass;
 
+            std::vector<bool> allowTransient;
             for (auto tex : textures)
             {
                 layouts.push_back({ tex->m_format, tex->m_descriptor.imageLayout });
+                allowTransient.push_back(tex->m_allowTransient);
+            }
+            pass->Create(logicalDevice, layouts, false, subpasses, allowTransient);
+
+            //the attachments that never leave the pass don't need memory that is written out, or any memory on tile based GPUs.
+            //Only the textures that opted in are created again, the others may still be sampled or copied
+            for (uint32_t i = 0; i < textures.size(); i++)
+            {
+                VulkanTexture* tex = textures[i];
+                if (!pass->IsTransient(i))
+                    continue;
+                if (!tex->m_transient)
+                {
+                    if (m_bindlessTable)
+                        m_bindlessTable->RemoveTexture(tex);
+                    m_descriptorAllocator->Forget(&tex->m_descriptor);
+                    tex->MakeTransient(&memoryProperties);
+                }
+                pass->m_statistics.transientAttachments++;
+                pass->m_statistics.lazilyAllocatedAttachments += tex->m_lazilyAllocated ? 1 : 0;
+                pass->m_statistics.savedBytesPerFrame += tex->m_imageSize;
             }
-            pass->Create(logicalDevice, layouts, false, subpasses);
             m_renderPasses.push_back(pass);
             return pass;
         }
@@ -782,12 +991,17 @@ namespace engine
         {
             if (onCPU)
             {
-                GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, copyQueue, size, data, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+                return GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, copyQueue, size, data, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
             }
             else
                 return GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, copyQueue, size, data);
         }
 
+        Buffer* VulkanDevice::GetIndirectBuffer(size_t size, void* data, DescriptorPool* descriptorPool, CommandBuffer* commandBuffer)
+        {
+            return GetGeometryBuffer(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, copyQueue, size, data);
+        }
+
         Texture* VulkanDevice::GetTexture(TextureData* data, DescriptorPool* descriptorPool, CommandBuffer* commandBuffer, bool generateMipmaps)
         {
             /*VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
@@ -844,7 +1058,6 @@ namespace engine
         DescriptorSet* VulkanDevice::GetDescriptorSet(DescriptorSetLayout* layout, DescriptorPool* pool, std::vector<Buffer*> buffers, std::vector <Texture*> textures, size_t dynamicAlignment)
         {
             VulkanDescriptorSetLayout* vklayout = dynamic_cast<VulkanDescriptorSetLayout*>(layout);
-            VulkanDescriptorPool* vkpool = dynamic_cast<VulkanDescriptorPool*>(pool);
             std::vector<VkDescriptorBufferInfo*> buffersDescriptors(buffers.size());
             for (int i = 0; i < buffers.size(); i++)
             {
@@ -857,25 +1070,56 @@ namespace engine
                 VulkanTexture* vktexture = dynamic_cast<VulkanTexture*>(textures[i]);
                 texturesDescriptors[i]= &vktexture->m_descriptor;
             }
-            VulkanDescriptorSet* set = GetDescriptorSet(vkpool->m_vkPool, buffersDescriptors, texturesDescriptors, vklayout->m_descriptorSetLayout, vklayout->m_setLayoutBindings, dynamicAlignment);
-            //m_descriptorSets.push_back(set);
+            //every caller gets its own set object, the vulkan set behind it is shared until one of them is updated
+            VulkanDescriptorSet* set = m_descriptorAllocator->Share(vklayout->m_descriptorSetLayout, buffersDescriptors, texturesDescriptors, static_cast<uint32_t>(dynamicAlignment));
+            if (set)
+            {
+                m_descriptorSets.push_back(set);
+                return set;
+            }
+            //shared sets come from the pools of the device, the pool of the caller can be destroyed while others still use them
+            set = GetDescriptorSet(VK_NULL_HANDLE, buffersDescriptors, texturesDescriptors, vklayout->m_descriptorSetLayout, vklayout->m_setLayoutBindings, dynamicAlignment);
+            m_descriptorAllocator->Cache(set, vklayout->m_descriptorSetLayout);
             return set;
         }
 
+        DescriptorSet* VulkanDevice::GetTransientDescriptorSet(DescriptorSetLayout* layout, std::vector<Buffer*> buffers, std::vector <Texture*> textures, uint32_t frame)
+        {
+            VulkanDescriptorSetLayout* vklayout = dynamic_cast<VulkanDescriptorSetLayout*>(layout);
+            std::vector<VkDescriptorBufferInfo*> buffersDescriptors(buffers.size());
+            for (int i = 0; i < buffers.size(); i++)
+                buffersDescriptors[i] = &dynamic_cast<VulkanBuffer*>(buffers[i])->m_descriptor;
+            std::vector<VkDescriptorImageInfo*> texturesDescriptors(textures.size());
+            for (int i = 0; i < textures.size(); i++)
+                texturesDescriptors[i] = &dynamic_cast<VulkanTexture*>(textures[i])->m_descriptor;
+            return m_descriptorAllocator->GetTransient(frame, vklayout->m_descriptorSetLayout, vklayout->m_setLayoutBindings, buffersDescriptors, texturesDescriptors);
+        }
+
+        void VulkanDevice::ResetTransientDescriptorSets(uint32_t frame)
+        {
+            m_descriptorAllocator->ResetTransient(frame);
+        }
+
+        DescriptorStatistics VulkanDevice::GetDescriptorStatistics()
+        {
+            return m_descriptorAllocator->GetStatistics();
+        }
+
         RenderPass* VulkanDevice::GetRenderPass(uint32_t width, uint32_t height, std::vector<Texture*> colorTextures, Texture* depthTexture, std::vector<RenderSubpass> subpasses)
         {
-            std::vector<VkImageView> texturesViews(colorTextures.size());
             std::vector<VulkanTexture*> vktextures(colorTextures.size());
             for (int i = 0; i < colorTextures.size(); i++)
             {
                 vktextures[i] = dynamic_cast<VulkanTexture*>(colorTextures[i]);
-                texturesViews[i] = vktextures[i]->m_descriptor.imageView;
             }
             VulkanTexture* vkdtexture = dynamic_cast<VulkanTexture*>(depthTexture);
             vktextures.push_back(vkdtexture);
-            texturesViews.push_back(vkdtexture->m_descriptor.imageView);
 
             VulkanRenderPass* scenepass = GetRenderPass(vktextures, subpasses);
+            //after the pass, it creates the transient attachments again
+            std::vector<VkImageView> texturesViews;
+            for (auto tex : vktextures)
+                texturesViews.push_back(tex->m_descriptor.imageView);
             VulkanFrameBuffer* fb = GetFrameBuffer(scenepass->GetRenderPass(), width, height, texturesViews, { { 0.0f, 0.0f, 0.0f, 1.0f } });
             scenepass->AddFrameBuffer(fb);
             //m_renderPasses.push_back(scenepass);
@@ -893,6 +1137,49 @@ namespace engine
             return pipeline;
         }
 
+        void VulkanDevice::BeginPipelinePrewarm()
+        {
+            m_prewarmPipelines = true;
+        }
+
+        PipelinePrewarmStatistics VulkanDevice::CompilePipelines(ThreadPool* threadPool, const std::function<void(uint32_t compiled, uint32_t count)>& progress)
+        {
+            m_prewarmPipelines = false;
+
+            PipelinePrewarmStatistics statistics;
+            statistics.pipelines = static_cast<uint32_t>(m_pendingPipelines.size());
+            statistics.threads = threadPool ? std::max(static_cast<uint32_t>(threadPool->threads.size()), 1u) : 1;
+
+            //the pipeline cache is synchronized by the driver, every pipeline has its own shader modules and layout
+            std::mutex progressMutex;
+            uint32_t compiled = 0;
+            auto tStart = std::chrono::high_resolution_clock::now();
+            auto compile = [&](uint32_t job) {
+                auto tCompile = std::chrono::high_resolution_clock::now();
+                m_pendingPipelines[job]->Compile();
+                float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - tCompile).count();
+
+                std::lock_guard<std::mutex> lock(progressMutex);
+                compiled++;
+                statistics.compileMilliseconds += milliseconds;
+                if (progress)
+                    progress(compiled, statistics.pipelines);
+            };
+            if (threadPool)
+            {
+                threadPool->runJobs(statistics.pipelines, compile);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < statistics.pipelines; i++)
+                    compile(i);
+            }
+            statistics.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+            m_pendingPipelines.clear();
+            return statistics;
+        }
+
         Pipeline* VulkanDevice::GetComputePipeline(std::string computeFileName, std::string computeEntry, DescriptorSetLayout* descriptorSetlayout, uint32_t constanBlockSize)
         {
             VulkanDescriptorSetLayout* vkdlayout = dynamic_cast<VulkanDescriptorSetLayout*>(descriptorSetlayout);
@@ -945,8 +1232,23 @@ namespace engine
         {
             VulkanVertexLayout* vkvlayout = dynamic_cast<VulkanVertexLayout*>(vlayout);
             VulkanMesh* mesh = new VulkanMesh(logicalDevice, vkvlayout->GetVertexInputBinding(VK_VERTEX_INPUT_RATE_VERTEX), vkvlayout->GetVertexInputBinding(VK_VERTEX_INPUT_RATE_INSTANCE));
-            if(data->m_indexCount > 0)
-            mesh->_indexBuffer = GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, copyQueue, data->m_indexCount * sizeof(uint32_t), data->m_indices);
+            mesh->m_multiDrawIndirect = m_enabledFeatures.multiDrawIndirect == VK_TRUE;
+            if (data->m_indexCount > 0)
+            {
+                //upload 16 bit indices whenever the mesh allows it
+                if (data->FitsShortIndices())
+                {
+                    uint16_t* shortIndices = data->GetShortIndices();
+                    mesh->_indexBuffer = GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, copyQueue, data->m_indexCount * sizeof(uint16_t), shortIndices);
+                    mesh->m_indexSize = sizeof(uint16_t);
+                    delete[] shortIndices;
+                }
+                else
+                {
+                    mesh->_indexBuffer = GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, copyQueue, data->m_indexCount * data->m_indexSize, data->m_indices);
+                    mesh->m_indexSize = data->m_indexSize;
+                }
+            }
             VkDeviceSize vertexBufferSize = data->m_vertexCount * vlayout->GetVertexSize(0);
             if(vertexBufferSize > 0)
             mesh->_vertexBuffer = GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, copyQueue, vertexBufferSize, data->m_vertices);
@@ -1012,6 +1314,13 @@ namespace engine
                 vkDestroyCommandPool(logicalDevice, cmdPool.second, nullptr);
             }
             m_commandPools.clear();*/
+            //the structures give their buffers back to the device
+            for (auto structures : m_accelerationStructures)
+                delete structures;
+            m_accelerationStructures.clear();
+            for (auto graph : m_renderGraphs)
+                delete graph;
+            m_renderGraphs.clear();
             for (auto cb : m_primaryCommandPools)
                 delete cb;
             m_primaryCommandPools.clear();
@@ -1050,12 +1359,20 @@ namespace engine
             for (auto pool : m_descriptorPools)
                 delete pool;
             m_descriptorPools.clear();
+            for (auto queries : m_timestampQueries)
+                delete queries;
+            m_timestampQueries.clear();
            /* for (auto pool : m_descriptorPools)
             if (pool != VK_NULL_HANDLE)
             {
                 vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
             }*/
 
+            delete m_bindlessTable;
+            m_bindlessTable = nullptr;
+            delete m_descriptorAllocator;
+            m_descriptorAllocator = nullptr;
+
             if (logicalDevice)
             {
                 vkDestroyDevice(logicalDevice, nullptr);
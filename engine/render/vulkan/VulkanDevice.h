@@ -6,6 +6,11 @@
 #include "render/vulkan/VulkanTexture.h"
 #include "scene/RenderObject.h"
 #include "VulkanRenderPass.h"
+#include "VulkanBindlessTable.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanTimestampQueries.h"
+#include "VulkanAccelerationStructures.h"
+#include "VulkanRenderGraph.h"
 #include "GraphicsDevice.h"
 #include "threadpool.hpp"
 
@@ -43,6 +48,7 @@ namespace engine
 
 			bool enableDebugMarkers = false;  // Indicates if debug markers extension is enabled
 			VkPipelineCache pipelineCache = VK_NULL_HANDLE;  // Pipeline cache object
+			std::string m_pipelineCacheFile;  // File the pipeline cache is loaded from and saved to
 
 			//std::vector<VkDescriptorPool> m_descriptorPools;  // Descriptor pools
 			//std::vector<VulkanBuffer*> m_buffers;  // Graphical resources - buffers
@@ -56,6 +62,20 @@ namespace engine
 			std::vector<VkSemaphore> m_semaphores;  // Semaphores
 			std::vector<VkFence> m_fences;  // Fences
 
+			//descriptor indexing features enabled for the bindless table, chained in front of the features of the application
+			VkPhysicalDeviceDescriptorIndexingFeatures m_descriptorIndexingFeatures{};
+
+			//pools grown by the device for sets requested without a pool or from a full one, and for the transient sets
+			VulkanDescriptorAllocator* m_descriptorAllocator = nullptr;
+
+			std::vector<VulkanTimestampQueries*> m_timestampQueries;
+			std::vector<VulkanAccelerationStructures*> m_accelerationStructures;
+			std::vector<VulkanRenderGraph*> m_renderGraphs;
+
+			//graphics pipelines recorded since BeginPipelinePrewarm, compiled together by CompilePipelines
+			bool m_prewarmPipelines = false;
+			std::vector<VulkanPipeline*> m_pendingPipelines;
+
 			VkQueue copyQueue;//queue used for data transfers
 			VkFence resourceLoadingFence;//fence used for loadings
 
@@ -64,7 +84,8 @@ namespace engine
 
 		public:
 			// Constructor
-			VulkanDevice(VkInstance instance, VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface, void* pNextChain);
+			// Constructor, bindless creates the global table of textures and storage buffers when the device supports descriptor indexing
+			VulkanDevice(VkInstance instance, VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface, void* pNextChain, bool bindless = false);
 
 			// Selects a physical device
 			void GetPhysicalDevice(VkPhysicalDeviceFeatures* wantedFeatures, std::vector<const char*> wantedExtensions, VkSurfaceKHR surface);
@@ -72,6 +93,12 @@ namespace engine
 			// Creates a logical device
 			void CreateLogicalDevice(const std::vector<const char*> layers, void* pNextChain = nullptr);
 
+			// Enables the descriptor indexing features of the bindless table, returns the chain to create the device with
+			void* EnableBindless(void* pNextChain);
+
+			// Creates the bindless table after the logical device
+			void CreateBindlessTable();
+
 			// Returns the name of the device
 			virtual char* GetDeviceName()
 			{
@@ -114,6 +141,15 @@ namespace engine
 			// Gets a render target texture
 			VulkanTexture* GetRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImageLayout imageLayout);
 
+			// Gets timestamp queries for the graphics queue, check IsSupported before reading them
+			VulkanTimestampQueries* GetTimestampQueries(uint32_t queriesPerSlot, uint32_t slots);
+
+			// Gets a manager of ray tracing acceleration structures with one copy of the instances per slot
+			VulkanAccelerationStructures* GetAccelerationStructures(uint32_t slots);
+
+			// Gets an empty render graph, its resources are created by Build once the passes are declared
+			VulkanRenderGraph* GetRenderGraph();
+
 			// Gets a color render target texture
 			VulkanTexture* GetColorRenderTarget(uint32_t width, uint32_t height, VkFormat format);
 
@@ -123,10 +159,12 @@ namespace engine
 			// Destroys a texture
 			void DestroyTexture(VulkanTexture* texture);
 
-			// Creates a pipeline cache
-			VkPipelineCache CreatePipelineCache();
+			virtual void DestroyBuffer(Buffer* buffer);
+
+			// Creates a pipeline cache, with the pipelines of the file when it was saved by the same device and driver
+			VkPipelineCache CreatePipelineCache(const std::string& file = "");
 
-			// Destroys the pipeline cache
+			// Saves the pipeline cache to its file and destroys it
 			void DestroyPipelineCache();
 
 			// Gets a graphics pipeline with additional properties
@@ -198,6 +236,8 @@ namespace engine
 
 			virtual Buffer* GetStorageVertexBuffer(size_t size, void* data, size_t vertexSize, DescriptorPool* descriptorPool, bool onCPU, CommandBuffer* commandBuffer);
 
+			virtual Buffer* GetIndirectBuffer(size_t size, void* data, DescriptorPool* descriptorPool, CommandBuffer* commandBuffer);
+
 			virtual Texture* GetTexture(TextureData* data, DescriptorPool* descriptorPool, CommandBuffer* commandBuffer, bool generateMipmaps = false);
 
 			virtual Texture* GetRenderTarget(uint32_t width, uint32_t height, GfxFormat format, DescriptorPool* srvDescriptorPool, DescriptorPool* rtvDescriptorPool, CommandBuffer* commandBuffer, float* clearValues = nullptr);
@@ -212,10 +252,20 @@ namespace engine
 
 			virtual DescriptorSet* GetDescriptorSet(DescriptorSetLayout* layout, DescriptorPool* pool, std::vector<Buffer*> buffers, std::vector <Texture*> textures, size_t dynamicAlignment = 0);
 
+			virtual DescriptorSet* GetTransientDescriptorSet(DescriptorSetLayout* layout, std::vector<Buffer*> buffers, std::vector <Texture*> textures, uint32_t frame);
+
+			virtual void ResetTransientDescriptorSets(uint32_t frame);
+
+			virtual DescriptorStatistics GetDescriptorStatistics();
+
 			virtual RenderPass* GetRenderPass(uint32_t width, uint32_t height, std::vector<Texture*> colorTextures, Texture* depthTexture, std::vector<RenderSubpass> subpasses = {});
 
 			virtual Pipeline* GetPipeline(std::string vertexFileName, std::string vertexEntry, std::string fragmentFilename, std::string fragmentEntry, VertexLayout* vertexLayout, DescriptorSetLayout* descriptorSetlayout, PipelineProperties properties, RenderPass* renderPass);
 			
+			virtual void BeginPipelinePrewarm();
+
+			virtual PipelinePrewarmStatistics CompilePipelines(ThreadPool* threadPool, const std::function<void(uint32_t compiled, uint32_t count)>& progress = nullptr);
+
 			virtual Pipeline* GetComputePipeline(std::string computeFileName, std::string computeEntry, DescriptorSetLayout* descriptorSetlayout, uint32_t constanBlockSize = 0);
 
 			virtual CommandPool* GetCommandPool(uint32_t queueIndex, bool primary = true);
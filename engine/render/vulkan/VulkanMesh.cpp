@@ -5,6 +5,20 @@ namespace engine
 {
     namespace render
     {
+		void VulkanMesh::BindBuffers(VkCommandBuffer commandBuffer)
+		{
+			VkDeviceSize offsets[1] = { 0 };
+			const VkBuffer vertexBuffer = _vertexBuffer->GetVkBuffer();
+			vkCmdBindVertexBuffers(commandBuffer, m_vertexInputBinding, 1, &vertexBuffer, offsets);
+			VkIndexType indexType = m_indexSize > 2 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;//TODO make a switch
+			vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->GetVkBuffer(), 0, indexType);
+			if (_instanceBuffer && _instanceBuffer->GetVkBuffer() && m_instanceInputBinding > 0)
+			{
+				const VkBuffer instanceBuffer = _instanceBuffer->GetVkBuffer();
+				vkCmdBindVertexBuffers(commandBuffer, m_instanceInputBinding, 1, &instanceBuffer, offsets);
+			}
+		}
+
         void VulkanMesh::Draw(VkCommandBuffer commandBuffer, const std::vector<MeshPart>& parts)
         {
 			if (!m_isVisible)
@@ -16,16 +30,7 @@ namespace engine
 				return;
 			}
 
-			VkDeviceSize offsets[1] = { 0 };
-			const VkBuffer vertexBuffer = _vertexBuffer->GetVkBuffer();
-			vkCmdBindVertexBuffers(commandBuffer, m_vertexInputBinding, 1, &vertexBuffer, offsets);
-			VkIndexType indexType = m_indexSize > 2 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;//TODO make a switch
-			vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->GetVkBuffer(), 0, indexType);
-			if (_instanceBuffer && _instanceBuffer->GetVkBuffer() && m_instanceInputBinding > 0)
-			{
-				const VkBuffer instanceBuffer = _instanceBuffer->GetVkBuffer();
-				vkCmdBindVertexBuffers(commandBuffer, m_instanceInputBinding, 1, &instanceBuffer, offsets);
-			}
+			BindBuffers(commandBuffer);
 
 			if(parts.size() == 0)
 				vkCmdDrawIndexed(commandBuffer, m_indexCount, m_instanceNo, 0, 0, 0);
@@ -42,8 +47,36 @@ namespace engine
         {
 			VulkanCommandBuffer* cb = static_cast<VulkanCommandBuffer*>(commandBuffer);
 			Draw(cb->m_vkCommandBuffer, parts);
+			if (m_isVisible)
+			{
+				bool buffers = _vertexBuffer != nullptr || _indexBuffer != nullptr;
+				cb->m_statistics.draws += (buffers && parts.size() > 0) ? static_cast<uint32_t>(parts.size()) : 1;
+				cb->m_statistics.vertexBufferBinds += buffers ? 1 : 0;
+			}
         }
 
+		void VulkanMesh::DrawIndirect(CommandBuffer* commandBuffer, class render::Buffer* indirectBuffer, uint32_t drawCount, uint32_t firstDraw)
+		{
+			if (!m_isVisible || drawCount == 0)
+				return;
+
+			VkCommandBuffer cb = static_cast<VulkanCommandBuffer*>(commandBuffer)->m_vkCommandBuffer;
+			BindBuffers(cb);
+			commandBuffer->m_statistics.draws += drawCount;
+			commandBuffer->m_statistics.vertexBufferBinds++;
+			VkBuffer buffer = static_cast<VulkanBuffer*>(indirectBuffer)->GetVkBuffer();
+			VkDeviceSize offset = firstDraw * sizeof(VkDrawIndexedIndirectCommand);
+			if (m_multiDrawIndirect)
+			{
+				vkCmdDrawIndexedIndirect(cb, buffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+			}
+			else
+			{
+				for (uint32_t i = 0; i < drawCount; i++)
+					vkCmdDrawIndexedIndirect(cb, buffer, offset + i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
+
 		void VulkanMesh::UpdateIndexBuffer(void* data, size_t size, size_t offset)
 		{
 			_indexBuffer->MemCopy(data, size, offset);
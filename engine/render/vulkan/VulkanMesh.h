@@ -24,6 +24,7 @@ namespace engine
 
             uint32_t m_vertexInputBinding = 0;
             uint32_t m_instanceInputBinding = 0;
+            bool m_multiDrawIndirect = false;
 
             VulkanMesh(VkDevice device, uint32_t vertexInputBinding, uint32_t instanceInputBinding) :
                 _device(device), m_vertexInputBinding(vertexInputBinding), m_instanceInputBinding(instanceInputBinding) {}
@@ -37,6 +38,9 @@ namespace engine
 
             void Draw(VkCommandBuffer commandBuffer, const std::vector<MeshPart>& parts);
             virtual void Draw(CommandBuffer* commandBuffer, const std::vector<MeshPart>& parts = std::vector<MeshPart>());
+            virtual void DrawIndirect(CommandBuffer* commandBuffer, class render::Buffer* indirectBuffer, uint32_t drawCount, uint32_t firstDraw = 0);
+        private:
+            void BindBuffers(VkCommandBuffer commandBuffer);
         };
     }
 }
\ No newline at end of file
@@ -42,10 +42,51 @@ namespace engine
 
 		VulkanPipeline::~VulkanPipeline()
 		{
+			delete m_description;
 			vkDestroyPipeline(_device, m_vkPipeline, nullptr);
 			vkDestroyPipelineLayout(_device, m_pipelineLayout, nullptr);
 		}
 
+		void VulkanPipeline::Describe(VkDevice device, VkDescriptorSetLayout descriptorSetLayout,
+			std::vector<VkVertexInputBindingDescription> vertexInputBindings,
+			std::vector<VkVertexInputAttributeDescription> vertexInputAttributes,
+			std::string vertexFile, std::string fragmentFile,
+			VkRenderPass renderPass, VkPipelineCache cache,
+			PipelineProperties properties
+		)
+		{
+			_device = device;
+			_renderPass = renderPass;
+			_pipelineCache = cache;
+
+			delete m_description;
+			m_description = new Description;
+			m_description->descriptorSetLayout = descriptorSetLayout;
+			m_description->vertexInputBindings = vertexInputBindings;
+			m_description->vertexInputAttributes = vertexInputAttributes;
+			m_description->vertexFile = vertexFile;
+			m_description->fragmentFile = fragmentFile;
+			m_description->properties = properties;
+			//the blend states of the caller are usually gone by the time it is compiled
+			if (properties.pAttachments)
+				m_description->attachments.assign(properties.pAttachments, properties.pAttachments + properties.attachmentCount);
+			m_description->properties.pAttachments = m_description->attachments.empty() ? nullptr : m_description->attachments.data();
+			m_constantBlockSize = properties.vertexConstantBlockSize;
+			m_depthBias = properties.depthBias;
+		}
+
+		void VulkanPipeline::Compile()
+		{
+			if (!m_description)
+				return;
+
+			Description* description = m_description;
+			m_description = nullptr;
+			Create(_device, description->descriptorSetLayout, description->vertexInputBindings, description->vertexInputAttributes,
+				description->vertexFile, description->fragmentFile, _renderPass, _pipelineCache, description->properties);
+			delete description;
+		}
+
 		void VulkanPipeline::Create(VkDevice device, VkDescriptorSetLayout descriptorSetLayout,
 			std::vector<VkVertexInputBindingDescription> vertexInputBindings,
 			std::vector<VkVertexInputAttributeDescription> vertexInputAttributes,
@@ -214,20 +255,24 @@ namespace engine
 			{
 				shaderStages.push_back(LoadShader(fragmentFile, VK_SHADER_STAGE_FRAGMENT_BIT));
 
-				if (properties.fragmentConstants)
+			}
+
+			//declared outside of the branch, the create info points at them
+			VkSpecializationMapEntry specializationMapEntries[MAX_SHADER_CONSTANTS];
+			VkSpecializationInfo specializationInfo{};
+			if (shaderStages.size() > 1 && properties.fragmentConstants.count > 0)
+			{
+				for (uint32_t i = 0; i < properties.fragmentConstants.count; i++)
 				{
-					VkSpecializationMapEntry specializationMapEntry{};
-					specializationMapEntry.constantID = 0;
-					specializationMapEntry.offset = 0;
-					specializationMapEntry.size = sizeof(uint32_t);
-
-					VkSpecializationInfo specializationInfo{};
-					specializationInfo.mapEntryCount = 1;
-					specializationInfo.pMapEntries = &specializationMapEntry;
-					specializationInfo.dataSize = sizeof(uint32_t);
-					specializationInfo.pData = properties.fragmentConstants;
-					shaderStages[1].pSpecializationInfo = &specializationInfo;
+					specializationMapEntries[i].constantID = i;
+					specializationMapEntries[i].offset = i * sizeof(uint32_t);
+					specializationMapEntries[i].size = sizeof(uint32_t);
 				}
+				specializationInfo.mapEntryCount = properties.fragmentConstants.count;
+				specializationInfo.pMapEntries = specializationMapEntries;
+				specializationInfo.dataSize = properties.fragmentConstants.count * sizeof(uint32_t);
+				specializationInfo.pData = properties.fragmentConstants.values;
+				shaderStages[1].pSpecializationInfo = &specializationInfo;
 			}
 
 			pipelineCreateInfoCI.stageCount = static_cast<uint32_t>(shaderStages.size());
@@ -244,7 +289,7 @@ namespace engine
 
 		void VulkanPipeline::Draw(VkCommandBuffer command_buffer)
 		{
-			vkCmdBindPipeline(command_buffer, m_bindPoint, m_vkPipeline);
+			vkCmdBindPipeline(command_buffer, m_bindPoint, getPipeline());
 		}
 
 		void VulkanPipeline::Draw(CommandBuffer* commandBuffer)
@@ -261,6 +306,7 @@ namespace engine
 				depthBiasSlope);
 			
 			Draw(cb->m_vkCommandBuffer);
+			cb->m_statistics.pipelineBinds++;
 		}
 
 		void VulkanPipeline::PushConstants(class CommandBuffer* commandBuffer, void* constantsData)
@@ -288,15 +334,17 @@ namespace engine
 			pipelineLayoutCreateInfo.setLayoutCount = 1;
 			pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
 
+			VkPushConstantRange pushConstantRange{};
 			if (properties.vertexConstantBlockSize > 0)
 			{
-				VkPushConstantRange pushConstantRange{};
 				pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 				pushConstantRange.offset = 0;
 				pushConstantRange.size = properties.vertexConstantBlockSize;				
 				
 				pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
 				pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+				m_constantBlockSize = properties.vertexConstantBlockSize;
 			}
 
 			VK_CHECK_RESULT(vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
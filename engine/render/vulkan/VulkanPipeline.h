@@ -41,6 +41,19 @@ namespace engine
 
 			bool m_depthBias = false;
 
+			//arguments of Create kept by Describe until Compile
+			struct Description
+			{
+				VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+				std::vector<VkVertexInputBindingDescription> vertexInputBindings;
+				std::vector<VkVertexInputAttributeDescription> vertexInputAttributes;
+				std::string vertexFile;
+				std::string fragmentFile;
+				PipelineProperties properties;
+				std::vector<BlendAttachmentState> attachments;
+			};
+			Description* m_description = nullptr;
+
 		public:
 			VulkanPipeline() {};
 			~VulkanPipeline();
@@ -50,8 +63,8 @@ namespace engine
 
 			//void SetBlending(bool value) { m_blendEnable = value; }
 
-			VkPipeline			getPipeline() { return m_vkPipeline; }
-			VkPipelineLayout	getPipelineLayout() { return m_pipelineLayout; }
+			VkPipeline			getPipeline() { if (m_description) Compile(); return m_vkPipeline; }
+			VkPipelineLayout	getPipelineLayout() { if (m_description) Compile(); return m_pipelineLayout; }
 			VkPipelineBindPoint getBindPoint() { return m_bindPoint; }
 
 			void Create(VkDevice device, VkDescriptorSetLayout descriptorSetLayout,
@@ -62,6 +75,20 @@ namespace engine
 				PipelineProperties properties
 			);
 
+			/** @brief Keeps the arguments of Create, the pipeline is compiled by Compile, or when it is first bound */
+			void Describe(VkDevice device, VkDescriptorSetLayout descriptorSetLayout,
+				std::vector<VkVertexInputBindingDescription> vertexInputBindings,
+				std::vector<VkVertexInputAttributeDescription> vertexInputAttributes,
+				std::string vertexFile, std::string fragmentFile,
+				VkRenderPass renderPass, VkPipelineCache cache,
+				PipelineProperties properties
+			);
+
+			/** @brief Creates a described pipeline, different pipelines can be compiled on different threads */
+			void Compile();
+
+			bool IsCompiled() const { return m_vkPipeline != VK_NULL_HANDLE; }
+
 			void Draw(VkCommandBuffer commandBuffer);
 
 			virtual void Draw(class CommandBuffer* commandBuffer);
@@ -0,0 +1,422 @@
+#include "VulkanRenderGraph.h"
+#include "VulkanDevice.h"
+#include "VulkanCommandBuffer.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace render
+	{
+		static bool HasStencil(VkFormat format)
+		{
+			return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D16_UNORM_S8_UINT;
+		}
+
+		static bool IsDepth(VkFormat format)
+		{
+			return HasStencil(format) || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM;
+		}
+
+		static void GetVkAccess(RenderGraphAccess access, uint32_t stages, bool texture, VkAccessFlags& accessMask, VkPipelineStageFlags& stageMask)
+		{
+			VkPipelineStageFlags shaderStages = 0;
+			if (stages & RENDER_GRAPH_STAGE_VERTEX)
+				shaderStages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+			if (stages & RENDER_GRAPH_STAGE_FRAGMENT)
+				shaderStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			if (stages & RENDER_GRAPH_STAGE_COMPUTE)
+				shaderStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+			switch (access) {
+			case RENDER_GRAPH_COLOR_ATTACHMENT:
+				accessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				break;
+			case RENDER_GRAPH_DEPTH_ATTACHMENT:
+				accessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				stageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				break;
+			case RENDER_GRAPH_DEPTH_READ:
+				//the shaders of the same pass can sample it too
+				accessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (shaderStages ? VK_ACCESS_SHADER_READ_BIT : 0);
+				stageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | shaderStages;
+				break;
+			case RENDER_GRAPH_SAMPLED:
+				accessMask = texture ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+				stageMask = shaderStages;
+				break;
+			case RENDER_GRAPH_STORAGE_READ:
+				accessMask = VK_ACCESS_SHADER_READ_BIT;
+				stageMask = shaderStages;
+				break;
+			case RENDER_GRAPH_STORAGE_WRITE:
+				accessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+				stageMask = shaderStages;
+				break;
+			case RENDER_GRAPH_TRANSFER_READ:
+				accessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				stageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+				break;
+			case RENDER_GRAPH_TRANSFER_WRITE:
+				accessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				stageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+				break;
+			default:
+				accessMask = 0;
+				stageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				break;
+			}
+			//a shader access without stages waits for and blocks everything
+			if (stageMask == 0)
+				stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+
+		VkImageLayout VulkanRenderGraph::ToVkImageLayout(RenderGraphLayout layout)
+		{
+			switch (layout) {
+			case RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			case RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			case RENDER_GRAPH_LAYOUT_DEPTH_READ_ONLY: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			case RENDER_GRAPH_LAYOUT_SHADER_READ: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			case RENDER_GRAPH_LAYOUT_GENERAL: return VK_IMAGE_LAYOUT_GENERAL;
+			case RENDER_GRAPH_LAYOUT_TRANSFER_SRC: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			case RENDER_GRAPH_LAYOUT_TRANSFER_DST: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			default: return VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		RenderGraphLayout VulkanRenderGraph::ToRenderGraphLayout(VkImageLayout layout)
+		{
+			switch (layout) {
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT;
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT;
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return RENDER_GRAPH_LAYOUT_DEPTH_READ_ONLY;
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return RENDER_GRAPH_LAYOUT_SHADER_READ;
+			case VK_IMAGE_LAYOUT_GENERAL: return RENDER_GRAPH_LAYOUT_GENERAL;
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return RENDER_GRAPH_LAYOUT_TRANSFER_SRC;
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return RENDER_GRAPH_LAYOUT_TRANSFER_DST;
+			default: return RENDER_GRAPH_LAYOUT_UNDEFINED;
+			}
+		}
+
+		VulkanRenderGraph::~VulkanRenderGraph()
+		{
+			for (PassTarget& target : m_targets)
+			{
+				if (target.frameBuffer)
+					vkDestroyFramebuffer(_device, target.frameBuffer, nullptr);
+				if (target.renderPass)
+					vkDestroyRenderPass(_device, target.renderPass, nullptr);
+			}
+			m_targets.clear();
+			for (uint32_t i = 0; i < m_textures.size(); i++)
+			{
+				if (!m_resources[i].imported)
+					delete m_textures[i];
+			}
+			m_textures.clear();
+			if (m_memory)
+				vkFreeMemory(_device, m_memory, nullptr);
+		}
+
+		uint32_t VulkanRenderGraph::ImportTexture(const std::string& name, VulkanTexture* texture)
+		{
+			uint32_t index = RenderGraph::ImportTexture(name, texture->m_width, texture->m_height, GfxFormat::UNKNOWN, ToRenderGraphLayout(texture->m_descriptor.imageLayout));
+			m_textures.resize(m_resources.size(), nullptr);
+			m_textures[index] = texture;
+			return index;
+		}
+
+		uint32_t VulkanRenderGraph::ImportBuffer(const std::string& name, VulkanBuffer* buffer)
+		{
+			uint32_t index = RenderGraph::ImportBuffer(name);
+			m_buffers.resize(m_resources.size(), nullptr);
+			m_buffers[index] = buffer;
+			return index;
+		}
+
+		void VulkanRenderGraph::Build(VulkanDevice* device)
+		{
+			_device = device->logicalDevice;
+			m_textures.resize(m_resources.size(), nullptr);
+			m_buffers.resize(m_resources.size(), nullptr);
+
+			Compile();
+			CreateTextures(device);
+
+			m_targets.resize(m_passes.size());
+			for (uint32_t pass : m_schedule)
+				CreateTarget(pass);
+		}
+
+		void VulkanRenderGraph::CreateTextures(VulkanDevice* device)
+		{
+			std::vector<VkImageUsageFlags> usages(m_resources.size(), 0);
+			for (uint32_t passIndex : m_schedule)
+			{
+				for (const RenderGraphUse& use : m_passes[passIndex].uses)
+				{
+					VkImageUsageFlags& usage = usages[use.resource];
+					switch (use.access) {
+					case RENDER_GRAPH_COLOR_ATTACHMENT: usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+					case RENDER_GRAPH_DEPTH_ATTACHMENT: usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+					case RENDER_GRAPH_DEPTH_READ: usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (use.stages ? VK_IMAGE_USAGE_SAMPLED_BIT : 0); break;
+					case RENDER_GRAPH_SAMPLED: usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+					case RENDER_GRAPH_STORAGE_READ:
+					case RENDER_GRAPH_STORAGE_WRITE: usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+					case RENDER_GRAPH_TRANSFER_READ: usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; break;
+					case RENDER_GRAPH_TRANSFER_WRITE: usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; break;
+					default: break;
+					}
+				}
+			}
+
+			std::vector<VkMemoryRequirements> requirements(m_resources.size());
+			uint32_t memoryTypeBits = ~0u;
+			for (uint32_t i = 0; i < m_resources.size(); i++)
+			{
+				RenderGraphResource& resource = m_resources[i];
+				if (!resource.used || resource.imported || !resource.texture)
+					continue;
+
+				//the depth textures of the graph have no stencil
+				VkFormat format = resource.format == GfxFormat::D32_FLOAT ? VK_FORMAT_D32_SFLOAT : ToVkFormat(resource.format);
+				VkImageAspectFlags aspect = IsDepth(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+				//the layout of the descriptors of the passes that sample it
+				VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				if (usages[i] & VK_IMAGE_USAGE_STORAGE_BIT)
+					layout = VK_IMAGE_LAYOUT_GENERAL;
+
+				VulkanTexture* texture = new VulkanTexture;
+				texture->CreateImage(_device, { resource.width, resource.height, 1 }, format, usages[i], layout, aspect);
+				m_textures[i] = texture;
+
+				vkGetImageMemoryRequirements(_device, texture->m_vkImage, &requirements[i]);
+				resource.size = requirements[i].size;
+				resource.alignment = requirements[i].alignment;
+				memoryTypeBits &= requirements[i].memoryTypeBits;
+			}
+
+			PlanMemory();
+
+			if (m_statistics.transientTextures > 0 && memoryTypeBits != 0)
+			{
+				VkMemoryAllocateInfo memAllocInfo{};
+				memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				memAllocInfo.allocationSize = m_statistics.aliasedMemory;
+				memAllocInfo.memoryTypeIndex = tools::getMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &device->memoryProperties);
+				VK_CHECK_RESULT(vkAllocateMemory(_device, &memAllocInfo, nullptr, &m_memory));
+			}
+
+			for (uint32_t i = 0; i < m_resources.size(); i++)
+			{
+				RenderGraphResource& resource = m_resources[i];
+				VulkanTexture* texture = m_textures[i];
+				if (resource.imported || !texture)
+					continue;
+
+				if (m_memory)
+				{
+					VK_CHECK_RESULT(vkBindImageMemory(_device, texture->m_vkImage, m_memory, resource.offset));
+				}
+				else
+				{
+					//no memory type fits all of them, every texture gets its own and nothing is aliased
+					VkMemoryAllocateInfo memAllocInfo{};
+					memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+					memAllocInfo.allocationSize = requirements[i].size;
+					memAllocInfo.memoryTypeIndex = tools::getMemoryType(requirements[i].memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &device->memoryProperties);
+					VK_CHECK_RESULT(vkAllocateMemory(_device, &memAllocInfo, nullptr, &texture->m_deviceMemory));
+					VK_CHECK_RESULT(vkBindImageMemory(_device, texture->m_vkImage, texture->m_deviceMemory, 0));
+				}
+				texture->CreateDescriptor(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_IMAGE_VIEW_TYPE_2D);
+			}
+			if (!m_memory)
+				m_statistics.aliasedMemory = m_statistics.transientMemory;
+		}
+
+		void VulkanRenderGraph::CreateTarget(uint32_t passIndex)
+		{
+			const RenderGraphPass& pass = m_passes[passIndex];
+			PassTarget& target = m_targets[passIndex];
+
+			std::vector<VkAttachmentDescription> attachments;
+			std::vector<VkAttachmentReference> colorReferences;
+			VkAttachmentReference depthReference{};
+			bool hasDepth = false;
+			std::vector<VkImageView> views;
+			std::vector<uint32_t> added;
+
+			for (const RenderGraphUse& use : pass.uses)
+			{
+				if (!IsAttachment(use.access) || std::find(added.begin(), added.end(), use.resource) != added.end())
+					continue;
+				VulkanTexture* texture = m_textures[use.resource];
+				if (!texture)
+					continue;
+				added.push_back(use.resource);
+				const RenderGraphResource& resource = m_resources[use.resource];
+
+				//the barriers before the pass put it in the layout of the attachment already
+				VkImageLayout layout = ToVkImageLayout(GetLayout(use.access));
+				VkAttachmentDescription attachment{};
+				attachment.format = texture->m_format;
+				attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+				attachment.loadOp = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+				attachment.storeOp = use.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachment.stencilLoadOp = HasStencil(texture->m_format) ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachment.stencilStoreOp = HasStencil(texture->m_format) ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachment.initialLayout = layout;
+				attachment.finalLayout = layout;
+
+				VkAttachmentReference reference{ static_cast<uint32_t>(attachments.size()), layout };
+				VkClearValue clearValue{};
+				if (use.access == RENDER_GRAPH_COLOR_ATTACHMENT)
+				{
+					colorReferences.push_back(reference);
+					clearValue.color = { { resource.clearValue[0], resource.clearValue[1], resource.clearValue[2], resource.clearValue[3] } };
+				}
+				else
+				{
+					depthReference = reference;
+					hasDepth = true;
+					clearValue.depthStencil = { resource.clearValue[0], 0 };
+				}
+				attachments.push_back(attachment);
+				views.push_back(texture->m_descriptor.imageView);
+				target.clearValues.push_back(clearValue);
+				if (target.width == 0)
+				{
+					target.width = texture->m_width;
+					target.height = texture->m_height;
+				}
+			}
+			if (attachments.empty())
+				return;
+
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+			subpass.pColorAttachments = colorReferences.data();
+			subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+			VkRenderPassCreateInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+			renderPassInfo.pAttachments = attachments.data();
+			renderPassInfo.subpassCount = 1;
+			renderPassInfo.pSubpasses = &subpass;
+			VK_CHECK_RESULT(vkCreateRenderPass(_device, &renderPassInfo, nullptr, &target.renderPass));
+
+			VkFramebufferCreateInfo framebufferCreateInfo{};
+			framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferCreateInfo.renderPass = target.renderPass;
+			framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(views.size());
+			framebufferCreateInfo.pAttachments = views.data();
+			framebufferCreateInfo.width = target.width;
+			framebufferCreateInfo.height = target.height;
+			framebufferCreateInfo.layers = 1;
+			VK_CHECK_RESULT(vkCreateFramebuffer(_device, &framebufferCreateInfo, nullptr, &target.frameBuffer));
+		}
+
+		void VulkanRenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphBarrier>& barriers)
+		{
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			VkPipelineStageFlags srcStageMask = 0;
+			VkPipelineStageFlags dstStageMask = 0;
+
+			for (const RenderGraphBarrier& barrier : barriers)
+			{
+				const RenderGraphResource& resource = m_resources[barrier.resource];
+				VkAccessFlags srcAccessMask, dstAccessMask;
+				VkPipelineStageFlags srcStages, dstStages;
+				GetVkAccess(barrier.srcAccess, barrier.srcStages, resource.texture, srcAccessMask, srcStages);
+				GetVkAccess(barrier.dstAccess, barrier.dstStages, resource.texture, dstAccessMask, dstStages);
+
+				if (resource.texture && m_textures[barrier.resource])
+				{
+					VulkanTexture* texture = m_textures[barrier.resource];
+					VkImageMemoryBarrier imageBarrier{};
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					imageBarrier.srcAccessMask = srcAccessMask;
+					imageBarrier.dstAccessMask = dstAccessMask;
+					imageBarrier.oldLayout = ToVkImageLayout(barrier.oldLayout);
+					imageBarrier.newLayout = ToVkImageLayout(barrier.newLayout);
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.image = texture->m_vkImage;
+					VkImageAspectFlags aspect = texture->m_aspect;
+					if (HasStencil(texture->m_format))
+						aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+					imageBarrier.subresourceRange = { aspect, 0, texture->m_mipLevelsCount, 0, texture->m_layerCount };
+					imageBarriers.push_back(imageBarrier);
+				}
+				else if (!resource.texture && m_buffers[barrier.resource])
+				{
+					VkBufferMemoryBarrier bufferBarrier{};
+					bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					bufferBarrier.srcAccessMask = srcAccessMask;
+					bufferBarrier.dstAccessMask = dstAccessMask;
+					bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.buffer = m_buffers[barrier.resource]->GetVkBuffer();
+					bufferBarrier.offset = 0;
+					bufferBarrier.size = VK_WHOLE_SIZE;
+					bufferBarriers.push_back(bufferBarrier);
+				}
+				else
+				{
+					continue;
+				}
+				srcStageMask |= srcStages;
+				dstStageMask |= dstStages;
+			}
+
+			if (imageBarriers.empty() && bufferBarriers.empty())
+				return;
+			vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0,
+				0, nullptr,
+				static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+
+		void VulkanRenderGraph::Execute(CommandBuffer* commandBuffer, uint32_t frameBufferIndex)
+		{
+			VkCommandBuffer vkCommandBuffer = static_cast<VulkanCommandBuffer*>(commandBuffer)->m_vkCommandBuffer;
+			for (uint32_t passIndex : m_schedule)
+			{
+				RenderGraphPass& pass = m_passes[passIndex];
+				PassTarget& target = m_targets[passIndex];
+				RecordBarriers(vkCommandBuffer, pass.barriers);
+				if (!pass.enabled)
+					continue;
+
+				if (target.renderPass)
+				{
+					VkRenderPassBeginInfo renderPassBeginInfo{};
+					renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+					renderPassBeginInfo.renderPass = target.renderPass;
+					renderPassBeginInfo.framebuffer = target.frameBuffer;
+					renderPassBeginInfo.renderArea.extent.width = target.width;
+					renderPassBeginInfo.renderArea.extent.height = target.height;
+					renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(target.clearValues.size());
+					renderPassBeginInfo.pClearValues = target.clearValues.data();
+					vkCmdBeginRenderPass(vkCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+					VkViewport viewport = { 0, 0, (float)target.width, (float)target.height, 0.0f, 1.0f };
+					vkCmdSetViewport(vkCommandBuffer, 0, 1, &viewport);
+					VkRect2D scissor = { VkOffset2D{0,0}, VkExtent2D{target.width, target.height} };
+					vkCmdSetScissor(vkCommandBuffer, 0, 1, &scissor);
+				}
+
+				if (pass.execute)
+					pass.execute(commandBuffer, frameBufferIndex);
+
+				if (target.renderPass)
+					vkCmdEndRenderPass(vkCommandBuffer);
+			}
+			RecordBarriers(vkCommandBuffer, m_finalBarriers);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "VulkanTools.h"
+#include "VulkanTexture.h"
+#include "VulkanBuffer.h"
+#include "render/RenderGraph.h"
+
+namespace engine
+{
+	namespace render
+	{
+		class VulkanDevice;
+
+		/** @brief Creates the transient textures of a compiled render graph in one shared allocation, a render pass and a frame
+		 *  buffer for every pass that draws into attachments, and records the barriers and the passes in the order of the graph */
+		class VulkanRenderGraph : public RenderGraph
+		{
+		public:
+			~VulkanRenderGraph();
+
+			using RenderGraph::ImportTexture;
+			using RenderGraph::ImportBuffer;
+			/** @brief The texture is expected in its m_descriptor.imageLayout before the frame and is put back in it after */
+			uint32_t ImportTexture(const std::string& name, VulkanTexture* texture);
+			uint32_t ImportBuffer(const std::string& name, VulkanBuffer* buffer);
+
+			/** @brief Compiles the graph and creates its resources, call it once every pass is declared */
+			void Build(VulkanDevice* device);
+			void Execute(CommandBuffer* commandBuffer, uint32_t frameBufferIndex = 0);
+
+			/** @brief Valid after Build, nullptr for the culled textures */
+			VulkanTexture* GetTexture(uint32_t resource) { return m_textures[resource]; }
+			/** @brief The render pass the pipelines of a pass are created with */
+			VkRenderPass GetRenderPass(uint32_t pass) { return m_targets[pass].renderPass; }
+
+			static VkImageLayout ToVkImageLayout(RenderGraphLayout layout);
+			static RenderGraphLayout ToRenderGraphLayout(VkImageLayout layout);
+
+		private:
+			struct PassTarget
+			{
+				VkRenderPass renderPass = VK_NULL_HANDLE;
+				VkFramebuffer frameBuffer = VK_NULL_HANDLE;
+				uint32_t width = 0;
+				uint32_t height = 0;
+				std::vector<VkClearValue> clearValues;
+			};
+
+			VkDevice _device = VK_NULL_HANDLE;
+			std::vector<VulkanTexture*> m_textures;//per resource, the imported ones are not owned
+			std::vector<VulkanBuffer*> m_buffers;
+			std::vector<PassTarget> m_targets;//per pass
+			VkDeviceMemory m_memory = VK_NULL_HANDLE;//shared by the transient textures
+
+			void CreateTextures(VulkanDevice* device);
+			void CreateTarget(uint32_t pass);
+			void RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphBarrier>& barriers);
+		};
+	}
+}
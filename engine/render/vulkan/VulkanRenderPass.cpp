@@ -1,6 +1,7 @@
 #include "VulkanRenderPass.h"
 #include "VulkanCommandBuffer.h"
 #include <array>
+#include <algorithm>
 
 namespace engine
 {
@@ -40,34 +41,71 @@ namespace engine
 
 		// Set up a separate render pass for the offscreen frame buffer
 			// This is necessary as the offscreen frame buffer attachments use formats different to those from the example render pass
-		void VulkanRenderPass::Create(VkDevice device, std::vector <std::pair<VkFormat, VkImageLayout>> layouts, bool bottom_of_pipe, std::vector<RenderSubpass> subpasses)
+		void VulkanRenderPass::Create(VkDevice device, std::vector <std::pair<VkFormat, VkImageLayout>> layouts, bool bottom_of_pipe, std::vector<RenderSubpass> subpasses, std::vector<bool> allowTransient)
 		{
 			_device = device;
 
 			std::vector<VkAttachmentDescription> attchmentDescriptions;
 
+			m_subpasses = subpasses;
+			if (m_subpasses.empty())
+			{
+				std::vector<uint32_t> outputAttachmanets;
+				for (uint32_t i = 0; i < layouts.size(); i++)
+				{
+					outputAttachmanets.push_back(i);
+				}
+				m_subpasses.push_back(RenderSubpass({}, outputAttachmanets));
+			}
+
+			//where every attachment is first written and read decides what is loaded and stored
+			const int notUsed = (int)m_subpasses.size();
+			std::vector<int> firstWrite(layouts.size(), notUsed);
+			std::vector<int> firstRead(layouts.size(), notUsed);
+			std::vector<int> lastRead(layouts.size(), -1);
+			for (int p = 0; p < m_subpasses.size(); p++)
+			{
+				for (uint32_t attachment : m_subpasses[p].outputAttachmanets)
+					firstWrite[attachment] = std::min(firstWrite[attachment], p);
+				for (uint32_t attachment : m_subpasses[p].inputAttachmanets)
+				{
+					firstRead[attachment] = std::min(firstRead[attachment], p);
+					lastRead[attachment] = std::max(lastRead[attachment], p);
+				}
+			}
+			const RenderSubpass& lastSubpass = m_subpasses.back();
+
+			m_transient.assign(layouts.size(), false);
 			for (int i = 0;i < layouts.size();i++)
 			{
 				VkImageLayout img_layout = layouts[i].second;
+				bool depth = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL == img_layout;
+
+				//a depth buffer that can't be sampled and a g-buffer target that only the later subpasses read as an input attachment
+				//never leave the pass, on tile based GPUs they stay in the tile memory. The caller decides if nothing else uses them
+				bool writtenLast = std::find(lastSubpass.outputAttachmanets.begin(), lastSubpass.outputAttachmanets.end(), (uint32_t)i) != lastSubpass.outputAttachmanets.end();
+				if (i >= allowTransient.size() || !allowTransient[i])
+					m_transient[i] = false;
+				else if (depth)
+					m_transient[i] = true;
+				else
+					m_transient[i] = firstWrite[i] != notUsed && lastRead[i] > firstWrite[i] && !writtenLast;
 
 				VkAttachmentDescription desc;
 				desc.flags = 0;
 				desc.format = layouts[i].first;
 				desc.samples = VK_SAMPLE_COUNT_1_BIT;
-				desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-
-				if (VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL == img_layout)
-					desc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;//TODO should it be VK_ATTACHMENT_STORE_OP_STORE
-				else
-					desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				//read before it is written, the contents come from an earlier pass
+				desc.loadOp = firstRead[i] < firstWrite[i] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+				desc.storeOp = (depth || m_transient[i]) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 
-				if (VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL == img_layout)
-					desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				if (depth)
+					desc.stencilLoadOp = desc.loadOp;
 				else
 					desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 
 				desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-				desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				desc.initialLayout = desc.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? img_layout : VK_IMAGE_LAYOUT_UNDEFINED;
 
 				desc.finalLayout = img_layout;
 
@@ -90,22 +128,10 @@ namespace engine
 				}
 			}
 
-			m_subpasses = subpasses;
-
 			std::vector<VkSubpassDescription> subpassDescriptions;
 
 			std::vector<VkAttachmentReference> allDepthReferences;
 
-			if (m_subpasses.empty())
-			{
-				std::vector<uint32_t> outputAttachmanets;
-				for (uint32_t i = 0; i < m_image_layouts.size(); i++)
-				{
-					outputAttachmanets.push_back(i);
-				}
-				m_subpasses.push_back(RenderSubpass({}, outputAttachmanets));
-			}
-
 			std::vector<std::vector<VkAttachmentReference>> allInputReferences;
 			allInputReferences.resize(m_subpasses.size());
 			std::vector<std::vector<VkAttachmentReference>> allColorReferences;
@@ -29,6 +29,7 @@ namespace engine
 			VulkanFrameBuffer* m_currentFrameBuffer = nullptr;
 
 			std::vector<RenderSubpass> m_subpasses;
+			std::vector<bool> m_transient;//per attachment, its contents never leave the pass
 			VkRenderPassBeginInfo m_renderPassBeginInfo;
 			VkRenderPass m_vkRenderPass;
 
@@ -38,10 +39,12 @@ namespace engine
 				Destroy();
 			}
 
-			void Create(VkDevice device, std::vector <std::pair<VkFormat, VkImageLayout>> layouts, bool bottom_of_pipe = false, std::vector<RenderSubpass> subpasses = {});
+			/** @brief allowTransient has a flag per attachment, only those can be transient */
+			void Create(VkDevice device, std::vector <std::pair<VkFormat, VkImageLayout>> layouts, bool bottom_of_pipe = false, std::vector<RenderSubpass> subpasses = {}, std::vector<bool> allowTransient = {});
 			void AddFrameBuffer(VulkanFrameBuffer* fb);
 			void ResetFrameBuffers() { m_frameBuffers.clear(); }
 			VkRenderPass GetRenderPass() { return m_vkRenderPass; }
+			bool IsTransient(uint32_t attachment) { return m_transient[attachment]; }
 			void Begin(VkCommandBuffer command_buffer, int fb_index, VkSubpassContents pass_constants = VK_SUBPASS_CONTENTS_INLINE);
 			void End(VkCommandBuffer command_buffer);
 			void SetClearColor(VkClearColorValue value, int attachment);
@@ -1,5 +1,6 @@
 #include "VulkanSwapChain.h"
 #include <stdexcept>
+#include <algorithm>
 
 namespace engine
 {
@@ -23,7 +24,7 @@ namespace engine
                 throw std::runtime_error("failed to create surface!");
         }
 
-        void VulkanSwapChain::Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t* width, uint32_t* height, uint32_t graphicsQueueIndex, uint32_t presentQueueIndex, bool vsync)
+        void VulkanSwapChain::Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t* width, uint32_t* height, uint32_t graphicsQueueIndex, uint32_t presentQueueIndex, const std::vector<VkPresentModeKHR>& presentModes)
         {
             _physicalDevice = physicalDevice;
             _logicalDevice = device;
@@ -64,9 +65,11 @@ namespace engine
                 vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, surface, &presentModeCount, availablePresentModes.data());
             }
 
-            for (const auto& availablePresentMode : availablePresentModes) {
-                if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                    m_presentMode = availablePresentMode;
+            m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+            for (const auto& presentMode : presentModes) {
+                if (std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end()) {
+                    m_presentMode = presentMode;
+                    break;
                 }
             }
 
@@ -29,7 +29,8 @@ namespace engine
 
             void InitSurface(VkInstance instance, void* platformHandle, void* platformWindow);
 
-            void Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t* width, uint32_t* height, uint32_t graphicsQueueIndex, uint32_t presentQueueIndex, bool vsync = false);
+            // The first supported mode of presentModes is used, FIFO is always supported
+            void Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t* width, uint32_t* height, uint32_t graphicsQueueIndex, uint32_t presentQueueIndex, const std::vector<VkPresentModeKHR>& presentModes);
 
             VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t* imageIndex);
 
@@ -16,6 +16,28 @@ namespace engine
 			VkImageAspectFlags aspect,
 			uint32_t mipLevelsCount, uint32_t layersCount,
 			VkImageCreateFlags flags)
+		{
+			CreateImage(device, extent, format, imageUsageFlags, imageLayout, aspect, mipLevelsCount, layersCount, flags);
+
+			VkMemoryAllocateInfo memAllocInfo{};
+			memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			VkMemoryRequirements memReqs;
+
+			vkGetImageMemoryRequirements(_device, m_vkImage, &memReqs);//TODO see which is faster? call this or store it's contents?
+
+			memAllocInfo.allocationSize = memReqs.size;
+
+			memAllocInfo.memoryTypeIndex = tools::getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryProperties);
+			VK_CHECK_RESULT(vkAllocateMemory(_device, &memAllocInfo, nullptr, &m_deviceMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(_device, m_vkImage, m_deviceMemory, 0));
+		}
+
+		void VulkanTexture::CreateImage(VkDevice device, VkExtent3D extent, VkFormat format,
+			VkImageUsageFlags imageUsageFlags,
+			VkImageLayout imageLayout,
+			VkImageAspectFlags aspect,
+			uint32_t mipLevelsCount, uint32_t layersCount,
+			VkImageCreateFlags flags)
 		{
 			_device = device;
 			m_format = format;
@@ -27,10 +49,6 @@ namespace engine
 			m_descriptor.imageLayout = imageLayout;
 			m_aspect = aspect;
 
-			VkMemoryAllocateInfo memAllocInfo{};
-			memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			VkMemoryRequirements memReqs;
-
 			// Create optimal tiled target image
 			VkImageCreateInfo imageCreateInfo{};
 			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -48,15 +66,45 @@ namespace engine
 			imageCreateInfo.flags = flags;
 
 			VK_CHECK_RESULT(vkCreateImage(_device, &imageCreateInfo, nullptr, &m_vkImage));
+		}
 
-			vkGetImageMemoryRequirements(_device, m_vkImage, &memReqs);//TODO see which is faster? call this or store it's contents?
+		void VulkanTexture::MakeTransient(VkPhysicalDeviceMemoryProperties* memoryProperties)
+		{
+			if (m_transient)
+				return;
 
-			memAllocInfo.allocationSize = memReqs.size;
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(_device, m_vkImage, &memReqs);
+			m_imageSize = memReqs.size;
 
-			memAllocInfo.memoryTypeIndex = tools::getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryProperties);
+			VkExtent3D extent = { m_width, m_height, m_depth };
+			VkImageLayout imageLayout = m_descriptor.imageLayout;
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+			usage |= (m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+			Destroy();
+			m_vkImage = VK_NULL_HANDLE;
+			m_deviceMemory = VK_NULL_HANDLE;
+			m_descriptor.imageView = VK_NULL_HANDLE;
+			m_descriptor.sampler = VK_NULL_HANDLE;
+
+			CreateImage(_device, extent, m_format, usage, imageLayout, m_aspect, m_mipLevelsCount, m_layerCount);
+			vkGetImageMemoryRequirements(_device, m_vkImage, &memReqs);
+
+			VkMemoryAllocateInfo memAllocInfo{};
+			memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memAllocInfo.allocationSize = memReqs.size;
+			VkBool32 lazilyAllocated = VK_FALSE;
+			memAllocInfo.memoryTypeIndex = tools::getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, memoryProperties, &lazilyAllocated);
+			//desktop GPUs have no lazily allocated memory, the attachment is still never stored there
+			if (!lazilyAllocated)
+				memAllocInfo.memoryTypeIndex = tools::getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryProperties);
 			VK_CHECK_RESULT(vkAllocateMemory(_device, &memAllocInfo, nullptr, &m_deviceMemory));
 			VK_CHECK_RESULT(vkBindImageMemory(_device, m_vkImage, m_deviceMemory, 0));
 
+			CreateDescriptor(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_IMAGE_VIEW_TYPE_2D);
+			m_transient = true;
+			m_lazilyAllocated = lazilyAllocated == VK_TRUE;
 		}
 
 		void VulkanTexture::ChangeLayout(
@@ -45,6 +45,9 @@ namespace engine
 
 			VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
 
+			bool m_transient = false;//an attachment whose contents never leave its render pass
+			bool m_lazilyAllocated = false;
+
 			VulkanTexture::~VulkanTexture() { Destroy(); }
 
 			void Create(VkDevice device, VkPhysicalDeviceMemoryProperties* memoryProperties, VkExtent3D extent, VkFormat format,
@@ -54,6 +57,18 @@ namespace engine
 				uint32_t mipLevelsCount = 1, uint32_t layersCount = 1, VkImageCreateFlags flags = 0
 			);
 
+			/** @brief Only the image, its memory is bound by the caller and not freed by Destroy */
+			void CreateImage(VkDevice device, VkExtent3D extent, VkFormat format,
+				VkImageUsageFlags imageUsageFlags,
+				VkImageLayout imageLayout,
+				VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+				uint32_t mipLevelsCount = 1, uint32_t layersCount = 1, VkImageCreateFlags flags = 0
+			);
+
+			/** @brief Creates the image again as a transient attachment, in lazily allocated memory when the device has it. Its old
+			 *  contents, view and sampler are gone and it can only be an attachment or an input attachment after */
+			void MakeTransient(VkPhysicalDeviceMemoryProperties* memoryProperties);
+
 			void ChangeLayout(
 				VkCommandBuffer cmdbuffer,
 				VkImageLayout oldImageLayout,
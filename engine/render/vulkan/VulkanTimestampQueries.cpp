@@ -0,0 +1,64 @@
+#include "VulkanTimestampQueries.h"
+
+namespace engine
+{
+	namespace render
+	{
+		bool VulkanTimestampQueries::Create(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkQueueFamilyProperties& queueFamily, uint32_t queriesPerSlot, uint32_t slots)
+		{
+			_device = device;
+			m_queriesPerSlot = queriesPerSlot;
+			m_slots = slots;
+			if (queueFamily.timestampValidBits == 0 || properties.limits.timestampPeriod <= 0.0f)
+				return false;
+			m_period = properties.limits.timestampPeriod;
+
+			VkQueryPoolCreateInfo queryPoolInfo{};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = queriesPerSlot * slots;
+			VK_CHECK_RESULT(vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &m_queryPool));
+			m_results.resize(queriesPerSlot * 2);
+			return true;
+		}
+
+		void VulkanTimestampQueries::Reset(VkCommandBuffer commandBuffer, uint32_t slot)
+		{
+			if (m_queryPool == VK_NULL_HANDLE)
+				return;
+			vkCmdResetQueryPool(commandBuffer, m_queryPool, slot * m_queriesPerSlot, m_queriesPerSlot);
+		}
+
+		void VulkanTimestampQueries::Write(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t query, VkPipelineStageFlagBits stage)
+		{
+			if (m_queryPool == VK_NULL_HANDLE)
+				return;
+			vkCmdWriteTimestamp(commandBuffer, stage, m_queryPool, slot * m_queriesPerSlot + query);
+		}
+
+		bool VulkanTimestampQueries::GetIntervals(uint32_t slot, std::vector<double>& milliseconds)
+		{
+			if (m_queryPool == VK_NULL_HANDLE || m_queriesPerSlot < 2)
+				return false;
+			//every value is followed by its availability, a slot that was never submitted has none
+			VkResult result = vkGetQueryPoolResults(_device, m_queryPool, slot * m_queriesPerSlot, m_queriesPerSlot, m_results.size() * sizeof(uint64_t), m_results.data(),
+				2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if (result != VK_SUCCESS && result != VK_NOT_READY)
+				return false;
+			for (uint32_t query = 0; query < m_queriesPerSlot; query++)
+				if (m_results[query * 2 + 1] == 0)
+					return false;
+
+			milliseconds.resize(m_queriesPerSlot - 1);
+			for (uint32_t query = 0; query + 1 < m_queriesPerSlot; query++)
+				milliseconds[query] = static_cast<double>(m_results[(query + 1) * 2] - m_results[query * 2]) * m_period / 1000000.0;
+			return true;
+		}
+
+		VulkanTimestampQueries::~VulkanTimestampQueries()
+		{
+			if (m_queryPool != VK_NULL_HANDLE)
+				vkDestroyQueryPool(_device, m_queryPool, nullptr);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <VulkanTools.h>
+#include <vector>
+
+namespace engine
+{
+	namespace render
+	{
+		/** @brief Timestamps written by command buffers, one range of queries per slot so every frame in flight
+		 *  or every swap chain image has its own. The results of a slot are read once its work finished */
+		class VulkanTimestampQueries
+		{
+			VkDevice _device = VK_NULL_HANDLE;
+			VkQueryPool m_queryPool = VK_NULL_HANDLE;
+			uint32_t m_queriesPerSlot = 0;
+			uint32_t m_slots = 0;
+			//nanoseconds per tick
+			float m_period = 1.0f;
+			std::vector<uint64_t> m_results;
+
+		public:
+			/** @brief False when the queue can't write timestamps, the other calls do nothing then */
+			bool Create(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkQueueFamilyProperties& queueFamily, uint32_t queriesPerSlot, uint32_t slots);
+
+			bool IsSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+			/** @brief Resets the queries of the slot, recorded before the first Write of the slot and outside of render passes */
+			void Reset(VkCommandBuffer commandBuffer, uint32_t slot);
+			void Write(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t query, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+			/** @brief Milliseconds between each query of the slot and the next one, false when the slot has no results yet.
+			 *  It doesn't wait for the GPU */
+			bool GetIntervals(uint32_t slot, std::vector<double>& milliseconds);
+
+			~VulkanTimestampQueries();
+		};
+	}
+}
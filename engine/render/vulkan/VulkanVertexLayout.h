@@ -43,6 +43,15 @@ namespace engine
 				case VERTEX_COMPONENT_TANGENT4:
 				case VERTEX_COMPONENT_DUMMY_VEC4:	return VK_FORMAT_R32G32B32A32_SFLOAT;
 
+				case VERTEX_COMPONENT_POSITION_SNORM16:	return VK_FORMAT_R16G16B16A16_SNORM;
+
+				case VERTEX_COMPONENT_NORMAL_OCT16:
+				case VERTEX_COMPONENT_TANGENT_OCT16:	return VK_FORMAT_R16G16_SNORM;
+
+				case VERTEX_COMPONENT_UV_HALF:		return VK_FORMAT_R16G16_SFLOAT;
+
+				case VERTEX_COMPONENT_UV_UNORM16:	return VK_FORMAT_R16G16_UNORM;
+
 				default:							return VK_FORMAT_R32G32B32_SFLOAT;
 				}
 			}
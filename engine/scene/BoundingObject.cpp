@@ -65,9 +65,6 @@ namespace engine
 
 				if (dist < -m_radius)
 					return false;//we are outside
-
-				if (abs(dist) < m_radius)
-					return true;//we intersect
 			}
 			return ret;
 		}
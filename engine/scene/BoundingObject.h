@@ -14,13 +14,19 @@ namespace engine
 			glm::vec3 m_center = glm::vec3(0.0f);
 			glm::vec3 m_velocity = glm::vec3(0.0f);
 			float m_size;
+			uint32_t m_index = 0;
 		public:
 			std::vector<int> position_in_tree;
 			glm::vec3 GetCenter() { return m_center; }
 			glm::vec3 GetVelocity() { return m_velocity; }
+			void SetCenter(glm::vec3 value) { m_center = value; }
+			void SetVelocity(glm::vec3 value) { m_velocity = value; }
 			float GetSize() { return m_size; }
 			bool IsVisible() { return m_visible; }
 			void SetVisibility(bool value) { m_visible = value; }
+			//index of the object in the application, reported by the visibility queries
+			uint32_t GetIndex() { return m_index; }
+			void SetIndex(uint32_t value) { m_index = value; }
 			virtual bool isInsideSpace(glm::vec3 point1, glm::vec3 point2) = 0;
 			virtual bool FrustumIntersect(glm::vec4* planes) = 0;
 			virtual bool IsClose(BoundingObject*) = 0;
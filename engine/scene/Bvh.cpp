@@ -0,0 +1,680 @@
+#include "Bvh.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+
+//the packets are traversed with SSE where it's available, elsewhere every ray of a packet is traversed on its own
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace engine
+{
+	namespace scene
+	{
+		static float BoxDistanceSquared(const BvhNode& node, glm::vec3 p)
+		{
+			glm::vec3 d = glm::max(glm::max(node.boundsMin - p, p - node.boundsMax), glm::vec3(0.0f));
+			return glm::dot(d, d);
+		}
+
+		static void RunJobs(ThreadPool* threadPool, uint32_t jobCount, const std::function<void(uint32_t job)>& function)
+		{
+			if (threadPool)
+			{
+				threadPool->runJobs(jobCount, function);
+				return;
+			}
+			for (uint32_t job = 0; job < jobCount; job++)
+				function(job);
+		}
+
+		struct BvhBin
+		{
+			glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+			glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+			uint32_t count = 0;
+
+			void Grow(glm::vec3 otherMin, glm::vec3 otherMax, uint32_t otherCount)
+			{
+				boundsMin = glm::min(boundsMin, otherMin);
+				boundsMax = glm::max(boundsMax, otherMax);
+				count += otherCount;
+			}
+		};
+
+		static float HalfArea(glm::vec3 boundsMin, glm::vec3 boundsMax)
+		{
+			glm::vec3 e = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+
+		void BvhRayPacket::Set(uint32_t lane, const BvhRay& ray)
+		{
+			originX[lane] = ray.origin.x;
+			originY[lane] = ray.origin.y;
+			originZ[lane] = ray.origin.z;
+			directionX[lane] = ray.direction.x;
+			directionY[lane] = ray.direction.y;
+			directionZ[lane] = ray.direction.z;
+			tMin[lane] = ray.tMin;
+			tMax[lane] = ray.tMax;
+		}
+
+		BvhRay BvhRayPacket::Get(uint32_t lane) const
+		{
+			BvhRay ray;
+			ray.origin = glm::vec3(originX[lane], originY[lane], originZ[lane]);
+			ray.direction = glm::vec3(directionX[lane], directionY[lane], directionZ[lane]);
+			ray.tMin = tMin[lane];
+			ray.tMax = tMax[lane];
+			return ray;
+		}
+
+		void Bvh::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, ThreadPool* threadPool)
+		{
+			uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+			m_nodes.clear();
+			m_vertices.clear();
+			m_triangles.resize(triangleCount);
+			std::iota(m_triangles.begin(), m_triangles.end(), 0);
+			if (triangleCount == 0)
+				return;
+
+			uint32_t threadCount = threadPool ? std::max(static_cast<uint32_t>(threadPool->threads.size()), 1u) : 1;
+			uint32_t jobCount = threadCount * 4;
+			uint32_t trianglesPerJob = (triangleCount + jobCount - 1) / jobCount;
+			BuildData data;
+			data.centroids.resize(triangleCount);
+			data.boundsMin.resize(triangleCount);
+			data.boundsMax.resize(triangleCount);
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				for (uint32_t t = job * trianglesPerJob; t < std::min((job + 1) * trianglesPerJob, triangleCount); t++)
+				{
+					glm::vec3 a = positions[indices[t * 3]], b = positions[indices[t * 3 + 1]], c = positions[indices[t * 3 + 2]];
+					data.boundsMin[t] = glm::min(glm::min(a, b), c);
+					data.boundsMax[t] = glm::max(glm::max(a, b), c);
+					data.centroids[t] = (a + b + c) / 3.0f;
+				}
+			});
+
+			BvhNode root;
+			root.boundsMin = glm::vec3(FLT_MAX);
+			root.boundsMax = glm::vec3(-FLT_MAX);
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				root.boundsMin = glm::min(root.boundsMin, data.boundsMin[t]);
+				root.boundsMax = glm::max(root.boundsMax, data.boundsMax[t]);
+			}
+			root.leftFirst = 0;
+			root.triangleCount = triangleCount;
+			m_nodes.reserve(triangleCount * 2);
+			m_nodes.push_back(root);
+
+			//the top of the tree is split here until there are enough subtrees to keep every thread busy, node and depth
+			uint32_t subtreeTriangles = threadCount > 1 ? std::max(triangleCount / (threadCount * 8), 256u) : UINT32_MAX;
+			std::vector<std::pair<uint32_t, uint32_t>> pending(1, std::make_pair(0u, 0u));
+			std::vector<std::pair<uint32_t, uint32_t>> subtrees;
+			while (!pending.empty())
+			{
+				std::pair<uint32_t, uint32_t> task = pending.back();
+				pending.pop_back();
+				if (m_nodes[task.first].triangleCount > subtreeTriangles && task.second < MAX_DEPTH && Split(m_nodes, task.first, data, threadPool))
+				{
+					pending.push_back(std::make_pair(m_nodes[task.first].leftFirst, task.second + 1));
+					pending.push_back(std::make_pair(m_nodes[task.first].leftFirst + 1, task.second + 1));
+				}
+				else
+				{
+					subtrees.push_back(task);
+				}
+			}
+
+			//every subtree owns its range of triangles, its nodes go to a list of its own
+			std::vector<std::vector<BvhNode>> subtreeNodes(subtrees.size());
+			RunJobs(threadPool, static_cast<uint32_t>(subtrees.size()), [&](uint32_t job) {
+				subtreeNodes[job].push_back(m_nodes[subtrees[job].first]);
+				BuildSubtree(subtreeNodes[job], subtrees[job].second, data);
+			});
+
+			//the subtree roots stay where they are, the rest of their nodes is appended after the top of the tree
+			for (size_t i = 0; i < subtrees.size(); i++)
+			{
+				std::vector<BvhNode>& nodes = subtreeNodes[i];
+				uint32_t offset = static_cast<uint32_t>(m_nodes.size()) - 1;
+				for (auto& node : nodes)
+					if (!node.IsLeaf())
+						node.leftFirst += offset;
+				m_nodes[subtrees[i].first] = nodes[0];
+				m_nodes.insert(m_nodes.end(), nodes.begin() + 1, nodes.end());
+			}
+
+			m_vertices.resize(triangleCount * 3);
+			for (uint32_t t = 0; t < triangleCount; t++)
+				for (uint32_t c = 0; c < 3; c++)
+					m_vertices[t * 3 + c] = positions[indices[m_triangles[t] * 3 + c]];
+		}
+
+		void Bvh::BuildSubtree(std::vector<BvhNode>& nodes, uint32_t depth, const BuildData& data)
+		{
+			std::vector<std::pair<uint32_t, uint32_t>> stack(1, std::make_pair(0u, depth));
+			while (!stack.empty())
+			{
+				std::pair<uint32_t, uint32_t> task = stack.back();
+				stack.pop_back();
+				if (task.second >= MAX_DEPTH || !Split(nodes, task.first, data))
+					continue;
+				stack.push_back(std::make_pair(nodes[task.first].leftFirst + 1, task.second + 1));
+				stack.push_back(std::make_pair(nodes[task.first].leftFirst, task.second + 1));
+			}
+		}
+
+		bool Bvh::Split(std::vector<BvhNode>& nodes, uint32_t node, const BuildData& data, ThreadPool* threadPool)
+		{
+			uint32_t first = nodes[node].leftFirst;
+			uint32_t count = nodes[node].triangleCount;
+			if (count <= 1)
+				return false;
+
+			//the nodes at the top of the tree are binned in parallel, every job bins its part of the triangles and the bins are added up after
+			uint32_t jobCount = threadPool && count >= PARALLEL_SPLIT_TRIANGLES ? static_cast<uint32_t>(threadPool->threads.size()) * 4 : 1;
+			uint32_t trianglesPerJob = (count + jobCount - 1) / jobCount;
+			//one job keeps its bins on the stack, most nodes are small
+			BvhBin singleBounds;
+			BvhBin singleBins[3 * SAH_BINS];
+			std::vector<BvhBin> jobBoundsList, jobBinsList;
+			BvhBin* jobBounds = &singleBounds;
+			BvhBin* jobBins = singleBins;
+			if (jobCount > 1)
+			{
+				jobBoundsList.resize(jobCount);
+				jobBinsList.resize(jobCount * 3 * SAH_BINS);
+				jobBounds = jobBoundsList.data();
+				jobBins = jobBinsList.data();
+			}
+			RunJobs(jobCount > 1 ? threadPool : nullptr, jobCount, [&](uint32_t job) {
+				for (uint32_t i = first + job * trianglesPerJob; i < std::min(first + (job + 1) * trianglesPerJob, first + count); i++)
+					jobBounds[job].Grow(data.centroids[m_triangles[i]], data.centroids[m_triangles[i]], 1);
+			});
+			BvhBin centroidBounds;
+			for (uint32_t job = 0; job < jobCount; job++)
+				centroidBounds.Grow(jobBounds[job].boundsMin, jobBounds[job].boundsMax, jobBounds[job].count);
+			glm::vec3 centroidMin = centroidBounds.boundsMin;
+			glm::vec3 extent = centroidBounds.boundsMax - centroidMin;
+			glm::vec3 scale;
+			for (int axis = 0; axis < 3; axis++)
+				scale[axis] = extent[axis] > 0.0f ? SAH_BINS / extent[axis] : 0.0f;
+
+			RunJobs(jobCount > 1 ? threadPool : nullptr, jobCount, [&](uint32_t job) {
+				BvhBin* bins = &jobBins[job * 3 * SAH_BINS];
+				for (uint32_t i = first + job * trianglesPerJob; i < std::min(first + (job + 1) * trianglesPerJob, first + count); i++)
+				{
+					uint32_t t = m_triangles[i];
+					for (int axis = 0; axis < 3; axis++)
+					{
+						uint32_t b = std::min(static_cast<uint32_t>((data.centroids[t][axis] - centroidMin[axis]) * scale[axis]), SAH_BINS - 1);
+						bins[axis * SAH_BINS + b].Grow(data.boundsMin[t], data.boundsMax[t], 1);
+					}
+				}
+			});
+
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			uint32_t bestSplit = 0;
+			BvhNode bestLeft, bestRight;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				//every centroid in the same plane, no split on this axis separates them
+				if (extent[axis] <= 0.0f)
+					continue;
+				BvhBin bins[SAH_BINS];
+				for (uint32_t job = 0; job < jobCount; job++)
+					for (uint32_t b = 0; b < SAH_BINS; b++)
+					{
+						const BvhBin& bin = jobBins[(job * 3 + axis) * SAH_BINS + b];
+						bins[b].Grow(bin.boundsMin, bin.boundsMax, bin.count);
+					}
+
+				//the bins right of every plane are swept once from the right, then the planes are tried from the left
+				BvhBin right[SAH_BINS];
+				for (int b = SAH_BINS - 1; b > 0; b--)
+				{
+					right[b - 1] = right[b];
+					right[b - 1].Grow(bins[b].boundsMin, bins[b].boundsMax, bins[b].count);
+				}
+				BvhBin left;
+				for (uint32_t b = 0; b + 1 < SAH_BINS; b++)
+				{
+					left.Grow(bins[b].boundsMin, bins[b].boundsMax, bins[b].count);
+					if (left.count == 0 || right[b].count == 0)
+						continue;
+					float cost = left.count * HalfArea(left.boundsMin, left.boundsMax) + right[b].count * HalfArea(right[b].boundsMin, right[b].boundsMax);
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = b + 1;
+						bestLeft.boundsMin = left.boundsMin;
+						bestLeft.boundsMax = left.boundsMax;
+						bestRight.boundsMin = right[b].boundsMin;
+						bestRight.boundsMax = right[b].boundsMax;
+					}
+				}
+			}
+			if (bestAxis < 0)
+				return false;
+
+			//a traversal step costs about as much as a triangle test, small nodes stay leaves when splitting them doesn't pay
+			float area = HalfArea(nodes[node].boundsMin, nodes[node].boundsMax);
+			if (count <= MAX_LEAF_TRIANGLES && area + bestCost >= count * area)
+				return false;
+
+			float axisScale = scale[bestAxis];
+			float axisMin = centroidMin[bestAxis];
+			uint32_t middle = static_cast<uint32_t>(std::partition(m_triangles.begin() + first, m_triangles.begin() + first + count, [&](uint32_t t) {
+				return std::min(static_cast<uint32_t>((data.centroids[t][bestAxis] - axisMin) * axisScale), SAH_BINS - 1) < bestSplit;
+			}) - m_triangles.begin());
+
+			uint32_t left = static_cast<uint32_t>(nodes.size());
+			bestLeft.leftFirst = first;
+			bestLeft.triangleCount = middle - first;
+			bestRight.leftFirst = middle;
+			bestRight.triangleCount = first + count - middle;
+			nodes.push_back(bestLeft);
+			nodes.push_back(bestRight);
+			nodes[node].leftFirst = left;
+			nodes[node].triangleCount = 0;
+			return true;
+		}
+
+		void Bvh::Refit(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+		{
+			for (uint32_t t = 0; t < GetTriangleCount(); t++)
+				for (uint32_t c = 0; c < 3; c++)
+					m_vertices[t * 3 + c] = positions[indices[m_triangles[t] * 3 + c]];
+
+			//children come after their parents, going backwards every child is done before its parent
+			for (size_t i = m_nodes.size(); i-- > 0;)
+			{
+				BvhNode& node = m_nodes[i];
+				if (node.IsLeaf())
+				{
+					node.boundsMin = glm::vec3(FLT_MAX);
+					node.boundsMax = glm::vec3(-FLT_MAX);
+					for (uint32_t v = node.leftFirst * 3; v < (node.leftFirst + node.triangleCount) * 3; v++)
+					{
+						node.boundsMin = glm::min(node.boundsMin, m_vertices[v]);
+						node.boundsMax = glm::max(node.boundsMax, m_vertices[v]);
+					}
+				}
+				else
+				{
+					node.boundsMin = glm::min(m_nodes[node.leftFirst].boundsMin, m_nodes[node.leftFirst + 1].boundsMin);
+					node.boundsMax = glm::max(m_nodes[node.leftFirst].boundsMax, m_nodes[node.leftFirst + 1].boundsMax);
+				}
+			}
+		}
+
+		float Bvh::GetSahCost() const
+		{
+			if (m_nodes.empty())
+				return 0.0f;
+			float cost = 0.0f;
+			for (auto& node : m_nodes)
+				cost += HalfArea(node.boundsMin, node.boundsMax) * (node.IsLeaf() ? node.triangleCount : 1.0f);
+			return cost / std::max(HalfArea(m_nodes[0].boundsMin, m_nodes[0].boundsMax), FLT_MIN);
+		}
+
+		//Ericson, Real-Time Collision Detection 5.1.5, with the region the point falls in kept as the feature
+		glm::vec3 Bvh::ClosestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c, uint32_t& feature)
+		{
+			glm::vec3 ab = b - a;
+			glm::vec3 ac = c - a;
+			glm::vec3 ap = p - a;
+			float d1 = glm::dot(ab, ap);
+			float d2 = glm::dot(ac, ap);
+			if (d1 <= 0.0f && d2 <= 0.0f)
+			{
+				feature = FEATURE_VERTEX0;
+				return a;
+			}
+
+			glm::vec3 bp = p - b;
+			float d3 = glm::dot(ab, bp);
+			float d4 = glm::dot(ac, bp);
+			if (d3 >= 0.0f && d4 <= d3)
+			{
+				feature = FEATURE_VERTEX1;
+				return b;
+			}
+
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f && d1 - d3 > 0.0f)
+			{
+				feature = FEATURE_EDGE01;
+				return a + ab * (d1 / (d1 - d3));
+			}
+
+			glm::vec3 cp = p - c;
+			float d5 = glm::dot(ab, cp);
+			float d6 = glm::dot(ac, cp);
+			if (d6 >= 0.0f && d5 <= d6)
+			{
+				feature = FEATURE_VERTEX2;
+				return c;
+			}
+
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f && d2 - d6 > 0.0f)
+			{
+				feature = FEATURE_EDGE20;
+				return a + ac * (d2 / (d2 - d6));
+			}
+
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f && (d4 - d3) + (d5 - d6) > 0.0f)
+			{
+				feature = FEATURE_EDGE12;
+				return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			}
+
+			//degenerate triangles end up here with a zero area, their first corner is as good as any point
+			float area = va + vb + vc;
+			if (area <= 0.0f)
+			{
+				feature = FEATURE_VERTEX0;
+				return a;
+			}
+			feature = FEATURE_FACE;
+			return a + ab * (vb / area) + ac * (vc / area);
+		}
+
+		bool Bvh::ClosestPoint(glm::vec3 p, BvhClosestPoint& result, float maxDistance) const
+		{
+			result = BvhClosestPoint();
+			if (m_nodes.empty())
+				return false;
+			float best = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+
+			uint32_t stack[64];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const BvhNode& node = m_nodes[stack[--stackSize]];
+				if (BoxDistanceSquared(node, p) >= best)
+					continue;
+				if (node.IsLeaf())
+				{
+					for (uint32_t t = node.leftFirst; t < node.leftFirst + node.triangleCount; t++)
+					{
+						uint32_t feature;
+						glm::vec3 q = ClosestPointOnTriangle(p, m_vertices[t * 3], m_vertices[t * 3 + 1], m_vertices[t * 3 + 2], feature);
+						float distanceSquared = glm::dot(p - q, p - q);
+						if (distanceSquared < best)
+						{
+							best = distanceSquared;
+							result.point = q;
+							result.distanceSquared = distanceSquared;
+							result.triangle = m_triangles[t];
+							result.feature = feature;
+						}
+					}
+					continue;
+				}
+				//the nearer child goes on top so it is visited first and shrinks the search for the other one
+				uint32_t nearChild = node.leftFirst;
+				uint32_t farChild = node.leftFirst + 1;
+				float nearDistance = BoxDistanceSquared(m_nodes[nearChild], p);
+				float farDistance = BoxDistanceSquared(m_nodes[farChild], p);
+				if (farDistance < nearDistance)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearDistance, farDistance);
+				}
+				if (farDistance < best)
+					stack[stackSize++] = farChild;
+				if (nearDistance < best)
+					stack[stackSize++] = nearChild;
+			}
+			return result.triangle != UINT32_MAX;
+		}
+
+		//Moller and Trumbore, Fast, Minimum Storage Ray/Triangle Intersection
+		bool Bvh::IntersectTriangle(const BvhRay& ray, glm::vec3 a, glm::vec3 b, glm::vec3 c, float& t, float& u, float& v)
+		{
+			glm::vec3 e1 = b - a;
+			glm::vec3 e2 = c - a;
+			glm::vec3 p = glm::cross(ray.direction, e2);
+			float determinant = glm::dot(e1, p);
+			if (fabsf(determinant) < 1e-12f)
+				return false;
+			float inverseDeterminant = 1.0f / determinant;
+			glm::vec3 s = ray.origin - a;
+			u = glm::dot(s, p) * inverseDeterminant;
+			if (u < 0.0f || u > 1.0f)
+				return false;
+			glm::vec3 q = glm::cross(s, e1);
+			v = glm::dot(ray.direction, q) * inverseDeterminant;
+			if (v < 0.0f || u + v > 1.0f)
+				return false;
+			t = glm::dot(e2, q) * inverseDeterminant;
+			return t > ray.tMin && t < ray.tMax;
+		}
+
+		static bool IntersectBox(const BvhNode& node, glm::vec3 origin, glm::vec3 inverseDirection, float tMin, float tMax, float& tEntry)
+		{
+			glm::vec3 t0 = (node.boundsMin - origin) * inverseDirection;
+			glm::vec3 t1 = (node.boundsMax - origin) * inverseDirection;
+			glm::vec3 tNear = glm::min(t0, t1);
+			glm::vec3 tFar = glm::max(t0, t1);
+			tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+			return tEntry <= std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+		}
+
+		template<bool anyHit> bool Bvh::Traverse(const BvhRay& ray, BvhHit& hit) const
+		{
+			hit = BvhHit();
+			if (m_nodes.empty())
+				return false;
+			BvhRay clipped = ray;
+			glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+			uint32_t stack[64];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const BvhNode& node = m_nodes[stack[--stackSize]];
+				float tEntry;
+				if (!IntersectBox(node, ray.origin, inverseDirection, clipped.tMin, clipped.tMax, tEntry))
+					continue;
+				if (node.IsLeaf())
+				{
+					for (uint32_t t = node.leftFirst; t < node.leftFirst + node.triangleCount; t++)
+					{
+						float distance, u, v;
+						if (!IntersectTriangle(clipped, m_vertices[t * 3], m_vertices[t * 3 + 1], m_vertices[t * 3 + 2], distance, u, v))
+							continue;
+						clipped.tMax = distance;
+						hit.t = distance;
+						hit.u = u;
+						hit.v = v;
+						hit.triangle = m_triangles[t];
+						if (anyHit)
+							return true;
+					}
+					continue;
+				}
+				//the nearer child goes on top, its hits shorten the ray before the other one is tested
+				uint32_t nearChild = node.leftFirst;
+				uint32_t farChild = node.leftFirst + 1;
+				float nearEntry, farEntry;
+				bool nearHit = IntersectBox(m_nodes[nearChild], ray.origin, inverseDirection, clipped.tMin, clipped.tMax, nearEntry);
+				bool farHit = IntersectBox(m_nodes[farChild], ray.origin, inverseDirection, clipped.tMin, clipped.tMax, farEntry);
+				if (farHit && (!nearHit || farEntry < nearEntry))
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearHit, farHit);
+				}
+				if (farHit)
+					stack[stackSize++] = farChild;
+				if (nearHit)
+					stack[stackSize++] = nearChild;
+			}
+			return hit.IsHit();
+		}
+
+		bool Bvh::Intersect(const BvhRay& ray, BvhHit& hit) const
+		{
+			return Traverse<false>(ray, hit);
+		}
+
+		bool Bvh::Occluded(const BvhRay& ray) const
+		{
+			BvhHit hit;
+			return Traverse<true>(ray, hit);
+		}
+
+#if defined(BVH_SSE)
+		//the box of the node against the four rays, a bit per lane that hits it
+		static int IntersectBox4(const BvhNode& node, const __m128 origin[3], const __m128 inverseDirection[3], __m128 tMin, __m128 tMax)
+		{
+			__m128 tNear = tMin;
+			__m128 tFar = tMax;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin[axis]), origin[axis]), inverseDirection[axis]);
+				__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax[axis]), origin[axis]), inverseDirection[axis]);
+				tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+				tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+			}
+			return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+		}
+#endif
+
+		void Bvh::Intersect(const BvhRayPacket& packet, BvhHit hits[BVH_PACKET_SIZE]) const
+		{
+#if defined(BVH_SSE)
+			for (uint32_t lane = 0; lane < BVH_PACKET_SIZE; lane++)
+				hits[lane] = BvhHit();
+			if (m_nodes.empty())
+				return;
+
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 zero = _mm_setzero_ps();
+			__m128 origin[3] = { _mm_loadu_ps(packet.originX), _mm_loadu_ps(packet.originY), _mm_loadu_ps(packet.originZ) };
+			__m128 direction[3] = { _mm_loadu_ps(packet.directionX), _mm_loadu_ps(packet.directionY), _mm_loadu_ps(packet.directionZ) };
+			__m128 inverseDirection[3] = { _mm_div_ps(one, direction[0]), _mm_div_ps(one, direction[1]), _mm_div_ps(one, direction[2]) };
+			__m128 tMin = _mm_loadu_ps(packet.tMin);
+			__m128 tMax = _mm_loadu_ps(packet.tMax);
+			__m128 hitU = zero, hitV = zero;
+			__m128i hitTriangle = _mm_set1_epi32(-1);
+			//lanes without a hit keep their tMax, it is only written back where a triangle was hit
+			__m128 hitT = tMax;
+
+			uint32_t stack[64];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const BvhNode& node = m_nodes[stack[--stackSize]];
+				if (IntersectBox4(node, origin, inverseDirection, tMin, hitT) == 0)
+					continue;
+				if (node.IsLeaf())
+				{
+					for (uint32_t t = node.leftFirst; t < node.leftFirst + node.triangleCount; t++)
+					{
+						glm::vec3 a = m_vertices[t * 3];
+						glm::vec3 e1 = m_vertices[t * 3 + 1] - a;
+						glm::vec3 e2 = m_vertices[t * 3 + 2] - a;
+						__m128 e1x = _mm_set1_ps(e1.x), e1y = _mm_set1_ps(e1.y), e1z = _mm_set1_ps(e1.z);
+						__m128 e2x = _mm_set1_ps(e2.x), e2y = _mm_set1_ps(e2.y), e2z = _mm_set1_ps(e2.z);
+						__m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+						__m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+						__m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+						__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+						__m128 inverseDeterminant = _mm_div_ps(one, determinant);
+						__m128 sx = _mm_sub_ps(origin[0], _mm_set1_ps(a.x));
+						__m128 sy = _mm_sub_ps(origin[1], _mm_set1_ps(a.y));
+						__m128 sz = _mm_sub_ps(origin[2], _mm_set1_ps(a.z));
+						__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+						__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+						__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+						__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+						__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), inverseDeterminant);
+						__m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+
+						//the same tests as the single ray, a zero determinant gives infinities and NaNs that fail them
+						__m128 absDeterminant = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+						__m128 mask = _mm_cmpge_ps(absDeterminant, _mm_set1_ps(1e-12f));
+						mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+						mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+						mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+						mask = _mm_and_ps(mask, _mm_cmpgt_ps(distance, tMin));
+						mask = _mm_and_ps(mask, _mm_cmplt_ps(distance, hitT));
+						if (_mm_movemask_ps(mask) == 0)
+							continue;
+						hitT = _mm_or_ps(_mm_and_ps(mask, distance), _mm_andnot_ps(mask, hitT));
+						hitU = _mm_or_ps(_mm_and_ps(mask, u), _mm_andnot_ps(mask, hitU));
+						hitV = _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, hitV));
+						__m128i laneMask = _mm_castps_si128(mask);
+						hitTriangle = _mm_or_si128(_mm_and_si128(laneMask, _mm_set1_epi32(static_cast<int>(m_triangles[t]))), _mm_andnot_si128(laneMask, hitTriangle));
+					}
+					continue;
+				}
+				//the rays of a packet point about the same way, the first one picks the order of the children
+				uint32_t nearChild = node.leftFirst;
+				uint32_t farChild = node.leftFirst + 1;
+				glm::vec3 separation = (m_nodes[farChild].boundsMin + m_nodes[farChild].boundsMax) - (m_nodes[nearChild].boundsMin + m_nodes[nearChild].boundsMax);
+				glm::vec3 firstDirection(packet.directionX[0], packet.directionY[0], packet.directionZ[0]);
+				if (glm::dot(separation, firstDirection) < 0.0f)
+					std::swap(nearChild, farChild);
+				stack[stackSize++] = farChild;
+				stack[stackSize++] = nearChild;
+			}
+
+			float t[BVH_PACKET_SIZE], u[BVH_PACKET_SIZE], v[BVH_PACKET_SIZE];
+			uint32_t triangle[BVH_PACKET_SIZE];
+			_mm_storeu_ps(t, hitT);
+			_mm_storeu_ps(u, hitU);
+			_mm_storeu_ps(v, hitV);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(triangle), hitTriangle);
+			for (uint32_t lane = 0; lane < BVH_PACKET_SIZE; lane++)
+			{
+				if (triangle[lane] == UINT32_MAX)
+					continue;
+				hits[lane].t = t[lane];
+				hits[lane].u = u[lane];
+				hits[lane].v = v[lane];
+				hits[lane].triangle = triangle[lane];
+			}
+#else
+			for (uint32_t lane = 0; lane < BVH_PACKET_SIZE; lane++)
+				Intersect(packet.Get(lane), hits[lane]);
+#endif
+		}
+
+		void Bvh::GetTriangles(const std::vector<render::MeshData*>& meshes, render::VertexLayout* vertexLayout, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+		{
+			uint32_t positionOffset = MeshOptimizer::GetPositionOffset(vertexLayout);
+			for (auto mesh : meshes)
+			{
+				uint32_t stride = MeshOptimizer::GetVertexStride(mesh);
+				if (stride == 0 || mesh->m_indices == nullptr)
+					continue;
+				uint32_t firstVertex = static_cast<uint32_t>(positions.size());
+				for (uint64_t v = 0; v < mesh->m_vertexCount; v++)
+				{
+					const float* position = mesh->m_vertices + v * stride + positionOffset;
+					positions.push_back(glm::vec3(position[0], position[1], position[2]));
+				}
+				uint32_t indexCount = mesh->m_indexCount - mesh->m_indexCount % 3;
+				for (uint32_t i = 0; i < indexCount; i++)
+					indices.push_back(mesh->m_indices[i] + firstVertex);
+			}
+		}
+	}
+}
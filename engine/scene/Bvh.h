@@ -0,0 +1,137 @@
+#pragma once
+#include "render/Mesh.h"
+#include "threadpool.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <float.h>
+
+#define BVH_PACKET_SIZE 4
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief 32 byte node, an inner node points to its first child (the second one follows it), a leaf to its first triangle */
+		struct BvhNode
+		{
+			glm::vec3 boundsMin;
+			uint32_t leftFirst;
+			glm::vec3 boundsMax;
+			uint32_t triangleCount;//0 for inner nodes
+
+			bool IsLeaf() const { return triangleCount > 0; }
+		};
+
+		/** @brief Part of the triangle the closest point lies on, it picks the pseudo normal that signs a distance */
+		enum TriangleFeature
+		{
+			FEATURE_FACE = 0,
+			FEATURE_VERTEX0,
+			FEATURE_VERTEX1,
+			FEATURE_VERTEX2,
+			FEATURE_EDGE01,
+			FEATURE_EDGE12,
+			FEATURE_EDGE20
+		};
+
+		struct BvhClosestPoint
+		{
+			glm::vec3 point = glm::vec3(0.0f);
+			float distanceSquared = FLT_MAX;
+			uint32_t triangle = UINT32_MAX;//index of the triangle in the indices given to Build
+			uint32_t feature = FEATURE_FACE;
+		};
+
+		struct BvhRay
+		{
+			glm::vec3 origin = glm::vec3(0.0f);
+			float tMin = 0.0f;
+			glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+			float tMax = FLT_MAX;
+		};
+
+		struct BvhHit
+		{
+			float t = FLT_MAX;
+			float u = 0.0f;//barycentrics of the second and third corner
+			float v = 0.0f;
+			uint32_t triangle = UINT32_MAX;//index of the triangle in the indices given to Build
+
+			bool IsHit() const { return triangle != UINT32_MAX; }
+		};
+
+		/** @brief Rays stored per component so a packet is tested against a node at once. The rays should be coherent, like the primary rays of a 2x2 pixel block,
+		 *  a lane that is not used gets a tMax below its tMin */
+		struct BvhRayPacket
+		{
+			float originX[BVH_PACKET_SIZE];
+			float originY[BVH_PACKET_SIZE];
+			float originZ[BVH_PACKET_SIZE];
+			float directionX[BVH_PACKET_SIZE];
+			float directionY[BVH_PACKET_SIZE];
+			float directionZ[BVH_PACKET_SIZE];
+			float tMin[BVH_PACKET_SIZE];
+			float tMax[BVH_PACKET_SIZE];
+
+			void Set(uint32_t lane, const BvhRay& ray);
+			BvhRay Get(uint32_t lane) const;
+		};
+
+		/** @brief Bounding volume hierarchy over triangles, built top down with a binned surface area heuristic. Children are always stored after their parent */
+		class Bvh
+		{
+		public:
+			static const uint32_t MAX_LEAF_TRIANGLES = 4;
+			static const uint32_t SAH_BINS = 16;
+			//nodes with fewer triangles are binned on one thread
+			static const uint32_t PARALLEL_SPLIT_TRIANGLES = 65536;
+			//the traversal stacks hold 64 nodes
+			static const uint32_t MAX_DEPTH = 60;
+
+			std::vector<BvhNode> m_nodes;
+			//three corners per triangle, in leaf order
+			std::vector<glm::vec3> m_vertices;
+			//leaf order to the triangle index in the input
+			std::vector<uint32_t> m_triangles;
+
+			/** @brief The top of the tree is split on the calling thread, the subtrees below it are built in parallel on the pool */
+			void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, ThreadPool* threadPool = nullptr);
+			/** @brief Updates the bounds after the vertices moved, the triangles have to be the ones given to Build. The tree gets worse the more they move */
+			void Refit(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+			/** @brief Closest point of the triangles to p, false when there is none closer than maxDistance */
+			bool ClosestPoint(glm::vec3 p, BvhClosestPoint& result, float maxDistance = FLT_MAX) const;
+
+			/** @brief Closest hit between tMin and tMax, triangles are hit from both sides */
+			bool Intersect(const BvhRay& ray, BvhHit& hit) const;
+			/** @brief Stops at the first hit, for shadow and occlusion rays */
+			bool Occluded(const BvhRay& ray) const;
+			/** @brief Closest hits of the packet, the lanes share the traversal */
+			void Intersect(const BvhRayPacket& packet, BvhHit hits[BVH_PACKET_SIZE]) const;
+
+			/** @brief Expected cost of a ray relative to testing a triangle, lower is a better tree */
+			float GetSahCost() const;
+			uint32_t GetTriangleCount() const { return static_cast<uint32_t>(m_triangles.size()); }
+			glm::vec3 GetBoundsMin() const { return m_nodes.empty() ? glm::vec3(0.0f) : m_nodes[0].boundsMin; }
+			glm::vec3 GetBoundsMax() const { return m_nodes.empty() ? glm::vec3(0.0f) : m_nodes[0].boundsMax; }
+
+			static glm::vec3 ClosestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c, uint32_t& feature);
+			static bool IntersectTriangle(const BvhRay& ray, glm::vec3 a, glm::vec3 b, glm::vec3 c, float& t, float& u, float& v);
+
+			/** @brief Appends the positions and indices of the meshes, the positions are read from the position component of the layout */
+			static void GetTriangles(const std::vector<render::MeshData*>& meshes, render::VertexLayout* vertexLayout, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices);
+
+		private:
+			struct BuildData
+			{
+				std::vector<glm::vec3> centroids;
+				std::vector<glm::vec3> boundsMin;
+				std::vector<glm::vec3> boundsMax;
+			};
+
+			bool Split(std::vector<BvhNode>& nodes, uint32_t node, const BuildData& data, ThreadPool* threadPool = nullptr);
+			void BuildSubtree(std::vector<BvhNode>& nodes, uint32_t depth, const BuildData& data);
+			template<bool anyHit> bool Traverse(const BvhRay& ray, BvhHit& hit) const;
+		};
+	}
+}
@@ -110,6 +110,27 @@ namespace engine
 			UpdateViewMatrix();
 		}
 
+		CameraState Camera::GetState() const
+		{
+			CameraState state;
+			state.position = m_position;
+			state.rotation = m_rotation;
+			state.sphereRadius = m_SphereRadius;
+			state.theta = m_theta;
+			state.phi = m_phi;
+			return state;
+		}
+
+		void Camera::SetState(const CameraState& state)
+		{
+			m_position = state.position;
+			m_rotation = state.rotation;
+			m_SphereRadius = state.sphereRadius;
+			m_theta = state.theta;
+			m_phi = state.phi;
+			UpdateViewMatrix();
+		}
+
 		void Camera::ToSphere(glm::vec3 point)
 		{
 			m_SphereRadius = sqrt(point.x * point.x + point.y * point.y + point.z * point.z);
@@ -12,6 +12,16 @@ namespace engine
 {
 	namespace scene
 	{
+		/** @brief Everything that places a camera, the sphere coordinates are used by the surface cameras */
+		struct CameraState
+		{
+			glm::vec3 position;
+			glm::vec3 rotation;
+			float sphereRadius;
+			float theta;
+			float phi;
+		};
+
 		class Camera
 		{
 			float m_fov;
@@ -72,6 +82,7 @@ namespace engine
 				return m_fov;
 			}
 			const glm::vec3 GetPosition() const { return m_position; }
+			const glm::vec3 GetRotation() const { return m_rotation; }
 			const glm::mat4 GetViewMatrix() const  { return matrices.view; }
 			const glm::mat4 GetOldViewMatrix() const { return matrices.viewold; }
 			const glm::mat4 GetPerspectiveMatrix() const { return matrices.perspective; }
@@ -100,6 +111,9 @@ namespace engine
 			glm::vec3 ToCartesian();
 
 			void Update(float deltaTime);
+
+			CameraState GetState() const;
+			void SetState(const CameraState& state);
 			
 		};
 	}
@@ -0,0 +1,81 @@
+#include "CameraPath.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		static const char s_magic[4] = { 'C', 'P', 'T', 'H' };
+		static const uint32_t s_version = 1;
+
+		struct CameraPathHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t cameraType;
+			uint32_t frameCount;
+		};
+
+		//the frames are written as they are in memory, 10 floats and the flags
+		static_assert(sizeof(CameraPathFrame) == 11 * sizeof(uint32_t), "CameraPathFrame must be tightly packed");
+
+		void CameraPath::Record(const Camera& camera, float frameTime, bool paused)
+		{
+			m_cameraType = camera.type;
+			CameraPathFrame frame;
+			frame.camera = camera.GetState();
+			frame.frameTime = frameTime;
+			frame.flags = paused ? CAMERA_PATH_PAUSED : 0;
+			m_frames.push_back(frame);
+		}
+
+		bool CameraPath::Apply(uint32_t frame, Camera& camera) const
+		{
+			if (frame >= m_frames.size())
+				return false;
+			camera.SetState(m_frames[frame].camera);
+			return true;
+		}
+
+		bool CameraPath::Save(const std::string& path) const
+		{
+			FILE* file = fopen(path.c_str(), "wb");
+			if (!file)
+				return false;
+			CameraPathHeader header;
+			memcpy(header.magic, s_magic, sizeof(s_magic));
+			header.version = s_version;
+			header.cameraType = static_cast<uint32_t>(m_cameraType);
+			header.frameCount = GetFrameCount();
+			bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+			if (written && !m_frames.empty())
+				written = fwrite(m_frames.data(), sizeof(CameraPathFrame), m_frames.size(), file) == m_frames.size();
+			fclose(file);
+			return written;
+		}
+
+		bool CameraPath::Load(const std::string& path)
+		{
+			m_frames.clear();
+			FILE* file = fopen(path.c_str(), "rb");
+			if (!file)
+				return false;
+			CameraPathHeader header;
+			bool read = fread(&header, sizeof(header), 1, file) == 1
+				&& memcmp(header.magic, s_magic, sizeof(s_magic)) == 0
+				&& header.version == s_version;
+			if (read)
+			{
+				m_cameraType = static_cast<Camera::CameraType>(header.cameraType);
+				m_frames.resize(header.frameCount);
+				if (header.frameCount > 0)
+					read = fread(m_frames.data(), sizeof(CameraPathFrame), header.frameCount, file) == header.frameCount;
+			}
+			fclose(file);
+			if (!read)
+				m_frames.clear();
+			return read;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Camera.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		enum CameraPathFlags
+		{
+			CAMERA_PATH_PAUSED = 1
+		};
+
+		/** @brief The camera and the timer inputs of one frame */
+		struct CameraPathFrame
+		{
+			CameraState camera;
+			float frameTime;//seconds
+			uint32_t flags;
+		};
+
+		/** @brief Records the camera and the frame time of every frame into a small binary file and plays them back,
+		 *  so every run of an example goes through the same views */
+		class CameraPath
+		{
+		public:
+			std::vector<CameraPathFrame> m_frames;
+			Camera::CameraType m_cameraType = Camera::normal;
+
+			void Clear() { m_frames.clear(); }
+			uint32_t GetFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+
+			void Record(const Camera& camera, float frameTime, bool paused);
+			/** @brief Places the camera as it was in the frame, returns false after the last frame */
+			bool Apply(uint32_t frame, Camera& camera) const;
+
+			bool Save(const std::string& path) const;
+			bool Load(const std::string& path);
+		};
+	}
+}
@@ -0,0 +1,115 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "CascadedShadows.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <math.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		void CascadedShadows::Init(uint32_t cascadeCount, uint32_t resolution, float lambda, float margin, float casterDistance)
+		{
+			m_cascades.assign(cascadeCount, ShadowCascade());
+			m_resolution = resolution;
+			m_lambda = lambda;
+			m_margin = margin;
+			m_casterDistance = casterDistance;
+			m_lightDirection = glm::vec3(0.0f);
+		}
+
+		void CascadedShadows::Update(const glm::mat4& view, float fov, float aspect, float nearClip, float farClip, const glm::vec3& lightDirection)
+		{
+			glm::vec3 direction = glm::normalize(lightDirection);
+			bool lightMoved = direction != m_lightDirection;
+			m_lightDirection = direction;
+
+			glm::mat4 cameraToWorld = glm::inverse(view);
+			//distance from the view axis to the corners of the frustum, per unit of depth
+			float tanHalfFov = tanf(fov * 0.5f);
+			float k2 = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+
+			float splitNear = nearClip;
+			uint32_t count = static_cast<uint32_t>(m_cascades.size());
+			for (uint32_t i = 0; i < count; i++)
+			{
+				//practical split scheme, between the logarithmic and the uniform split
+				float p = float(i + 1) / float(count);
+				float logSplit = nearClip * powf(farClip / nearClip, p);
+				float uniformSplit = nearClip + (farClip - nearClip) * p;
+				float splitFar = m_lambda * logSplit + (1.0f - m_lambda) * uniformSplit;
+
+				//the smallest sphere around the slice has its center on the view axis, at the same distance from the near and far corners
+				float depth = std::min(0.5f * (splitNear + splitFar) * (1.0f + k2), splitFar);
+				float radius = sqrtf((splitFar - depth) * (splitFar - depth) + k2 * splitFar * splitFar);
+				glm::vec3 center = glm::vec3(cameraToWorld * glm::vec4(0.0f, 0.0f, -depth, 1.0f));
+
+				ShadowCascade& cascade = m_cascades[i];
+				cascade.splitNear = splitNear;
+				cascade.splitFar = splitFar;
+				Fit(cascade, center, radius, lightMoved);
+
+				splitNear = splitFar;
+			}
+		}
+
+		void CascadedShadows::Fit(ShadowCascade& cascade, const glm::vec3& sliceCenter, float sliceRadius, bool lightMoved)
+		{
+			//rounded up so the size of the texels doesn't change with small changes of the camera
+			float radius = ceilf(sliceRadius * (1.0f + m_margin) * 16.0f) / 16.0f;
+			if (!lightMoved && radius == cascade.radius && glm::length(sliceCenter - cascade.center) + sliceRadius <= cascade.radius)
+				return;
+
+			glm::vec3 up = fabsf(m_lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), m_lightDirection, up);
+
+			//the center moves in whole texels across the light, the cascade then samples the same texels of a static scene
+			float texel = 2.0f * radius / float(m_resolution);
+			glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(sliceCenter, 1.0f));
+			lightCenter.x = floorf(lightCenter.x / texel) * texel;
+			lightCenter.y = floorf(lightCenter.y / texel) * texel;
+
+			cascade.center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightCenter, 1.0f));
+			cascade.radius = radius;
+			cascade.view = glm::lookAt(cascade.center - m_lightDirection * (radius + m_casterDistance), cascade.center, up);
+			cascade.projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + m_casterDistance);
+			cascade.viewProjection = cascade.projection * cascade.view;
+			cascade.moved = true;
+
+			const glm::mat4& m = cascade.viewProjection;
+			glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+			glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+			glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+			glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+			cascade.planes[0] = row3 + row0;
+			cascade.planes[1] = row3 - row0;
+			cascade.planes[2] = row3 + row1;
+			cascade.planes[3] = row3 - row1;
+			cascade.planes[4] = row2;//the depth goes from 0 to 1
+			cascade.planes[5] = row3 - row2;
+			for (auto& plane : cascade.planes)
+				plane /= glm::length(glm::vec3(plane));
+		}
+
+		bool CascadedShadows::IsVisible(uint32_t cascade, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+		{
+			for (const auto& plane : m_cascades[cascade].planes)
+			{
+				//the corner of the box the farthest along the normal
+				glm::vec3 corner(plane.x > 0.0f ? boundsMax.x : boundsMin.x,
+					plane.y > 0.0f ? boundsMax.y : boundsMin.y,
+					plane.z > 0.0f ? boundsMax.z : boundsMin.z);
+				if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+					return false;
+			}
+			return true;
+		}
+
+		void CascadedShadows::Invalidate()
+		{
+			for (auto& cascade : m_cascades)
+				cascade.moved = true;
+		}
+	}
+}
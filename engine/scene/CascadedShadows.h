@@ -0,0 +1,57 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		struct ShadowCascade
+		{
+			glm::mat4 view;
+			glm::mat4 projection;
+			glm::mat4 viewProjection;
+			glm::vec4 planes[6];//of the light frustum, the normals point inside
+			float splitNear = 0.0f;//distances from the camera of the slice it covers
+			float splitFar = 0.0f;
+			glm::vec3 center;//of the covered sphere, on the texel grid of the light
+			float radius = 0.0f;
+			bool moved = true;//since MarkCached, what was rendered into it before doesn't match anymore
+		};
+
+		/** @brief Fits the cascades of a directional light to slices of the camera frustum. A cascade covers a sphere around its
+		 *  slice, so its size doesn't change when the camera turns, and the sphere moves in whole texels of the light, so the shadow
+		 *  edges don't crawl. The sphere is bigger than the slice by a margin and only follows the camera once the slice leaves it,
+		 *  until then the cascade doesn't move at all and the static casters rendered into it can be kept */
+		class CascadedShadows
+		{
+		public:
+			std::vector<ShadowCascade> m_cascades;
+
+			/** @brief lambda blends the split distances between uniform (0) and logarithmic (1), margin is the fraction the covered
+			 *  sphere is bigger than the slice, casterDistance how far behind a cascade the casters are still rendered */
+			void Init(uint32_t cascadeCount, uint32_t resolution, float lambda = 0.9f, float margin = 0.1f, float casterDistance = 100.0f);
+
+			/** @brief The camera is given by its view matrix and its perspective, fov is vertical and in radians, the shadows end at farClip */
+			void Update(const glm::mat4& view, float fov, float aspect, float nearClip, float farClip, const glm::vec3& lightDirection);
+
+			/** @brief False when the box can't cast a shadow into the cascade */
+			bool IsVisible(uint32_t cascade, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+			/** @brief The static casters were rendered into the cascade, it stays cached until it moves */
+			void MarkCached(uint32_t cascade) { m_cascades[cascade].moved = false; }
+			/** @brief Every cascade has to be rendered again, when the static casters themselves changed */
+			void Invalidate();
+
+		private:
+			uint32_t m_resolution = 1024;
+			float m_lambda = 0.9f;
+			float m_margin = 0.1f;
+			float m_casterDistance = 100.0f;
+			glm::vec3 m_lightDirection = glm::vec3(0.0f);
+
+			void Fit(ShadowCascade& cascade, const glm::vec3& sliceCenter, float sliceRadius, bool lightMoved);
+		};
+	}
+}
@@ -0,0 +1,298 @@
+#include "CollisionEngine.h"
+#include "Timer.h"
+#include <algorithm>
+
+namespace engine
+{
+	namespace scene
+	{
+		uint32_t CollisionEngine::AddSphere(glm::vec3 center, glm::vec3 velocity, float radius)
+		{
+			m_positionsX.push_back(center.x);
+			m_positionsY.push_back(center.y);
+			m_positionsZ.push_back(center.z);
+			m_velocitiesX.push_back(velocity.x);
+			m_velocitiesY.push_back(velocity.y);
+			m_velocitiesZ.push_back(velocity.z);
+			m_radii.push_back(radius);
+			m_inverseMasses.push_back(1.0f / (radius * radius * radius));
+			m_maxRadius = std::max(m_maxRadius, radius);
+			return static_cast<uint32_t>(m_radii.size() - 1);
+		}
+
+		void CollisionEngine::Clear()
+		{
+			m_positionsX.clear();
+			m_positionsY.clear();
+			m_positionsZ.clear();
+			m_velocitiesX.clear();
+			m_velocitiesY.clear();
+			m_velocitiesZ.clear();
+			m_radii.clear();
+			m_inverseMasses.clear();
+			m_contacts.clear();
+			m_maxRadius = 0.0f;
+		}
+
+		void CollisionEngine::RunJobs(ThreadPool* threadPool, uint32_t jobCount, const std::function<void(uint32_t job)>& function)
+		{
+			if (threadPool)
+			{
+				threadPool->runJobs(jobCount, function);
+				return;
+			}
+			for (uint32_t job = 0; job < jobCount; job++)
+				function(job);
+		}
+
+		uint32_t CollisionEngine::GetCellHash(glm::ivec3 cell) const
+		{
+			uint32_t hash = (static_cast<uint32_t>(cell.x) * 73856093u) ^ (static_cast<uint32_t>(cell.y) * 19349663u) ^ (static_cast<uint32_t>(cell.z) * 83492791u);
+			return hash & m_tableMask;
+		}
+
+		glm::ivec3 CollisionEngine::GetCell(float x, float y, float z) const
+		{
+			float inverseSize = 1.0f / m_cellSize;
+			return glm::ivec3(static_cast<int>(floorf(x * inverseSize)), static_cast<int>(floorf(y * inverseSize)), static_cast<int>(floorf(z * inverseSize)));
+		}
+
+		void CollisionEngine::Integrate(uint32_t begin, uint32_t end, float dt)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				m_velocitiesX[i] += m_gravity.x * dt;
+				m_velocitiesY[i] += m_gravity.y * dt;
+				m_velocitiesZ[i] += m_gravity.z * dt;
+				m_positionsX[i] += m_velocitiesX[i] * dt;
+				m_positionsY[i] += m_velocitiesY[i] * dt;
+				m_positionsZ[i] += m_velocitiesZ[i] * dt;
+
+				if (m_useBounds)
+				{
+					float radius = m_radii[i];
+					//only bounce when moving out so the spheres do not stick to the walls
+					if ((m_positionsX[i] - radius < m_boundsMin.x && m_velocitiesX[i] < 0.0f) || (m_positionsX[i] + radius > m_boundsMax.x && m_velocitiesX[i] > 0.0f))
+						m_velocitiesX[i] = -m_velocitiesX[i];
+					if ((m_positionsY[i] - radius < m_boundsMin.y && m_velocitiesY[i] < 0.0f) || (m_positionsY[i] + radius > m_boundsMax.y && m_velocitiesY[i] > 0.0f))
+						m_velocitiesY[i] = -m_velocitiesY[i];
+					if ((m_positionsZ[i] - radius < m_boundsMin.z && m_velocitiesZ[i] < 0.0f) || (m_positionsZ[i] + radius > m_boundsMax.z && m_velocitiesZ[i] > 0.0f))
+						m_velocitiesZ[i] = -m_velocitiesZ[i];
+				}
+
+				uint64_t hash = GetCellHash(GetCell(m_positionsX[i], m_positionsY[i], m_positionsZ[i]));
+				m_keys[i] = (hash << 32) | i;
+			}
+		}
+
+		void CollisionEngine::SortKeys(ThreadPool* threadPool)
+		{
+			uint32_t count = GetCount();
+			uint32_t jobCount = std::min(GetJobCount(threadPool), std::max(count / 1024u, 1u));
+			std::vector<uint32_t> runs(jobCount + 1);
+			for (uint32_t j = 0; j <= jobCount; j++)
+				runs[j] = static_cast<uint32_t>(static_cast<uint64_t>(count) * j / jobCount);
+
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				std::sort(m_keys.begin() + runs[job], m_keys.begin() + runs[job + 1]);
+			});
+
+			//merge the sorted runs pairwise, every round halves the runs
+			m_keysScratch.resize(count);
+			std::vector<uint64_t>* source = &m_keys;
+			std::vector<uint64_t>* destination = &m_keysScratch;
+			for (uint32_t width = 1; width < jobCount; width *= 2)
+			{
+				uint32_t mergeCount = (jobCount + 2 * width - 1) / (2 * width);
+				RunJobs(threadPool, mergeCount, [&](uint32_t job) {
+					uint32_t first = runs[job * 2 * width];
+					uint32_t middle = runs[std::min(job * 2 * width + width, jobCount)];
+					uint32_t last = runs[std::min(job * 2 * width + 2 * width, jobCount)];
+					std::merge(source->begin() + first, source->begin() + middle, source->begin() + middle, source->begin() + last, destination->begin() + first);
+				});
+				std::swap(source, destination);
+			}
+			if (source != &m_keys)
+				m_keys.swap(m_keysScratch);
+		}
+
+		void CollisionEngine::BuildCells(ThreadPool* threadPool)
+		{
+			uint32_t count = GetCount();
+			uint32_t jobCount = GetJobCount(threadPool);
+			uint32_t tableSize = static_cast<uint32_t>(m_cells.size());
+
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				CellRange empty = { ~0u, 0 };
+				std::fill(m_cells.begin() + static_cast<uint64_t>(tableSize) * job / jobCount, m_cells.begin() + static_cast<uint64_t>(tableSize) * (job + 1) / jobCount, empty);
+			});
+
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * job / jobCount);
+				uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (job + 1) / jobCount);
+				for (uint32_t k = begin; k < end; k++)
+				{
+					uint32_t hash = static_cast<uint32_t>(m_keys[k] >> 32);
+					uint32_t index = static_cast<uint32_t>(m_keys[k]);
+					if (k == 0 || static_cast<uint32_t>(m_keys[k - 1] >> 32) != hash)
+						m_cells[hash].start = k;
+					if (k == count - 1 || static_cast<uint32_t>(m_keys[k + 1] >> 32) != hash)
+						m_cells[hash].end = k + 1;
+					m_sorted[k] = glm::vec4(m_positionsX[index], m_positionsY[index], m_positionsZ[index], m_radii[index]);
+				}
+			});
+		}
+
+		void CollisionEngine::Narrowphase(uint32_t begin, uint32_t end, uint32_t job)
+		{
+			std::vector<SphereContact>& contacts = m_jobContacts[job];
+			uint64_t pairsTested = 0;
+			float inverseSize = 1.0f / m_cellSize;
+			uint32_t buckets[8];
+			uint32_t bucketCount = 0;
+			glm::ivec3 previousCell, previousSide;
+
+			for (uint32_t k = begin; k < end; k++)
+			{
+				glm::vec4 sphere = m_sorted[k];
+				glm::ivec3 cell = GetCell(sphere.x, sphere.y, sphere.z);
+
+				//the cells are twice the biggest diameter, the spheres touching this one are in the 2x2x2 cells on the side of the cell it is in
+				glm::ivec3 side(sphere.x * inverseSize - cell.x < 0.5f ? -1 : 1, sphere.y * inverseSize - cell.y < 0.5f ? -1 : 1, sphere.z * inverseSize - cell.z < 0.5f ? -1 : 1);
+				if (k == begin || cell.x != previousCell.x || cell.y != previousCell.y || cell.z != previousCell.z ||
+					side.x != previousSide.x || side.y != previousSide.y || side.z != previousSide.z)
+				{
+					//different cells can share a hash table entry, every entry is visited once
+					bucketCount = 0;
+					for (int z = 0; z < 2; z++)
+					{
+						for (int y = 0; y < 2; y++)
+						{
+							for (int x = 0; x < 2; x++)
+							{
+								uint32_t hash = GetCellHash(cell + glm::ivec3(x * side.x, y * side.y, z * side.z));
+								if (m_cells[hash].start == ~0u || std::find(buckets, buckets + bucketCount, hash) != buckets + bucketCount)
+									continue;
+								buckets[bucketCount++] = hash;
+							}
+						}
+					}
+					previousCell = cell;
+					previousSide = side;
+				}
+
+				for (uint32_t b = 0; b < bucketCount; b++)
+				{
+					//every pair is tested from its first sphere in m_keys order
+					const CellRange& range = m_cells[buckets[b]];
+					for (uint32_t m = std::max(range.start, k + 1); m < range.end; m++)
+					{
+						pairsTested++;
+						glm::vec4 other = m_sorted[m];
+						float dx = sphere.x - other.x;
+						float dy = sphere.y - other.y;
+						float dz = sphere.z - other.z;
+						float radii = sphere.w + other.w;
+						if (dx * dx + dy * dy + dz * dz < radii * radii)
+						{
+							uint32_t a = static_cast<uint32_t>(m_keys[k]);
+							uint32_t c = static_cast<uint32_t>(m_keys[m]);
+							contacts.push_back({ std::min(a, c), std::max(a, c) });
+						}
+					}
+				}
+			}
+			m_jobPairsTested[job] = pairsTested;
+		}
+
+		void CollisionEngine::Resolve()
+		{
+			uint32_t resolved = 0;
+			for (const SphereContact& contact : m_contacts)
+			{
+				uint32_t a = contact.a;
+				uint32_t b = contact.b;
+				float nx = m_positionsX[a] - m_positionsX[b];
+				float ny = m_positionsY[a] - m_positionsY[b];
+				float nz = m_positionsZ[a] - m_positionsZ[b];
+				float distance2 = nx * nx + ny * ny + nz * nz;
+				if (distance2 <= 0.0f)
+					continue;
+
+				//separating pairs are left alone, the velocities may already have been changed by an earlier contact
+				float normalVelocity = (m_velocitiesX[a] - m_velocitiesX[b]) * nx + (m_velocitiesY[a] - m_velocitiesY[b]) * ny + (m_velocitiesZ[a] - m_velocitiesZ[b]) * nz;
+				if (normalVelocity >= 0.0f)
+					continue;
+
+				//impulse along the unnormalized normal
+				float impulse = -(1.0f + m_restitution) * normalVelocity / (distance2 * (m_inverseMasses[a] + m_inverseMasses[b]));
+				m_velocitiesX[a] += nx * impulse * m_inverseMasses[a];
+				m_velocitiesY[a] += ny * impulse * m_inverseMasses[a];
+				m_velocitiesZ[a] += nz * impulse * m_inverseMasses[a];
+				m_velocitiesX[b] -= nx * impulse * m_inverseMasses[b];
+				m_velocitiesY[b] -= ny * impulse * m_inverseMasses[b];
+				m_velocitiesZ[b] -= nz * impulse * m_inverseMasses[b];
+				resolved++;
+			}
+			m_statistics.contactsResolved = resolved;
+		}
+
+		void CollisionEngine::Step(float dt, ThreadPool* threadPool)
+		{
+			uint32_t count = GetCount();
+			m_contacts.clear();
+			m_statistics = CollisionStatistics();
+			if (count == 0)
+				return;
+
+			uint32_t jobCount = GetJobCount(threadPool);
+			Timer timer;
+
+			m_cellSize = std::max(4.0f * m_maxRadius, 1e-6f);
+			uint32_t tableSize = 64;
+			while (tableSize < count)
+				tableSize *= 2;
+			m_tableMask = tableSize - 1;
+			m_keys.resize(count);
+			m_cells.resize(tableSize);
+			m_sorted.resize(count);
+
+			timer.start();
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				Integrate(static_cast<uint32_t>(static_cast<uint64_t>(count) * job / jobCount), static_cast<uint32_t>(static_cast<uint64_t>(count) * (job + 1) / jobCount), dt);
+			});
+			timer.stop();
+			m_statistics.timeIntegrate = timer.elapsedMicroseconds();
+
+			timer.start();
+			SortKeys(threadPool);
+			BuildCells(threadPool);
+			timer.stop();
+			m_statistics.timeBroadphase = timer.elapsedMicroseconds();
+
+			timer.start();
+			m_jobContacts.resize(jobCount);
+			m_jobPairsTested.resize(jobCount);
+			RunJobs(threadPool, jobCount, [&](uint32_t job) {
+				m_jobContacts[job].clear();
+				Narrowphase(static_cast<uint32_t>(static_cast<uint64_t>(count) * job / jobCount), static_cast<uint32_t>(static_cast<uint64_t>(count) * (job + 1) / jobCount), job);
+			});
+			for (uint32_t job = 0; job < jobCount; job++)
+			{
+				m_contacts.insert(m_contacts.end(), m_jobContacts[job].begin(), m_jobContacts[job].end());
+				m_statistics.pairsTested += m_jobPairsTested[job];
+			}
+			std::sort(m_contacts.begin(), m_contacts.end(), [](const SphereContact& l, const SphereContact& r) {
+				return l.a < r.a || (l.a == r.a && l.b < r.b);
+			});
+			m_statistics.contacts = static_cast<uint32_t>(m_contacts.size());
+			timer.stop();
+			m_statistics.timeNarrowphase = timer.elapsedMicroseconds();
+
+			timer.start();
+			Resolve();
+			timer.stop();
+			m_statistics.timeResolve = timer.elapsedMicroseconds();
+		}
+	}
+}
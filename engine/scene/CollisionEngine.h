@@ -0,0 +1,101 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <functional>
+#include "threadpool.hpp"
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief Two overlapping spheres, a < b */
+		struct SphereContact
+		{
+			uint32_t a;
+			uint32_t b;
+		};
+
+		struct CollisionStatistics
+		{
+			uint64_t pairsTested = 0;
+			uint32_t contacts = 0;
+			uint32_t contactsResolved = 0;
+			//microseconds of the last step
+			uint64_t timeIntegrate = 0;
+			uint64_t timeBroadphase = 0;
+			uint64_t timeNarrowphase = 0;
+			uint64_t timeResolve = 0;
+		};
+
+		/** @brief Sphere simulation with the spheres stored as a structure of arrays.
+		 *  Every step the spheres are hashed into a uniform grid (cells of twice the biggest diameter) which is sorted in parallel,
+		 *  the narrowphase runs in parallel over the sorted spheres into a contact list and the contacts are resolved in (a, b) order,
+		 *  so the result does not depend on the number of threads. */
+		class CollisionEngine
+		{
+		public:
+			std::vector<float> m_positionsX;
+			std::vector<float> m_positionsY;
+			std::vector<float> m_positionsZ;
+			std::vector<float> m_velocitiesX;
+			std::vector<float> m_velocitiesY;
+			std::vector<float> m_velocitiesZ;
+			std::vector<float> m_radii;
+			std::vector<float> m_inverseMasses;
+
+			glm::vec3 m_gravity = glm::vec3(0.0f);
+			//the spheres bounce off the walls of this box when m_useBounds is set
+			glm::vec3 m_boundsMin = glm::vec3(-1.0f);
+			glm::vec3 m_boundsMax = glm::vec3(1.0f);
+			bool m_useBounds = false;
+			float m_restitution = 1.0f;
+
+			std::vector<SphereContact> m_contacts;
+			CollisionStatistics m_statistics;
+
+			/** @brief The mass is the sphere volume, returns the sphere index */
+			uint32_t AddSphere(glm::vec3 center, glm::vec3 velocity, float radius);
+			void Clear();
+			void SetBounds(glm::vec3 boundsMin, glm::vec3 boundsMax) { m_boundsMin = boundsMin; m_boundsMax = boundsMax; m_useBounds = true; }
+
+			uint32_t GetCount() const { return static_cast<uint32_t>(m_radii.size()); }
+			glm::vec3 GetPosition(uint32_t index) const { return glm::vec3(m_positionsX[index], m_positionsY[index], m_positionsZ[index]); }
+			glm::vec3 GetVelocity(uint32_t index) const { return glm::vec3(m_velocitiesX[index], m_velocitiesY[index], m_velocitiesZ[index]); }
+
+			/** @brief Integrates, collides and resolves the contacts. Without a thread pool everything runs on the calling thread */
+			void Step(float dt, ThreadPool* threadPool = nullptr);
+
+		private:
+			float m_maxRadius = 0.0f;
+			float m_cellSize = 1.0f;
+			uint32_t m_tableMask = 0;
+
+			//cell hash in the high 32 bits, sphere index in the low ones
+			std::vector<uint64_t> m_keys;
+			std::vector<uint64_t> m_keysScratch;
+			//range of m_keys per hash table entry, start is ~0 for empty entries
+			struct CellRange
+			{
+				uint32_t start;
+				uint32_t end;
+			};
+			std::vector<CellRange> m_cells;
+			//positions and radii in m_keys order
+			std::vector<glm::vec4> m_sorted;
+
+			std::vector<std::vector<SphereContact>> m_jobContacts;
+			std::vector<uint64_t> m_jobPairsTested;
+
+			static void RunJobs(ThreadPool* threadPool, uint32_t jobCount, const std::function<void(uint32_t job)>& function);
+			static uint32_t GetJobCount(ThreadPool* threadPool) { return threadPool && threadPool->threads.size() > 0 ? static_cast<uint32_t>(threadPool->threads.size()) : 1; }
+			uint32_t GetCellHash(glm::ivec3 cell) const;
+			glm::ivec3 GetCell(float x, float y, float z) const;
+
+			void Integrate(uint32_t begin, uint32_t end, float dt);
+			void SortKeys(ThreadPool* threadPool);
+			void BuildCells(ThreadPool* threadPool);
+			void Narrowphase(uint32_t begin, uint32_t end, uint32_t job);
+			void Resolve();
+		};
+	}
+}
@@ -0,0 +1,95 @@
+#include "FramePacer.h"
+#include <thread>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace engine
+{
+	namespace scene
+	{
+		//frames kept for the latency average
+		static const size_t s_latencyFrames = 120;
+		//the sleep can wake up this late, the rest of the wait spins
+		static const std::chrono::microseconds s_spinTime(1500);
+
+		void FramePacer::SetTargetRate(float framesPerSecond)
+		{
+			m_targetRate = std::max(framesPerSecond, 0.0f);
+			m_scheduled = false;
+#if defined(_WIN32)
+			//the default scheduler tick is too coarse to sleep to a frame deadline
+			if (m_targetRate > 0.0f && !m_fineTimer)
+				m_fineTimer = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+		}
+
+		void FramePacer::Wait()
+		{
+			if (m_targetRate <= 0.0f)
+				return;
+			Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetRate));
+			Clock::time_point now = Clock::now();
+			//the first frame and the frames after a stall start a new schedule instead of catching up
+			if (!m_scheduled || now > m_nextFrame + period)
+			{
+				m_nextFrame = now + period;
+				m_scheduled = true;
+				return;
+			}
+			if (m_nextFrame - now > s_spinTime)
+				std::this_thread::sleep_for(m_nextFrame - now - s_spinTime);
+			while (Clock::now() < m_nextFrame)
+				std::this_thread::yield();
+			m_nextFrame += period;
+		}
+
+		void FramePacer::InputSampled()
+		{
+			m_inputSampled = Clock::now();
+			m_inputPending = true;
+		}
+
+		void FramePacer::FramePresented()
+		{
+			if (!m_inputPending)
+				return;
+			m_inputPending = false;
+			float latency = (float)std::chrono::duration<double, std::milli>(Clock::now() - m_inputSampled).count();
+			if (m_latencies.size() < s_latencyFrames)
+				m_latencies.push_back(latency);
+			else
+				m_latencies[m_latencyIndex] = latency;
+			m_latencyIndex = (m_latencyIndex + 1) % s_latencyFrames;
+		}
+
+		float FramePacer::GetAverageLatency() const
+		{
+			if (m_latencies.empty())
+				return 0.0f;
+			float sum = 0.0f;
+			for (float latency : m_latencies)
+				sum += latency;
+			return sum / m_latencies.size();
+		}
+
+		float FramePacer::GetMaxLatency() const
+		{
+			if (m_latencies.empty())
+				return 0.0f;
+			return *std::max_element(m_latencies.begin(), m_latencies.end());
+		}
+
+		FramePacer::~FramePacer()
+		{
+#if defined(_WIN32)
+			if (m_fineTimer)
+				timeEndPeriod(1);
+#endif
+		}
+	}
+}
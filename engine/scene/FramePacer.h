@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief How the frames are presented, from no tearing to the lowest latency */
+		enum PresentPolicy
+		{
+			PRESENT_POLICY_VSYNC = 0,//waits for the vertical blank, the most latency
+			PRESENT_POLICY_BALANCED,//replaces the queued frame without tearing when the platform can, tears only when a frame is late
+			PRESENT_POLICY_LOW_LATENCY//presents right away and tears
+		};
+
+		/** @brief Limits the frame rate by sleeping before the input is read and measures the time from reading the input to presenting the frame */
+		class FramePacer
+		{
+			typedef std::chrono::high_resolution_clock Clock;
+
+			float m_targetRate = 0.0f;
+			Clock::time_point m_nextFrame;
+			bool m_scheduled = false;
+			bool m_fineTimer = false;
+
+			Clock::time_point m_inputSampled;
+			bool m_inputPending = false;
+			std::vector<float> m_latencies;
+			size_t m_latencyIndex = 0;
+
+		public:
+			/** @brief Frames per second, 0 renders as fast as the present mode allows */
+			void SetTargetRate(float framesPerSecond);
+			float GetTargetRate() const { return m_targetRate; }
+
+			/** @brief Sleeps until the next frame of the target rate, a short spin at the end keeps it precise */
+			void Wait();
+
+			/** @brief Called after the input of the frame was read and before it is recorded */
+			void InputSampled();
+			/** @brief Called after the frame was handed to the presentation engine */
+			void FramePresented();
+
+			/** @brief Input to present latency of the last frames in milliseconds */
+			float GetAverageLatency() const;
+			float GetMaxLatency() const;
+
+			~FramePacer();
+		};
+	}
+}
@@ -0,0 +1,97 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		static const char* s_phaseNames[PHASE_COUNT] = { "viewChanged", "render", "update", "overlay" };
+
+		static std::string EscapeJson(const std::string& text)
+		{
+			std::string escaped;
+			for (char c : text)
+			{
+				if (c == '"' || c == '\\')
+					escaped += '\\';
+				if (static_cast<unsigned char>(c) >= 0x20)
+					escaped += c;
+			}
+			return escaped;
+		}
+
+		static void WriteTimes(FILE* file, const char* name, std::vector<float> values, const char* separator)
+		{
+			double sum = 0.0;
+			for (float value : values)
+				sum += value;
+			std::sort(values.begin(), values.end());
+			fprintf(file, "\t\t\"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+				name, sum / values.size(), values.front(),
+				FrameProfiler::Percentile(values, 50.0f), FrameProfiler::Percentile(values, 90.0f), FrameProfiler::Percentile(values, 99.0f),
+				values.back(), separator);
+		}
+
+		float FrameProfiler::Percentile(std::vector<float> values, float percentile)
+		{
+			if (values.empty())
+				return 0.0f;
+			std::sort(values.begin(), values.end());
+			size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size() - 1e-6));
+			rank = std::min(std::max(rank, static_cast<size_t>(1)), values.size());
+			return values[rank - 1];
+		}
+
+		bool FrameProfiler::WriteReport(const std::string& path, const std::string& title, const std::string& deviceName, uint32_t width, uint32_t height, float timestep) const
+		{
+			if (m_frames.empty())
+				return false;
+			FILE* file = fopen(path.c_str(), "w");
+			if (!file)
+				return false;
+
+			size_t count = m_frames.size();
+			std::vector<float> frameTimes(count);
+			std::vector<std::vector<float>> phaseTimes(PHASE_COUNT, std::vector<float>(count));
+			double draws = 0.0, pipelineBinds = 0.0, descriptorSetBinds = 0.0, vertexBufferBinds = 0.0, dispatches = 0.0;
+			for (size_t i = 0; i < count; i++)
+			{
+				const FrameRecord& frame = m_frames[i];
+				frameTimes[i] = frame.frameTime;
+				for (int p = 0; p < PHASE_COUNT; p++)
+					phaseTimes[p][i] = frame.phases[p];
+				draws += frame.commands.draws;
+				pipelineBinds += frame.commands.pipelineBinds;
+				descriptorSetBinds += frame.commands.descriptorSetBinds;
+				vertexBufferBinds += frame.commands.vertexBufferBinds;
+				dispatches += frame.commands.dispatches;
+			}
+
+			fprintf(file, "{\n");
+			fprintf(file, "\t\"title\": \"%s\",\n", EscapeJson(title).c_str());
+			fprintf(file, "\t\"device\": \"%s\",\n", EscapeJson(deviceName).c_str());
+			fprintf(file, "\t\"width\": %u,\n\t\"height\": %u,\n", width, height);
+			fprintf(file, "\t\"frames\": %u,\n", static_cast<uint32_t>(count));
+			fprintf(file, "\t\"timestep\": %.6f,\n", timestep);
+			fprintf(file, "\t\"cpuFrameTimeMs\": {\n");
+			WriteTimes(file, "frame", frameTimes, "");
+			fprintf(file, "\t},\n");
+			fprintf(file, "\t\"phasesMs\": {\n");
+			for (int p = 0; p < PHASE_COUNT; p++)
+				WriteTimes(file, s_phaseNames[p], phaseTimes[p], p + 1 < PHASE_COUNT ? "," : "");
+			fprintf(file, "\t},\n");
+			fprintf(file, "\t\"commandsPerFrame\": {\n");
+			fprintf(file, "\t\t\"draws\": %.2f,\n", draws / count);
+			fprintf(file, "\t\t\"pipelineBinds\": %.2f,\n", pipelineBinds / count);
+			fprintf(file, "\t\t\"descriptorSetBinds\": %.2f,\n", descriptorSetBinds / count);
+			fprintf(file, "\t\t\"vertexBufferBinds\": %.2f,\n", vertexBufferBinds / count);
+			fprintf(file, "\t\t\"dispatches\": %.2f\n", dispatches / count);
+			fprintf(file, "\t}\n");
+			fprintf(file, "}\n");
+			fclose(file);
+			return true;
+		}
+	}
+}
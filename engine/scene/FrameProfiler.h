@@ -0,0 +1,43 @@
+#pragma once
+#include "render/CommandBuffer.h"
+#include <vector>
+#include <string>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief CPU phases of ApplicationBase::UpdateFrame */
+		enum FramePhase
+		{
+			PHASE_VIEW = 0,
+			PHASE_RENDER,
+			PHASE_UPDATE,
+			PHASE_OVERLAY,
+			PHASE_COUNT
+		};
+
+		struct FrameRecord
+		{
+			float frameTime = 0.0f;//milliseconds
+			float phases[PHASE_COUNT] = {};
+			render::CommandStatistics commands;
+		};
+
+		/** @brief Keeps the CPU timings and the recorded commands of every frame and writes them as a JSON report
+		 *  with the frame time percentiles, the average of every phase and the average commands per frame */
+		class FrameProfiler
+		{
+		public:
+			std::vector<FrameRecord> m_frames;
+
+			void Clear() { m_frames.clear(); }
+			void AddFrame(const FrameRecord& frame) { m_frames.push_back(frame); }
+
+			/** @brief Nearest rank percentile, percentile in 0..100 */
+			static float Percentile(std::vector<float> values, float percentile);
+
+			bool WriteReport(const std::string& path, const std::string& title, const std::string& deviceName, uint32_t width, uint32_t height, float timestep) const;
+		};
+	}
+}
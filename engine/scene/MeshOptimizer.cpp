@@ -0,0 +1,579 @@
+#include "MeshOptimizer.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <cassert>
+
+namespace engine
+{
+	namespace scene
+	{
+		//Forsyth vertex cache scoring constants
+		static const int FORSYTH_CACHE_SIZE = 32;
+		static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		static const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+		static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+		static float ForsythVertexScore(int cachePosition, uint32_t remainingValence)
+		{
+			if (remainingValence == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				if (cachePosition < 3)
+				{
+					//the last triangle was just emitted, using it again does not help as much as it seems
+					score = FORSYTH_LAST_TRI_SCORE;
+				}
+				else
+				{
+					const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+					score = 1.0f - (cachePosition - 3) * scaler;
+					score = powf(score, FORSYTH_CACHE_DECAY_POWER);
+				}
+			}
+
+			//bonus for vertices with few triangles left so we don't leave lonely triangles for the end
+			score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingValence, -FORSYTH_VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		static uint32_t HashVertex(const float* vertex, uint32_t stride)
+		{
+			//FNV-1a over the raw bits, welding is bitwise so -0.0f and 0.0f stay different vertices
+			const uint32_t* words = reinterpret_cast<const uint32_t*>(vertex);
+			uint32_t hash = 2166136261u;
+			for (uint32_t i = 0; i < stride; i++)
+			{
+				hash ^= words[i];
+				hash *= 16777619u;
+			}
+			//finalizer so the low bits used to index the table depend on every word
+			hash ^= hash >> 16;
+			hash *= 0x85ebca6bu;
+			hash ^= hash >> 13;
+			hash *= 0xc2b2ae35u;
+			hash ^= hash >> 16;
+			return hash;
+		}
+
+		uint32_t MeshOptimizer::GetVertexStride(const render::MeshData* data)
+		{
+			if (data->m_vertexCount == 0)
+				return 0;
+			return static_cast<uint32_t>(data->m_verticesSize / data->m_vertexCount);
+		}
+
+		uint32_t MeshOptimizer::GetPositionOffset(render::VertexLayout* vertexLayout)
+		{
+			uint32_t offset = 0;
+			for (auto& component : vertexLayout->m_components[0])
+			{
+				if (component == render::VERTEX_COMPONENT_POSITION || component == render::VERTEX_COMPONENT_POSITION4D)
+					break;
+				offset += vertexLayout->GetComponentSize(component);
+			}
+			return offset / sizeof(float);
+		}
+
+		void MeshOptimizer::Optimize(render::MeshData* data, render::VertexLayout* vertexLayout, int stages, float overdrawThreshold)
+		{
+			//the passes below only make sense for indexed triangle lists
+			if (data->m_indices == nullptr || data->m_indexCount < 3 || data->m_vertexCount == 0)
+				return;
+
+			if (stages & STAGE_WELD)
+				WeldVertices(data);
+			if (stages & STAGE_VERTEX_CACHE)
+				OptimizeVertexCache(data->m_indices, data->m_indexCount, data->m_vertexCount);
+			if (stages & STAGE_OVERDRAW)
+				OptimizeOverdraw(data->m_indices, data->m_indexCount, data->m_vertices, data->m_vertexCount, GetVertexStride(data), GetPositionOffset(vertexLayout), overdrawThreshold);
+			if (stages & STAGE_VERTEX_FETCH)
+				OptimizeVertexFetch(data);
+		}
+
+		void MeshOptimizer::WeldVertices(render::MeshData* data)
+		{
+			const uint32_t stride = GetVertexStride(data);
+			if (stride == 0)
+				return;
+
+			size_t tableSize = 1;
+			while (tableSize < data->m_vertexCount * 2)
+				tableSize <<= 1;
+			const uint32_t emptySlot = ~0u;
+			std::vector<uint32_t> table(tableSize, emptySlot);
+			std::vector<uint32_t> remap(data->m_vertexCount);
+
+			uint32_t uniqueCount = 0;
+			for (uint64_t i = 0; i < data->m_vertexCount; i++)
+			{
+				const float* vertex = data->m_vertices + i * stride;
+				size_t slot = HashVertex(vertex, stride) & (tableSize - 1);
+				//open addressing with linear probing, the table is never more than half full
+				while (table[slot] != emptySlot)
+				{
+					const float* other = data->m_vertices + (size_t)table[slot] * stride;
+					if (memcmp(vertex, other, stride * sizeof(float)) == 0)
+						break;
+					slot = (slot + 1) & (tableSize - 1);
+				}
+
+				if (table[slot] == emptySlot)
+				{
+					//compact in place, the unique vertex always lands at or before its source
+					if (uniqueCount != i)
+						memcpy(data->m_vertices + (size_t)uniqueCount * stride, vertex, stride * sizeof(float));
+					table[slot] = uniqueCount;
+					uniqueCount++;
+				}
+				remap[i] = table[slot];
+			}
+
+			for (uint32_t i = 0; i < data->m_indexCount; i++)
+				data->m_indices[i] = remap[data->m_indices[i]];
+
+			data->m_vertexCount = uniqueCount;
+			data->m_verticesSize = (uint64_t)uniqueCount * stride;
+		}
+
+		void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint64_t vertexCount)
+		{
+			const uint32_t triangleCount = indexCount / 3;
+			if (triangleCount == 0)
+				return;
+
+			//vertex to triangle adjacency
+			std::vector<uint32_t> valence(vertexCount, 0);
+			for (uint32_t i = 0; i < triangleCount * 3; i++)
+				valence[indices[i]]++;
+
+			std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+			for (uint64_t v = 0; v < vertexCount; v++)
+				adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+
+			std::vector<uint32_t> adjacency(triangleCount * 3);
+			std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; t++)
+				for (int k = 0; k < 3; k++)
+					adjacency[fill[indices[t * 3 + k]]++] = t;
+
+			std::vector<float> vertexScore(vertexCount);
+			for (uint64_t v = 0; v < vertexCount; v++)
+				vertexScore[v] = ForsythVertexScore(-1, valence[v]);
+
+			std::vector<bool> emitted(triangleCount, false);
+
+			std::vector<uint32_t> result(triangleCount * 3);
+			std::vector<uint32_t> cache;
+			cache.reserve(FORSYTH_CACHE_SIZE + 3);
+			std::vector<uint32_t> newCache;
+			newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+			uint32_t scanCursor = 0;
+			int bestTriangle = -1;
+			for (uint32_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+			{
+				if (bestTriangle < 0)
+				{
+					//nothing useful in the cache, take the next unemitted triangle in input order
+					while (emitted[scanCursor])
+						scanCursor++;
+					bestTriangle = scanCursor;
+				}
+
+				const uint32_t* tri = &indices[bestTriangle * 3];
+				result[outTriangle * 3] = tri[0];
+				result[outTriangle * 3 + 1] = tri[1];
+				result[outTriangle * 3 + 2] = tri[2];
+				emitted[bestTriangle] = true;
+
+				//push the triangle vertices to the front of the LRU cache
+				newCache.clear();
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t v = tri[k];
+					if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+						newCache.push_back(v);
+
+					//remove the triangle from the vertex adjacency
+					uint32_t begin = adjacencyOffset[v];
+					uint32_t end = begin + valence[v];
+					for (uint32_t a = begin; a < end; a++)
+					{
+						if (adjacency[a] == (uint32_t)bestTriangle)
+						{
+							adjacency[a] = adjacency[end - 1];
+							break;
+						}
+					}
+					valence[v]--;
+				}
+				for (uint32_t v : cache)
+					if (v != tri[0] && v != tri[1] && v != tri[2])
+						newCache.push_back(v);
+
+				//vertices pushed out of the cache lose their cache score
+				for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+				{
+					uint32_t v = newCache[i];
+					vertexScore[v] = ForsythVertexScore(-1, valence[v]);
+				}
+				if (newCache.size() > FORSYTH_CACHE_SIZE)
+					newCache.resize(FORSYTH_CACHE_SIZE);
+				cache.swap(newCache);
+
+				for (size_t i = 0; i < cache.size(); i++)
+				{
+					uint32_t v = cache[i];
+					vertexScore[v] = ForsythVertexScore((int)i, valence[v]);
+				}
+
+				//only triangles touching the cache changed score
+				bestTriangle = -1;
+				float bestScore = -1.0f;
+				for (uint32_t v : cache)
+				{
+					uint32_t begin = adjacencyOffset[v];
+					for (uint32_t a = begin; a < begin + valence[v]; a++)
+					{
+						uint32_t t = adjacency[a];
+						float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+						if (score > bestScore)
+						{
+							bestScore = score;
+							bestTriangle = (int)t;
+						}
+					}
+				}
+			}
+
+			memcpy(indices, result.data(), triangleCount * 3 * sizeof(uint32_t));
+		}
+
+		void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const float* vertices, uint64_t vertexCount, uint32_t vertexStride, uint32_t positionOffset, float threshold)
+		{
+			const uint32_t triangleCount = indexCount / 3;
+			if (triangleCount == 0 || vertexStride == 0)
+				return;
+
+			const VertexCacheStatistics before = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount);
+
+			//split the cache optimized order into clusters where the cache gets flushed (all 3 vertices miss)
+			std::vector<uint32_t> clusters;
+			{
+				const uint32_t cacheSize = 16;
+				std::vector<uint32_t> timestamp(vertexCount, 0);
+				uint32_t time = cacheSize + 1;
+				for (uint32_t t = 0; t < triangleCount; t++)
+				{
+					int misses = 0;
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t v = indices[t * 3 + k];
+						if (time - timestamp[v] > cacheSize)
+						{
+							timestamp[v] = time++;
+							misses++;
+						}
+					}
+					if (t == 0 || misses == 3)
+						clusters.push_back(t);
+				}
+			}
+			if (clusters.size() < 2)
+				return;
+
+			auto position = [&](uint32_t v) { return glm::make_vec3(vertices + (size_t)v * vertexStride + positionOffset); };
+
+			glm::vec3 meshCenter(0.0f);
+			float meshArea = 0.0f;
+			struct Cluster
+			{
+				uint32_t begin;
+				uint32_t end;
+				float sortKey;
+			};
+			std::vector<Cluster> sortedClusters(clusters.size());
+			std::vector<glm::vec3> clusterCenter(clusters.size());
+			std::vector<glm::vec3> clusterNormal(clusters.size());
+			for (size_t c = 0; c < clusters.size(); c++)
+			{
+				sortedClusters[c].begin = clusters[c];
+				sortedClusters[c].end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+				glm::vec3 center(0.0f);
+				glm::vec3 normal(0.0f);
+				float area = 0.0f;
+				for (uint32_t t = sortedClusters[c].begin; t < sortedClusters[c].end; t++)
+				{
+					glm::vec3 p0 = position(indices[t * 3]);
+					glm::vec3 p1 = position(indices[t * 3 + 1]);
+					glm::vec3 p2 = position(indices[t * 3 + 2]);
+					glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+					float triangleArea = glm::length(n);
+					center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+					normal += n;
+					area += triangleArea;
+				}
+				meshCenter += center;
+				meshArea += area;
+				clusterCenter[c] = area > 0.0f ? center / area : position(indices[sortedClusters[c].begin * 3]);
+				float normalLength = glm::length(normal);
+				clusterNormal[c] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+			}
+			if (meshArea > 0.0f)
+				meshCenter /= meshArea;
+
+			//clusters far out along their normal occlude the rest from most view directions, draw them first
+			for (size_t c = 0; c < clusters.size(); c++)
+				sortedClusters[c].sortKey = glm::dot(clusterCenter[c] - meshCenter, clusterNormal[c]);
+			std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+			std::vector<uint32_t> result;
+			result.reserve(triangleCount * 3);
+			for (auto& cluster : sortedClusters)
+				result.insert(result.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+
+			//keep the new order only if it doesn't throw away too much of the vertex cache work
+			const VertexCacheStatistics after = AnalyzeVertexCache(result.data(), triangleCount * 3, vertexCount);
+			if (after.acmr <= before.acmr * threshold)
+				memcpy(indices, result.data(), triangleCount * 3 * sizeof(uint32_t));
+		}
+
+		void MeshOptimizer::OptimizeVertexFetch(render::MeshData* data)
+		{
+			const uint32_t stride = GetVertexStride(data);
+			if (stride == 0)
+				return;
+
+			const uint32_t unused = ~0u;
+			std::vector<uint32_t> remap(data->m_vertexCount, unused);
+			uint32_t nextVertex = 0;
+			for (uint32_t i = 0; i < data->m_indexCount; i++)
+			{
+				uint32_t& newIndex = remap[data->m_indices[i]];
+				if (newIndex == unused)
+					newIndex = nextVertex++;
+				data->m_indices[i] = newIndex;
+			}
+
+			float* vertices = new float[(size_t)nextVertex * stride];
+			for (uint64_t v = 0; v < data->m_vertexCount; v++)
+			{
+				if (remap[v] != unused)
+					memcpy(vertices + (size_t)remap[v] * stride, data->m_vertices + v * stride, stride * sizeof(float));
+			}
+
+			delete[] data->m_vertices;
+			data->m_vertices = vertices;
+			data->m_vertexCount = nextVertex;
+			data->m_verticesSize = (uint64_t)nextVertex * stride;
+		}
+
+		static int16_t FloatToSnorm16(float value)
+		{
+			value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+			return static_cast<int16_t>(roundf(value * 32767.0f));
+		}
+
+		static uint16_t FloatToUnorm16(float value)
+		{
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			return static_cast<uint16_t>(roundf(value * 65535.0f));
+		}
+
+		glm::vec2 MeshOptimizer::OctEncode(glm::vec3 n)
+		{
+			float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+			if (l1 == 0.0f)
+				return glm::vec2(0.0f);
+			n = n / l1;
+			if (n.z < 0.0f)
+			{
+				//fold the lower hemisphere over the diagonals
+				float x = (1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+				float y = (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+				return glm::vec2(x, y);
+			}
+			return glm::vec2(n.x, n.y);
+		}
+
+		uint16_t MeshOptimizer::FloatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+			int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+			uint32_t mantissa = bits & 0x7FFFFF;
+
+			if (((bits >> 23) & 0xFF) == 0xFF)//inf and nan
+				return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+			if (exponent >= 31)//too big, clamp to inf
+				return sign | 0x7C00;
+			if (exponent <= 0)
+			{
+				//denormals, anything smaller goes to zero
+				if (exponent < -10)
+					return sign;
+				mantissa |= 0x800000;
+				uint32_t shift = 14 - exponent;
+				uint16_t half = static_cast<uint16_t>(mantissa >> shift);
+				if ((mantissa >> (shift - 1)) & 1)
+					half++;
+				return sign | half;
+			}
+
+			uint16_t half = static_cast<uint16_t>((exponent << 10) | (mantissa >> 13));
+			//round to nearest, a carry into the exponent is still correct
+			if (mantissa & 0x1000)
+				half++;
+			return sign | half;
+		}
+
+		bool MeshOptimizer::CanQuantize(render::Component srcComponent, render::Component dstComponent)
+		{
+			if (srcComponent == dstComponent)
+				return true;
+			switch (dstComponent)
+			{
+			case render::VERTEX_COMPONENT_POSITION_SNORM16:
+				return srcComponent == render::VERTEX_COMPONENT_POSITION;
+			case render::VERTEX_COMPONENT_NORMAL_OCT16:
+				return srcComponent == render::VERTEX_COMPONENT_NORMAL;
+			case render::VERTEX_COMPONENT_TANGENT_OCT16:
+				return srcComponent == render::VERTEX_COMPONENT_TANGENT || srcComponent == render::VERTEX_COMPONENT_TANGENT4;
+			case render::VERTEX_COMPONENT_UV_HALF:
+			case render::VERTEX_COMPONENT_UV_UNORM16:
+				return srcComponent == render::VERTEX_COMPONENT_UV;
+			default:
+				return false;
+			}
+		}
+
+		bool MeshOptimizer::Quantize(render::MeshData* data, render::VertexLayout* srcLayout, render::VertexLayout* dstLayout, QuantizationParams& params)
+		{
+			params = QuantizationParams();
+			const std::vector<render::Component>& srcComponents = srcLayout->m_components[0];
+			const std::vector<render::Component>& dstComponents = dstLayout->m_components[0];
+			if (srcComponents.size() != dstComponents.size())
+				return false;
+			for (size_t c = 0; c < srcComponents.size(); c++)
+			{
+				if (!CanQuantize(srcComponents[c], dstComponents[c]))
+					return false;
+			}
+			if (data->m_vertexCount == 0)
+				return true;
+
+			const uint32_t srcStride = GetVertexStride(data);
+			const uint32_t dstVertexSize = dstLayout->GetVertexSize(0);
+			assert(dstVertexSize % sizeof(float) == 0);
+
+			//positions are mapped from the mesh bounds to [-1,1]
+			const uint32_t positionOffset = GetPositionOffset(srcLayout);
+			glm::vec3 minPos(FLT_MAX);
+			glm::vec3 maxPos(-FLT_MAX);
+			for (uint64_t v = 0; v < data->m_vertexCount; v++)
+			{
+				glm::vec3 p = glm::make_vec3(data->m_vertices + v * srcStride + positionOffset);
+				minPos = glm::min(minPos, p);
+				maxPos = glm::max(maxPos, p);
+			}
+			glm::vec3 center = (minPos + maxPos) * 0.5f;
+			glm::vec3 extent = (maxPos - minPos) * 0.5f;
+			for (int i = 0; i < 3; i++)
+				extent[i] = extent[i] > 0.0f ? extent[i] : 1.0f;
+			params.positionOffset = glm::vec4(center, 0.0f);
+			params.positionScale = glm::vec4(extent, 1.0f);
+
+			const uint64_t verticesSize = data->m_vertexCount * dstVertexSize / sizeof(float);
+			float* vertices = new float[verticesSize];
+			char* dst = reinterpret_cast<char*>(vertices);
+			for (uint64_t v = 0; v < data->m_vertexCount; v++)
+			{
+				const float* src = data->m_vertices + v * srcStride;
+				for (size_t c = 0; c < srcComponents.size(); c++)
+				{
+					render::Component srcComponent = srcComponents[c];
+					render::Component dstComponent = dstComponents[c];
+					uint32_t srcSize = srcLayout->GetComponentSize(srcComponent);
+					uint32_t dstSize = dstLayout->GetComponentSize(dstComponent);
+
+					if (srcComponent == dstComponent)
+					{
+						memcpy(dst, src, srcSize);
+					}
+					else if (dstComponent == render::VERTEX_COMPONENT_POSITION_SNORM16)
+					{
+						glm::vec3 p = (glm::make_vec3(src) - center) / extent;
+						int16_t q[4] = { FloatToSnorm16(p.x), FloatToSnorm16(p.y), FloatToSnorm16(p.z), 0 };
+						memcpy(dst, q, sizeof(q));
+					}
+					else if (dstComponent == render::VERTEX_COMPONENT_NORMAL_OCT16 || dstComponent == render::VERTEX_COMPONENT_TANGENT_OCT16)
+					{
+						glm::vec2 e = OctEncode(glm::make_vec3(src));
+						int16_t q[2] = { FloatToSnorm16(e.x), FloatToSnorm16(e.y) };
+						memcpy(dst, q, sizeof(q));
+					}
+					else if (dstComponent == render::VERTEX_COMPONENT_UV_HALF)
+					{
+						uint16_t q[2] = { FloatToHalf(src[0]), FloatToHalf(src[1]) };
+						memcpy(dst, q, sizeof(q));
+					}
+					else if (dstComponent == render::VERTEX_COMPONENT_UV_UNORM16)
+					{
+						uint16_t q[2] = { FloatToUnorm16(src[0]), FloatToUnorm16(src[1]) };
+						memcpy(dst, q, sizeof(q));
+					}
+
+					src += srcSize / sizeof(float);
+					dst += dstSize;
+				}
+			}
+
+			delete[] data->m_vertices;
+			data->m_vertices = vertices;
+			data->m_verticesSize = verticesSize;
+			data->m_vlayout = dstLayout;
+			return true;
+		}
+
+		VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint64_t vertexCount, uint32_t cacheSize)
+		{
+			VertexCacheStatistics stats;
+			if (indexCount < 3 || vertexCount == 0)
+				return stats;
+
+			//FIFO cache, a vertex is a hit if it was inserted less than cacheSize misses ago
+			std::vector<uint32_t> timestamp(vertexCount, 0);
+			std::vector<bool> referenced(vertexCount, false);
+			uint32_t time = cacheSize + 1;
+			uint32_t uniqueVertices = 0;
+			for (uint32_t i = 0; i < indexCount; i++)
+			{
+				uint32_t v = indices[i];
+				if (time - timestamp[v] > cacheSize)
+				{
+					timestamp[v] = time++;
+					stats.verticesTransformed++;
+				}
+				if (!referenced[v])
+				{
+					referenced[v] = true;
+					uniqueVertices++;
+				}
+			}
+
+			stats.acmr = (float)stats.verticesTransformed / (indexCount / 3);
+			stats.atvr = (float)stats.verticesTransformed / uniqueVertices;
+			return stats;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "render/Mesh.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief Post-transform vertex cache statistics of an index buffer */
+		struct VertexCacheStatistics
+		{
+			uint32_t verticesTransformed = 0;
+			/** @brief Average cache miss ratio, transformed vertices per triangle (0.5 best, 3.0 worst) */
+			float acmr = 0.0f;
+			/** @brief Average transform to vertex ratio, transformed vertices per unique vertex (1.0 best) */
+			float atvr = 0.0f;
+		};
+
+		/** @brief Dequantization constants of VERTEX_COMPONENT_POSITION_SNORM16, laid out to be used as the vertex push constant block */
+		struct QuantizationParams
+		{
+			glm::vec4 positionOffset = glm::vec4(0.0f);
+			glm::vec4 positionScale = glm::vec4(1.0f);
+		};
+
+		/** @brief Offline/load time processing of MeshData: welding, vertex cache, overdraw and vertex fetch ordering */
+		class MeshOptimizer
+		{
+		public:
+			enum Stage
+			{
+				STAGE_WELD = 1 << 0,
+				STAGE_VERTEX_CACHE = 1 << 1,
+				STAGE_OVERDRAW = 1 << 2,
+				STAGE_VERTEX_FETCH = 1 << 3,
+				STAGE_ALL = STAGE_WELD | STAGE_VERTEX_CACHE | STAGE_OVERDRAW | STAGE_VERTEX_FETCH
+			};
+
+			/** @brief Runs the requested stages in the order weld, vertex cache, overdraw, vertex fetch */
+			static void Optimize(render::MeshData* data, render::VertexLayout* vertexLayout, int stages = STAGE_ALL, float overdrawThreshold = 1.05f);
+
+			/** @brief Merges vertices with bitwise identical attributes and remaps the indices */
+			static void WeldVertices(render::MeshData* data);
+
+			/** @brief Reorders triangles for post-transform vertex cache efficiency (Forsyth) */
+			static void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint64_t vertexCount);
+
+			/** @brief Reorders clusters of triangles front to back from the mesh center, keeping the ACMR under threshold * current ACMR */
+			static void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const float* vertices, uint64_t vertexCount, uint32_t vertexStride, uint32_t positionOffset, float threshold = 1.05f);
+
+			/** @brief Reorders vertices in the order they are first referenced by the index buffer, dropping unreferenced ones */
+			static void OptimizeVertexFetch(render::MeshData* data);
+
+			/** @brief Simulates a FIFO post-transform cache of cacheSize entries over the index buffer */
+			static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint64_t vertexCount, uint32_t cacheSize = 16);
+
+			/** @brief Rewrites the vertices from srcLayout to dstLayout, components are matched in order and either copied or quantized.
+			 *  False, with the data untouched, when the layouts don't have the same components or one can't be converted */
+			static bool Quantize(render::MeshData* data, render::VertexLayout* srcLayout, render::VertexLayout* dstLayout, QuantizationParams& params);
+
+			/** @brief True when dstComponent is srcComponent or one of its quantized forms */
+			static bool CanQuantize(render::Component srcComponent, render::Component dstComponent);
+
+			/** @brief Octahedral encoding of a unit vector to [-1,1]^2 */
+			static glm::vec2 OctEncode(glm::vec3 n);
+
+			static uint16_t FloatToHalf(float value);
+
+			/** @brief Vertex stride in floats, derived from the data since loaders don't always fill m_vertexSize */
+			static uint32_t GetVertexStride(const render::MeshData* data);
+
+			/** @brief Offset in floats of the position component inside a vertex */
+			static uint32_t GetPositionOffset(render::VertexLayout* vertexLayout);
+		};
+	}
+}
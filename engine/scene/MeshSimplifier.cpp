@@ -0,0 +1,335 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief Area weighted sum of plane quadrics, the error is the weighted mean squared distance to the planes */
+		struct Quadric
+		{
+			double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+			double w = 0.0;
+
+			void AddPlane(glm::vec3 n, float d, float weight)
+			{
+				a00 += weight * n.x * n.x; a11 += weight * n.y * n.y; a22 += weight * n.z * n.z;
+				a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a12 += weight * n.y * n.z;
+				b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+				c += weight * d * d;
+				w += weight;
+			}
+
+			void Add(const Quadric& q)
+			{
+				a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+			}
+
+			double Error(glm::vec3 p) const
+			{
+				double x = p.x, y = p.y, z = p.z;
+				double r = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				return w > 0.0 ? fabs(r) / w : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double error;
+		};
+
+		uint32_t MeshSimplifier::Simplify(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const float* vertices, uint64_t vertexCount, uint32_t vertexStride, uint32_t positionOffset,
+			uint32_t targetIndexCount, float targetError, float* resultError)
+		{
+			auto position = [&](uint32_t v) {
+				return glm::make_vec3(vertices + (size_t)v * vertexStride + positionOffset);
+			};
+
+			memcpy(destination, indices, indexCount * sizeof(uint32_t));
+			if (resultError)
+				*resultError = 0.0f;
+			if (indexCount < 3 || vertexCount == 0)
+				return indexCount;
+
+			//vertices with the same position share a canonical vertex, attribute seams are where several vertices share one
+			std::vector<uint32_t> sorted(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; v++)
+				sorted[v] = v;
+			std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+				const float* pa = vertices + (size_t)a * vertexStride + positionOffset;
+				const float* pb = vertices + (size_t)b * vertexStride + positionOffset;
+				return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+			});
+			std::vector<uint32_t> canonical(vertexCount);
+			std::vector<uint8_t> locked(vertexCount, 0);
+			for (size_t i = 0; i < sorted.size(); i++)
+			{
+				if (i > 0 && memcmp(vertices + (size_t)sorted[i] * vertexStride + positionOffset, vertices + (size_t)sorted[i - 1] * vertexStride + positionOffset, 3 * sizeof(float)) == 0)
+				{
+					canonical[sorted[i]] = canonical[sorted[i - 1]];
+					locked[canonical[sorted[i]]] = 1;
+				}
+				else
+					canonical[sorted[i]] = sorted[i];
+			}
+
+			//border edges belong to a single triangle, their vertices stay where they are
+			std::vector<uint64_t> edges;
+			edges.reserve(indexCount);
+			for (uint32_t i = 0; i < indexCount; i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = canonical[destination[i + k]];
+					uint32_t b = canonical[destination[i + (k + 1) % 3]];
+					edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < edges.size();)
+			{
+				size_t j = i + 1;
+				while (j < edges.size() && edges[j] == edges[i])
+					j++;
+				if (j - i == 1)
+				{
+					locked[edges[i] >> 32] = 1;
+					locked[edges[i] & 0xFFFFFFFF] = 1;
+				}
+				i = j;
+			}
+
+			std::vector<Quadric> quadrics(vertexCount);
+			for (uint32_t i = 0; i < indexCount; i += 3)
+			{
+				glm::vec3 p0 = position(destination[i]);
+				glm::vec3 n = glm::cross(position(destination[i + 1]) - p0, position(destination[i + 2]) - p0);
+				float length = glm::length(n);
+				if (length == 0.0f)
+					continue;
+				n = n / length;
+				float d = -glm::dot(n, p0);
+				for (int k = 0; k < 3; k++)
+					quadrics[canonical[destination[i + k]]].AddPlane(n, d, length * 0.5f);
+			}
+
+			const double errorLimit = (double)targetError * targetError;
+			double maxError = 0.0;
+			uint32_t count = indexCount;
+
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+			std::vector<uint32_t> adjacency;
+			std::vector<Collapse> collapses;
+			std::vector<uint8_t> passLocked(vertexCount);
+			std::vector<uint32_t> remap(vertexCount);
+
+			//each pass collapses the cheapest edges whose neighbourhoods don't overlap
+			while (count > targetIndexCount)
+			{
+				std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+				for (uint32_t i = 0; i < count; i++)
+					adjacencyOffsets[destination[i] + 1]++;
+				for (uint64_t v = 0; v < vertexCount; v++)
+					adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+				adjacency.resize(count);
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (uint32_t i = 0; i < count; i++)
+					adjacency[fill[destination[i]]++] = i / 3;
+
+				//every interior edge shows up once in each direction
+				collapses.clear();
+				for (uint32_t i = 0; i < count; i += 3)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t from = destination[i + k];
+						uint32_t to = destination[i + (k + 1) % 3];
+						if (locked[canonical[from]])
+							continue;
+						Quadric q = quadrics[canonical[from]];
+						q.Add(quadrics[canonical[to]]);
+						double error = q.Error(position(to));
+						if (error <= errorLimit)
+							collapses.push_back({ from, to, error });
+					}
+				}
+				if (collapses.empty())
+					break;
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+				std::fill(passLocked.begin(), passLocked.end(), 0);
+				for (uint32_t v = 0; v < vertexCount; v++)
+					remap[v] = v;
+
+				uint32_t removed = 0;
+				uint32_t applied = 0;
+				for (const Collapse& collapse : collapses)
+				{
+					if (count - removed * 3 <= targetIndexCount)
+						break;
+					if (passLocked[collapse.from] || passLocked[collapse.to])
+						continue;
+
+					//the triangles around the collapsed vertex must not flip
+					bool flips = false;
+					uint32_t degenerate = 0;
+					glm::vec3 target = position(collapse.to);
+					for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+					{
+						const uint32_t* tri = &destination[adjacency[a] * 3];
+						if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+						{
+							degenerate++;
+							continue;
+						}
+						glm::vec3 p[3] = { position(tri[0]), position(tri[1]), position(tri[2]) };
+						glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+						for (int k = 0; k < 3; k++)
+						{
+							if (tri[k] == collapse.from)
+								p[k] = target;
+						}
+						glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+						//a large rotation is as bad as a flip, it folds the surface over its neighbours
+						flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+					}
+					if (flips)
+						continue;
+
+					for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+					{
+						const uint32_t* tri = &destination[adjacency[a] * 3];
+						passLocked[tri[0]] = passLocked[tri[1]] = passLocked[tri[2]] = 1;
+					}
+					remap[collapse.from] = collapse.to;
+					quadrics[canonical[collapse.to]].Add(quadrics[canonical[collapse.from]]);
+					maxError = std::max(maxError, collapse.error);
+					removed += degenerate;
+					applied++;
+				}
+				if (applied == 0)
+					break;
+
+				uint32_t write = 0;
+				for (uint32_t i = 0; i < count; i += 3)
+				{
+					uint32_t a = remap[destination[i]];
+					uint32_t b = remap[destination[i + 1]];
+					uint32_t c = remap[destination[i + 2]];
+					if (a == b || b == c || a == c)
+						continue;
+					destination[write++] = a;
+					destination[write++] = b;
+					destination[write++] = c;
+				}
+				count = write;
+			}
+
+			if (resultError)
+				*resultError = static_cast<float>(sqrt(maxError));
+			return count;
+		}
+
+		void MeshSimplifier::GenerateLods(render::MeshData* data, render::VertexLayout* vertexLayout, LodChain& chain, uint32_t lodCount, float reduction, float maxError)
+		{
+			chain = LodChain();
+			if (data->m_indices == nullptr || data->m_indexCount < 3 || data->m_vertexCount == 0)
+				return;
+
+			const uint32_t vertexStride = MeshOptimizer::GetVertexStride(data);
+			const uint32_t positionOffset = MeshOptimizer::GetPositionOffset(vertexLayout);
+
+			glm::vec3 minPos(FLT_MAX);
+			glm::vec3 maxPos(-FLT_MAX);
+			for (uint64_t v = 0; v < data->m_vertexCount; v++)
+			{
+				glm::vec3 p = glm::make_vec3(data->m_vertices + v * vertexStride + positionOffset);
+				minPos = glm::min(minPos, p);
+				maxPos = glm::max(maxPos, p);
+			}
+			glm::vec3 center = (minPos + maxPos) * 0.5f;
+			float radius = 0.0f;
+			for (uint64_t v = 0; v < data->m_vertexCount; v++)
+				radius = fmax(radius, glm::length(glm::make_vec3(data->m_vertices + v * vertexStride + positionOffset) - center));
+			chain.m_boundingSphere = glm::vec4(center, radius);
+
+			LodLevel level0;
+			level0.indexCount = data->m_indexCount;
+			chain.m_levels.push_back(level0);
+
+			//every level is simplified from the previous one and appended after it
+			std::vector<uint32_t> lodIndices(data->m_indices, data->m_indices + data->m_indexCount);
+			std::vector<uint32_t> scratch(data->m_indexCount);
+			float error = 0.0f;
+			for (uint32_t i = 1; i < lodCount; i++)
+			{
+				const LodLevel& source = chain.m_levels.back();
+				uint32_t target = static_cast<uint32_t>(source.indexCount * reduction) / 3 * 3;
+				float levelError = 0.0f;
+				uint32_t count = Simplify(scratch.data(), &lodIndices[source.firstIndex], source.indexCount, data->m_vertices, data->m_vertexCount, vertexStride, positionOffset,
+					target, maxError * radius, &levelError);
+				//not worth a level if it barely removed anything
+				if (count == 0 || source.indexCount - count < source.indexCount / 10)
+					break;
+
+				error += levelError;
+				LodLevel level;
+				level.firstIndex = static_cast<uint32_t>(lodIndices.size());
+				level.indexCount = count;
+				level.error = error;
+				lodIndices.insert(lodIndices.end(), scratch.begin(), scratch.begin() + count);
+				chain.m_levels.push_back(level);
+			}
+
+			if (lodIndices.size() != data->m_indexCount)
+			{
+				delete[] data->m_indices;
+				data->m_indexCount = static_cast<uint32_t>(lodIndices.size());
+				data->m_indices = new uint32_t[data->m_indexCount];
+				memcpy(data->m_indices, lodIndices.data(), data->m_indexCount * sizeof(uint32_t));
+			}
+		}
+
+		bool LodChain::Select(glm::vec3 cameraPosition, float projectionScale, float pixelError, float hysteresis)
+		{
+			if (m_levels.empty())
+				return false;
+
+			float distance = glm::length(glm::vec3(m_boundingSphere) - cameraPosition) - m_boundingSphere.w;
+			uint32_t level = 0;
+			if (distance > 0.0f)
+			{
+				//errors grow with the level, keep the coarsest one that projects small enough
+				for (uint32_t i = 1; i < m_levels.size(); i++)
+				{
+					float threshold = i > m_current ? pixelError * (1.0f - hysteresis) : pixelError;
+					if (m_levels[i].error * projectionScale / distance <= threshold)
+						level = i;
+				}
+			}
+			if (level == m_current)
+				return false;
+			m_current = level;
+			return true;
+		}
+
+		render::MeshPart LodChain::GetCurrentPart() const
+		{
+			render::MeshPart part;
+			part.indexCount = m_levels[m_current].indexCount;
+			part.instanceCount = 1;
+			part.firstIndex = m_levels[m_current].firstIndex;
+			part.vertexOffset = 0;
+			part.firstInstance = 0;
+			return part;
+		}
+	}
+}
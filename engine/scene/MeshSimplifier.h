@@ -0,0 +1,49 @@
+#pragma once
+#include "render/Mesh.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief A detail level stored as a range of the mesh index buffer, all levels share the vertices */
+		struct LodLevel
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			/** @brief Object space simplification error, the distance the surface may have moved */
+			float error = 0.0f;
+		};
+
+		/** @brief Detail levels of a geometry, finest first */
+		struct LodChain
+		{
+			std::vector<LodLevel> m_levels;
+			/** @brief xyz center, w radius */
+			glm::vec4 m_boundingSphere = glm::vec4(0.0f);
+			uint32_t m_current = 0;
+
+			/** @brief Picks the coarsest level whose error projects under pixelError. A coarser level has to be under pixelError * (1 - hysteresis), returns true if the level changed */
+			bool Select(glm::vec3 cameraPosition, float projectionScale, float pixelError, float hysteresis);
+
+			render::MeshPart GetCurrentPart() const;
+		};
+
+		/** @brief Quadric error metric simplification by half edge collapses, vertices are never moved or created */
+		class MeshSimplifier
+		{
+		public:
+			/** @brief Writes at most indexCount indices to destination and returns how many were written.
+			 *  Stops at targetIndexCount or when the next collapse would move the surface more than targetError (object space).
+			 *  Border and attribute seam vertices are locked so the mesh doesn't crack. */
+			static uint32_t Simplify(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const float* vertices, uint64_t vertexCount, uint32_t vertexStride, uint32_t positionOffset,
+				uint32_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+			/** @brief Builds up to lodCount levels, each with reduction times the triangles of the previous one.
+			 *  The levels are appended to the mesh index buffer, maxError is relative to the mesh radius. */
+			static void GenerateLods(render::MeshData* data, render::VertexLayout* vertexLayout, LodChain& chain, uint32_t lodCount = 4, float reduction = 0.5f, float maxError = 0.05f);
+		};
+	}
+}
@@ -0,0 +1,306 @@
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include <cfloat>
+
+namespace engine
+{
+	namespace scene
+	{
+		struct VertexAccess
+		{
+			const float* vertices;
+			uint32_t stride;
+			uint32_t positionOffset;
+			int normalOffset;//-1 when the layout has no float normals
+
+			VertexAccess(const render::MeshData* data, render::VertexLayout* vertexLayout) :
+				vertices(data->m_vertices), stride(MeshOptimizer::GetVertexStride(data)), positionOffset(MeshOptimizer::GetPositionOffset(vertexLayout)), normalOffset(-1)
+			{
+				uint32_t offset = 0;
+				for (auto& component : vertexLayout->m_components[0])
+				{
+					if (component == render::VERTEX_COMPONENT_NORMAL)
+					{
+						normalOffset = offset / sizeof(float);
+						break;
+					}
+					offset += vertexLayout->GetComponentSize(component);
+				}
+			}
+
+			glm::vec3 Position(uint32_t vertex) const
+			{
+				return glm::make_vec3(vertices + (size_t)vertex * stride + positionOffset);
+			}
+
+			//normalized face normal pointing to the front side, zero for degenerate triangles
+			glm::vec3 FaceNormal(const uint32_t* triangle) const
+			{
+				glm::vec3 p0 = Position(triangle[0]);
+				glm::vec3 n = glm::cross(Position(triangle[1]) - p0, Position(triangle[2]) - p0);
+				float length = glm::length(n);
+				if (length == 0.0f)
+					return glm::vec3(0.0f);
+				n = n / length;
+				//the front side follows the vertex normals, without them the pipelines front face is clockwise
+				if (normalOffset >= 0)
+				{
+					glm::vec3 vertexNormals = glm::make_vec3(vertices + (size_t)triangle[0] * stride + normalOffset)
+						+ glm::make_vec3(vertices + (size_t)triangle[1] * stride + normalOffset)
+						+ glm::make_vec3(vertices + (size_t)triangle[2] * stride + normalOffset);
+					return glm::dot(n, vertexNormals) < 0.0f ? -n : n;
+				}
+				return -n;
+			}
+		};
+
+		static void ComputeMeshletBounds(Meshlet& meshlet, const MeshletData& meshlets, const uint32_t* indices, const VertexAccess& access)
+		{
+			//sphere around the bounding box center, not the tightest but always contains the vertices
+			glm::vec3 minPos(FLT_MAX);
+			glm::vec3 maxPos(-FLT_MAX);
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			{
+				glm::vec3 position = access.Position(meshlets.m_vertices[meshlet.vertexOffset + v]);
+				minPos = glm::min(minPos, position);
+				maxPos = glm::max(maxPos, position);
+			}
+			glm::vec3 center = (minPos + maxPos) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+				radius = fmax(radius, glm::length(access.Position(meshlets.m_vertices[meshlet.vertexOffset + v]) - center));
+			meshlet.boundingSphere = glm::vec4(center, radius);
+
+			//normal cone from the triangle normals
+			std::vector<glm::vec3> normals(meshlet.triangleCount);
+			glm::vec3 axis(0.0f);
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				normals[t] = access.FaceNormal(&indices[(meshlet.triangleOffset + t) * 3]);
+				axis += normals[t];
+			}
+
+			float axisLength = glm::length(axis);
+			if (axisLength == 0.0f)
+			{
+				meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				return;
+			}
+			axis = axis / axisLength;
+
+			float minDot = 1.0f;
+			for (auto& n : normals)
+			{
+				if (glm::length(n) > 0.0f)
+					minDot = fmin(minDot, glm::dot(n, axis));
+			}
+
+			//close to a half sphere or wider, a backface test would never pass
+			if (minDot <= 0.1f)
+			{
+				meshlet.cone = glm::vec4(axis, 1.0f);
+				return;
+			}
+			meshlet.cone = glm::vec4(axis, sqrtf(1.0f - minDot * minDot));
+		}
+
+		void MeshletBuilder::Build(render::MeshData* data, render::VertexLayout* vertexLayout, MeshletData& meshlets)
+		{
+			meshlets.m_meshlets.clear();
+			meshlets.m_vertices.clear();
+			meshlets.m_triangles.clear();
+
+			const uint32_t triangleCount = data->m_indexCount / 3;
+			if (triangleCount == 0)
+				return;
+
+			const uint32_t unused = ~0u;
+			std::vector<uint32_t> localIndex(data->m_vertexCount, unused);
+
+			Meshlet current = {};
+			auto flush = [&]() {
+				for (uint32_t v = 0; v < current.vertexCount; v++)
+					localIndex[meshlets.m_vertices[current.vertexOffset + v]] = unused;
+				meshlets.m_meshlets.push_back(current);
+				current = {};
+				current.vertexOffset = static_cast<uint32_t>(meshlets.m_vertices.size());
+				current.triangleOffset = static_cast<uint32_t>(meshlets.m_triangles.size() / 3);
+			};
+
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				const uint32_t* tri = &data->m_indices[t * 3];
+				uint32_t newVertices = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					if (localIndex[tri[k]] == unused && (k == 0 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+						newVertices++;
+				}
+				if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+					flush();
+
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t& local = localIndex[tri[k]];
+					if (local == unused)
+					{
+						local = current.vertexCount++;
+						meshlets.m_vertices.push_back(tri[k]);
+					}
+					meshlets.m_triangles.push_back(static_cast<uint8_t>(local));
+				}
+				current.triangleCount++;
+			}
+			if (current.triangleCount > 0)
+				flush();
+
+			//meshlets are built in index order so the index buffer already matches, rewrite it from the meshlets anyway so they are the reference
+			for (auto& meshlet : meshlets.m_meshlets)
+			{
+				for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+					data->m_indices[meshlet.triangleOffset * 3 + i] = meshlets.m_vertices[meshlet.vertexOffset + meshlets.m_triangles[meshlet.triangleOffset * 3 + i]];
+			}
+
+			VertexAccess access(data, vertexLayout);
+			for (auto& meshlet : meshlets.m_meshlets)
+				ComputeMeshletBounds(meshlet, meshlets, data->m_indices, access);
+		}
+
+		bool MeshletBuilder::Validate(const render::MeshData* data, render::VertexLayout* vertexLayout, const MeshletData& meshlets)
+		{
+			VertexAccess access(data, vertexLayout);
+
+			uint32_t triangles = 0;
+			for (auto& meshlet : meshlets.m_meshlets)
+			{
+				if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES)
+					return false;
+				if (meshlet.triangleOffset != triangles)
+					return false;
+				triangles += meshlet.triangleCount;
+
+				glm::vec3 center = glm::vec3(meshlet.boundingSphere);
+				for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+				{
+					uint8_t local = meshlets.m_triangles[meshlet.triangleOffset * 3 + i];
+					if (local >= meshlet.vertexCount)
+						return false;
+					uint32_t vertex = meshlets.m_vertices[meshlet.vertexOffset + local];
+					if (data->m_indices[meshlet.triangleOffset * 3 + i] != vertex)
+						return false;
+					if (glm::length(access.Position(vertex) - center) > meshlet.boundingSphere.w * 1.0001f + 1e-6f)
+						return false;
+				}
+
+				//every front facing triangle normal has to be inside the cone
+				if (meshlet.cone.w < 1.0f)
+				{
+					glm::vec3 axis = glm::vec3(meshlet.cone);
+					float minDot = sqrtf(1.0f - meshlet.cone.w * meshlet.cone.w);
+					for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+					{
+						glm::vec3 n = access.FaceNormal(&data->m_indices[(meshlet.triangleOffset + t) * 3]);
+						if (glm::length(n) > 0.0f && glm::dot(n, axis) < minDot - 1e-4f)
+							return false;
+					}
+				}
+			}
+			return triangles == data->m_indexCount / 3;
+		}
+
+		bool MeshletBuilder::IsVisible(const Meshlet& meshlet, const Frustum& frustum, glm::vec3 cameraPosition, bool& backfacing)
+		{
+			backfacing = false;
+			glm::vec3 center = glm::vec3(meshlet.boundingSphere);
+			float radius = meshlet.boundingSphere.w;
+			for (auto& plane : frustum.m_planes)
+			{
+				if (glm::dot(glm::vec3(plane), center) + plane.w <= -radius)
+					return false;
+			}
+
+			//the whole sphere sees only the back of the cone
+			glm::vec3 toCenter = center - cameraPosition;
+			if (glm::dot(toCenter, glm::vec3(meshlet.cone)) >= meshlet.cone.w * glm::length(toCenter) + radius)
+			{
+				backfacing = true;
+				return false;
+			}
+			return true;
+		}
+
+		MeshletCullStatistics MeshletBuilder::Cull(const MeshletData& meshlets, const Frustum& frustum, glm::vec3 cameraPosition, std::vector<render::MeshPart>& parts)
+		{
+			MeshletCullStatistics stats;
+			for (auto& meshlet : meshlets.m_meshlets)
+			{
+				bool backfacing;
+				if (!IsVisible(meshlet, frustum, cameraPosition, backfacing))
+				{
+					if (backfacing)
+						stats.meshletsBackfaceCulled++;
+					else
+						stats.meshletsFrustumCulled++;
+					stats.trianglesCulled += meshlet.triangleCount;
+					continue;
+				}
+				stats.meshletsVisible++;
+				stats.trianglesVisible += meshlet.triangleCount;
+
+				//merge with the previous part when the meshlets are next to each other in the index buffer
+				if (!parts.empty() && parts.back().firstIndex + parts.back().indexCount == meshlet.triangleOffset * 3)
+				{
+					parts.back().indexCount += meshlet.triangleCount * 3;
+					continue;
+				}
+				render::MeshPart part;
+				part.indexCount = meshlet.triangleCount * 3;
+				part.instanceCount = 1;
+				part.firstIndex = meshlet.triangleOffset * 3;
+				part.vertexOffset = 0;
+				part.firstInstance = 0;
+				parts.push_back(part);
+			}
+			return stats;
+		}
+
+		bool MeshletCulling::Init(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool, const MeshletData& meshlets, std::string computeShaderFile, render::CommandBuffer* commandBuffer)
+		{
+			m_meshletCount = static_cast<uint32_t>(meshlets.m_meshlets.size());
+
+			m_drawsBuffer = device->GetIndirectBuffer(m_meshletCount * sizeof(render::MeshPart), nullptr, descriptorPool, commandBuffer);
+			if (!m_drawsBuffer)
+				return false;
+			m_meshletsBuffer = device->GetStorageVertexBuffer(m_meshletCount * sizeof(Meshlet), (void*)meshlets.m_meshlets.data(), sizeof(Meshlet), descriptorPool, false, commandBuffer);
+			m_uniformBuffer = device->GetUniformBuffer(sizeof(m_uniforms), nullptr, descriptorPool, true);
+
+			_descriptorLayout = device->GetDescriptorSetLayout({
+				{render::DescriptorType::INPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::OUTPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::UNIFORM_BUFFER, render::ShaderStage::COMPUTE}
+				});
+			m_descriptorSet = device->GetDescriptorSet(_descriptorLayout, descriptorPool, { m_meshletsBuffer, m_drawsBuffer, m_uniformBuffer }, {});
+			_pipeline = device->GetComputePipeline(computeShaderFile, "", _descriptorLayout, 0);
+			return true;
+		}
+
+		void MeshletCulling::Update(const Frustum& frustum, glm::vec3 cameraPosition)
+		{
+			for (size_t i = 0; i < frustum.m_planes.size(); i++)
+				m_uniforms.frustumPlanes[i] = frustum.m_planes[i];
+			m_uniforms.cameraPosition = glm::vec4(cameraPosition, (float)m_meshletCount);
+			m_uniformBuffer->MemCopy(&m_uniforms, sizeof(m_uniforms));
+		}
+
+		void MeshletCulling::Prepare(render::CommandBuffer* commandBuffer)
+		{
+			_pipeline->Draw(commandBuffer);
+			m_descriptorSet->Draw(commandBuffer, _pipeline);
+		}
+
+		void MeshletCulling::Draw(render::CommandBuffer* commandBuffer, render::Mesh* mesh)
+		{
+			mesh->DrawIndirect(commandBuffer, m_drawsBuffer, m_meshletCount);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "render/Mesh.h"
+#include "render/GraphicsDevice.h"
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace engine
+{
+	namespace scene
+	{
+		#define MESHLET_MAX_VERTICES 64
+		#define MESHLET_MAX_TRIANGLES 124
+
+		/** @brief GPU friendly (std430) meshlet description, shared with the culling compute shader */
+		struct Meshlet
+		{
+			/** @brief xyz center, w radius */
+			glm::vec4 boundingSphere;
+			/** @brief xyz normalized cone axis, w cutoff (1 means the cone is too wide to be culled) */
+			glm::vec4 cone;
+			uint32_t vertexOffset;//into MeshletData::m_vertices
+			uint32_t triangleOffset;//into MeshletData::m_triangles and into the mesh index buffer (in triangles)
+			uint32_t vertexCount;
+			uint32_t triangleCount;
+		};
+
+		/** @brief Meshlets of a mesh. The mesh index buffer is reordered so every meshlet is a contiguous range of triangles */
+		struct MeshletData
+		{
+			std::vector<Meshlet> m_meshlets;
+			/** @brief Meshlet local vertex index to mesh vertex index */
+			std::vector<uint32_t> m_vertices;
+			/** @brief Meshlet local triangles, 3 local vertex indices per triangle */
+			std::vector<uint8_t> m_triangles;
+		};
+
+		struct MeshletCullStatistics
+		{
+			uint32_t meshletsVisible = 0;
+			uint32_t meshletsFrustumCulled = 0;
+			uint32_t meshletsBackfaceCulled = 0;
+			uint64_t trianglesVisible = 0;
+			uint64_t trianglesCulled = 0;
+		};
+
+		class MeshletBuilder
+		{
+		public:
+			/** @brief Splits the mesh into meshlets in index order and rewrites the indices meshlet by meshlet. Run the vertex cache optimization first for better meshlets */
+			static void Build(render::MeshData* data, render::VertexLayout* vertexLayout, MeshletData& meshlets);
+
+			/** @brief Checks the meshlet limits, that every triangle is covered and that the bounds contain their triangles */
+			static bool Validate(const render::MeshData* data, render::VertexLayout* vertexLayout, const MeshletData& meshlets);
+
+			/** @brief CPU reference of the culling shader: frustum and backface cone culling, visible meshlets are appended as draw parts */
+			static MeshletCullStatistics Cull(const MeshletData& meshlets, const Frustum& frustum, glm::vec3 cameraPosition, std::vector<render::MeshPart>& parts);
+
+			static bool IsVisible(const Meshlet& meshlet, const Frustum& frustum, glm::vec3 cameraPosition, bool& backfacing);
+		};
+
+		/** @brief Frustum and cone culling of meshlets on the GPU, writes one indirect draw per meshlet (culled ones have no indices) */
+		class MeshletCulling
+		{
+		public:
+			struct CullUniforms
+			{
+				glm::vec4 frustumPlanes[6];
+				glm::vec4 cameraPosition;//w is the meshlet count
+			} m_uniforms;
+
+			render::Buffer* m_meshletsBuffer = nullptr;
+			render::Buffer* m_drawsBuffer = nullptr;
+			render::Buffer* m_uniformBuffer = nullptr;
+			render::DescriptorSetLayout* _descriptorLayout = nullptr;
+			render::DescriptorSet* m_descriptorSet = nullptr;
+			render::Pipeline* _pipeline = nullptr;
+			uint32_t m_meshletCount = 0;
+
+			/** @brief False when the device can't draw indirectly */
+			bool Init(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool, const MeshletData& meshlets, std::string computeShaderFile, render::CommandBuffer* commandBuffer);
+			void Update(const Frustum& frustum, glm::vec3 cameraPosition);
+			/** @brief Binds the pipeline and descriptors, the dispatch and barrier are left to the application */
+			void Prepare(render::CommandBuffer* commandBuffer);
+			uint32_t GetGroupCount() const { return (m_meshletCount + 63) / 64; }
+			void Draw(render::CommandBuffer* commandBuffer, render::Mesh* mesh);
+		};
+	}
+}
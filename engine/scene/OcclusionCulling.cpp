@@ -0,0 +1,329 @@
+#include "OcclusionCulling.h"
+#include "RenderObject.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace engine
+{
+	namespace scene
+	{
+		void DepthPyramid::GetLevels(uint32_t width, uint32_t height, std::vector<Level>& levels)
+		{
+			levels.clear();
+			uint32_t offset = 0;
+			do
+			{
+				width = std::max(1u, (width + 1) / 2);
+				height = std::max(1u, (height + 1) / 2);
+				Level level = { offset, width, height, 0 };
+				levels.push_back(level);
+				offset += width * height;
+			} while ((width > 1 || height > 1) && levels.size() < DEPTH_PYRAMID_MAX_LEVELS);
+		}
+
+		void DepthPyramid::Build(const float* depth, uint32_t width, uint32_t height)
+		{
+			m_width = width;
+			m_height = height;
+			GetLevels(width, height, m_levels);
+			m_data.resize(m_levels.back().offset + m_levels.back().width * m_levels.back().height);
+
+			const float* src = depth;
+			uint32_t srcWidth = width, srcHeight = height;
+			for (auto& level : m_levels)
+			{
+				float* dst = m_data.data() + level.offset;
+				for (uint32_t y = 0; y < level.height; y++)
+				{
+					uint32_t y0 = std::min(y * 2, srcHeight - 1), y1 = std::min(y * 2 + 1, srcHeight - 1);
+					for (uint32_t x = 0; x < level.width; x++)
+					{
+						uint32_t x0 = std::min(x * 2, srcWidth - 1), x1 = std::min(x * 2 + 1, srcWidth - 1);
+						dst[y * level.width + x] = std::max(std::max(src[y0 * srcWidth + x0], src[y0 * srcWidth + x1]), std::max(src[y1 * srcWidth + x0], src[y1 * srcWidth + x1]));
+					}
+				}
+				src = dst;
+				srcWidth = level.width;
+				srcHeight = level.height;
+			}
+		}
+
+		void DepthRasterizer::Init(uint32_t width, uint32_t height)
+		{
+			m_width = width;
+			m_height = height;
+			m_depth.resize(width * height);
+			Clear();
+		}
+
+		void DepthRasterizer::Clear(float depth)
+		{
+			std::fill(m_depth.begin(), m_depth.end(), depth);
+		}
+
+		void DepthRasterizer::RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+		{
+			//skipping an occluder is always safe
+			if (clip0.w <= 1e-5f || clip1.w <= 1e-5f || clip2.w <= 1e-5f)
+				return;
+
+			glm::vec3 v[3] = { glm::vec3(clip0) / clip0.w, glm::vec3(clip1) / clip1.w, glm::vec3(clip2) / clip2.w };
+			for (int i = 0; i < 3; i++)
+			{
+				v[i].x = (v[i].x * 0.5f + 0.5f) * m_width;
+				v[i].y = (v[i].y * 0.5f + 0.5f) * m_height;
+			}
+
+			float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+			if (fabs(area) < 1e-8f)
+				return;
+			if (area < 0.0f)
+			{
+				std::swap(v[1], v[2]);
+				area = -area;
+			}
+
+			int minX = std::max(0, (int)floorf(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+			int maxX = std::min((int)m_width - 1, (int)ceilf(std::max(v[0].x, std::max(v[1].x, v[2].x))));
+			int minY = std::max(0, (int)floorf(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+			int maxY = std::min((int)m_height - 1, (int)ceilf(std::max(v[0].y, std::max(v[1].y, v[2].y))));
+
+			for (int y = minY; y <= maxY; y++)
+			{
+				float py = y + 0.5f;
+				for (int x = minX; x <= maxX; x++)
+				{
+					float px = x + 0.5f;
+					float w0 = (v[2].x - v[1].x) * (py - v[1].y) - (v[2].y - v[1].y) * (px - v[1].x);
+					float w1 = (v[0].x - v[2].x) * (py - v[2].y) - (v[0].y - v[2].y) * (px - v[2].x);
+					float w2 = (v[1].x - v[0].x) * (py - v[0].y) - (v[1].y - v[0].y) * (px - v[0].x);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+					//ndc depth is linear in screen space
+					float z = (w0 * v[0].z + w1 * v[1].z + w2 * v[2].z) / area;
+					if (z < 0.0f || z > 1.0f)
+						continue;
+					float& dst = m_depth[y * m_width + x];
+					dst = std::min(dst, z);
+				}
+			}
+		}
+
+		void DepthRasterizer::RasterizeMesh(const render::MeshData* data, render::VertexLayout* vertexLayout, const glm::mat4& viewProjection)
+		{
+			uint32_t stride = MeshOptimizer::GetVertexStride(data);
+			uint32_t positionOffset = MeshOptimizer::GetPositionOffset(vertexLayout);
+			std::vector<glm::vec4> clip(data->m_vertexCount);
+			for (uint64_t i = 0; i < data->m_vertexCount; i++)
+				clip[i] = viewProjection * glm::vec4(glm::make_vec3(data->m_vertices + i * stride + positionOffset), 1.0f);
+			for (uint32_t i = 0; i + 2 < data->m_indexCount; i += 3)
+				RasterizeTriangle(clip[data->m_indices[i]], clip[data->m_indices[i + 1]], clip[data->m_indices[i + 2]]);
+		}
+
+		void OcclusionCulling::AddObject(RenderObject* object)
+		{
+			_renderObjects.push_back(object);
+			for (uint32_t j = 0; j < object->m_geometries.size(); j++)
+			{
+				CullObject cullObject = {};
+				BoundingBox* box = j < object->m_boundingBoxes.size() ? object->m_boundingBoxes[j] : nullptr;
+				if (box)
+				{
+					cullObject.boundsMin = glm::vec4(box->GetPoint1(), 1.0f);
+					cullObject.boundsMax = glm::vec4(box->GetPoint2(), 1.0f);
+				}
+				//the full detail range, detail levels are not selected on the GPU
+				cullObject.draw.indexCount = object->m_geometries[j]->m_indexCount;
+				cullObject.draw.instanceCount = 1;
+				cullObject.draw.firstIndex = 0;
+				cullObject.draw.vertexOffset = 0;
+				cullObject.draw.firstInstance = 0;
+				m_objects.push_back(cullObject);
+				_boxes.push_back(box);
+			}
+		}
+
+		bool OcclusionCulling::IsOccluded(const DepthPyramid& pyramid, glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4& viewProjection)
+		{
+			glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+			float nearestDepth = 1.0f;
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+				glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+				if (clip.w <= 1e-5f)
+					return false;
+				glm::vec3 ndc = glm::vec3(clip) / clip.w;
+				screenMin = glm::min(screenMin, glm::vec2(ndc));
+				screenMax = glm::max(screenMax, glm::vec2(ndc));
+				nearestDepth = std::min(nearestDepth, ndc.z);
+			}
+			if (nearestDepth <= 0.0f)
+				return false;
+
+			glm::vec2 size((float)pyramid.m_width, (float)pyramid.m_height);
+			screenMin = glm::clamp((screenMin * 0.5f + 0.5f) * size, glm::vec2(0.0f), size - 1.0f);
+			screenMax = glm::clamp((screenMax * 0.5f + 0.5f) * size, glm::vec2(0.0f), size - 1.0f);
+			glm::ivec2 p0(screenMin), p1(screenMax);
+
+			//the coarsest level where the rectangle spans at most 2x2 texels
+			uint32_t extent = (uint32_t)std::max(p1.x - p0.x, p1.y - p0.y) + 1;
+			uint32_t level = 0;
+			while ((2u << level) < extent)
+				level++;
+			level = std::min(level, (uint32_t)pyramid.m_levels.size() - 1);
+
+			const DepthPyramid::Level& l = pyramid.m_levels[level];
+			uint32_t x0 = std::min((uint32_t)p0.x >> (level + 1), l.width - 1), x1 = std::min((uint32_t)p1.x >> (level + 1), l.width - 1);
+			uint32_t y0 = std::min((uint32_t)p0.y >> (level + 1), l.height - 1), y1 = std::min((uint32_t)p1.y >> (level + 1), l.height - 1);
+			float farthestDepth = 0.0f;
+			for (uint32_t y = y0; y <= y1; y++)
+				for (uint32_t x = x0; x <= x1; x++)
+					farthestDepth = std::max(farthestDepth, pyramid.Sample(level, x, y));
+
+			return nearestDepth > farthestDepth;
+		}
+
+		bool OcclusionCulling::Cull(const DepthPyramid& pyramid, const glm::mat4& viewProjection, const Frustum& frustum, OcclusionCullStatistics* statistics)
+		{
+			glm::vec4 planes[6];
+			for (size_t i = 0; i < frustum.m_planes.size(); i++)
+				planes[i] = frustum.m_planes[i];
+
+			bool changed = false;
+			OcclusionCullStatistics stats;
+			for (auto box : _boxes)
+			{
+				if (!box)
+					continue;
+				stats.objectsTested++;
+				bool visible = box->FrustumIntersect(planes);
+				if (!visible)
+					stats.objectsFrustumCulled++;
+				else if (IsOccluded(pyramid, box->GetPoint1(), box->GetPoint2(), viewProjection))
+				{
+					stats.objectsOccluded++;
+					visible = false;
+				}
+				changed |= box->IsVisible() != visible;
+				box->SetVisibility(visible);
+			}
+			if (statistics)
+				*statistics = stats;
+			return changed;
+		}
+
+		bool OcclusionCulling::ResetVisibility()
+		{
+			bool changed = false;
+			for (auto box : _boxes)
+			{
+				if (box && !box->IsVisible())
+				{
+					box->SetVisibility(true);
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+		bool OcclusionCulling::Init(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool, render::Texture* depthTexture, uint32_t width, uint32_t height,
+			std::string pyramidShaderFile, std::string cullShaderFile, render::CommandBuffer* commandBuffer)
+		{
+			std::vector<render::MeshPart> draws(m_objects.size());
+			for (size_t i = 0; i < m_objects.size(); i++)
+				draws[i] = m_objects[i].draw;
+			m_drawsBuffer = device->GetIndirectBuffer(draws.size() * sizeof(render::MeshPart), draws.data(), descriptorPool, commandBuffer);
+			if (!m_drawsBuffer)
+				return false;
+
+			std::vector<DepthPyramid::Level> levels;
+			DepthPyramid::GetLevels(width, height, levels);
+			uint32_t pyramidSize = levels.back().offset + levels.back().width * levels.back().height;
+
+			m_pyramidPasses.clear();
+			for (size_t i = 0; i < levels.size(); i++)
+			{
+				PyramidConstants pass;
+				pass.srcOffset = i == 0 ? 0 : levels[i - 1].offset;
+				pass.srcWidth = i == 0 ? width : levels[i - 1].width;
+				pass.srcHeight = i == 0 ? height : levels[i - 1].height;
+				pass.dstOffset = levels[i].offset;
+				pass.dstWidth = levels[i].width;
+				pass.dstHeight = levels[i].height;
+				pass.fromTexture = i == 0 ? 1 : 0;
+				m_pyramidPasses.push_back(pass);
+			}
+
+			m_uniforms.params = glm::vec4((float)width, (float)height, (float)levels.size(), (float)m_objects.size());
+			for (size_t i = 0; i < levels.size(); i++)
+				m_uniforms.levels[i] = levels[i];
+
+			//until the first pyramid is built nothing is occluded
+			std::vector<float> farthest(pyramidSize, 1.0f);
+			m_pyramidBuffer = device->GetStorageVertexBuffer(pyramidSize * sizeof(float), farthest.data(), sizeof(float), descriptorPool, false, commandBuffer);
+			m_objectsBuffer = device->GetStorageVertexBuffer(m_objects.size() * sizeof(CullObject), m_objects.data(), sizeof(CullObject), descriptorPool, false, commandBuffer);
+			m_uniformBuffer = device->GetUniformBuffer(sizeof(m_uniforms), nullptr, descriptorPool, true);
+
+			_pyramidDescriptorLayout = device->GetDescriptorSetLayout({
+				{render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::OUTPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE}
+				});
+			m_pyramidDescriptorSet = device->GetDescriptorSet(_pyramidDescriptorLayout, descriptorPool, { m_pyramidBuffer }, { depthTexture });
+			_pyramidPipeline = device->GetComputePipeline(pyramidShaderFile, "", _pyramidDescriptorLayout, sizeof(PyramidConstants));
+
+			_cullDescriptorLayout = device->GetDescriptorSetLayout({
+				{render::DescriptorType::INPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::INPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::OUTPUT_STORAGE_BUFFER, render::ShaderStage::COMPUTE},
+				{render::DescriptorType::UNIFORM_BUFFER, render::ShaderStage::COMPUTE}
+				});
+			m_cullDescriptorSet = device->GetDescriptorSet(_cullDescriptorLayout, descriptorPool, { m_objectsBuffer, m_pyramidBuffer, m_drawsBuffer, m_uniformBuffer }, {});
+			_cullPipeline = device->GetComputePipeline(cullShaderFile, "", _cullDescriptorLayout, 0);
+
+			Enable();
+			return true;
+		}
+
+		void OcclusionCulling::Update(const glm::mat4& viewProjection, const Frustum& frustum)
+		{
+			m_uniforms.viewProjection = viewProjection;
+			for (size_t i = 0; i < frustum.m_planes.size(); i++)
+				m_uniforms.frustumPlanes[i] = frustum.m_planes[i];
+			m_uniformBuffer->MemCopy(&m_uniforms, sizeof(m_uniforms));
+		}
+
+		void OcclusionCulling::Enable()
+		{
+			if (!m_drawsBuffer)
+				return;
+			uint32_t first = 0;
+			for (auto obj : _renderObjects)
+			{
+				obj->_indirectDraws = m_drawsBuffer;
+				obj->m_firstIndirectDraw = first;
+				first += static_cast<uint32_t>(obj->m_geometries.size());
+			}
+		}
+
+		void OcclusionCulling::Disable()
+		{
+			for (auto obj : _renderObjects)
+				obj->_indirectDraws = nullptr;
+		}
+
+		void OcclusionCulling::PreparePyramidPass(render::CommandBuffer* commandBuffer, uint32_t pass)
+		{
+			_pyramidPipeline->Draw(commandBuffer);
+			m_pyramidDescriptorSet->Draw(commandBuffer, _pyramidPipeline);
+			_pyramidPipeline->PushConstants(commandBuffer, &m_pyramidPasses[pass]);
+		}
+
+		void OcclusionCulling::PrepareCull(render::CommandBuffer* commandBuffer)
+		{
+			_cullPipeline->Draw(commandBuffer);
+			m_cullDescriptorSet->Draw(commandBuffer, _cullPipeline);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "render/Mesh.h"
+#include "render/GraphicsDevice.h"
+#include "BoundingObject.h"
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace engine
+{
+	namespace scene
+	{
+		class RenderObject;
+
+		#define DEPTH_PYRAMID_MAX_LEVELS 16
+
+		/** @brief Farthest depth mip chain of a depth buffer, texel x of level l covers the depth pixels [x * 2^(l+1), (x+1) * 2^(l+1)) */
+		class DepthPyramid
+		{
+		public:
+			struct Level
+			{
+				uint32_t offset;//in floats, into m_data
+				uint32_t width;
+				uint32_t height;
+				uint32_t padding;
+			};
+
+			uint32_t m_width = 0;//of the source depth
+			uint32_t m_height = 0;
+			std::vector<Level> m_levels;
+			std::vector<float> m_data;
+
+			/** @brief Halves the size (rounding up) down to 1x1, the same layout is used by the GPU pyramid buffer */
+			static void GetLevels(uint32_t width, uint32_t height, std::vector<Level>& levels);
+
+			void Build(const float* depth, uint32_t width, uint32_t height);
+
+			float Sample(uint32_t level, uint32_t x, uint32_t y) const { return m_data[m_levels[level].offset + y * m_levels[level].width + x]; }
+		};
+
+		/** @brief Small software depth rasterizer, used to test the culling without a GPU or to cull with a few big occluders */
+		class DepthRasterizer
+		{
+		public:
+			uint32_t m_width = 0;
+			uint32_t m_height = 0;
+			std::vector<float> m_depth;
+
+			void Init(uint32_t width, uint32_t height);
+			void Clear(float depth = 1.0f);
+			/** @brief Both windings are drawn, triangles crossing the near plane are skipped */
+			void RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2);
+			void RasterizeMesh(const render::MeshData* data, render::VertexLayout* vertexLayout, const glm::mat4& viewProjection);
+		};
+
+		struct OcclusionCullStatistics
+		{
+			uint32_t objectsTested = 0;
+			uint32_t objectsFrustumCulled = 0;
+			uint32_t objectsOccluded = 0;
+		};
+
+		/** @brief Hierarchical Z occlusion culling of the RenderObject geometries against the previous frame depth.
+		 *  On the GPU the pyramid and the tests run in compute and the results are indirect draws consumed by RenderObject::Draw,
+		 *  on the CPU the bounding boxes visibility is set instead. */
+		class OcclusionCulling
+		{
+		public:
+			/** @brief std430 layout shared with hizcull.comp */
+			struct CullObject
+			{
+				glm::vec4 boundsMin;//w is 0 for geometries without bounds, they are never culled
+				glm::vec4 boundsMax;
+				render::MeshPart draw;
+				uint32_t padding[3];
+			};
+
+			struct CullUniforms
+			{
+				glm::mat4 viewProjection;
+				glm::vec4 frustumPlanes[6];
+				glm::vec4 params;//depth width, depth height, pyramid levels, objects count
+				DepthPyramid::Level levels[DEPTH_PYRAMID_MAX_LEVELS];
+			} m_uniforms;
+
+			struct PyramidConstants
+			{
+				uint32_t srcOffset;
+				uint32_t srcWidth;
+				uint32_t srcHeight;
+				uint32_t dstOffset;
+				uint32_t dstWidth;
+				uint32_t dstHeight;
+				uint32_t fromTexture;
+			};
+
+			std::vector<CullObject> m_objects;
+			std::vector<BoundingBox*> _boxes;//of m_objects, can be null
+			std::vector<RenderObject*> _renderObjects;
+
+			render::Buffer* m_objectsBuffer = nullptr;
+			render::Buffer* m_drawsBuffer = nullptr;
+			render::Buffer* m_pyramidBuffer = nullptr;
+			render::Buffer* m_uniformBuffer = nullptr;
+			render::DescriptorSetLayout* _pyramidDescriptorLayout = nullptr;
+			render::DescriptorSet* m_pyramidDescriptorSet = nullptr;
+			render::Pipeline* _pyramidPipeline = nullptr;
+			render::DescriptorSetLayout* _cullDescriptorLayout = nullptr;
+			render::DescriptorSet* m_cullDescriptorSet = nullptr;
+			render::Pipeline* _cullPipeline = nullptr;
+			std::vector<PyramidConstants> m_pyramidPasses;
+
+			/** @brief Registers every geometry of the object, call before Init */
+			void AddObject(RenderObject* object);
+
+			/** @brief CPU reference of the occlusion test. The box is visible if it crosses the camera plane */
+			static bool IsOccluded(const DepthPyramid& pyramid, glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4& viewProjection);
+
+			/** @brief Frustum and occlusion test of the registered geometries on the CPU, the result goes to the bounding boxes visibility.
+			 *  Returns true if a visibility changed and the draws have to be recorded again */
+			bool Cull(const DepthPyramid& pyramid, const glm::mat4& viewProjection, const Frustum& frustum, OcclusionCullStatistics* statistics = nullptr);
+			/** @brief Makes every registered bounding box visible again */
+			bool ResetVisibility();
+
+			/** @brief Creates the GPU resources. The depth texture has to be usable in shaders, the render objects draw indirectly from now on.
+			 *  False when the device can't draw indirectly, only the culling on the CPU is available then */
+			bool Init(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool, render::Texture* depthTexture, uint32_t width, uint32_t height,
+				std::string pyramidShaderFile, std::string cullShaderFile, render::CommandBuffer* commandBuffer);
+			void Update(const glm::mat4& viewProjection, const Frustum& frustum);
+			/** @brief The render objects draw from m_drawsBuffer, or again directly after Disable */
+			void Enable();
+			void Disable();
+
+			uint32_t GetPyramidPassCount() const { return static_cast<uint32_t>(m_pyramidPasses.size()); }
+			/** @brief Binds the reduction of one pyramid level, the dispatch of GetPyramidGroupCount groups and a barrier on the pyramid are left to the application */
+			void PreparePyramidPass(render::CommandBuffer* commandBuffer, uint32_t pass);
+			glm::uvec2 GetPyramidGroupCount(uint32_t pass) const { return glm::uvec2((m_pyramidPasses[pass].dstWidth + 15) / 16, (m_pyramidPasses[pass].dstHeight + 15) / 16); }
+
+			/** @brief Binds the culling, the dispatch and the barrier on m_drawsBuffer are left to the application */
+			void PrepareCull(render::CommandBuffer* commandBuffer);
+			uint32_t GetCullGroupCount() const { return (static_cast<uint32_t>(m_objects.size()) + 63) / 64; }
+		};
+	}
+}
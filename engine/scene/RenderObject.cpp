@@ -27,6 +27,41 @@ namespace engine
 		void RenderObject::AddGeometry(render::Mesh* geometry)
 		{
 			m_geometries.push_back(geometry);//TODO verify compatibility
+			//the lod levels are appended to the index buffer, a plain draw should still only draw the first one
+			size_t index = m_geometries.size() - 1;
+			if (index < m_lods.size() && !m_lods[index].m_levels.empty())
+				geometry->m_indexCount = m_lods[index].m_levels[0].indexCount;
+		}
+
+		void RenderObject::SetGeometryLods(uint32_t geometryIndex, const LodChain& chain)
+		{
+			if (m_lods.size() <= geometryIndex)
+				m_lods.resize(geometryIndex + 1);
+			m_lods[geometryIndex] = chain;
+			if (geometryIndex < m_geometries.size() && !chain.m_levels.empty())
+				m_geometries[geometryIndex]->m_indexCount = chain.m_levels[0].indexCount;
+		}
+
+		bool RenderObject::SelectLods(glm::vec3 cameraPosition, float projectionScale, float pixelError, float hysteresis)
+		{
+			bool changed = false;
+			for (auto& chain : m_lods)
+				changed |= chain.Select(cameraPosition, projectionScale, pixelError, hysteresis);
+			return changed;
+		}
+
+		uint64_t RenderObject::GetTriangleCount(bool fullDetail)
+		{
+			uint64_t triangles = 0;
+			for (uint32_t j = 0; j < m_geometries.size(); j++)
+			{
+				if (!m_boundingBoxes.empty() && (m_boundingBoxes.size() - 1) >= j && !m_boundingBoxes[j]->IsVisible()) continue;
+				if (j < m_lods.size() && !m_lods[j].m_levels.empty())
+					triangles += m_lods[j].m_levels[fullDetail ? 0 : m_lods[j].m_current].indexCount / 3;
+				else
+					triangles += m_geometries[j]->m_indexCount / 3;
+			}
+			return triangles;
 		}
 
 		void RenderObject::PopulateDynamicUniformBufferIndices()
@@ -44,10 +79,10 @@ namespace engine
 			memcpy(_geometriesPushConstants, data, constantSize * constantsNumber);
 		}
 
-		void RenderObject::Draw(render::CommandBuffer* commandBuffer, uint32_t swapchainImageIndex, render::Pipeline* currentPipeline, render::DescriptorSet* currentDescriptorSet)
+		bool RenderObject::Draw(render::CommandBuffer* commandBuffer, uint32_t swapchainImageIndex, render::Pipeline* currentPipeline, render::DescriptorSet* currentDescriptorSet)
 		{
 			if (m_geometries.empty())
-				return;
+				return false;
 			bool is_visible = false;
 			if (m_boundingBoxes.empty()) is_visible = true;
 			for (int i = 0; i < m_boundingBoxes.size(); i++)
@@ -55,7 +90,7 @@ namespace engine
 				is_visible |= m_boundingBoxes[i]->IsVisible();
 			}
 			if (!is_visible)
-				return;
+				return false;
 
 			//render::VulkanVertexLayout* vjlayout = static_cast<render::VulkanVertexLayout*>(_vertexLayout);
 
@@ -78,8 +113,14 @@ namespace engine
 
 				//render::VulkanCommandBuffer* vkcmd = static_cast<render::VulkanCommandBuffer*>(commandBuffer);
 				//m_geometries[j]->Draw(&vkcmd->m_vkCommandBuffer, vip, iip);
-				m_geometries[j]->Draw(commandBuffer);
+				if (_indirectDraws)
+					m_geometries[j]->DrawIndirect(commandBuffer, _indirectDraws, 1, m_firstIndirectDraw + j);
+				else if (j < m_lods.size() && !m_lods[j].m_levels.empty())
+					m_geometries[j]->Draw(commandBuffer, { m_lods[j].GetCurrentPart() });
+				else
+					m_geometries[j]->Draw(commandBuffer);
 			}
+			return true;
 		}
 
 		std::vector<render::MeshData*> RenderObject::LoadGeometry(const std::string& filename, render::VertexLayout* vertexLayout, float scale, int instanceNo, glm::vec3 atPos)
@@ -9,6 +9,7 @@
 #include "CommandBuffer.h"
 #include "scene/Geometry.h"
 #include "render/Mesh.h"
+#include "scene/MeshSimplifier.h"
 
 namespace engine
 {
@@ -33,6 +34,18 @@ namespace engine
 			uint32_t m_sizeofConstant;
 			uint32_t m_constantsNumber;
 
+			//run the MeshOptimizer over the loaded geometry
+			bool m_optimizeMeshes = false;
+
+			//when set the geometries are drawn from GPU written draws, one per geometry starting at m_firstIndirectDraw
+			render::Buffer* _indirectDraws = nullptr;
+			uint32_t m_firstIndirectDraw = 0;
+
+			//detail levels of each geometry, a geometry without levels is always drawn whole
+			std::vector<LodChain> m_lods;
+			bool m_generateLods = false;
+			uint32_t m_lodCount = 4;
+
 			virtual ~RenderObject()
 			{
 				//for (auto geo : m_geometries)delete geo;
@@ -47,6 +60,7 @@ namespace engine
 			RenderObject& operator = (const RenderObject& t);
 
 			virtual std::vector<render::MeshData*> LoadGeometry(const std::string& filename, render::VertexLayout* vertexLayout, float scale = 1.0f, int instanceNo = 1, glm::vec3 atPos = glm::vec3(0.0f));
+			/** @brief Shares the meshes of t without its lod chains, the copy always draws them at full detail */
 			void AdoptGeometriesFrom(const RenderObject& t);
 			void ComputeTangents(glm::vec3 pos1, glm::vec3 pos2, glm::vec3 pos3, glm::vec2 uv1, glm::vec2 uv2, glm::vec2 uv3, glm::vec3& tangent1, glm::vec3& bitangent1);
 			void SetVertexLayout(render::VertexLayout* vlayout) { _vertexLayout = vlayout; };
@@ -58,9 +72,17 @@ namespace engine
 			void PopulateDynamicUniformBufferIndices();
 			void InitGeometriesPushConstants(uint32_t constantSize, uint32_t constantsNumber, void *data);
 
+			void SetGeometryLods(uint32_t geometryIndex, const LodChain& chain);
+			/** @brief Selects the detail level of every geometry, projectionScale is the viewport height / (2 * tan(fov / 2)). Returns true if a level changed and the draws have to be recorded again */
+			bool SelectLods(glm::vec3 cameraPosition, float projectionScale, float pixelError = 1.0f, float hysteresis = 0.25f);
+			/** @brief Triangles drawn with the current levels, or with the full detail meshes */
+			uint64_t GetTriangleCount(bool fullDetail = false);
+
 			bool IsSimilar(RenderObject* another) { return _pipeline == another->_pipeline /*|| m_descriptorSet == another->m_descriptorSet*/; };
 
-			void Draw(render::CommandBuffer* commandBuffer, uint32_t swapchainImageIndex = 0, render::Pipeline* currentPipeline = nullptr, render::DescriptorSet* currentDescriptorSet = nullptr);
+			/** @brief Binds the pipeline and the descriptor set when they differ from the current ones and draws the visible geometries.
+			 *  Returns false when nothing was drawn, nothing was bound either then */
+			bool Draw(render::CommandBuffer* commandBuffer, uint32_t swapchainImageIndex = 0, render::Pipeline* currentPipeline = nullptr, render::DescriptorSet* currentDescriptorSet = nullptr);
 		};
 	}
 }
\ No newline at end of file
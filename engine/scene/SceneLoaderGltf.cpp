@@ -3,9 +3,11 @@
 //#include "render/vulkan/VulkanDevice.h"
 #include "scene/Timer.h"
 #include "Camera.h"
+#include "MeshOptimizer.h"
 //#include "render/vulkan/VulkanRenderPass.h"
 
 #include <algorithm>
+#include <cfloat>
 #define TINYGLTF_IMPLEMENTATION
 
 #define TINYGLTF_NO_STB_IMAGE_WRITE
@@ -155,42 +157,21 @@ namespace engine
 			if(deferred == false)
 				modelbindings.insert(modelbindings.begin()+2, { render::DescriptorType::UNIFORM_BUFFER, render::ShaderStage::FRAGMENT });
 
+			//the normal map is a placeholder for the materials without one, every material has the same layout
+			modelbindings.push_back({ render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT });
 			for (auto tex : globalTextures)
 			{
 				modelbindings.push_back({ render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT });
 			}
 
-			render::DescriptorSetLayout* currentDesclayoutSimple = _device->GetDescriptorSetLayout(modelbindings);
-			render::DescriptorSetLayout* currentDesclayoutNormalmap = nullptr;
+			render::DescriptorSetLayout* currentDesclayout = _device->GetDescriptorSetLayout(modelbindings);
 
 			std::string shaderfolder = (deferred ? deferredShadersFolder : forwardShadersFolder) + "/";
 			render::PipelineProperties props;
 			props.cullMode = render::CullMode::FRONT;
 			props.attachmentCount = blendAttachmentStates.size();
 			props.pAttachments = blendAttachmentStates.data();
-			/*render::VulkanPipeline* currentPipeline = _device->GetPipeline(currentDesclayoutSimple->m_descriptorSetLayout, vertexlayout.m_vertexInputBindings, vertexlayout.m_vertexInputAttributes,
-				shaderfolder + lightingVS, shaderfolder + lightingFS, modelsVkRenderPass, vKpipelineCache, props);*/
-			render::Pipeline* currentPipeline = _device->GetPipeline(
-				shaderfolder + lightingVS, "VSMain", shaderfolder + lightingFS, "PSMain",
-				vertexlayout, currentDesclayoutSimple, props, modelsVkRenderPass);
-
-			render::Pipeline* currentPipelineNormalmap = nullptr;
-			bool hasNormalmap = false;
-			for (size_t i = 0; i < input.materials.size(); i++)
-			{
-				if (input.materials[i].additionalValues.find("normalTexture") != input.materials[i].additionalValues.end())
-				{
-					hasNormalmap = true;
-					modelbindings.push_back({ render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT });
-					currentDesclayoutNormalmap = _device->GetDescriptorSetLayout(modelbindings);
-					/*currentPipelineNormalmap = _device->GetPipeline(currentDesclayoutNormalmap->m_descriptorSetLayout, vertexlayoutNormalmap.m_vertexInputBindings, vertexlayoutNormalmap.m_vertexInputAttributes,
-						shaderfolder + normalmapVS, shaderfolder + normalmapFS, modelsVkRenderPass, vKpipelineCache, props);*/
-					currentPipelineNormalmap = _device->GetPipeline(
-						shaderfolder + normalmapVS, "VSMain", shaderfolder + normalmapFS, "PSMain",
-						vertexlayoutNormalmap, currentDesclayoutNormalmap, props, modelsVkRenderPass);
-					break;
-				}
-			}
+			m_pipelineVariants.Init(_device, shaderfolder + lightingFS, "PSMain", { "NORMAL_MAP" }, props, modelsVkRenderPass);
 
 			individualFragmentUniformBuffers.resize(input.materials.size());
 			std::fill(individualFragmentUniformBuffers.begin(), individualFragmentUniformBuffers.end(), nullptr);
@@ -241,6 +222,10 @@ namespace engine
 					texturesDescriptors.push_back(modelsTextures[modelsTexturesIds[glTFMaterial.additionalValues["normalTexture"].TextureIndex()]]);
 					hasNormalmap = true;
 				}
+				else
+				{
+					texturesDescriptors.push_back(m_placeholder);
+				}
 
 				for (auto tex : globalTextures)
 				{
@@ -251,11 +236,14 @@ namespace engine
 				individualFragmentUniformBuffers[i] = _device->GetUniformBuffer(sizeof(fdata), &fdata, descriptorPool, true);//TODO make it gpu visible
 				buffersDescriptors.push_back(individualFragmentUniformBuffers[i]);
 
-				render::DescriptorSetLayout* currentDesclayout = hasNormalmap ? currentDesclayoutNormalmap : currentDesclayoutSimple;
+				//the normal mapped variant reads the tangents of its own vertex shader
+				uint32_t features = hasNormalmap ? MATERIAL_NORMAL_MAP : 0;
+				render::VertexLayout* currentVertexLayout = hasNormalmap ? vertexlayoutNormalmap : vertexlayout;
+				render::Pipeline* currentPipeline = m_pipelineVariants.Get(features, shaderfolder + (hasNormalmap ? normalmapVS : lightingVS), "VSMain", currentVertexLayout, currentDesclayout);
 
 				render_objects[i]->SetDescriptorSetLayout(currentDesclayout);
-				render_objects[i]->_vertexLayout = hasNormalmap ? vertexlayoutNormalmap : vertexlayout;
-				render_objects[i]->AddPipeline(hasNormalmap ? currentPipelineNormalmap : currentPipeline);
+				render_objects[i]->_vertexLayout = currentVertexLayout;
+				render_objects[i]->AddPipeline(currentPipeline);
 				/*render::VulkanDescriptorSet* desc = _device->GetDescriptorSet(descriptorPool, buffersDescriptors, texturesDescriptors,
 					currentDesclayout->m_descriptorSetLayout, currentDesclayout->m_setLayoutBindings);
 				render_objects[i]->AddDescriptor(desc);*/
@@ -264,6 +252,124 @@ namespace engine
 			}
 		}
 
+		//std430 layout of Material in bindless.glsl
+		struct BindlessMaterial
+		{
+			uint32_t baseColorTexture;
+			uint32_t metallicRoughnessTexture;
+			uint32_t normalTexture;
+			uint32_t padding = 0;
+			float baseColorFactor = 1.0f;
+			float metallicFactor = 1.0f;
+			float roughnessFactor = 1.0f;
+			float aoFactor = 0.01f;
+		};
+
+		//BindlessConstants in bindless.glsl
+		struct BindlessConstants
+		{
+			uint32_t material;
+			uint32_t sceneBuffer;
+			uint32_t lightBuffer;
+			uint32_t materialsBuffer;
+			uint32_t shadowmap;
+		};
+
+		void SceneLoaderGltf::LoadBindlessMaterials(tinygltf::Model& input)
+		{
+			render::BindlessTable* table = _device->GetBindlessTable();
+
+			uniform_manager.SetDescriptorPool(descriptorPool);
+			uniform_manager.SetEngineDevice(_device);
+			//the shadow coordinates are always computed, the fragment shader ignores them without a shadow map
+			sceneVertexUniformBuffer = uniform_manager.GetGlobalUniformBuffer({ UNIFORM_PROJECTION ,UNIFORM_VIEW, UNIFORM_LIGHT0_SPACE_BIASED ,UNIFORM_LIGHT0_POSITION, UNIFORM_CAMERA_POSITION });
+			sceneFragmentUniformBuffer = uniform_manager.GetGlobalUniformBuffer({ UNIFORM_LIGHT0_COLOR });
+			shadow_uniform_buffer = uniform_manager.GetGlobalUniformBuffer({ UNIFORM_LIGHT0_SPACE });
+
+			render::BlendAttachmentState opaqueState{ false };
+			std::vector <render::BlendAttachmentState> blendAttachmentStates{ opaqueState };
+
+			std::string shaderfolder = forwardShadersFolder + "/";
+			render::PipelineProperties props;
+			props.cullMode = render::CullMode::FRONT;
+			props.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
+			props.pAttachments = blendAttachmentStates.data();
+			props.vertexConstantBlockSize = sizeof(BindlessConstants);
+
+			//both pipelines have the layout of the table, switching between them keeps the table bound
+			render::Pipeline* pipeline = _device->GetPipeline(
+				shaderfolder + bindlessVS, "VSMain", shaderfolder + bindlessFS, "PSMain",
+				vertexlayout, table->GetLayout(), props, modelsVkRenderPass);
+			render::Pipeline* pipelineNormalmap = nullptr;
+
+			individualFragmentUniformBuffers.resize(input.materials.size());
+			std::fill(individualFragmentUniformBuffers.begin(), individualFragmentUniformBuffers.end(), nullptr);
+
+			//a texture that didn't fit in the table is replaced by the placeholder
+			auto textureIndex = [&](int gltfTexture) {
+				uint32_t index = modelsTextures[modelsTexturesIds[gltfTexture]]->m_bindlessIndex;
+				return index != UINT32_MAX ? index : m_placeholder->m_bindlessIndex;
+			};
+
+			std::vector<BindlessMaterial> materials(input.materials.size());
+			for (size_t i = 0; i < input.materials.size(); i++) {
+				tinygltf::Material glTFMaterial = input.materials[i];
+				BindlessMaterial& material = materials[i];
+				material.baseColorTexture = m_placeholder->m_bindlessIndex;
+				material.metallicRoughnessTexture = m_placeholder->m_bindlessIndex;
+				material.normalTexture = UINT32_MAX;
+				bool hasNormalmap = false;
+				if (glTFMaterial.values.find("metallicFactor") != glTFMaterial.values.end()) {
+					material.metallicFactor = static_cast<float>(glTFMaterial.values["metallicFactor"].Factor());
+				}
+				if (glTFMaterial.values.find("baseColorTexture") != glTFMaterial.values.end()) {
+					material.baseColorTexture = textureIndex(glTFMaterial.values["baseColorTexture"].TextureIndex());
+				}
+				if (glTFMaterial.values.find("metallicRoughnessTexture") != glTFMaterial.values.end()) {
+					material.metallicRoughnessTexture = textureIndex(glTFMaterial.values["metallicRoughnessTexture"].TextureIndex());
+				}
+				if (glTFMaterial.additionalValues.find("normalTexture") != glTFMaterial.additionalValues.end()) {
+					//the vertices still have tangents when the normal map is missing from the table, the shader falls back to the vertex normal
+					material.normalTexture = modelsTextures[modelsTexturesIds[glTFMaterial.additionalValues["normalTexture"].TextureIndex()]]->m_bindlessIndex;
+					hasNormalmap = true;
+				}
+
+				if (hasNormalmap && !pipelineNormalmap)
+				{
+					pipelineNormalmap = _device->GetPipeline(
+						shaderfolder + bindlessNormalmapVS, "VSMain", shaderfolder + bindlessFS, "PSMain",
+						vertexlayoutNormalmap, table->GetLayout(), props, modelsVkRenderPass);
+				}
+
+				render_objects[i] = new RenderObject;
+				render_objects[i]->SetDescriptorSetLayout(table->GetLayout());
+				render_objects[i]->_vertexLayout = hasNormalmap ? vertexlayoutNormalmap : vertexlayout;
+				render_objects[i]->AddPipeline(hasNormalmap ? pipelineNormalmap : pipeline);
+				render_objects[i]->AddDescriptor(table);
+			}
+
+			if (!materials.empty())
+				materialsBuffer = _device->GetStorageVertexBuffer(materials.size() * sizeof(BindlessMaterial), materials.data(), sizeof(BindlessMaterial), descriptorPool, false, m_loadingCommandBuffer);
+		}
+
+		void SceneLoaderGltf::InitBindlessConstants()
+		{
+			BindlessConstants constants;
+			constants.sceneBuffer = sceneVertexUniformBuffer->m_bindlessIndex;
+			constants.lightBuffer = sceneFragmentUniformBuffer->m_bindlessIndex;
+			constants.materialsBuffer = materialsBuffer ? materialsBuffer->m_bindlessIndex : UINT32_MAX;
+			constants.shadowmap = useShadows && shadowmap ? shadowmap->m_bindlessIndex : UINT32_MAX;
+			for (size_t i = 0; i < render_objects.size(); i++)
+			{
+				RenderObject* ro = render_objects[i];
+				if (!ro || ro->m_geometries.empty())
+					continue;
+				constants.material = static_cast<uint32_t>(i);
+				std::vector<BindlessConstants> geometriesConstants(ro->m_geometries.size(), constants);
+				ro->InitGeometriesPushConstants(sizeof(BindlessConstants), static_cast<uint32_t>(geometriesConstants.size()), geometriesConstants.data());
+			}
+		}
+
 		void SceneLoaderGltf::LoadNode(const tinygltf::Node& inputNode, glm::mat4 parentMatrix, const tinygltf::Model& input)
 		{
 			glm::mat4 mymatrix = parentMatrix;
@@ -349,10 +455,13 @@ namespace engine
 						geometry->m_vertices = new float[geometry->m_verticesSize];
 
 						int vertex_index = 0;
+						glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
 						// Append data to model's vertex buffer
 						for (size_t v = 0; v < vertexCount; v++) {
 
 							glm::vec3 pPos = mymatrix * glm::vec4(glm::make_vec3(&positionBuffer[v * 3]), 1.0f); //pPos.y = -pPos.y;
+							boundsMin = glm::min(boundsMin, pPos);
+							boundsMax = glm::max(boundsMax, pPos);
 							glm::vec3 pNormal = glm::normalize(glm::vec3(normalsBuffer ? glm::make_vec3(&normalsBuffer[v * 3]) : glm::vec3(0.0f))); 
 							pNormal = glm::vec3(mymatrix * glm::vec4(pNormal, 0.0)); //pNormal.y = -pNormal.y;
 							glm::vec2 pTexCoord = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[v * 2]) : glm::vec3(0.0f);
@@ -439,8 +548,21 @@ namespace engine
 						}
 
 					}
+					if (optimizeMeshes)
+						MeshOptimizer::Optimize(geometry, vlayout);
+					if (generateLods)
+					{
+						LodChain chain;
+						MeshSimplifier::GenerateLods(geometry, vlayout, chain, lodCount);
+						render_objects[glTFPrimitive.material]->SetGeometryLods(static_cast<uint32_t>(render_objects[glTFPrimitive.material]->m_geometries.size()), chain);
+					}
+					//world space bounds, used for visibility and occlusion culling
+					render_objects[glTFPrimitive.material]->m_boundingBoxes.push_back(new BoundingBox(boundsMin, boundsMax, glm::length(boundsMax - boundsMin)));
 					render_objects[glTFPrimitive.material]->AddGeometry(_device->GetMesh(geometry, vlayout, m_loadingCommandBuffer));
-					delete geometry;
+					if (keepMeshData)
+						render_objects[glTFPrimitive.material]->m_meshesData.push_back(geometry);
+					else
+						delete geometry;
 				}
 			}
 			else
@@ -465,6 +587,7 @@ namespace engine
 			modelsVkRenderPass = renderPass;
 			useShadows = withShadow;
 			m_deferred = deferred;
+			m_bindless = !deferred && _device->GetBindlessTable() != nullptr;
 			//vKpipelineCache = pipelineCache;
 			tinygltf::Model glTFInput;
 			tinygltf::TinyGLTF gltfContext;
@@ -500,7 +623,10 @@ namespace engine
 			}
 			
 			LoadImages(glTFInput);
-			LoadMaterials(glTFInput, deferred);
+			if (m_bindless)
+				LoadBindlessMaterials(glTFInput);
+			else
+				LoadMaterials(glTFInput, deferred);
 
 			const tinygltf::Scene& scene = glTFInput.scenes[0];
 			for (size_t i = 0; i < scene.nodes.size(); i++) {
@@ -508,6 +634,9 @@ namespace engine
 				LoadNode(node, glm::mat4(1.0f), glTFInput);
 			}
 
+			if (m_bindless)
+				InitBindlessConstants();
+
 			if (withShadow)
 			{
 				CreateShadowObjects();
@@ -1,6 +1,7 @@
 #pragma once
 #include "RenderObject.h"
 #include "UniformBuffersManager.h"
+#include "render/PipelineVariants.h"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 //#define GLM_ENABLE_EXPERIMENTAL
@@ -48,10 +49,12 @@ namespace engine
 			std::string lightingVS = "pbr.vert.spv";
 			std::string lightingFS = "pbrtextured.frag.spv";
 			std::string normalmapVS = "pbrnormalmap.vert.spv";
-			std::string normalmapFS = "pbrtexturednormalmap.frag.spv";
 			std::string shadowmapVS = "pbrtexturednormalmap.frag.spv";
 			std::string shadowmapFS = "pbrtexturednormalmap.frag.spv";
 			std::string shadowmapFSColored = "pbrtexturednormalmap.frag.spv";
+			std::string bindlessVS = "pbrbindless.vert.spv";
+			std::string bindlessNormalmapVS = "pbrbindlessnormalmap.vert.spv";
+			std::string bindlessFS = "pbrbindless.frag.spv";
 
 			struct {
 				glm::mat4 depthMVP;
@@ -64,6 +67,14 @@ namespace engine
 
 			render::RenderPass* modelsVkRenderPass;
 
+			//bits of the variant of a material, switch i of the lighting fragment shader
+			enum MaterialFeatures
+			{
+				MATERIAL_NORMAL_MAP = 1 << 0
+			};
+			//the pipelines of the materials, one per combination of features that the scene uses
+			render::PipelineVariants m_pipelineVariants;
+
 			render::Texture* m_placeholder;
 			std::vector<render::Texture*> globalTextures;
 			std::vector<render::Texture*> modelsTextures;
@@ -73,6 +84,8 @@ namespace engine
 			render::Buffer* sceneVertexUniformBuffer;
 			render::Buffer* sceneFragmentUniformBuffer = nullptr;
 			std::vector<render::Buffer*> individualFragmentUniformBuffers;
+			//bindless, the materials in one storage buffer that the shaders index with the push constants of each object
+			render::Buffer* materialsBuffer = nullptr;
 
 			std::vector<bool> areTransparents;//TODO store all uniform data in an array because maybe we want to modify it at runtime
 
@@ -98,6 +111,13 @@ namespace engine
 
 			bool useShadows = false;
 			bool m_deferred = false;
+			//forward materials read from the bindless table of the device when it has one, all objects share its descriptor set
+			bool m_bindless = false;
+			bool optimizeMeshes = false;
+			bool generateLods = false;
+			uint32_t lodCount = 4;
+			//keep the loaded MeshData in RenderObject::m_meshesData, for CPU side work like software occlusion
+			bool keepMeshData = false;
 
 			SceneLoaderGltf::~SceneLoaderGltf();
 
@@ -115,6 +135,11 @@ namespace engine
 
 			void LoadMaterials(tinygltf::Model& input, bool deferred = false);
 
+			void LoadBindlessMaterials(tinygltf::Model& input);
+
+			/** @brief Pushes the material and the buffers of the table for every geometry, after the nodes are loaded */
+			void InitBindlessConstants();
+
 			void LoadNode(const tinygltf::Node& inputNode, glm::mat4 parentMatrix, const tinygltf::Model& input);
 
 			std::vector<RenderObject*> LoadFromFile(const std::string& foldername, const std::string& filename, float scale,
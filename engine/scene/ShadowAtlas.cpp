@@ -0,0 +1,362 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "ShadowAtlas.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		uint32_t ShadowAtlas::RoundUpToPowerOfTwo(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result < value)
+				result <<= 1;
+			return result;
+		}
+
+		void ShadowAtlas::Init(uint32_t size, uint32_t minTileSize)
+		{
+			m_size = RoundUpToPowerOfTwo(size);
+			m_minTileSize = std::min(RoundUpToPowerOfTwo(minTileSize), m_size);
+			Clear();
+		}
+
+		void ShadowAtlas::Clear()
+		{
+			uint32_t levels = 1;
+			for (uint32_t size = m_size; size > m_minTileSize; size >>= 1)
+				levels++;
+			m_freeTiles.assign(levels, std::vector<FreeTile>());
+			m_freeTiles[0].push_back({ 0, 0 });
+			m_usedArea = 0;
+		}
+
+		uint32_t ShadowAtlas::GetLevel(uint32_t size) const
+		{
+			uint32_t level = 0;
+			for (uint32_t levelSize = m_size; levelSize > size && level + 1 < m_freeTiles.size(); levelSize >>= 1)
+				level++;
+			return level;
+		}
+
+		bool ShadowAtlas::Allocate(uint32_t size, ShadowAtlasTile& tile)
+		{
+			size = std::max(RoundUpToPowerOfTwo(size), m_minTileSize);
+			if (size > m_size)
+				return false;
+
+			//the smallest free tile that is at least as big
+			uint32_t level = GetLevel(size);
+			int32_t freeLevel = static_cast<int32_t>(level);
+			while (freeLevel >= 0 && m_freeTiles[freeLevel].empty())
+				freeLevel--;
+			if (freeLevel < 0)
+				return false;
+
+			FreeTile freeTile = m_freeTiles[freeLevel].back();
+			m_freeTiles[freeLevel].pop_back();
+			//keeps the first quarter of every split and frees the other three
+			for (uint32_t l = static_cast<uint32_t>(freeLevel); l < level; l++)
+			{
+				uint32_t quarter = m_size >> (l + 1);
+				m_freeTiles[l + 1].push_back({ freeTile.x + quarter, freeTile.y });
+				m_freeTiles[l + 1].push_back({ freeTile.x, freeTile.y + quarter });
+				m_freeTiles[l + 1].push_back({ freeTile.x + quarter, freeTile.y + quarter });
+			}
+
+			tile.x = freeTile.x;
+			tile.y = freeTile.y;
+			tile.size = size;
+			m_usedArea += uint64_t(size) * size;
+			return true;
+		}
+
+		bool ShadowAtlas::TakeFreeTile(uint32_t level, uint32_t x, uint32_t y)
+		{
+			std::vector<FreeTile>& tiles = m_freeTiles[level];
+			for (size_t i = 0; i < tiles.size(); i++)
+			{
+				if (tiles[i].x == x && tiles[i].y == y)
+				{
+					tiles[i] = tiles.back();
+					tiles.pop_back();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void ShadowAtlas::Free(const ShadowAtlasTile& tile)
+		{
+			if (!tile.IsValid())
+				return;
+			m_usedArea -= uint64_t(tile.size) * tile.size;
+
+			uint32_t level = GetLevel(tile.size);
+			uint32_t size = tile.size;
+			uint32_t x = tile.x;
+			uint32_t y = tile.y;
+			while (level > 0)
+			{
+				//the four quarters of the parent become one free tile again when the other three are free too
+				uint32_t parentX = x & ~(2 * size - 1);
+				uint32_t parentY = y & ~(2 * size - 1);
+				FreeTile siblings[3];
+				uint32_t count = 0;
+				for (uint32_t q = 0; q < 4; q++)
+				{
+					FreeTile quarter = { parentX + (q & 1) * size, parentY + (q >> 1) * size };
+					if (quarter.x != x || quarter.y != y)
+						siblings[count++] = quarter;
+				}
+
+				const std::vector<FreeTile>& tiles = m_freeTiles[level];
+				bool allFree = true;
+				for (uint32_t s = 0; s < 3 && allFree; s++)
+				{
+					allFree = std::find_if(tiles.begin(), tiles.end(), [&](const FreeTile& t) { return t.x == siblings[s].x && t.y == siblings[s].y; }) != tiles.end();
+				}
+				if (!allFree)
+					break;
+
+				for (uint32_t s = 0; s < 3; s++)
+					TakeFreeTile(level, siblings[s].x, siblings[s].y);
+				x = parentX;
+				y = parentY;
+				size *= 2;
+				level--;
+			}
+			m_freeTiles[level].push_back({ x, y });
+		}
+
+		glm::vec4 ShadowAtlas::GetUVTransform(const ShadowAtlasTile& tile) const
+		{
+			float scale = float(tile.size) / float(m_size);
+			return glm::vec4(scale, scale, float(tile.x) / float(m_size), float(tile.y) / float(m_size));
+		}
+
+		bool ShadowLight::IsReady() const
+		{
+			if (resolution == 0)
+				return false;
+			for (uint32_t f = 0; f < GetFaceCount(); f++)
+			{
+				if (!faces[f].valid)
+					return false;
+			}
+			return true;
+		}
+
+		void ShadowScheduler::Init(uint32_t atlasSize, uint32_t minResolution, uint32_t maxResolution, uint32_t viewsPerFrame)
+		{
+			m_atlas.Init(atlasSize, minResolution);
+			m_minResolution = m_atlas.GetMinTileSize();
+			m_maxResolution = std::max(std::min(ShadowAtlas::RoundUpToPowerOfTwo(maxResolution), m_atlas.GetSize()), m_minResolution);
+			m_viewsPerFrame = viewsPerFrame;
+			m_lights.clear();
+			m_updates.clear();
+		}
+
+		uint32_t ShadowScheduler::AddLight(const ShadowLight& light)
+		{
+			m_lights.push_back(light);
+			ShadowLight& added = m_lights.back();
+			added.resolution = 0;
+			for (auto& face : added.faces)
+				face = ShadowFace();
+			return static_cast<uint32_t>(m_lights.size() - 1);
+		}
+
+		uint32_t ShadowScheduler::GetResolution(const ShadowLight& light) const
+		{
+			//about one texel per pixel of the range on the screen
+			uint32_t diameter = static_cast<uint32_t>(std::min(2.0f * light.importance, float(m_maxResolution)));
+			uint32_t resolution = std::max(std::min(ShadowAtlas::RoundUpToPowerOfTwo(diameter), m_maxResolution), m_minResolution);
+			//one size smaller isn't worth rendering the faces again
+			if (light.resolution && resolution < light.resolution && resolution * 2 >= light.resolution)
+				return light.resolution;
+			return resolution;
+		}
+
+		void ShadowScheduler::FreeTiles(ShadowLight& light)
+		{
+			for (uint32_t f = 0; f < light.GetFaceCount(); f++)
+			{
+				m_atlas.Free(light.faces[f].tile);
+				light.faces[f] = ShadowFace();
+			}
+			light.resolution = 0;
+		}
+
+		bool ShadowScheduler::AllocateTiles(ShadowLight& light, uint32_t resolution)
+		{
+			uint32_t faceCount = light.GetFaceCount();
+			for (uint32_t f = 0; f < faceCount; f++)
+			{
+				ShadowFace& face = light.faces[f];
+				face = ShadowFace();
+				if (!m_atlas.Allocate(resolution, face.tile))
+				{
+					//all the faces or none
+					for (uint32_t allocated = 0; allocated < f; allocated++)
+					{
+						m_atlas.Free(light.faces[allocated].tile);
+						light.faces[allocated] = ShadowFace();
+					}
+					return false;
+				}
+			}
+			light.resolution = resolution;
+			m_statistics.reallocations += faceCount;
+			return true;
+		}
+
+		void ShadowScheduler::Schedule(const glm::vec3& cameraPosition, float projectionScale)
+		{
+			m_statistics = ShadowScheduleStatistics();
+			m_updates.clear();
+
+			for (auto& light : m_lights)
+			{
+				float distance = glm::length(light.position - cameraPosition);
+				light.importance = projectionScale * light.range / std::max(distance, light.range);
+			}
+
+			std::vector<uint32_t> order(m_lights.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_lights[a].importance > m_lights[b].importance; });
+
+			//the lights that got smaller give their tiles back first, so the smaller tiles can be taken from them
+			std::vector<uint32_t> wanted(m_lights.size());
+			for (uint32_t i : order)
+			{
+				wanted[i] = GetResolution(m_lights[i]);
+				if (m_lights[i].resolution > wanted[i])
+					FreeTiles(m_lights[i]);
+			}
+
+			for (size_t p = 0; p < order.size(); p++)
+			{
+				ShadowLight& light = m_lights[order[p]];
+				uint32_t resolution = wanted[order[p]];
+				if (light.resolution)
+				{
+					//a light that got bigger only moves into bigger tiles that are free, otherwise it keeps the ones it has
+					if (resolution > light.resolution)
+					{
+						ShadowLight grown = light;
+						if (AllocateTiles(grown, resolution))
+						{
+							for (uint32_t f = 0; f < light.GetFaceCount(); f++)
+								m_atlas.Free(light.faces[f].tile);
+							light = grown;
+						}
+					}
+					continue;
+				}
+				while (!AllocateTiles(light, resolution))
+				{
+					//the least important light that has tiles gives them up, then this light gets smaller
+					bool evicted = false;
+					for (size_t q = order.size() - 1; q > p && !evicted; q--)
+					{
+						if (m_lights[order[q]].resolution)
+						{
+							FreeTiles(m_lights[order[q]]);
+							evicted = true;
+						}
+					}
+					if (evicted)
+						continue;
+					if (resolution <= m_minResolution)
+						break;
+					resolution /= 2;
+				}
+			}
+
+			std::vector<ShadowView> candidates;
+			for (uint32_t i = 0; i < m_lights.size(); i++)
+			{
+				ShadowLight& light = m_lights[i];
+				if (!light.resolution)
+				{
+					light.castersChanged = false;
+					m_statistics.lightsWithoutShadow++;
+					continue;
+				}
+				m_statistics.shadowedLights++;
+				for (uint32_t f = 0; f < light.GetFaceCount(); f++)
+				{
+					ShadowFace& face = light.faces[f];
+					if (!face.valid || light.castersChanged || face.renderedPosition != light.position ||
+						(light.type == SHADOW_LIGHT_SPOT && face.renderedDirection != light.direction))
+						face.dirty = true;
+					m_statistics.views++;
+					if (face.dirty)
+					{
+						ShadowView view;
+						view.light = i;
+						view.face = f;
+						candidates.push_back(view);
+					}
+				}
+				light.castersChanged = false;
+			}
+			m_statistics.dirtyViews = static_cast<uint32_t>(candidates.size());
+
+			//a new tile shows nothing until it is rendered, then the important lights and the ones that waited long
+			auto score = [this](const ShadowView& view) {
+				const ShadowLight& light = m_lights[view.light];
+				return light.importance * float(light.faces[view.face].age + 1);
+			};
+			std::stable_sort(candidates.begin(), candidates.end(), [&](const ShadowView& a, const ShadowView& b) {
+				bool validA = m_lights[a.light].faces[a.face].valid;
+				bool validB = m_lights[b.light].faces[b.face].valid;
+				if (validA != validB)
+					return !validA;
+				return score(a) > score(b);
+			});
+
+			for (size_t c = 0; c < candidates.size(); c++)
+			{
+				ShadowLight& light = m_lights[candidates[c].light];
+				ShadowFace& face = light.faces[candidates[c].face];
+				if (c < m_viewsPerFrame)
+				{
+					//counts as rendered from now on, the application renders every view of m_updates this frame
+					m_updates.push_back(candidates[c]);
+					face.valid = true;
+					face.dirty = false;
+					face.age = 0;
+					face.renderedPosition = light.position;
+					face.renderedDirection = light.direction;
+				}
+				else
+					face.age++;
+			}
+			m_statistics.updatedViews = static_cast<uint32_t>(m_updates.size());
+			if (m_atlas.GetSize())
+				m_statistics.atlasUsage = float(double(m_atlas.GetUsedArea()) / (double(m_atlas.GetSize()) * m_atlas.GetSize()));
+		}
+
+		glm::mat4 ShadowScheduler::GetViewProjection(uint32_t lightIndex, uint32_t face) const
+		{
+			const ShadowLight& light = m_lights[lightIndex];
+			if (light.type == SHADOW_LIGHT_SPOT)
+			{
+				glm::vec3 direction = glm::normalize(light.direction);
+				glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				return glm::perspective(2.0f * light.angle, 1.0f, m_nearPlane, light.range) * glm::lookAt(light.position, light.position + direction, up);
+			}
+
+			//the faces of a cube map, +x -x +y -y +z -z
+			static const glm::vec3 directions[6] = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+			static const glm::vec3 ups[6] = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+			return glm::perspective(glm::radians(90.0f), 1.0f, m_nearPlane, light.range) * glm::lookAt(light.position, light.position + directions[face], ups[face]);
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		struct ShadowAtlasTile
+		{
+			uint32_t x = 0;
+			uint32_t y = 0;
+			uint32_t size = 0;//0 when nothing was allocated
+
+			bool IsValid() const { return size > 0; }
+		};
+
+		/** @brief Splits a square power of two depth texture like a quadtree, every tile is a power of two and a quarter of a tile
+		 *  one level up. Allocate takes the smallest free tile that fits and splits bigger ones to get it, Free joins the four
+		 *  quarters of a tile again once all of them are free. It only does the bookkeeping, it never touches a texture */
+		class ShadowAtlas
+		{
+		public:
+			void Init(uint32_t size, uint32_t minTileSize);
+			/** @brief The size is rounded up to a power of two, false when there is no free tile that big */
+			bool Allocate(uint32_t size, ShadowAtlasTile& tile);
+			void Free(const ShadowAtlasTile& tile);
+			void Clear();
+
+			uint32_t GetSize() const { return m_size; }
+			uint32_t GetMinTileSize() const { return m_minTileSize; }
+			uint64_t GetUsedArea() const { return m_usedArea; }
+			/** @brief Scale in xy and offset in zw from the [0,1] coordinates of a shadow map to the ones of its tile in the atlas */
+			glm::vec4 GetUVTransform(const ShadowAtlasTile& tile) const;
+
+			static uint32_t RoundUpToPowerOfTwo(uint32_t value);
+
+		private:
+			struct FreeTile
+			{
+				uint32_t x;
+				uint32_t y;
+			};
+
+			uint32_t m_size = 0;
+			uint32_t m_minTileSize = 0;
+			uint64_t m_usedArea = 0;
+			std::vector<std::vector<FreeTile>> m_freeTiles;//per level, level 0 is the whole atlas
+
+			uint32_t GetLevel(uint32_t size) const;
+			bool TakeFreeTile(uint32_t level, uint32_t x, uint32_t y);
+		};
+
+		enum ShadowLightType
+		{
+			SHADOW_LIGHT_SPOT,//one view
+			SHADOW_LIGHT_POINT//six views, the faces of a cube
+		};
+
+		struct ShadowFace
+		{
+			ShadowAtlasTile tile;
+			bool valid = false;//rendered into its tile, a new tile has to be rendered before it is sampled
+			bool dirty = true;//the light moved or its casters changed since it was rendered
+			uint32_t age = 0;//frames it waited since it got dirty
+			glm::vec3 renderedPosition = glm::vec3(0.0f);
+			glm::vec3 renderedDirection = glm::vec3(0.0f);
+		};
+
+		struct ShadowLight
+		{
+			ShadowLightType type = SHADOW_LIGHT_POINT;
+			glm::vec3 position = glm::vec3(0.0f);
+			glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);//of a spot light
+			float range = 10.0f;
+			float angle = glm::radians(45.0f);//half of the cone of a spot light
+			bool castersChanged = false;//set when something moved inside the range, Schedule clears it
+
+			//from Schedule
+			float importance = 0.0f;//the radius of the range on the screen, in pixels
+			uint32_t resolution = 0;//of every face, 0 when the light has no shadow
+			ShadowFace faces[6];
+
+			uint32_t GetFaceCount() const { return type == SHADOW_LIGHT_POINT ? 6 : 1; }
+			/** @brief Every face is rendered into its tile, until then the light is drawn without a shadow */
+			bool IsReady() const;
+		};
+
+		struct ShadowView
+		{
+			uint32_t light = 0;
+			uint32_t face = 0;
+		};
+
+		struct ShadowScheduleStatistics
+		{
+			uint32_t shadowedLights = 0;
+			uint32_t lightsWithoutShadow = 0;//didn't fit in the atlas
+			uint32_t views = 0;
+			uint32_t dirtyViews = 0;//before this frame's updates
+			uint32_t updatedViews = 0;
+			uint32_t reallocations = 0;//faces that got a new tile
+			float atlasUsage = 0.0f;
+		};
+
+		/** @brief Shadows of many spot and point lights in one atlas. Every frame the lights get a resolution from how big their
+		 *  range is on the screen, keep their tiles while it stays about the same, and the most important ones take the atlas
+		 *  first. Only the faces whose light moved, whose casters changed or whose tile is new are rendered, at most
+		 *  m_viewsPerFrame of them, the most important and the ones that waited the longest first */
+		class ShadowScheduler
+		{
+		public:
+			std::vector<ShadowLight> m_lights;
+			std::vector<ShadowView> m_updates;//the faces to render this frame, valid after Schedule
+			ShadowScheduleStatistics m_statistics;
+			ShadowAtlas m_atlas;
+			uint32_t m_viewsPerFrame = 4;
+			float m_nearPlane = 0.05f;
+
+			void Init(uint32_t atlasSize, uint32_t minResolution, uint32_t maxResolution, uint32_t viewsPerFrame);
+			uint32_t AddLight(const ShadowLight& light);
+
+			/** @brief projectionScale is the viewport height / (2 * tan(fov / 2)) */
+			void Schedule(const glm::vec3& cameraPosition, float projectionScale);
+
+			/** @brief The view and projection a face is rendered with, a cube face of a point light is a 90 degrees view */
+			glm::mat4 GetViewProjection(uint32_t light, uint32_t face) const;
+
+		private:
+			uint32_t m_minResolution = 64;
+			uint32_t m_maxResolution = 1024;
+
+			uint32_t GetResolution(const ShadowLight& light) const;
+			void FreeTiles(ShadowLight& light);
+			bool AllocateTiles(ShadowLight& light, uint32_t resolution);
+		};
+	}
+}
@@ -164,6 +164,17 @@ namespace engine
 
 					m_boundingBoxes.push_back(box);
 
+					if (m_optimizeMeshes)
+						MeshOptimizer::Optimize(geometry, vertex_layout);
+
+					//the geometries are added in the returned order after the ones already in the model
+					if (m_generateLods)
+					{
+						LodChain chain;
+						MeshSimplifier::GenerateLods(geometry, vertex_layout, chain, m_lodCount);
+						SetGeometryLods(static_cast<uint32_t>(m_geometries.size()) + i, chain);
+					}
+
 					returnVector[i] = geometry;
 				}
 			}
@@ -1,5 +1,6 @@
 #pragma once
 #include "RenderObject.h"
+#include "MeshOptimizer.h"
 
 #include <assimp/Importer.hpp> 
 #include <assimp/scene.h>     
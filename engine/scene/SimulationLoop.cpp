@@ -0,0 +1,157 @@
+#include "SimulationLoop.h"
+
+namespace engine
+{
+	namespace scene
+	{
+		template <class Duration>
+		static Duration ToDuration(double seconds)
+		{
+			return std::chrono::duration_cast<Duration>(std::chrono::duration<double>(seconds));
+		}
+
+		void SimulationLoop::Start(float step, TickFunction tick, bool threaded)
+		{
+			Stop();
+			m_tick = tick;
+			m_step = step > 0.0f ? step : 1.0f / 60.0f;
+			m_threaded = threaded;
+			m_paused = false;
+			m_stop = false;
+			m_time = 0.0;
+			m_clock = 0.0;
+			m_ticks = 0;
+			m_droppedTicks = 0;
+			m_running = true;
+			if (m_threaded)
+			{
+				m_start = Clock::now();
+				m_thread = std::thread(&SimulationLoop::ThreadLoop, this);
+			}
+		}
+
+		void SimulationLoop::Stop()
+		{
+			if (!m_running)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_condition.notify_all();
+			if (m_thread.joinable())
+				m_thread.join();
+			m_running = false;
+		}
+
+		void SimulationLoop::RunTick(double time)
+		{
+			Clock::time_point begin = Clock::now();
+			m_tick(m_step, time);
+			float cost = static_cast<float>(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_time = time;
+			m_ticks++;
+			m_tickCost = cost;
+		}
+
+		void SimulationLoop::ThreadLoop()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_stop)
+			{
+				if (m_paused)
+				{
+					m_condition.wait(lock);
+					continue;
+				}
+				Clock::time_point due = m_start + ToDuration<Clock::duration>(m_time + m_step);
+				Clock::time_point now = Clock::now();
+				if (now < due)
+				{
+					m_condition.wait_until(lock, due);
+					continue;
+				}
+				//too far behind to catch up, the ticks that were missed are skipped
+				double lag = std::chrono::duration<double>(now - due).count();
+				if (lag > m_step * m_maxCatchUpTicks)
+				{
+					uint64_t dropped = static_cast<uint64_t>(lag / m_step);
+					m_start += ToDuration<Clock::duration>(dropped * m_step);
+					m_droppedTicks += dropped;
+				}
+				double time = m_time + m_step;
+				lock.unlock();
+				RunTick(time);
+				lock.lock();
+			}
+		}
+
+		void SimulationLoop::Advance(float dt)
+		{
+			if (!m_running || m_threaded || m_paused)
+				return;
+			m_clock += dt;
+			uint32_t ticks = 0;
+			//the epsilon keeps a frame time equal to the step at one tick per frame
+			while (m_time + m_step <= m_clock + 1e-9)
+			{
+				if (ticks == m_maxCatchUpTicks)
+				{
+					uint64_t dropped = static_cast<uint64_t>((m_clock - m_time) / m_step);
+					m_clock -= dropped * m_step;
+					m_droppedTicks += dropped;
+					break;
+				}
+				RunTick(m_time + m_step);
+				ticks++;
+			}
+		}
+
+		void SimulationLoop::SetPaused(bool paused)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (paused == m_paused)
+					return;
+				m_paused = paused;
+				if (m_threaded)
+				{
+					//the paused time is not simulated
+					if (paused)
+						m_pauseStart = Clock::now();
+					else
+						m_start += Clock::now() - m_pauseStart;
+				}
+			}
+			m_condition.notify_all();
+		}
+
+		double SimulationLoop::GetRenderTime() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_threaded)
+				return m_clock - m_step;
+			Clock::time_point now = m_paused ? m_pauseStart : Clock::now();
+			return std::chrono::duration<double>(now - m_start).count() - m_step;
+		}
+
+		uint64_t SimulationLoop::GetTickCount() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_ticks;
+		}
+
+		uint64_t SimulationLoop::GetDroppedTickCount() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_droppedTicks;
+		}
+
+		float SimulationLoop::GetTickCost() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_tickCost;
+		}
+	}
+}
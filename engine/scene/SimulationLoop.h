@@ -0,0 +1,127 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdint.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief Hands the state of the simulation ticks to the renderer, the simulation writes the next snapshot while the renderer
+		 *  reads the last two published ones, only publishing and reading take the lock */
+		template <class T>
+		class SimulationSnapshots
+		{
+			T m_snapshots[3];
+			double m_times[3] = { 0.0, 0.0, 0.0 };
+			uint32_t m_previous = 0;
+			uint32_t m_current = 1;
+			uint32_t m_write = 2;
+			uint32_t m_published = 0;
+			std::mutex m_mutex;
+
+		public:
+			/** @brief The snapshot of the tick being simulated, only for the simulation */
+			T& Write() { return m_snapshots[m_write]; }
+
+			/** @brief Makes the written snapshot the current one, time is the simulation time at the end of the tick */
+			void Publish(double time)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_times[m_write] = time;
+				uint32_t freed = m_previous;
+				m_previous = m_current;
+				m_current = m_write;
+				m_write = freed;
+				m_published++;
+			}
+
+			/** @brief Calls read(previous, current, alpha) with the blend factor of the render time between the two newest snapshots,
+			 *  a single published snapshot is passed as both, returns false before the first one */
+			template <class F>
+			bool Read(double renderTime, F read)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_published == 0)
+					return false;
+				const T& current = m_snapshots[m_current];
+				if (m_published == 1)
+				{
+					read(current, current, 1.0f);
+					return true;
+				}
+				double span = m_times[m_current] - m_times[m_previous];
+				float alpha = span > 0.0 ? static_cast<float>((renderTime - m_times[m_previous]) / span) : 1.0f;
+				read(m_snapshots[m_previous], current, std::min(std::max(alpha, 0.0f), 1.0f));
+				return true;
+			}
+		};
+
+		/** @brief Runs the simulation of an example with a fixed step, on its own thread or on the calling thread.
+		 *  The ticks follow the wall clock when threaded and the frame times passed to Advance otherwise,
+		 *  the renderer draws one step behind and interpolates between the snapshots around that time */
+		class SimulationLoop
+		{
+		public:
+			/** @brief Simulates one step, time is the simulation time at the end of the step */
+			typedef std::function<void(float step, double time)> TickFunction;
+
+		private:
+			typedef std::chrono::high_resolution_clock Clock;
+
+			TickFunction m_tick;
+			float m_step = 1.0f / 60.0f;
+			bool m_threaded = false;
+			bool m_running = false;
+			bool m_paused = false;
+			bool m_stop = false;
+
+			//end time of the last simulated tick and the number of ticks
+			double m_time = 0.0;
+			uint64_t m_ticks = 0;
+			uint64_t m_droppedTicks = 0;
+			float m_tickCost = 0.0f;
+
+			//threaded, the wall clock time of the simulation time 0, moved forward by the pauses and the dropped ticks
+			Clock::time_point m_start;
+			Clock::time_point m_pauseStart;
+			//not threaded, the sum of the frame times
+			double m_clock = 0.0;
+
+			std::thread m_thread;
+			mutable std::mutex m_mutex;
+			std::condition_variable m_condition;
+
+			void ThreadLoop();
+			void RunTick(double time);
+
+		public:
+			/** @brief Ticks that are further behind than this are dropped instead of simulated */
+			uint32_t m_maxCatchUpTicks = 5;
+
+			void Start(float step, TickFunction tick, bool threaded);
+			/** @brief Waits for the tick in progress and joins the thread */
+			void Stop();
+			/** @brief Runs the ticks that fit in dt on the calling thread, does nothing when threaded */
+			void Advance(float dt);
+			void SetPaused(bool paused);
+
+			/** @brief Simulation time to render, one step behind the newest tick that can be done */
+			double GetRenderTime() const;
+
+			bool IsRunning() const { return m_running; }
+			bool IsThreaded() const { return m_threaded; }
+			float GetStep() const { return m_step; }
+			uint64_t GetTickCount() const;
+			uint64_t GetDroppedTickCount() const;
+			/** @brief Milliseconds of the last tick */
+			float GetTickCost() const;
+
+			~SimulationLoop() { Stop(); }
+		};
+	}
+}
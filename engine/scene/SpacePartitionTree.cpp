@@ -246,6 +246,10 @@ namespace engine
 						glm::vec3 max(m_boundries[0].x + sizeonx * (x+1),
 							m_boundries[0].y + sizeonx * (y+1),
 							m_boundries[0].z + sizeonx * (z+1));
+						//the last division ends exactly on the parent, otherwise rounding leaves a gap where an object is in no child
+						if (x + 1 == divisions) max.x = m_boundries[1].x;
+						if (y + 1 == divisions) max.y = m_boundries[1].y;
+						if (z + 1 == divisions) max.z = m_boundries[1].z;
 						tree->m_boundries.push_back(max);
 
 						m_children.push_back(tree);
@@ -341,6 +345,139 @@ namespace engine
 			}
 		}
 
+		FrustumClassification SpacePartitionTree::ClassifyFrustum(const glm::vec4* planes, float margin) const
+		{
+			glm::vec3 boundsMin = m_boundries[0] - glm::vec3(margin);
+			glm::vec3 boundsMax = m_boundries[1] + glm::vec3(margin);
+			FrustumClassification result = FRUSTUM_INSIDE;
+			for (int i = 0; i < 6; ++i)
+			{
+				//the corners farthest along and against the plane normal
+				glm::vec3 positive(planes[i].x >= 0.0f ? boundsMax.x : boundsMin.x, planes[i].y >= 0.0f ? boundsMax.y : boundsMin.y, planes[i].z >= 0.0f ? boundsMax.z : boundsMin.z);
+				glm::vec3 negative(planes[i].x >= 0.0f ? boundsMin.x : boundsMax.x, planes[i].y >= 0.0f ? boundsMin.y : boundsMax.y, planes[i].z >= 0.0f ? boundsMin.z : boundsMax.z);
+				if (positive.x * planes[i].x + positive.y * planes[i].y + positive.z * planes[i].z + planes[i].w < 0.0f)
+					return FRUSTUM_OUTSIDE;
+				if (negative.x * planes[i].x + negative.y * planes[i].y + negative.z * planes[i].z + planes[i].w < 0.0f)
+					result = FRUSTUM_INTERSECT;
+			}
+			return result;
+		}
+
+		void SpacePartitionTree::CollectObjects(std::vector<uint32_t>& indices) const
+		{
+			if (m_hasActiveChildren)
+			{
+				for (auto child : m_children)
+				{
+					child->CollectObjects(indices);
+				}
+			}
+			else
+			{
+				for (auto obj : m_objects)
+				{
+					indices.push_back(obj->GetIndex());
+				}
+			}
+		}
+
+		void SpacePartitionTree::GatherVisibleObjects(glm::vec4* planes, float margin, std::vector<uint32_t>& indices, VisibilityStatistics* statistics)
+		{
+			if (statistics)
+				statistics->nodesVisited++;
+
+			FrustumClassification classification = ClassifyFrustum(planes, margin);
+			if (classification == FRUSTUM_OUTSIDE)
+				return;
+
+			if (classification == FRUSTUM_INSIDE)
+			{
+				if (statistics)
+					statistics->nodesInside++;
+				CollectObjects(indices);
+				return;
+			}
+
+			if (m_hasActiveChildren)
+			{
+				for (auto child : m_children)
+				{
+					child->GatherVisibleObjects(planes, margin, indices, statistics);
+				}
+			}
+			else
+			{
+				for (auto obj : m_objects)
+				{
+					if (statistics)
+						statistics->objectsTested++;
+					if (obj->FrustumIntersect(planes))
+						indices.push_back(obj->GetIndex());
+				}
+			}
+		}
+
+		void SpacePartitionTree::GetVisibleObjects(glm::vec4* planes, std::vector<uint32_t>& indices, float margin, ThreadPool* threadPool, VisibilityStatistics* statistics)
+		{
+			indices.clear();
+			VisibilityStatistics total;
+
+			//split the intersecting nodes until there are enough subtrees for the threads, the rest of the traversal runs in parallel
+			uint32_t threadCount = threadPool ? static_cast<uint32_t>(threadPool->threads.size()) : 1;
+			std::vector<SpacePartitionTree*> subtrees(1, this);
+			while (threadCount > 1 && subtrees.size() < 4 * threadCount)
+			{
+				std::vector<SpacePartitionTree*> split;
+				bool expanded = false;
+				for (auto node : subtrees)
+				{
+					if (!node->m_hasActiveChildren)
+					{
+						split.push_back(node);
+						continue;
+					}
+					FrustumClassification classification = node->ClassifyFrustum(planes, margin);
+					if (classification == FRUSTUM_INSIDE)
+					{
+						//left to a job which classifies it again
+						split.push_back(node);
+						continue;
+					}
+					total.nodesVisited++;
+					if (classification == FRUSTUM_INTERSECT)
+					{
+						split.insert(split.end(), node->m_children.begin(), node->m_children.end());
+						expanded = true;
+					}
+				}
+				subtrees.swap(split);
+				if (!expanded)
+					break;
+			}
+
+			std::vector<std::vector<uint32_t>> subtreeIndices(subtrees.size());
+			std::vector<VisibilityStatistics> subtreeStatistics(subtrees.size());
+			auto gather = [&](uint32_t job) {
+				subtrees[job]->GatherVisibleObjects(planes, margin, subtreeIndices[job], &subtreeStatistics[job]);
+			};
+			if (threadPool)
+				threadPool->runJobs(static_cast<uint32_t>(subtrees.size()), gather);
+			else
+				for (uint32_t job = 0; job < subtrees.size(); job++)
+					gather(job);
+
+			for (size_t i = 0; i < subtrees.size(); i++)
+			{
+				indices.insert(indices.end(), subtreeIndices[i].begin(), subtreeIndices[i].end());
+				total.nodesVisited += subtreeStatistics[i].nodesVisited;
+				total.nodesInside += subtreeStatistics[i].nodesInside;
+				total.objectsTested += subtreeStatistics[i].objectsTested;
+			}
+			total.objectsVisible = static_cast<uint32_t>(indices.size());
+			if (statistics)
+				*statistics = total;
+		}
+
 		void SpacePartitionTree::DestroyChildren()
 		{
 			m_hasActiveChildren = false;
@@ -1,6 +1,7 @@
 #pragma once
 //#include "Geometry.h"
 #include "BoundingObject.h"
+#include "threadpool.hpp"
 #include <glm/glm.hpp>
 #include <list>
 
@@ -8,6 +9,22 @@ namespace engine
 {
 	namespace scene
 	{
+		enum FrustumClassification
+		{
+			FRUSTUM_OUTSIDE = 0,
+			FRUSTUM_INTERSECT,
+			FRUSTUM_INSIDE
+		};
+
+		struct VisibilityStatistics
+		{
+			uint32_t nodesVisited = 0;
+			//subtrees fully inside the frustum, their objects are not tested
+			uint32_t nodesInside = 0;
+			uint32_t objectsTested = 0;
+			uint32_t objectsVisible = 0;
+		};
+
 		class SpacePartitionTree
 		{
 		public://TODO maybe not
@@ -53,6 +70,19 @@ namespace engine
 
 			void TestVisibility(glm::vec4* frustum_planes);
 
+			/** @brief Node bounds grown by margin against the frustum planes */
+			FrustumClassification ClassifyFrustum(const glm::vec4* planes, float margin = 0.0f) const;
+
+			/** @brief Appends the indices of the subtree objects */
+			void CollectObjects(std::vector<uint32_t>& indices) const;
+
+			/** @brief Appends the indices of the visible subtree objects, subtrees fully inside the frustum are taken without testing their objects */
+			void GatherVisibleObjects(glm::vec4* planes, float margin, std::vector<uint32_t>& indices, VisibilityStatistics* statistics = nullptr);
+
+			/** @brief Visible object indices in tree order, the visibility flags of the objects are left alone.
+			 *  The subtrees are spread over the thread pool. Objects are stored by center, margin is the biggest object size so objects sticking out of an outside node are kept */
+			void GetVisibleObjects(glm::vec4* planes, std::vector<uint32_t>& indices, float margin = 0.0f, ThreadPool* threadPool = nullptr, VisibilityStatistics* statistics = nullptr);
+
 			void DestroyChildren();
 
 			~SpacePartitionTree();
@@ -0,0 +1,450 @@
+#include "SparseSdf.h"
+#include "Timer.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		static const char s_magic[4] = { 'S', 'D', 'F', 'B' };
+		static const uint32_t s_version = 1;
+		static const uint32_t s_brickSamples = SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE;
+
+		struct SparseSdfHeader
+		{
+			char magic[4];
+			uint32_t version;
+			float boundsMin[3];
+			float voxelSize;
+			uint32_t cellCount[3];
+			float band;
+			float maxDistance;
+			uint32_t brickSlots;
+		};
+
+		static void RunJobs(ThreadPool* threadPool, uint32_t jobCount, const std::function<void(uint32_t job)>& function)
+		{
+			if (threadPool)
+			{
+				threadPool->runJobs(jobCount, function);
+				return;
+			}
+			for (uint32_t job = 0; job < jobCount; job++)
+				function(job);
+		}
+
+		static float Angle(glm::vec3 u, glm::vec3 v)
+		{
+			float lengths = glm::length(u) * glm::length(v);
+			if (lengths <= 0.0f)
+				return 0.0f;
+			return acosf(glm::clamp(glm::dot(u, v) / lengths, -1.0f, 1.0f));
+		}
+
+		void SdfMesh::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+		{
+			m_positions = positions;
+			m_indices.assign(indices.begin(), indices.begin() + (indices.size() - indices.size() % 3));
+			m_bvh.Build(m_positions, m_indices);
+
+			//the loaders split vertices on uv and normal seams, the pseudo normals need the vertices welded by position
+			std::vector<uint32_t> order(m_positions.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+				const glm::vec3& pa = m_positions[a];
+				const glm::vec3& pb = m_positions[b];
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				return pa.z < pb.z;
+			});
+			std::vector<uint32_t> welded(m_positions.size());
+			uint32_t uniqueCount = 0;
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				if (i > 0 && m_positions[order[i]] != m_positions[order[i - 1]])
+					uniqueCount++;
+				welded[order[i]] = uniqueCount;
+			}
+			uniqueCount++;
+
+			uint32_t triangleCount = static_cast<uint32_t>(m_indices.size() / 3);
+			std::vector<glm::vec3> vertexNormals(uniqueCount, glm::vec3(0.0f));
+			std::unordered_map<uint64_t, glm::vec3> edgeNormals;
+			auto edgeKey = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a; };
+			m_normals.resize(triangleCount);
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				uint32_t w[3] = { welded[m_indices[t * 3]], welded[m_indices[t * 3 + 1]], welded[m_indices[t * 3 + 2]] };
+				glm::vec3 p[3] = { m_positions[m_indices[t * 3]], m_positions[m_indices[t * 3 + 1]], m_positions[m_indices[t * 3 + 2]] };
+				glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+				float length = glm::length(n);
+				n = length > 0.0f ? n / length : glm::vec3(0.0f);
+				m_normals[t].normals[FEATURE_FACE] = n;
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					vertexNormals[w[c]] += n * Angle(p[(c + 1) % 3] - p[c], p[(c + 2) % 3] - p[c]);
+					edgeNormals[edgeKey(w[c], w[(c + 1) % 3])] += n;
+				}
+			}
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				uint32_t w[3] = { welded[m_indices[t * 3]], welded[m_indices[t * 3 + 1]], welded[m_indices[t * 3 + 2]] };
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					m_normals[t].normals[FEATURE_VERTEX0 + c] = vertexNormals[w[c]];
+					m_normals[t].normals[FEATURE_EDGE01 + c] = edgeNormals[edgeKey(w[c], w[(c + 1) % 3])];
+				}
+			}
+		}
+
+		float SdfMesh::Sign(glm::vec3 p, glm::vec3 closest, uint32_t triangle, uint32_t feature) const
+		{
+			return glm::dot(p - closest, m_normals[triangle].normals[feature]) < 0.0f ? -1.0f : 1.0f;
+		}
+
+		float SdfMesh::SignedDistance(glm::vec3 p) const
+		{
+			BvhClosestPoint closest;
+			if (!m_bvh.ClosestPoint(p, closest))
+				return FLT_MAX;
+			return sqrtf(closest.distanceSquared) * Sign(p, closest.point, closest.triangle, closest.feature);
+		}
+
+		float SdfMesh::SignedDistanceBruteForce(glm::vec3 p) const
+		{
+			BvhClosestPoint closest;
+			for (uint32_t t = 0; t < m_indices.size() / 3; t++)
+			{
+				uint32_t feature;
+				glm::vec3 q = Bvh::ClosestPointOnTriangle(p, m_positions[m_indices[t * 3]], m_positions[m_indices[t * 3 + 1]], m_positions[m_indices[t * 3 + 2]], feature);
+				float distanceSquared = glm::dot(p - q, p - q);
+				if (distanceSquared < closest.distanceSquared)
+				{
+					closest.point = q;
+					closest.distanceSquared = distanceSquared;
+					closest.triangle = t;
+					closest.feature = feature;
+				}
+			}
+			if (closest.triangle == UINT32_MAX)
+				return FLT_MAX;
+			return sqrtf(closest.distanceSquared) * Sign(p, closest.point, closest.triangle, closest.feature);
+		}
+
+		void SparseSdf::Init(glm::vec3 boundsMin, glm::vec3 boundsMax, float voxelSize, float band)
+		{
+			m_boundsMin = boundsMin;
+			m_voxelSize = voxelSize;
+			m_band = band > 0.0f ? band : voxelSize;
+			m_cellCount = glm::max(glm::uvec3(glm::ceil((boundsMax - boundsMin) / GetCellSize())), glm::uvec3(1));
+			m_indirection.assign(GetCellTotal(), SDF_EMPTY_BRICK);
+			m_cellDistances.assign(GetCellTotal(), m_maxDistance);
+			m_bricks.clear();
+			m_freeBricks.clear();
+		}
+
+		uint32_t SparseSdf::AllocateBrick()
+		{
+			if (!m_freeBricks.empty())
+			{
+				uint32_t brick = m_freeBricks.back();
+				m_freeBricks.pop_back();
+				return brick;
+			}
+			uint32_t slots = GetBrickSlots();
+			if (m_brickCapacity > 0 && slots == m_brickCapacity)
+				return SDF_EMPTY_BRICK;
+			m_bricks.resize(m_bricks.size() + s_brickSamples);
+			return slots;
+		}
+
+		SdfBakeStatistics SparseSdf::Bake(const DistanceFunction& distance, ThreadPool* threadPool, const std::vector<uint32_t>* cells)
+		{
+			Timer timer;
+			timer.start();
+			SdfBakeStatistics statistics;
+			std::vector<uint32_t> allCells;
+			if (!cells)
+			{
+				allCells.resize(GetCellTotal());
+				std::iota(allCells.begin(), allCells.end(), 0);
+				cells = &allCells;
+			}
+			const uint32_t cellCount = static_cast<uint32_t>(cells->size());
+			const float halfDiagonal = 0.5f * sqrtf(3.0f) * GetCellSize();
+
+			//the center distances decide which cells need a brick
+			const uint32_t CELLS_PER_JOB = 64;
+			std::vector<float> centers(cellCount);
+			RunJobs(threadPool, (cellCount + CELLS_PER_JOB - 1) / CELLS_PER_JOB, [&](uint32_t job) {
+				uint32_t end = std::min((job + 1) * CELLS_PER_JOB, cellCount);
+				for (uint32_t i = job * CELLS_PER_JOB; i < end; i++)
+					centers[i] = distance(GetCellCenter(GetCell((*cells)[i])));
+			});
+
+			//bricks are handed out in cell order, so the atlas doesn't depend on the thread count
+			std::vector<uint32_t> brickCells;
+			for (uint32_t i = 0; i < cellCount; i++)
+			{
+				uint32_t cell = (*cells)[i];
+				m_cellDistances[cell] = glm::clamp(centers[i], -m_maxDistance, m_maxDistance);
+				if (fabsf(centers[i]) <= halfDiagonal + m_band)
+				{
+					if (m_indirection[cell] == SDF_EMPTY_BRICK)
+						m_indirection[cell] = AllocateBrick();
+					if (m_indirection[cell] == SDF_EMPTY_BRICK)
+						statistics.bricksDropped++;
+					else
+						brickCells.push_back(cell);
+				}
+				else if (m_indirection[cell] != SDF_EMPTY_BRICK)
+				{
+					m_freeBricks.push_back(m_indirection[cell]);
+					m_indirection[cell] = SDF_EMPTY_BRICK;
+					statistics.bricksFreed++;
+				}
+			}
+
+			RunJobs(threadPool, static_cast<uint32_t>(brickCells.size()), [&](uint32_t job) {
+				uint32_t cell = brickCells[job];
+				float* samples = m_bricks.data() + (size_t)m_indirection[cell] * s_brickSamples;
+				glm::vec3 origin = m_boundsMin + glm::vec3(GetCell(cell)) * GetCellSize();
+				for (uint32_t z = 0; z < SDF_BRICK_SIZE; z++)
+					for (uint32_t y = 0; y < SDF_BRICK_SIZE; y++)
+						for (uint32_t x = 0; x < SDF_BRICK_SIZE; x++)
+							*samples++ = glm::clamp(distance(origin + glm::vec3(x, y, z) * m_voxelSize), -m_maxDistance, m_maxDistance);
+			});
+
+			timer.stop();
+			statistics.cellsBaked = cellCount;
+			statistics.bricksBaked = static_cast<uint32_t>(brickCells.size());
+			statistics.samples = cellCount + (uint64_t)brickCells.size() * s_brickSamples;
+			statistics.microseconds = timer.elapsedMicroseconds();
+			return statistics;
+		}
+
+		SdfBakeStatistics SparseSdf::Bake(const SdfMesh& mesh, ThreadPool* threadPool)
+		{
+			return Bake([&mesh](glm::vec3 p) { return mesh.SignedDistance(p); }, threadPool);
+		}
+
+		float SparseSdf::Sample(glm::vec3 p) const
+		{
+			glm::vec3 q = glm::clamp(p, m_boundsMin, GetBoundsMax());
+			float outside = glm::length(p - q);
+			glm::vec3 local = (q - m_boundsMin) / GetCellSize();
+			glm::uvec3 cell = glm::min(glm::uvec3(local), m_cellCount - glm::uvec3(1));
+			uint32_t index = GetCellIndex(cell);
+			uint32_t brick = m_indirection[index];
+			if (brick == SDF_EMPTY_BRICK)
+			{
+				//the surface is at least this far from anywhere in the cell
+				float d = m_cellDistances[index];
+				float bound = std::max(fabsf(d) - glm::length(q - GetCellCenter(cell)), 0.0f);
+				return (d < 0.0f ? -bound : bound) + outside;
+			}
+
+			glm::vec3 f = glm::clamp((local - glm::vec3(cell)) * float(SDF_BRICK_CELLS), glm::vec3(0.0f), glm::vec3(float(SDF_BRICK_CELLS)));
+			glm::uvec3 i = glm::min(glm::uvec3(f), glm::uvec3(SDF_BRICK_CELLS - 1));
+			glm::vec3 t = f - glm::vec3(i);
+			const float* s = GetBrick(brick) + i.x + SDF_BRICK_SIZE * (i.y + SDF_BRICK_SIZE * i.z);
+			const uint32_t dy = SDF_BRICK_SIZE;
+			const uint32_t dz = SDF_BRICK_SIZE * SDF_BRICK_SIZE;
+			float x00 = glm::mix(s[0], s[1], t.x);
+			float x10 = glm::mix(s[dy], s[dy + 1], t.x);
+			float x01 = glm::mix(s[dz], s[dz + 1], t.x);
+			float x11 = glm::mix(s[dz + dy], s[dz + dy + 1], t.x);
+			return glm::mix(glm::mix(x00, x10, t.y), glm::mix(x01, x11, t.y), t.z) + outside;
+		}
+
+		bool SparseSdf::Save(const std::string& filename) const
+		{
+			FILE* file = fopen(filename.c_str(), "wb");
+			if (!file)
+				return false;
+			SparseSdfHeader header;
+			memcpy(header.magic, s_magic, sizeof(s_magic));
+			header.version = s_version;
+			for (int i = 0; i < 3; i++)
+			{
+				header.boundsMin[i] = m_boundsMin[i];
+				header.cellCount[i] = m_cellCount[i];
+			}
+			header.voxelSize = m_voxelSize;
+			header.band = m_band;
+			header.maxDistance = m_maxDistance;
+			header.brickSlots = GetBrickSlots();
+			bool written = fwrite(&header, sizeof(header), 1, file) == 1
+				&& fwrite(m_indirection.data(), sizeof(uint32_t), m_indirection.size(), file) == m_indirection.size()
+				&& fwrite(m_cellDistances.data(), sizeof(float), m_cellDistances.size(), file) == m_cellDistances.size();
+			if (written && !m_bricks.empty())
+				written = fwrite(m_bricks.data(), sizeof(float), m_bricks.size(), file) == m_bricks.size();
+			fclose(file);
+			return written;
+		}
+
+		bool SparseSdf::Load(const std::string& filename)
+		{
+			FILE* file = fopen(filename.c_str(), "rb");
+			if (!file)
+				return false;
+			SparseSdfHeader header;
+			bool read = fread(&header, sizeof(header), 1, file) == 1
+				&& memcmp(header.magic, s_magic, sizeof(s_magic)) == 0
+				&& header.version == s_version;
+			if (read)
+			{
+				m_boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+				m_cellCount = glm::uvec3(header.cellCount[0], header.cellCount[1], header.cellCount[2]);
+				m_voxelSize = header.voxelSize;
+				m_band = header.band;
+				m_maxDistance = header.maxDistance;
+				m_indirection.resize(GetCellTotal());
+				m_cellDistances.resize(GetCellTotal());
+				m_bricks.resize((size_t)header.brickSlots * s_brickSamples);
+				read = fread(m_indirection.data(), sizeof(uint32_t), m_indirection.size(), file) == m_indirection.size()
+					&& fread(m_cellDistances.data(), sizeof(float), m_cellDistances.size(), file) == m_cellDistances.size();
+				if (read && !m_bricks.empty())
+					read = fread(m_bricks.data(), sizeof(float), m_bricks.size(), file) == m_bricks.size();
+			}
+			fclose(file);
+			//the slots no cell points to are free
+			m_freeBricks.clear();
+			if (read)
+			{
+				std::vector<uint8_t> used(GetBrickSlots(), 0);
+				for (auto brick : m_indirection)
+					if (brick != SDF_EMPTY_BRICK)
+						used[brick] = 1;
+				for (uint32_t brick = 0; brick < used.size(); brick++)
+					if (!used[brick])
+						m_freeBricks.push_back(brick);
+			}
+			else
+			{
+				m_cellCount = glm::uvec3(0);
+				m_indirection.clear();
+				m_cellDistances.clear();
+				m_bricks.clear();
+			}
+			return read;
+		}
+
+		void GlobalSdf::Init(glm::vec3 boundsMin, glm::vec3 boundsMax, float voxelSize, float band, float maxDistance, uint32_t brickCapacity)
+		{
+			float cellSize = voxelSize * SDF_BRICK_CELLS;
+			if (band <= 0.0f)
+				band = voxelSize;
+			//the values are clamped to it, it can't be smaller than the distance that decides if a cell has a brick
+			maxDistance = maxDistance > 0.0f ? maxDistance : 4.0f * cellSize;
+			m_volume.m_maxDistance = std::max(maxDistance, 0.5f * sqrtf(3.0f) * cellSize + band);
+			m_volume.m_brickCapacity = brickCapacity;
+			m_volume.Init(boundsMin, boundsMax, voxelSize, band);
+			m_instances.clear();
+			m_updatedCells.clear();
+			m_dirty.assign(m_volume.GetCellTotal(), 0);
+			m_dirtyCells.clear();
+			MarkDirty(m_volume.m_boundsMin, m_volume.GetBoundsMax());
+		}
+
+		void GlobalSdf::UpdateBounds(Instance& instance)
+		{
+			glm::vec3 volumeMin = instance.volume->m_boundsMin;
+			glm::vec3 volumeMax = instance.volume->GetBoundsMax();
+			instance.boundsMin = glm::vec3(FLT_MAX);
+			instance.boundsMax = glm::vec3(-FLT_MAX);
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				glm::vec3 p((corner & 1) ? volumeMax.x : volumeMin.x, (corner & 2) ? volumeMax.y : volumeMin.y, (corner & 4) ? volumeMax.z : volumeMin.z);
+				glm::vec3 world = glm::vec3(instance.transform * glm::vec4(p, 1.0f));
+				instance.boundsMin = glm::min(instance.boundsMin, world);
+				instance.boundsMax = glm::max(instance.boundsMax, world);
+			}
+			instance.inverse = glm::inverse(instance.transform);
+			instance.scale = glm::length(glm::vec3(instance.transform[0]));
+		}
+
+		//the stored distances are clamped to m_maxDistance, an object changes only the cells closer than that to it
+		void GlobalSdf::MarkDirty(glm::vec3 boundsMin, glm::vec3 boundsMax)
+		{
+			float cellSize = m_volume.GetCellSize();
+			glm::vec3 from = (boundsMin - m_volume.m_maxDistance - m_volume.m_boundsMin) / cellSize;
+			glm::vec3 to = (boundsMax + m_volume.m_maxDistance - m_volume.m_boundsMin) / cellSize;
+			glm::vec3 last = glm::vec3(m_volume.m_cellCount) - 1.0f;
+			if (glm::any(glm::lessThan(to, glm::vec3(0.0f))) || glm::any(glm::greaterThan(from, last + 1.0f)))
+				return;
+			glm::uvec3 first = glm::uvec3(glm::clamp(glm::floor(from), glm::vec3(0.0f), last));
+			glm::uvec3 end = glm::uvec3(glm::clamp(glm::floor(to), glm::vec3(0.0f), last));
+			for (uint32_t z = first.z; z <= end.z; z++)
+				for (uint32_t y = first.y; y <= end.y; y++)
+					for (uint32_t x = first.x; x <= end.x; x++)
+					{
+						uint32_t cell = m_volume.GetCellIndex(glm::uvec3(x, y, z));
+						if (!m_dirty[cell])
+						{
+							m_dirty[cell] = 1;
+							m_dirtyCells.push_back(cell);
+						}
+					}
+		}
+
+		uint32_t GlobalSdf::AddInstance(const SparseSdf* volume, const glm::mat4& transform)
+		{
+			Instance instance;
+			instance.volume = volume;
+			instance.transform = transform;
+			UpdateBounds(instance);
+			m_instances.push_back(instance);
+			MarkDirty(instance.boundsMin, instance.boundsMax);
+			return static_cast<uint32_t>(m_instances.size() - 1);
+		}
+
+		void GlobalSdf::SetTransform(uint32_t instance, const glm::mat4& transform)
+		{
+			Instance& moved = m_instances[instance];
+			MarkDirty(moved.boundsMin, moved.boundsMax);
+			moved.transform = transform;
+			UpdateBounds(moved);
+			MarkDirty(moved.boundsMin, moved.boundsMax);
+		}
+
+		float GlobalSdf::Distance(glm::vec3 p) const
+		{
+			float distance = m_volume.m_maxDistance;
+			for (auto& instance : m_instances)
+			{
+				//the instance can't be closer than its bounds
+				glm::vec3 outside = glm::max(glm::max(instance.boundsMin - p, p - instance.boundsMax), glm::vec3(0.0f));
+				if (glm::dot(outside, outside) >= distance * distance)
+					continue;
+				glm::vec3 local = glm::vec3(instance.inverse * glm::vec4(p, 1.0f));
+				distance = std::min(distance, instance.volume->Sample(local) * instance.scale);
+			}
+			return distance;
+		}
+
+		SdfBakeStatistics GlobalSdf::Update(ThreadPool* threadPool)
+		{
+			m_updatedCells.swap(m_dirtyCells);
+			m_dirtyCells.clear();
+			if (m_updatedCells.empty())
+				return SdfBakeStatistics();
+			for (auto cell : m_updatedCells)
+				m_dirty[cell] = 0;
+			//the same cells in the same order whatever the order they were marked in
+			std::sort(m_updatedCells.begin(), m_updatedCells.end());
+			return m_volume.Bake([this](glm::vec3 p) { return Distance(p); }, threadPool, &m_updatedCells);
+		}
+
+		SdfBakeStatistics GlobalSdf::Rebuild(ThreadPool* threadPool)
+		{
+			MarkDirty(m_volume.m_boundsMin, m_volume.GetBoundsMax());
+			return Update(threadPool);
+		}
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "Bvh.h"
+#include "threadpool.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <functional>
+#include <cfloat>
+#include <cstdint>
+
+namespace engine
+{
+	namespace scene
+	{
+		#define SDF_BRICK_SIZE 8//samples per brick side
+		#define SDF_BRICK_CELLS (SDF_BRICK_SIZE - 1)//voxels per brick side, neighbouring bricks share their border samples
+		#define SDF_EMPTY_BRICK UINT32_MAX
+
+		/** @brief Triangles with a BVH and the angle weighted pseudo normals of their faces, edges and corners.
+		 *  The normal of the feature the closest point lies on gives the sign of the distance, which is exact for closed meshes */
+		class SdfMesh
+		{
+		public:
+			Bvh m_bvh;
+
+			void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+			/** @brief Distance to the closest triangle, negative inside */
+			float SignedDistance(glm::vec3 p) const;
+			/** @brief The same distance testing every triangle, the reference the BVH is checked against */
+			float SignedDistanceBruteForce(glm::vec3 p) const;
+
+			glm::vec3 GetBoundsMin() const { return m_bvh.GetBoundsMin(); }
+			glm::vec3 GetBoundsMax() const { return m_bvh.GetBoundsMax(); }
+
+		private:
+			//face, three corners and three edges (01, 12, 20) per input triangle
+			struct PseudoNormals
+			{
+				glm::vec3 normals[7];
+			};
+			std::vector<PseudoNormals> m_normals;
+			std::vector<glm::vec3> m_positions;
+			std::vector<uint32_t> m_indices;
+
+			float Sign(glm::vec3 p, glm::vec3 closest, uint32_t triangle, uint32_t feature) const;
+		};
+
+		struct SdfBakeStatistics
+		{
+			uint32_t cellsBaked = 0;
+			uint32_t bricksBaked = 0;
+			uint32_t bricksFreed = 0;
+			uint32_t bricksDropped = 0;//near the surface but over the brick capacity, only their center distance is kept
+			uint64_t samples = 0;
+			uint64_t microseconds = 0;
+		};
+
+		/** @brief Distance field stored in bricks of SDF_BRICK_SIZE^3 samples only where the surface is near.
+		 *  Every brick cell keeps the distance at its center, the cells without a brick are sampled with that conservative value */
+		class SparseSdf
+		{
+		public:
+			typedef std::function<float(glm::vec3)> DistanceFunction;
+
+			glm::vec3 m_boundsMin = glm::vec3(0.0f);
+			float m_voxelSize = 1.0f;
+			glm::uvec3 m_cellCount = glm::uvec3(0);
+			//a cell gets a brick when the surface is closer than this to it
+			float m_band = 0.0f;
+			//stored distances are clamped to it, it keeps the cells a moving object changes near the object
+			float m_maxDistance = FLT_MAX;
+			//0 for no limit, the GPU atlas of the volume has a fixed size
+			uint32_t m_brickCapacity = 0;
+
+			std::vector<uint32_t> m_indirection;//brick of every cell, x fastest
+			std::vector<float> m_cellDistances;//distance at the center of every cell
+			std::vector<float> m_bricks;//SDF_BRICK_SIZE^3 samples per brick, x fastest
+			std::vector<uint32_t> m_freeBricks;
+
+			/** @brief The bounds are grown to whole cells, band 0 means one voxel */
+			void Init(glm::vec3 boundsMin, glm::vec3 boundsMax, float voxelSize, float band = 0.0f);
+
+			/** @brief Bakes every cell, or only the given ones, with the distance function. The samples are computed in parallel on the pool */
+			SdfBakeStatistics Bake(const DistanceFunction& distance, ThreadPool* threadPool = nullptr, const std::vector<uint32_t>* cells = nullptr);
+			SdfBakeStatistics Bake(const SdfMesh& mesh, ThreadPool* threadPool = nullptr);
+
+			/** @brief Trilinear distance, outside the bounds the distance to them is added */
+			float Sample(glm::vec3 p) const;
+
+			float GetCellSize() const { return m_voxelSize * SDF_BRICK_CELLS; }
+			glm::vec3 GetBoundsMax() const { return m_boundsMin + glm::vec3(m_cellCount) * GetCellSize(); }
+			uint32_t GetCellTotal() const { return m_cellCount.x * m_cellCount.y * m_cellCount.z; }
+			uint32_t GetCellIndex(glm::uvec3 cell) const { return cell.x + m_cellCount.x * (cell.y + m_cellCount.y * cell.z); }
+			glm::uvec3 GetCell(uint32_t index) const { return glm::uvec3(index % m_cellCount.x, (index / m_cellCount.x) % m_cellCount.y, index / (m_cellCount.x * m_cellCount.y)); }
+			glm::vec3 GetCellCenter(glm::uvec3 cell) const { return m_boundsMin + (glm::vec3(cell) + 0.5f) * GetCellSize(); }
+			/** @brief Bricks ever allocated, the GPU atlas has to hold this many */
+			uint32_t GetBrickSlots() const { return static_cast<uint32_t>(m_bricks.size() / (SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE)); }
+			uint32_t GetBrickCount() const { return GetBrickSlots() - static_cast<uint32_t>(m_freeBricks.size()); }
+			const float* GetBrick(uint32_t brick) const { return m_bricks.data() + (size_t)brick * SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE; }
+			size_t GetMemorySize() const { return m_bricks.size() * sizeof(float) + m_cellDistances.size() * sizeof(float) + m_indirection.size() * sizeof(uint32_t); }
+
+			/** @brief Binary dump of the volume, so it can be baked offline and loaded at run time */
+			bool Save(const std::string& filename) const;
+			bool Load(const std::string& filename);
+
+		private:
+			uint32_t AllocateBrick();
+		};
+
+		/** @brief Baked object volumes placed in the world and composited into one volume, moving an object rebakes
+		 *  only the cells around where it was and where it is now. Scales have to be uniform */
+		class GlobalSdf
+		{
+		public:
+			struct Instance
+			{
+				const SparseSdf* volume;
+				glm::mat4 transform;
+				glm::mat4 inverse;
+				float scale;
+				glm::vec3 boundsMin;//world bounds
+				glm::vec3 boundsMax;
+			};
+
+			SparseSdf m_volume;
+			std::vector<Instance> m_instances;
+			//cells rebaked by the last Update, the ones that have to be uploaded again
+			std::vector<uint32_t> m_updatedCells;
+
+			/** @brief maxDistance 0 means four cells */
+			void Init(glm::vec3 boundsMin, glm::vec3 boundsMax, float voxelSize, float band = 0.0f, float maxDistance = 0.0f, uint32_t brickCapacity = 0);
+
+			uint32_t AddInstance(const SparseSdf* volume, const glm::mat4& transform);
+			/** @brief The cells the instance covered and the ones it covers now are rebaked by the next Update */
+			void SetTransform(uint32_t instance, const glm::mat4& transform);
+
+			/** @brief Rebakes the cells that changed since the last update */
+			SdfBakeStatistics Update(ThreadPool* threadPool = nullptr);
+			/** @brief Rebakes everything */
+			SdfBakeStatistics Rebuild(ThreadPool* threadPool = nullptr);
+
+			/** @brief Union of the instances, what the volume is baked from */
+			float Distance(glm::vec3 p) const;
+
+			uint32_t GetDirtyCount() const { return static_cast<uint32_t>(m_dirtyCells.size()); }
+
+		private:
+			std::vector<uint8_t> m_dirty;
+			std::vector<uint32_t> m_dirtyCells;
+
+			void UpdateBounds(Instance& instance);
+			void MarkDirty(glm::vec3 boundsMin, glm::vec3 boundsMax);
+		};
+	}
+}
@@ -1,4 +1,5 @@
 #include "Terrain.h"
+#include "MeshOptimizer.h"
 
 #include <stb_image.h>
 
@@ -316,6 +317,11 @@ namespace engine
 			}
 
 			m_boundingBoxes.push_back(box);
+
+			//the grid vertex order is kept so heights and normals can still be looked up by index
+			if (m_optimizeMeshes)
+				MeshOptimizer::Optimize(geometry, vertex_layout, MeshOptimizer::STAGE_VERTEX_CACHE | MeshOptimizer::STAGE_OVERDRAW);
+
 			returnVector.push_back(geometry);
 
 			return returnVector;
@@ -0,0 +1,135 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <assert.h>
+
+namespace engine
+{
+	namespace scene
+	{
+		uint32_t TransformHierarchy::AddNode(int32_t parent, glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+		{
+			uint32_t node = GetCount();
+			assert(parent < static_cast<int32_t>(node));
+			uint32_t depth = parent >= 0 ? m_depths[parent] + 1 : 0;
+
+			m_parents.push_back(parent);
+			m_depths.push_back(depth);
+			m_translations.push_back(translation);
+			m_rotations.push_back(rotation);
+			m_scales.push_back(scale);
+			m_worldMatrices.push_back(glm::mat4(1.0f));
+			m_localDirty.push_back(1);
+			m_worldChanged.push_back(0);
+
+			if (m_levels.size() <= depth)
+				m_levels.resize(depth + 1);
+			m_levels[depth].push_back(node);
+			return node;
+		}
+
+		void TransformHierarchy::Clear()
+		{
+			m_parents.clear();
+			m_depths.clear();
+			m_translations.clear();
+			m_rotations.clear();
+			m_scales.clear();
+			m_worldMatrices.clear();
+			m_localDirty.clear();
+			m_worldChanged.clear();
+			m_levels.clear();
+			m_changedNodes.clear();
+		}
+
+		glm::mat4 TransformHierarchy::GetLocalMatrix(uint32_t node) const
+		{
+			//translation * rotation * scale
+			glm::mat4 local = glm::mat4_cast(m_rotations[node]);
+			local[0] *= m_scales[node].x;
+			local[1] *= m_scales[node].y;
+			local[2] *= m_scales[node].z;
+			local[3] = glm::vec4(m_translations[node], 1.0f);
+			return local;
+		}
+
+		void TransformHierarchy::UpdateNode(uint32_t node)
+		{
+			//the parent was handled before, in the same pass or in the previous level
+			int32_t parent = m_parents[node];
+			bool changed = m_localDirty[node] || (parent >= 0 && m_worldChanged[parent]);
+			m_worldChanged[node] = changed;
+			if (!changed)
+				return;
+
+			m_localDirty[node] = 0;
+			if (parent >= 0)
+				m_worldMatrices[node] = m_worldMatrices[parent] * GetLocalMatrix(node);
+			else
+				m_worldMatrices[node] = GetLocalMatrix(node);
+		}
+
+		uint32_t TransformHierarchy::Update(ThreadPool* threadPool)
+		{
+			uint32_t count = GetCount();
+			m_changedNodes.clear();
+
+			uint32_t threadCount = threadPool ? static_cast<uint32_t>(threadPool->threads.size()) : 1;
+			if (threadCount <= 1)
+			{
+				for (uint32_t node = 0; node < count; node++)
+				{
+					UpdateNode(node);
+					if (m_worldChanged[node])
+						m_changedNodes.push_back(node);
+				}
+				return static_cast<uint32_t>(m_changedNodes.size());
+			}
+
+			//the nodes of a level only depend on the levels above
+			for (const std::vector<uint32_t>& level : m_levels)
+			{
+				uint32_t levelSize = static_cast<uint32_t>(level.size());
+				uint32_t jobCount = std::max(std::min(threadCount, levelSize / 1024), 1u);
+				threadPool->runJobs(jobCount, [&](uint32_t job) {
+					uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(levelSize) * job / jobCount);
+					uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(levelSize) * (job + 1) / jobCount);
+					for (uint32_t i = begin; i < end; i++)
+						UpdateNode(level[i]);
+				});
+			}
+			for (uint32_t node = 0; node < count; node++)
+			{
+				if (m_worldChanged[node])
+					m_changedNodes.push_back(node);
+			}
+			return static_cast<uint32_t>(m_changedNodes.size());
+		}
+
+		void TransformHierarchy::CreateBuffer(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool)
+		{
+			//created with data so it is mapped
+			m_worldBuffer = device->GetStorageVertexBuffer(m_worldMatrices.size() * sizeof(glm::mat4), m_worldMatrices.data(), sizeof(glm::mat4), descriptorPool, true, nullptr);
+		}
+
+		size_t TransformHierarchy::UploadChanged()
+		{
+			size_t copied = 0;
+			size_t i = 0;
+			while (i < m_changedNodes.size())
+			{
+				uint32_t first = m_changedNodes[i];
+				uint32_t last = first;
+				while (i + 1 < m_changedNodes.size() && m_changedNodes[i + 1] == last + 1)
+				{
+					i++;
+					last++;
+				}
+				size_t size = (last - first + 1) * sizeof(glm::mat4);
+				m_worldBuffer->MemCopy(&m_worldMatrices[first], size, first * sizeof(glm::mat4));
+				copied += size;
+				i++;
+			}
+			return copied;
+		}
+	}
+}
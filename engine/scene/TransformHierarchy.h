@@ -0,0 +1,59 @@
+#pragma once
+#include "render/Buffer.h"
+#include "render/GraphicsDevice.h"
+#include "threadpool.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+namespace engine
+{
+	namespace scene
+	{
+		/** @brief Transforms of a scene graph stored as a structure of arrays, a parent always comes before its children.
+		 *  Changing a local translation, rotation or scale marks the node dirty. Update recomputes the world matrices of the dirty nodes
+		 *  and of their descendants in one pass over the arrays, or level by level on a thread pool, and UploadChanged copies the changed
+		 *  world matrices into one storage buffer, indexed by node. */
+		class TransformHierarchy
+		{
+		public:
+			std::vector<int32_t> m_parents;//-1 for the roots
+			std::vector<uint32_t> m_depths;
+			std::vector<glm::vec3> m_translations;
+			std::vector<glm::quat> m_rotations;
+			std::vector<glm::vec3> m_scales;
+			std::vector<glm::mat4> m_worldMatrices;
+			std::vector<uint8_t> m_localDirty;
+			std::vector<uint8_t> m_worldChanged;//by the last Update
+
+			//nodes of every depth in index order, used by the parallel update
+			std::vector<std::vector<uint32_t>> m_levels;
+			//nodes whose world matrix changed in the last Update, in index order
+			std::vector<uint32_t> m_changedNodes;
+
+			render::Buffer* m_worldBuffer = nullptr;
+
+			/** @brief The parent has to be added before, returns the node index */
+			uint32_t AddNode(int32_t parent, glm::vec3 translation = glm::vec3(0.0f), glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f));
+			void Clear();
+
+			uint32_t GetCount() const { return static_cast<uint32_t>(m_parents.size()); }
+			void SetTranslation(uint32_t node, glm::vec3 translation) { m_translations[node] = translation; m_localDirty[node] = 1; }
+			void SetRotation(uint32_t node, glm::quat rotation) { m_rotations[node] = rotation; m_localDirty[node] = 1; }
+			void SetScale(uint32_t node, glm::vec3 scale) { m_scales[node] = scale; m_localDirty[node] = 1; }
+			glm::mat4 GetLocalMatrix(uint32_t node) const;
+			const glm::mat4& GetWorldMatrix(uint32_t node) const { return m_worldMatrices[node]; }
+
+			/** @brief Recomputes the world matrices of the dirty subtrees, returns the number of changed nodes */
+			uint32_t Update(ThreadPool* threadPool = nullptr);
+
+			/** @brief Mapped storage buffer with the world matrices of all the nodes */
+			void CreateBuffer(render::GraphicsDevice* device, render::DescriptorPool* descriptorPool);
+			/** @brief Copies the world matrices changed by the last Update, consecutive nodes are copied together. Returns the bytes copied */
+			size_t UploadChanged();
+
+		private:
+			void UpdateNode(uint32_t node);
+		};
+	}
+}
@@ -116,6 +116,24 @@ namespace engine
 				thread->wait();
 			}
 		}
+
+		// Runs the jobs spread over the threads and waits until all are finished, without threads they run on the calling one
+		void runJobs(uint32_t jobCount, const std::function<void(uint32_t)>& function)
+		{
+			if (threads.size() <= 1 || jobCount <= 1)
+			{
+				for (uint32_t job = 0; job < jobCount; job++)
+				{
+					function(job);
+				}
+				return;
+			}
+			for (uint32_t job = 0; job < jobCount; job++)
+			{
+				threads[job % threads.size()]->addJob([&function, job] { function(job); });
+			}
+			wait();
+		}
 	};
 
 }
@@ -0,0 +1,441 @@
+/*
+* Headless benchmark of the CPU BVH on the model of the raytracingscene example
+*
+* bvhbenchmark [-width N] [-height N] [-threads N] [-validate N] [-ppm FILE]
+* Times the builds on one and on many threads and traces primary rays one by one and in 2x2 packets, shadow rays and diffuse bounces.
+* The hits are checked against testing every triangle, and a refit of the deformed model is compared with building it again.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <math.h>
+
+#include <glm/glm.hpp>
+#include "threadpool.hpp"
+#include "VulkanTools.h"
+#include "scene/SimpleModel.h"
+#include "scene/Bvh.h"
+#include "scene/Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+//rows of pixels a job traces, even so the packets of 2x2 pixels don't cross jobs
+const uint32_t ROWS_PER_JOB = 8;
+
+struct View
+{
+	uint32_t width;
+	uint32_t height;
+	glm::vec3 eye;
+	glm::vec3 forward;
+	glm::vec3 right;
+	glm::vec3 up;
+	glm::vec3 light;
+	float epsilon;//the secondary rays start this far from the surface
+};
+
+struct Mesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	glm::vec3 Normal(uint32_t triangle) const
+	{
+		glm::vec3 a = positions[indices[triangle * 3]];
+		glm::vec3 n = glm::cross(positions[indices[triangle * 3 + 1]] - a, positions[indices[triangle * 3 + 2]] - a);
+		float length = glm::length(n);
+		return length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+};
+
+void RunJobs(ThreadPool* threadPool, uint32_t jobCount, const std::function<void(uint32_t job)>& function)
+{
+	if (threadPool)
+	{
+		threadPool->runJobs(jobCount, function);
+		return;
+	}
+	for (uint32_t job = 0; job < jobCount; job++)
+		function(job);
+}
+
+uint32_t GetThreadCount(ThreadPool* threadPool)
+{
+	return threadPool ? static_cast<uint32_t>(threadPool->threads.size()) : 1;
+}
+
+void PrintRays(const char* name, uint32_t threads, uint64_t rays, uint64_t microseconds)
+{
+	printf("%-16s %2u threads: %8.1f ms, %8.2f Mrays/s\n", name, threads, microseconds / 1000.0, rays / std::max<double>(static_cast<double>(microseconds), 1.0));
+}
+
+scene::BvhRay PrimaryRay(const View& view, uint32_t x, uint32_t y)
+{
+	//60 degrees vertical field of view
+	const float tanHalfFov = 0.57735f;
+	float aspect = static_cast<float>(view.width) / view.height;
+	float u = (2.0f * (x + 0.5f) / view.width - 1.0f) * tanHalfFov * aspect;
+	float v = (1.0f - 2.0f * (y + 0.5f) / view.height) * tanHalfFov;
+	scene::BvhRay ray;
+	ray.origin = view.eye;
+	ray.direction = glm::normalize(view.forward + view.right * u + view.up * v);
+	return ray;
+}
+
+//the same random numbers for a pixel whatever thread traces it
+float Random(uint32_t seed)
+{
+	seed ^= seed >> 16;
+	seed *= 0x7feb352d;
+	seed ^= seed >> 15;
+	seed *= 0x846ca68b;
+	seed ^= seed >> 16;
+	return (seed >> 8) / 16777216.0f;
+}
+
+scene::BvhRay BounceRay(const View& view, const Mesh& mesh, const scene::BvhRay& primary, const scene::BvhHit& hit, uint32_t pixel)
+{
+	glm::vec3 normal = mesh.Normal(hit.triangle);
+	if (glm::dot(normal, primary.direction) > 0.0f)
+		normal = -normal;
+	//cosine weighted around the normal
+	float phi = 6.2831853f * Random(pixel * 2);
+	float r = sqrtf(Random(pixel * 2 + 1));
+	glm::vec3 tangent = glm::normalize(fabsf(normal.x) > 0.5f ? glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f)) : glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f)));
+	glm::vec3 bitangent = glm::cross(normal, tangent);
+	scene::BvhRay ray;
+	ray.origin = primary.origin + primary.direction * hit.t + normal * view.epsilon;
+	ray.direction = glm::normalize(tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + normal * sqrtf(std::max(1.0f - r * r, 0.0f)));
+	return ray;
+}
+
+uint64_t TracePrimary(const scene::Bvh& bvh, const View& view, ThreadPool* threadPool, std::vector<scene::BvhHit>& hits)
+{
+	hits.assign(view.width * view.height, scene::BvhHit());
+	Timer timer;
+	timer.start();
+	RunJobs(threadPool, (view.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB, [&](uint32_t job) {
+		for (uint32_t y = job * ROWS_PER_JOB; y < std::min((job + 1) * ROWS_PER_JOB, view.height); y++)
+			for (uint32_t x = 0; x < view.width; x++)
+				bvh.Intersect(PrimaryRay(view, x, y), hits[y * view.width + x]);
+	});
+	timer.stop();
+	return timer.elapsedMicroseconds();
+}
+
+uint64_t TracePackets(const scene::Bvh& bvh, const View& view, ThreadPool* threadPool, std::vector<scene::BvhHit>& hits)
+{
+	hits.assign(view.width * view.height, scene::BvhHit());
+	Timer timer;
+	timer.start();
+	RunJobs(threadPool, (view.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB, [&](uint32_t job) {
+		for (uint32_t y = job * ROWS_PER_JOB; y < std::min((job + 1) * ROWS_PER_JOB, view.height); y += 2)
+		{
+			for (uint32_t x = 0; x < view.width; x += 2)
+			{
+				scene::BvhRayPacket packet;
+				for (uint32_t lane = 0; lane < BVH_PACKET_SIZE; lane++)
+				{
+					//the lanes past the right and bottom edges are switched off
+					uint32_t px = std::min(x + (lane & 1), view.width - 1), py = std::min(y + (lane >> 1), view.height - 1);
+					scene::BvhRay ray = PrimaryRay(view, px, py);
+					if (px != x + (lane & 1) || py != y + (lane >> 1))
+						ray.tMax = -1.0f;
+					packet.Set(lane, ray);
+				}
+				scene::BvhHit packetHits[BVH_PACKET_SIZE];
+				bvh.Intersect(packet, packetHits);
+				for (uint32_t lane = 0; lane < BVH_PACKET_SIZE; lane++)
+					if (x + (lane & 1) < view.width && y + (lane >> 1) < view.height)
+						hits[(y + (lane >> 1)) * view.width + x + (lane & 1)] = packetHits[lane];
+			}
+		}
+	});
+	timer.stop();
+	return timer.elapsedMicroseconds();
+}
+
+uint64_t TraceShadows(const scene::Bvh& bvh, const View& view, const Mesh& mesh, const std::vector<scene::BvhHit>& primaryHits, ThreadPool* threadPool,
+	std::vector<uint8_t>& shadowed, uint64_t& rays)
+{
+	shadowed.assign(view.width * view.height, 0);
+	std::vector<uint32_t> jobRays((view.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB, 0);
+	Timer timer;
+	timer.start();
+	RunJobs(threadPool, static_cast<uint32_t>(jobRays.size()), [&](uint32_t job) {
+		for (uint32_t y = job * ROWS_PER_JOB; y < std::min((job + 1) * ROWS_PER_JOB, view.height); y++)
+		{
+			for (uint32_t x = 0; x < view.width; x++)
+			{
+				const scene::BvhHit& hit = primaryHits[y * view.width + x];
+				if (!hit.IsHit())
+					continue;
+				scene::BvhRay primary = PrimaryRay(view, x, y);
+				glm::vec3 normal = mesh.Normal(hit.triangle);
+				if (glm::dot(normal, primary.direction) > 0.0f)
+					normal = -normal;
+				scene::BvhRay ray;
+				ray.origin = primary.origin + primary.direction * hit.t + normal * view.epsilon;
+				ray.direction = view.light;
+				shadowed[y * view.width + x] = bvh.Occluded(ray) ? 1 : 0;
+				jobRays[job]++;
+			}
+		}
+	});
+	timer.stop();
+	rays = 0;
+	for (auto count : jobRays)
+		rays += count;
+	return timer.elapsedMicroseconds();
+}
+
+uint64_t TraceBounces(const scene::Bvh& bvh, const View& view, const Mesh& mesh, const std::vector<scene::BvhHit>& primaryHits, ThreadPool* threadPool, uint64_t& rays)
+{
+	std::vector<uint32_t> jobRays((view.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB, 0);
+	Timer timer;
+	timer.start();
+	RunJobs(threadPool, static_cast<uint32_t>(jobRays.size()), [&](uint32_t job) {
+		for (uint32_t y = job * ROWS_PER_JOB; y < std::min((job + 1) * ROWS_PER_JOB, view.height); y++)
+		{
+			for (uint32_t x = 0; x < view.width; x++)
+			{
+				const scene::BvhHit& hit = primaryHits[y * view.width + x];
+				if (!hit.IsHit())
+					continue;
+				scene::BvhHit bounce;
+				bvh.Intersect(BounceRay(view, mesh, PrimaryRay(view, x, y), hit, y * view.width + x), bounce);
+				jobRays[job]++;
+			}
+		}
+	});
+	timer.stop();
+	rays = 0;
+	for (auto count : jobRays)
+		rays += count;
+	return timer.elapsedMicroseconds();
+}
+
+//hits on a shared edge can pick either triangle, only the distances have to agree
+bool SameHit(const scene::BvhHit& a, const scene::BvhHit& b)
+{
+	if (a.IsHit() != b.IsHit())
+		return false;
+	return !a.IsHit() || fabsf(a.t - b.t) <= 1e-4f * std::max(a.t, 1.0f);
+}
+
+scene::BvhHit BruteForce(const Mesh& mesh, const scene::BvhRay& ray)
+{
+	scene::BvhHit hit;
+	scene::BvhRay clipped = ray;
+	for (uint32_t t = 0; t < mesh.indices.size() / 3; t++)
+	{
+		float distance, u, v;
+		if (scene::Bvh::IntersectTriangle(clipped, mesh.positions[mesh.indices[t * 3]], mesh.positions[mesh.indices[t * 3 + 1]], mesh.positions[mesh.indices[t * 3 + 2]], distance, u, v))
+		{
+			clipped.tMax = distance;
+			hit.t = distance;
+			hit.u = u;
+			hit.v = v;
+			hit.triangle = t;
+		}
+	}
+	return hit;
+}
+
+uint32_t Validate(const scene::Bvh& bvh, const View& view, const Mesh& mesh, uint32_t samples, std::mt19937& generator)
+{
+	std::uniform_int_distribution<uint32_t> pixel(0, view.width * view.height - 1);
+	uint32_t mismatches = 0;
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		uint32_t p = pixel(generator);
+		scene::BvhRay ray = PrimaryRay(view, p % view.width, p / view.width);
+		scene::BvhHit hit;
+		bvh.Intersect(ray, hit);
+		mismatches += !SameHit(hit, BruteForce(mesh, ray));
+		mismatches += bvh.Occluded(ray) != hit.IsHit();
+		if (hit.IsHit())
+		{
+			scene::BvhRay bounce = BounceRay(view, mesh, ray, hit, p);
+			bvh.Intersect(bounce, hit);
+			mismatches += !SameHit(hit, BruteForce(mesh, bounce));
+		}
+	}
+	return mismatches;
+}
+
+void WritePpm(const char* fileName, const View& view, const Mesh& mesh, const std::vector<scene::BvhHit>& hits, const std::vector<uint8_t>& shadowed)
+{
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("could not write %s\n", fileName);
+		return;
+	}
+	fprintf(file, "P6\n%u %u\n255\n", view.width, view.height);
+	std::vector<uint8_t> row(view.width * 3);
+	for (uint32_t y = 0; y < view.height; y++)
+	{
+		for (uint32_t x = 0; x < view.width; x++)
+		{
+			const scene::BvhHit& hit = hits[y * view.width + x];
+			glm::vec3 color(0.4f, 0.5f, 0.7f);
+			if (hit.IsHit())
+			{
+				glm::vec3 normal = mesh.Normal(hit.triangle);
+				if (glm::dot(normal, PrimaryRay(view, x, y).direction) > 0.0f)
+					normal = -normal;
+				float diffuse = shadowed[y * view.width + x] ? 0.0f : std::max(glm::dot(normal, view.light), 0.0f);
+				color = glm::vec3(0.15f + 0.85f * diffuse);
+			}
+			for (int c = 0; c < 3; c++)
+				row[x * 3 + c] = static_cast<uint8_t>(glm::clamp(color[c], 0.0f, 1.0f) * 255.0f);
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	printf("image written to %s\n", fileName);
+}
+
+void PrintTraces(const scene::Bvh& bvh, const View& view, const Mesh& mesh, ThreadPool* threadPool, std::vector<scene::BvhHit>& hits, std::vector<uint8_t>& shadowed)
+{
+	uint32_t threads = GetThreadCount(threadPool);
+	uint64_t pixels = static_cast<uint64_t>(view.width) * view.height;
+	PrintRays("primary", threads, pixels, TracePrimary(bvh, view, threadPool, hits));
+
+	std::vector<scene::BvhHit> packetHits;
+	PrintRays("primary packets", threads, pixels, TracePackets(bvh, view, threadPool, packetHits));
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < hits.size(); i++)
+		mismatches += !SameHit(hits[i], packetHits[i]);
+	if (mismatches > 0)
+		printf("%u packet hits differ from the single rays\n", mismatches);
+
+	uint64_t rays;
+	uint64_t microseconds = TraceShadows(bvh, view, mesh, hits, threadPool, shadowed, rays);
+	PrintRays("shadow", threads, rays, microseconds);
+	microseconds = TraceBounces(bvh, view, mesh, hits, threadPool, rays);
+	PrintRays("diffuse bounce", threads, rays, microseconds);
+}
+
+int RunBenchmark(int argc, char** argv)
+{
+	View view;
+	view.width = 1280;
+	view.height = 720;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	uint32_t samples = 1000;
+	const char* ppmFile = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-width") == 0 && i + 1 < argc)
+			view.width = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-height") == 0 && i + 1 < argc)
+			view.height = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-validate") == 0 && i + 1 < argc)
+			samples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-ppm") == 0 && i + 1 < argc)
+			ppmFile = argv[++i];
+	}
+
+	//loaded like raytracingscene does it
+	render::VertexLayout vertexLayout({ render::VERTEX_COMPONENT_POSITION, render::VERTEX_COMPONENT_NORMAL, render::VERTEX_COMPONENT_UV }, {});
+	scene::SimpleModel loader;
+	std::vector<render::MeshData*> meshes = loader.LoadGeometry(engine::tools::getAssetPath() + "models/Medieval_building/Medieval_building.obj", &vertexLayout, 0.1f, 1);
+	Mesh mesh;
+	scene::Bvh::GetTriangles(meshes, &vertexLayout, mesh.positions, mesh.indices);
+	for (auto data : meshes)
+		delete data;
+	if (mesh.indices.empty())
+	{
+		printf("could not load Medieval_building.obj\n");
+		return 1;
+	}
+
+	ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+	std::mt19937 generator(1234);
+	printf("%u triangles, %ux%u rays, %u threads\n", static_cast<uint32_t>(mesh.indices.size() / 3), view.width, view.height, threadCount);
+
+	Timer timer;
+	scene::Bvh bvh;
+	timer.start();
+	bvh.Build(mesh.positions, mesh.indices);
+	timer.stop();
+	uint64_t singleBuild = timer.elapsedMicroseconds();
+	timer.start();
+	bvh.Build(mesh.positions, mesh.indices, &threadPool);
+	timer.stop();
+	printf("build  1 threads: %8.1f ms, %2u threads: %8.1f ms, %u nodes, SAH cost %.2f\n", singleBuild / 1000.0, threadCount, timer.elapsedMicroseconds() / 1000.0,
+		static_cast<uint32_t>(bvh.m_nodes.size()), bvh.GetSahCost());
+
+	//looking at the model from above one of its corners
+	glm::vec3 boundsMin = bvh.GetBoundsMin(), boundsMax = bvh.GetBoundsMax();
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float size = glm::length(boundsMax - boundsMin);
+	view.eye = center + glm::normalize(glm::vec3(0.7f, 0.45f, 1.0f)) * size * 0.9f;
+	view.forward = glm::normalize(center - view.eye);
+	view.right = glm::normalize(glm::cross(view.forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	view.up = glm::cross(view.right, view.forward);
+	view.light = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+	view.epsilon = size * 1e-4f;
+
+	std::vector<scene::BvhHit> hits;
+	std::vector<uint8_t> shadowed;
+	PrintTraces(bvh, view, mesh, nullptr, hits, shadowed);
+	PrintTraces(bvh, view, mesh, &threadPool, hits, shadowed);
+	if (samples > 0)
+		printf("validation: %u mismatches against testing every triangle over %u pixels\n", Validate(bvh, view, mesh, samples, generator), samples);
+	if (ppmFile)
+		WritePpm(ppmFile, view, mesh, hits, shadowed);
+
+	//a wave through the model, the refit keeps the tree of the undeformed one
+	Mesh deformed = mesh;
+	for (auto& p : deformed.positions)
+		p.y += sinf((p.x - boundsMin.x) / size * 12.0f) * size * 0.02f;
+	timer.start();
+	bvh.Refit(deformed.positions, deformed.indices);
+	timer.stop();
+	uint64_t refitTime = timer.elapsedMicroseconds();
+	scene::Bvh rebuilt;
+	timer.start();
+	rebuilt.Build(deformed.positions, deformed.indices, &threadPool);
+	timer.stop();
+	printf("refit %8.1f ms, SAH cost %.2f, rebuild %8.1f ms, SAH cost %.2f\n", refitTime / 1000.0, bvh.GetSahCost(), timer.elapsedMicroseconds() / 1000.0, rebuilt.GetSahCost());
+	uint64_t pixels = static_cast<uint64_t>(view.width) * view.height;
+	PrintRays("refit primary", threadCount, pixels, TracePrimary(bvh, view, &threadPool, hits));
+	PrintRays("rebuilt primary", threadCount, pixels, TracePrimary(rebuilt, view, &threadPool, hits));
+	if (samples > 0)
+		printf("refit validation: %u mismatches over %u pixels\n", Validate(bvh, view, deformed, samples, generator), samples);
+	return 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunBenchmark(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunBenchmark(argc, argv);
+}
+#endif
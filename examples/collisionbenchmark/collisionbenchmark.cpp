@@ -0,0 +1,244 @@
+/*
+* Headless benchmark of the sphere collisions, the CollisionEngine against the SpacePartitionTree used by the multithreaded example
+*
+* collisionbenchmark [-steps N] [-threads N] [-treelimit N] [-verify] [counts...]
+* The tree is only run up to -treelimit spheres (100000 by default), its leaves are tested in O(n^2) and a million spheres take minutes per step.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <math.h>
+
+#include "threadpool.hpp"
+#include "scene/CollisionEngine.h"
+#include "scene/SpacePartitionTree.h"
+#include "scene/Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+const float GRAVITY = 8.0f;
+const float TIME_STEP = 1.0f / 60.0f;
+
+struct SphereSetup
+{
+	std::vector<glm::vec3> centers;
+	std::vector<glm::vec3> velocities;
+	std::vector<float> radii;
+	float halfExtent;
+};
+
+//about 5% of the box volume is filled whatever the count
+void CreateSpheres(uint32_t count, SphereSetup& setup)
+{
+	const float minRadius = 0.05f, maxRadius = 0.1f;
+	float averageVolume = 4.0f / 3.0f * 3.14159265f * powf(0.5f * (minRadius + maxRadius), 3.0f);
+	setup.halfExtent = 0.5f * cbrtf(count * averageVolume / 0.05f);
+
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> position(-setup.halfExtent + maxRadius, setup.halfExtent - maxRadius);
+	std::uniform_real_distribution<float> velocity(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> radius(minRadius, maxRadius);
+	setup.centers.resize(count);
+	setup.velocities.resize(count);
+	setup.radii.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		setup.centers[i] = glm::vec3(position(generator), position(generator), position(generator));
+		setup.velocities[i] = glm::vec3(velocity(generator), velocity(generator), velocity(generator));
+		setup.radii[i] = radius(generator);
+	}
+}
+
+void CreateEngine(const SphereSetup& setup, scene::CollisionEngine& collisions)
+{
+	collisions.Clear();
+	for (size_t i = 0; i < setup.radii.size(); i++)
+		collisions.AddSphere(setup.centers[i], setup.velocities[i], setup.radii[i]);
+	collisions.SetBounds(glm::vec3(-setup.halfExtent), glm::vec3(setup.halfExtent));
+	collisions.m_gravity = glm::vec3(0.0f, GRAVITY, 0.0f);
+}
+
+//pair tests of SpacePartitionTree::TestCollisions
+uint64_t CountTreePairs(scene::SpacePartitionTree* tree)
+{
+	if (tree->m_hasActiveChildren)
+	{
+		uint64_t pairs = 0;
+		for (auto child : tree->m_children)
+			pairs += CountTreePairs(child);
+		return pairs;
+	}
+	uint64_t count = tree->m_objects.size();
+	return count > 1 ? count * (count - 1) / 2 : 0;
+}
+
+struct Result
+{
+	double stepsPerSecond = 0.0;
+	double pairsPerStep = 0.0;
+	double contactsPerStep = 0.0;
+};
+
+Result RunEngine(const SphereSetup& setup, uint32_t steps, ThreadPool* threadPool)
+{
+	scene::CollisionEngine collisions;
+	CreateEngine(setup, collisions);
+	Result result;
+	uint64_t pairs = 0, contacts = 0;
+	Timer timer;
+	timer.start();
+	for (uint32_t s = 0; s < steps; s++)
+	{
+		collisions.Step(TIME_STEP, threadPool);
+		pairs += collisions.m_statistics.pairsTested;
+		contacts += collisions.m_statistics.contacts;
+	}
+	timer.stop();
+	result.stepsPerSecond = steps * 1000000.0 / std::max<uint64_t>(timer.elapsedMicroseconds(), 1);
+	result.pairsPerStep = static_cast<double>(pairs) / steps;
+	result.contactsPerStep = static_cast<double>(contacts) / steps;
+	return result;
+}
+
+//the update of the multithreaded example
+Result RunTree(const SphereSetup& setup, uint32_t steps)
+{
+	std::vector<scene::BoundingSphere*> balls(setup.radii.size());
+	for (size_t i = 0; i < balls.size(); i++)
+		balls[i] = new scene::BoundingSphere(setup.centers[i], setup.velocities[i], setup.radii[i]);
+
+	scene::SpacePartitionTree* tree = new scene::SpacePartitionTree;
+	tree->m_boundries.push_back(glm::vec3(-setup.halfExtent));
+	tree->m_boundries.push_back(glm::vec3(setup.halfExtent));
+	tree->CreateChildren();
+	for (auto child : tree->m_children)
+	{
+		child->CreateChildren();
+	}
+
+	Result result;
+	uint64_t pairs = 0;
+	Timer timer;
+	timer.start();
+	for (uint32_t s = 0; s < steps; s++)
+	{
+		for (auto ball : balls)
+		{
+			ball->AddToVelocity(glm::vec3(0.0f, GRAVITY * TIME_STEP, 0.0f));
+			ball->AddToPosition(ball->GetVelocity() * TIME_STEP);
+			glm::vec3 center = ball->GetCenter(), velocity = ball->GetVelocity();
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if ((center[axis] < -setup.halfExtent && velocity[axis] < 0.0f) || (center[axis] > setup.halfExtent && velocity[axis] > 0.0f))
+					velocity[axis] = -velocity[axis];
+			}
+			ball->SetVelocity(velocity);
+			tree->AdvanceObject(ball);
+		}
+		pairs += CountTreePairs(tree);
+		tree->TestCollisions();
+	}
+	timer.stop();
+	result.stepsPerSecond = steps * 1000000.0 / std::max<uint64_t>(timer.elapsedMicroseconds(), 1);
+	result.pairsPerStep = static_cast<double>(pairs) / steps;
+
+	delete tree;
+	for (auto ball : balls)
+		delete ball;
+	return result;
+}
+
+//the same steps with one and with many threads have to end in the same state
+bool VerifyDeterminism(const SphereSetup& setup, uint32_t steps, ThreadPool* threadPool)
+{
+	scene::CollisionEngine single, multi;
+	CreateEngine(setup, single);
+	CreateEngine(setup, multi);
+	for (uint32_t s = 0; s < steps; s++)
+	{
+		single.Step(TIME_STEP, nullptr);
+		multi.Step(TIME_STEP, threadPool);
+	}
+	return single.m_positionsX == multi.m_positionsX && single.m_positionsY == multi.m_positionsY && single.m_positionsZ == multi.m_positionsZ &&
+		single.m_velocitiesX == multi.m_velocitiesX && single.m_velocitiesY == multi.m_velocitiesY && single.m_velocitiesZ == multi.m_velocitiesZ;
+}
+
+int RunBenchmark(int argc, char** argv)
+{
+	uint32_t steps = 20;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	uint32_t treeLimit = 100000;
+	bool verify = false;
+	std::vector<uint32_t> counts;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-steps") == 0 && i + 1 < argc)
+			steps = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-treelimit") == 0 && i + 1 < argc)
+			treeLimit = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-verify") == 0)
+			verify = true;
+		else
+			counts.push_back(atoi(argv[i]));
+	}
+	if (counts.empty())
+		counts = { 10000, 100000, 1000000 };
+
+	ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+	printf("%u steps, %u threads\n", steps, threadCount);
+
+	for (uint32_t count : counts)
+	{
+		SphereSetup setup;
+		CreateSpheres(count, setup);
+
+		Result engineResult = RunEngine(setup, steps, &threadPool);
+		printf("%8u spheres  engine: %9.2f steps/s %14.0f pairs/step %10.0f contacts/step\n", count, engineResult.stepsPerSecond, engineResult.pairsPerStep, engineResult.contactsPerStep);
+
+		if (count <= treeLimit)
+		{
+			Result treeResult = RunTree(setup, steps);
+			printf("%8u spheres    tree: %9.2f steps/s %14.0f pairs/step\n", count, treeResult.stepsPerSecond, treeResult.pairsPerStep);
+		}
+		else
+		{
+			printf("%8u spheres    tree: skipped, over -treelimit\n", count);
+		}
+
+		if (verify)
+			printf("%8u spheres  deterministic: %s\n", count, VerifyDeterminism(setup, std::min(steps, 5u), &threadPool) ? "yes" : "NO");
+		fflush(stdout);
+	}
+	return 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunBenchmark(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunBenchmark(argc, argv);
+}
+#endif
@@ -73,10 +73,17 @@ public:
 	render::VulkanTexture* colorMap;
 	render::VulkanTexture* colorTex;
 	render::VulkanTexture* depthTex;
-	render::VulkanTexture* scenecolor;
-	render::VulkanTexture* scenepositions;
-	render::VulkanTexture* scenenormals;
-	render::VulkanTexture* scenedepth;
+
+	//the g-buffer lives in the render graph, the depth is never stored since nothing reads it after the geometry pass
+	render::VulkanRenderGraph* graph = nullptr;
+	struct {
+		uint32_t color;
+		uint32_t positions;
+		uint32_t normals;
+		uint32_t depth;
+	} targets;
+	uint32_t gbufferPass = 0;
+	uint32_t lightingPass = 0;
 
 	struct {
 		render::VulkanDescriptorSetLayout* model;
@@ -99,9 +106,6 @@ public:
 	glm::vec3 meshPos = glm::vec3(0.0f, -1.5f, 0.0f);
 	glm::vec3 meshRot = glm::vec3(0.0f);
 
-	render::VulkanRenderPass* scenepass = nullptr;
-	render::VulkanRenderPass* lightingpass = nullptr;
-
 	glm::vec3 light_positions[LIGHTS_NO];
 	glm::vec3 light_colors[LIGHTS_NO];
 
@@ -130,16 +134,7 @@ public:
 
 	void init()
 	{
-		scenecolor = vulkanDevice->GetColorRenderTarget(width, height, FB_COLOR_FORMAT);
-		scenepositions = vulkanDevice->GetColorRenderTarget(width, height, VK_FORMAT_R16G16B16A16_SFLOAT);
-		scenenormals = vulkanDevice->GetColorRenderTarget(width, height, VK_FORMAT_R16G16B16A16_SFLOAT);
-		scenedepth = vulkanDevice->GetDepthRenderTarget(width, height, false);
-
-		scenepass = vulkanDevice->GetRenderPass({ scenecolor ,scenepositions, scenenormals, scenedepth }, {});
-		render::VulkanFrameBuffer* fb = vulkanDevice->GetFrameBuffer(scenepass->GetRenderPass(), width, height, 
-			{ scenecolor->m_descriptor.imageView, scenepositions->m_descriptor.imageView, scenenormals->m_descriptor.imageView, scenedepth->m_descriptor.imageView },
-			{ { 0.95f, 0.95f, 0.95f, 1.0f } });
-		scenepass->AddFrameBuffer(fb);
+		setupRenderGraph();
 
 		std::vector<render::MeshData*> pmd = models.plane.LoadGeometry(engine::tools::getAssetPath() + "models/plane.obj", &vertexLayout, 10.0f, 1, glm::vec3(0.0,1.5,0.0));
 		std::vector<render::MeshData*> emd = models.example.LoadGeometry(engine::tools::getAssetPath() + "models/chinesedragon.dae", &vertexLayoutInstanced, 0.3f, LIGHTS_NO, glm::vec3(0.0, 0.0, 0.0));
@@ -227,6 +222,41 @@ public:
 		
 	}
 
+	void setupRenderGraph()
+	{
+		graph = vulkanDevice->GetRenderGraph();
+		const float background[4] = { 0.95f, 0.95f, 0.95f, 1.0f };
+		targets.color = graph->AddTexture("color", width, height, render::GfxFormat::R8G8B8A8_UNORM, background);
+		targets.positions = graph->AddTexture("positions", width, height, render::GfxFormat::R16G16B16A16_SFLOAT);
+		targets.normals = graph->AddTexture("normals", width, height, render::GfxFormat::R16G16B16A16_SFLOAT);
+		targets.depth = graph->AddTexture("depth", width, height, render::GfxFormat::D32_FLOAT);
+
+		gbufferPass = graph->AddPass("gbuffer", [this](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+			models.example.Draw(commandBuffer);
+			models.plane.Draw(commandBuffer);
+		});
+		graph->Write(gbufferPass, targets.color, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+		graph->Write(gbufferPass, targets.positions, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+		graph->Write(gbufferPass, targets.normals, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+		graph->Write(gbufferPass, targets.depth, render::RENDER_GRAPH_DEPTH_ATTACHMENT);
+
+		//draws into the swapchain, which is outside of the graph
+		lightingPass = graph->AddPass("lighting", [this](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+			mainRenderPass->Begin(commandBuffer, frameBufferIndex);
+			pipelines.deferred->Draw(commandBuffer);
+			descriptorSets.deferred->Draw(commandBuffer, pipelines.deferred);
+			DrawFullScreenQuad(commandBuffer);
+			DrawUI(commandBuffer);
+			mainRenderPass->End(commandBuffer);
+		});
+		graph->Read(lightingPass, targets.color, render::RENDER_GRAPH_SAMPLED);
+		graph->Read(lightingPass, targets.positions, render::RENDER_GRAPH_SAMPLED);
+		graph->Read(lightingPass, targets.normals, render::RENDER_GRAPH_SAMPLED);
+		graph->SetSideEffects(lightingPass);
+
+		graph->Build(vulkanDevice);
+	}
+
 	void setupDescriptorPool()
 	{
 		// Example uses three ubos and two image samplers
@@ -293,7 +323,7 @@ public:
 		models.plane.AddDescriptor(descriptorSets.model);
 
 		descriptorSets.deferred = vulkanDevice->GetDescriptorSet(descriptorPool, { &uniformBuffers.fsdeferred->m_descriptor },
-			{ &scenecolor->m_descriptor , &scenepositions->m_descriptor, &scenenormals->m_descriptor }, layouts.deferred->m_descriptorSetLayout, layouts.deferred->m_setLayoutBindings);
+			{ &graph->GetTexture(targets.color)->m_descriptor , &graph->GetTexture(targets.positions)->m_descriptor, &graph->GetTexture(targets.normals)->m_descriptor }, layouts.deferred->m_descriptorSetLayout, layouts.deferred->m_setLayoutBindings);
 
 	}
 
@@ -312,10 +342,10 @@ public:
 		props.pAttachments = blendAttachmentStates.data();
 		pipelines.plane = vulkanDevice->GetPipeline(layouts.model->m_descriptorSetLayout, vertexLayout.m_vertexInputBindings, vertexLayout.m_vertexInputAttributes,
 			engine::tools::getAssetPath() + "shaders/basicdeferred/basictexturedcolored.vert.spv", engine::tools::getAssetPath() + "shaders/basicdeferred/basiccolored.frag.spv", 
-			scenepass->GetRenderPass(), pipelineCache, props);
+			graph->GetRenderPass(gbufferPass), pipelineCache, props);
 		pipelines.model = vulkanDevice->GetPipeline(layouts.model->m_descriptorSetLayout, vertexLayoutInstanced.m_vertexInputBindings, vertexLayoutInstanced.m_vertexInputAttributes,
 			engine::tools::getAssetPath() + "shaders/basicdeferred/basictexturedcoloredinstanced.vert.spv", engine::tools::getAssetPath() + "shaders/basicdeferred/basiccolored.frag.spv",
-			scenepass->GetRenderPass(), pipelineCache, props);
+			graph->GetRenderPass(gbufferPass), pipelineCache, props);
 		models.example.AddPipeline(pipelines.model);
 		models.plane.AddPipeline(pipelines.plane);
 
@@ -335,21 +365,7 @@ public:
 			//VK_CHECK_RESULT(vkBeginCommandBuffer(m_drawCommandBuffers[i], &cmdBufInfo));
 			m_drawCommandBuffers[i]->Begin();
 
-			scenepass->Begin(m_drawCommandBuffers[i], 0);
-			models.example.Draw(m_drawCommandBuffers[i]);
-			models.plane.Draw(m_drawCommandBuffers[i]);
-			scenepass->End(m_drawCommandBuffers[i]);
-
-			mainRenderPass->Begin(m_drawCommandBuffers[i], i);
-			//draw here
-			pipelines.deferred->Draw(m_drawCommandBuffers[i]);
-			descriptorSets.deferred->Draw(m_drawCommandBuffers[i], pipelines.deferred);
-			//vkCmdDraw(drawCommandBuffers[i], 3, 1, 0, 0);
-			DrawFullScreenQuad(m_drawCommandBuffers[i]);
-
-			DrawUI(m_drawCommandBuffers[i]);
-
-			mainRenderPass->End(m_drawCommandBuffers[i]);
+			graph->Execute(m_drawCommandBuffers[i], i);
 
 			//VK_CHECK_RESULT(vkEndCommandBuffer(drawCommandBuffers[i]));
 			m_drawCommandBuffers[i]->End();
@@ -394,6 +410,12 @@ public:
 		if (overlay->header("Settings")) {
 
 		}
+		if (overlay->header("Render graph")) {
+			const render::RenderGraphStatistics& statistics = graph->m_statistics;
+			overlay->text("%u passes, %u culled, %u barriers", statistics.passes, statistics.culledPasses, statistics.barriers);
+			overlay->text("%u transient textures, %.1f MB aliased into %.1f MB", statistics.transientTextures,
+				statistics.transientMemory / (1024.0f * 1024.0f), statistics.aliasedMemory / (1024.0f * 1024.0f));
+		}
 	}
 
 };
@@ -94,21 +94,18 @@ public:
 
 	struct {
 		render::DescriptorSetLayout* model;
-		render::DescriptorSetLayout* deferred;
 		render::DescriptorSetLayout* simpletexture;
 	} layouts;
 
 	struct {
 		render::Pipeline* plane;
 		render::Pipeline* model;
-		//render::Pipeline* deferred;
 		render::Pipeline* simpletexture;
 	} pipelines;
 
 	struct {
 		render::DescriptorSet* plane;
 		render::DescriptorSet* model;
-		render::DescriptorSet* deferred;
 		render::DescriptorSet* simpletexture;
 	} descriptorSets;
 
@@ -202,6 +199,10 @@ public:
 		scenepass->SetClearColor({ 0.0f, 0.0f, 0.0f, 0.0f }, 1);
 		scenepass->SetClearColor({ 0.0f, 0.0f, 0.0f, 0.0f }, 2);
 		scenepass->SetClearColor({ 0.0f, 0.0f, 0.0f, 1.0f }, 3);*/
+		//the positions and normals are only read as input attachments inside the pass, the colors are sampled after it
+		scenepositions->m_allowTransient = true;
+		scenenormals->m_allowTransient = true;
+		scenedepth->m_allowTransient = true;
 		scenepass = m_device->GetRenderPass(width, height, { scenecolor ,scenepositions, scenenormals, sceneLightscolor }, scenedepth, { render::RenderSubpass({}, {0,1,2,4}), render::RenderSubpass({1,2}, {3}) });
 		
 		/*scenepass->SetClearColor({ 0.0f, 0.0f, 0.0f, 0.0f }, 1);
@@ -298,21 +299,6 @@ public:
 
 		models.example.SetDescriptorSetLayout(layouts.model);
 
-		/*std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> deferredbindings
-		{
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT}
-		};*/
-		std::vector<render::LayoutBinding> deferredbindings{
-						{render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT},
-						{render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT},
-						{render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT},
-						{render::DescriptorType::UNIFORM_BUFFER, render::ShaderStage::FRAGMENT},
-		};
-		layouts.deferred = m_device->GetDescriptorSetLayout(deferredbindings);
-
 		/*std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> simpletexurebinding
 		{
 			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
@@ -432,9 +418,6 @@ public:
 		models.plane.AddDescriptor(descriptorSets.plane);
 		models.example.AddDescriptor(descriptorSets.model);	
 
-		descriptorSets.deferred = m_device->GetDescriptorSet(layouts.deferred, descriptorPool, { uniformBuffers.fsdeferred },
-			{ scenecolor , scenepositions, scenenormals });
-
 		descriptorSets.simpletexture = m_device->GetDescriptorSet(layouts.simpletexture, descriptorPool, {}, { scenecolor , sceneLightscolor });
 	}
 
@@ -461,13 +444,7 @@ public:
 		models.example.AddPipeline(pipelines.model);
 		models.plane.AddPipeline(pipelines.plane);
 
-		render::PipelineProperties props1;
-		props1.depthTestEnable = false;
-
 		render::VertexLayout* emptylayout = m_device->GetVertexLayout({}, {});
-		//pipelines.deferred = m_device->GetPipeline(//layouts.deferred->m_descriptorSetLayout, {}, {},
-		//	GetShadersPath() + "posteffects/screenquad" + GetVertexShadersExt(),"", GetShadersPath() + "basicdeferred/deferredlighting" + GetFragShadersExt(),"",
-		//	emptylayout, layouts.deferred, props1, m_mainRenderPass);
 
 		render::PipelineProperties props2;
 		pipelines.simpletexture = m_device->GetPipeline(//layouts.simpletexture->m_descriptorSetLayout, {}, {},
@@ -559,6 +536,11 @@ public:
 		if (overlay->header("Settings")) {
 
 		}
+		if (overlay->header("G-buffer")) {
+			const render::RenderPassStatistics& statistics = scenepass->m_statistics;
+			overlay->text("%u transient attachments, %u lazily allocated", statistics.transientAttachments, statistics.lazilyAllocatedAttachments);
+			overlay->text("%.1f MB of stores saved per frame", statistics.savedBytesPerFrame / (1024.0f * 1024.0f));
+		}
 	}
 
 };
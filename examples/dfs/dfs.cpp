@@ -4,32 +4,37 @@
 #include <string.h>
 #include <assert.h>
 #include <vector>
+#include <thread>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <vulkan/vulkan.h>
 #include "VulkanApplication.h"
+#include "threadpool.hpp"
 #include "render/vulkan/VulkanTexture.h"
 #include "scene/DrawDebug.h"
 #include "scene/SceneLoader.h"
 #include "scene/SimpleModel.h"
+#include "scene/SparseSdf.h"
 #include "render/vulkan/VulkanCommandBuffer.h"
 
-#define TEX_WIDTH 128
-#define TEX_HEIGHT 128
-#define TEX_DEPTH 128
-#define COMPUTE_GROUP_SIZE 8
-#define COMPUTE_GROUP_SIZE_Z 8
+//the shadows are traced in a 6 units cube, 18 cells of 7 voxels a side
+#define SDF_BOUNDS 3.0f
+#define SDF_VOXEL_SIZE (2.0f * SDF_BOUNDS / 126.0f)
+//bricks the atlas texture holds
+#define SDF_ATLAS_BRICKS_X 16
+#define SDF_ATLAS_BRICKS_Y 16
+#define SDF_ATLAS_BRICKS_Z 8
 
 #define CAMERA_NEAR_PLANE 0.1f
 #define CAMERA_FAR_PLANE 256.0f
 
-#define NUM_BLUE_NOISE_TEXTURES 16
-
 using namespace engine;
 
 class VulkanExample : public VulkanApplication
@@ -37,71 +42,42 @@ class VulkanExample : public VulkanApplication
 public:
 
 	render::VertexLayout* vertexLayout = nullptr;
-		/*render::VulkanVertexLayout(
-			{
-		render::VERTEX_COMPONENT_POSITION,
-		render::VERTEX_COMPONENT_NORMAL,
-		render::VERTEX_COMPONENT_UV
 
-		}, {});*/
-
-	//scene::SceneLoader scene;
-	//std::vector<scene::RenderObject*> scene_render_objects;
 	engine::scene::SimpleModel plane;
+	engine::scene::SimpleModel teapot;
 	render::Buffer* sceneVertexUniformBuffer;
 	scene::UniformBuffersManager uniform_manager;
 
 	render::DescriptorPool* descriptorPool;
 
-	render::VulkanDescriptorSetLayout* lightinjectiondescriptorSetLayout;
-	//render::VulkanDescriptorSetLayout* raymarchdescriptorSetLayout;
-
-	render::VulkanDescriptorSet* lightinjectiondescriptorSet;
-	//render::VulkanDescriptorSet* raymarchdescriptorSet;
-
-	render::VulkanPipeline* lightinjectionpipeline;
-	//render::VulkanPipeline* raymarchpipeline;
-
-	//render::VulkanTexture* textureColorMap;
-	render::VulkanTexture* textureDFS;
-	//render::VulkanTexture* textureCompute3dTargets[2];
-	//render::VulkanTexture* textureCompute3dTargetRaymarch;
-	//std::vector<render::VulkanTexture*> texturesBlueNoise;
-	//std::vector<std::string> textureBlueNoiseFilenames;
-	//render::VulkanTexture* textureBlueNoise;
-
-	struct UBOCompute
-	{
-		float textureWidth = TEX_WIDTH;
-		float textureHeight = TEX_HEIGHT;
-		float textureDepth = TEX_DEPTH;
-		int triangleCount = 0;
-	} uboCompute;
+	//venus and the teapot are baked once in their own volumes, the global volume the shadows are traced in is composed from them
+	scene::SdfMesh sdfMeshes[2];
+	scene::SparseSdf sdfVolumes[2];
+	scene::GlobalSdf globalSdf;
+	uint32_t teapotInstance = 0;
+	scene::SdfBakeStatistics lastBake;
+	ThreadPool threadPool;
 
-	render::VulkanBuffer* vertexStorageBuffer;
-	render::VulkanBuffer* indexStorageBuffer;
-	render::VulkanBuffer* computeUniformBuffer;
-
-	glm::mat4 previous_view_proj;
+	render::VulkanTexture* textureSdfIndirection;
+	render::VulkanTexture* textureSdfAtlas;
 
 	struct {
-		glm::mat4 view_proj;
-		glm::vec4 bias_near_far_pow;
-	} uboFSscene;
-	//render::VulkanBuffer* globalSceneFragmentUniformBuffer = nullptr;
+		glm::vec4 boundsMin;//w cell size
+		glm::vec4 cellCount;//w voxels per brick side
+		glm::vec4 atlasSize;//w max distance
+	} uboSdf;
+
+	render::VulkanBuffer* sdfUniformBuffer;
+	render::VulkanBuffer* planeModelUniformBuffer;
+	render::VulkanBuffer* teapotModelUniformBuffer;
 
 	scene::DrawDebugTexture dbgtex;
 	float depth = 0.0f;
 
-	float m_ct_ping_pong = false;
-	int m_currentNoiseIndex = 0;
-
 	float lightAngle = glm::radians(-45.0f);
 
-	//std::vector<VkCommandBuffer> drawShadowCmdBuffers;
-	std::vector<render::CommandBuffer*> drawComputeCmdBuffers;
-
-	engine::scene::SimpleModel model;
+	bool moveTeapot = false;
+	float teapotTime = 0.0f;
 
 	VulkanExample() : VulkanApplication(true)
 	{
@@ -114,123 +90,115 @@ public:
 		camera.SetPerspective(60.0f, (float)width / (float)height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 		camera.SetRotation(glm::vec3(0.0f, 0.0f, 0.0f));
 		camera.SetPosition(glm::vec3(0.0f, 0.0f, -3.0f));
-		//camera.setTranslation(glm::vec3(0.0f, 0.0f, 0.0f));
-
-		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
-		glm::mat4 viewMatrix = camera.GetViewMatrix();
-
-		previous_view_proj = perspectiveMatrix * viewMatrix;
 	}
 
 	~VulkanExample()
 	{
 	}
 
-	void initComputeObjects()
+	void bakeObject(const std::vector<render::MeshData*>& geos, scene::SdfMesh& mesh, scene::SparseSdf& volume)
 	{
-		/*for (int i = 0; i < NUM_BLUE_NOISE_TEXTURES; i++)
-			textureBlueNoiseFilenames.push_back(engine::tools::getAssetPath() + "textures/blue_noise/LDR_LLL1_" + std::to_string(i) + ".png");
-		textureBlueNoise = vulkanDevice->GetTextureArray(textureBlueNoiseFilenames, VK_FORMAT_R8G8B8A8_UNORM, queue);*/
-
-		computeUniformBuffer = vulkanDevice->GetUniformBuffer(sizeof(uboCompute));
-		VK_CHECK_RESULT(computeUniformBuffer->Map());
-
-		std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> computebindings
-		{
-			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
-			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
-			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT}
-		};
-		lightinjectiondescriptorSetLayout = vulkanDevice->GetDescriptorSetLayout(computebindings);
-		/*lightinjectiondescriptorSet = vulkanDevice->GetDescriptorSet(descriptorPool,
-			{ &vertexStorageBuffer->m_descriptor, &indexStorageBuffer->m_descriptor, &computeUniformBuffer->m_descriptor }, { &textureDFS->m_descriptor },
-			lightinjectiondescriptorSetLayout->m_descriptorSetLayout, lightinjectiondescriptorSetLayout->m_setLayoutBindings);*/
-		lightinjectiondescriptorSet = (render::VulkanDescriptorSet*)vulkanDevice->GetDescriptorSet(lightinjectiondescriptorSetLayout, descriptorPool,
-			{ vertexStorageBuffer, indexStorageBuffer, computeUniformBuffer }, { textureDFS });
-
-		/*std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> rmbindings
-		{
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
-			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT}
-		};
-		raymarchdescriptorSetLayout = vulkanDevice->GetDescriptorSetLayout(rmbindings);
-		raymarchdescriptorSet = vulkanDevice->GetDescriptorSet({ &computeUniformBuffer->m_descriptor }, { &textureCompute3dTargets[0]->m_descriptor, &textureCompute3dTargetRaymarch->m_descriptor },
-			raymarchdescriptorSetLayout->m_descriptorSetLayout, raymarchdescriptorSetLayout->m_setLayoutBindings);*/
-
-		std::string fileName = engine::tools::getAssetPath() + "shaders/computeshader/" + "generatedf" + ".comp.spv";
-		lightinjectionpipeline = vulkanDevice->GetComputePipeline(fileName, lightinjectiondescriptorSetLayout->m_descriptorSetLayout, pipelineCache);
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		scene::Bvh::GetTriangles(geos, vertexLayout, positions, indices);
+		mesh.Build(positions, indices);
+		//twice as fine as the global volume, with room for the distances around the object
+		glm::vec3 margin(2.0f * SDF_VOXEL_SIZE * SDF_BRICK_CELLS);
+		volume.Init(mesh.GetBoundsMin() - margin, mesh.GetBoundsMax() + margin, SDF_VOXEL_SIZE * 0.5f);
+		volume.Bake(mesh, &threadPool);
+	}
 
-		/*fileName = engine::tools::getAssetPath() + "shaders/computeshader/" + "raymarch" + ".comp.spv";
-		raymarchpipeline = vulkanDevice->GetComputePipeline(fileName, device, raymarchdescriptorSetLayout->m_descriptorSetLayout, pipelineCache);*/
+	glm::uvec3 getAtlasOrigin(uint32_t brick)
+	{
+		return glm::uvec3(brick % SDF_ATLAS_BRICKS_X, (brick / SDF_ATLAS_BRICKS_X) % SDF_ATLAS_BRICKS_Y, brick / (SDF_ATLAS_BRICKS_X * SDF_ATLAS_BRICKS_Y)) * glm::uvec3(SDF_BRICK_SIZE);
 	}
 
-	void generateSSOs(std::vector<render::MeshData*> geos)
+	//the whole indirection goes up every time, it is small, the atlas only gets the bricks of the given cells
+	void uploadSdf(const std::vector<uint32_t>& cells)
 	{
-		std::vector<glm::vec4> vertexBuffer;
-		std::vector<uint32_t> indexBuffer;
-		int vertexSize = vertexLayout->GetVertexSize(0)/sizeof(float);
-		for(auto geo : geos)
-		for (int i = 0; i < geo->m_verticesSize; i += vertexSize)
+		const scene::SparseSdf& volume = globalSdf.m_volume;
+		const uint32_t brickSamples = SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE;
+		std::vector<uint16_t> data(volume.GetCellTotal() * 4);
+		for (uint32_t cell = 0; cell < volume.GetCellTotal(); cell++)
 		{
-			vertexBuffer.push_back(glm::vec4(geo->m_vertices[i], geo->m_vertices[i+1], geo->m_vertices[i+2], 1.0));
+			uint32_t brick = volume.m_indirection[cell];
+			glm::vec3 origin = brick == SDF_EMPTY_BRICK ? glm::vec3(-1.0f) : glm::vec3(getAtlasOrigin(brick));
+			data[cell * 4] = glm::packHalf1x16(origin.x);
+			data[cell * 4 + 1] = glm::packHalf1x16(origin.y);
+			data[cell * 4 + 2] = glm::packHalf1x16(origin.z);
+			data[cell * 4 + 3] = glm::packHalf1x16(volume.m_cellDistances[cell]);
 		}
 
-		VkDeviceSize vertexStorageBufferSize = vertexBuffer.size() * sizeof(glm::vec4);
-		render::VulkanBuffer* stagingBuffer;
-		stagingBuffer = vulkanDevice->CreateStagingBuffer(vertexStorageBufferSize, vertexBuffer.data());
-		vertexStorageBuffer = vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-			, queue, vertexStorageBufferSize, nullptr);
-
-		int indexOffset = 0;
-		for (auto geo : geos)
+		std::vector<VkBufferImageCopy> regions;
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { volume.m_cellCount.x, volume.m_cellCount.y, volume.m_cellCount.z };
+		regions.push_back(region);
+		for (auto cell : cells)
 		{
-			for (int i = 0; i < geo->m_indexCount; i++)
-			{
-				indexBuffer.push_back(geo->m_indices[i] + indexOffset);
-			}
-			indexOffset += geo->m_indexCount;
+			uint32_t brick = volume.m_indirection[cell];
+			if (brick == SDF_EMPTY_BRICK)
+				continue;
+			glm::uvec3 origin = getAtlasOrigin(brick);
+			region.bufferOffset = data.size() * sizeof(uint16_t);
+			region.imageOffset = { (int32_t)origin.x, (int32_t)origin.y, (int32_t)origin.z };
+			region.imageExtent = { SDF_BRICK_SIZE, SDF_BRICK_SIZE, SDF_BRICK_SIZE };
+			regions.push_back(region);
+			const float* samples = volume.GetBrick(brick);
+			for (uint32_t i = 0; i < brickSamples; i++)
+				data.push_back(glm::packHalf1x16(samples[i]));
 		}
 
-		VkDeviceSize indexStorageBufferSize = indexBuffer.size() * sizeof(uint32_t);
-		render::VulkanBuffer* istagingBuffer;
-		istagingBuffer = vulkanDevice->CreateStagingBuffer(indexStorageBufferSize, indexBuffer.data());
-		indexStorageBuffer = vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-			, queue, indexStorageBufferSize, nullptr);
-
+		render::VulkanBuffer* stagingBuffer = vulkanDevice->CreateStagingBuffer(data.size() * sizeof(uint16_t), data.data());
 		VkCommandBuffer copyCmd = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBufferCopy copyRegion = {};
-		copyRegion.size = vertexStorageBufferSize;
-		vkCmdCopyBuffer(copyCmd, stagingBuffer->GetVkBuffer(), vertexStorageBuffer->GetVkBuffer(), 1, &copyRegion);
-		copyRegion.size = indexStorageBufferSize;
-		vkCmdCopyBuffer(copyCmd, istagingBuffer->GetVkBuffer(), indexStorageBuffer->GetVkBuffer(), 1, &copyRegion);
+		//the storage textures stay in the general layout, copies can write to it
+		textureSdfIndirection->PipelineBarrier(copyCmd, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		textureSdfAtlas->PipelineBarrier(copyCmd, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		vkCmdCopyBufferToImage(copyCmd, stagingBuffer->GetVkBuffer(), textureSdfIndirection->m_vkImage, VK_IMAGE_LAYOUT_GENERAL, 1, regions.data());
+		if (regions.size() > 1)
+			vkCmdCopyBufferToImage(copyCmd, stagingBuffer->GetVkBuffer(), textureSdfAtlas->m_vkImage, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(regions.size() - 1), regions.data() + 1);
+		textureSdfIndirection->PipelineBarrier(copyCmd, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		textureSdfAtlas->PipelineBarrier(copyCmd, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 		vulkanDevice->FlushCommandBuffer(copyCmd, queue, true);
 		vulkanDevice->DestroyBuffer(stagingBuffer);
-		vulkanDevice->DestroyBuffer(istagingBuffer);
-		vkQueueWaitIdle(queue);
-		vkDeviceWaitIdle(device);
+	}
+
+	void initSdf()
+	{
+		globalSdf.Init(glm::vec3(-SDF_BOUNDS), glm::vec3(SDF_BOUNDS), SDF_VOXEL_SIZE, 0.0f, 0.0f, SDF_ATLAS_BRICKS_X * SDF_ATLAS_BRICKS_Y * SDF_ATLAS_BRICKS_Z);
+		globalSdf.AddInstance(&sdfVolumes[0], glm::mat4(1.0f));
+		teapotInstance = globalSdf.AddInstance(&sdfVolumes[1], glm::mat4(1.0f));
+		lastBake = globalSdf.Update(&threadPool);
+
+		const scene::SparseSdf& volume = globalSdf.m_volume;
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, VK_FORMAT_R16_SFLOAT, &formatProperties);
+		// Check if requested image format supports image storage operations
+		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+
+		textureSdfIndirection = vulkanDevice->GetTextureStorage({ volume.m_cellCount.x, volume.m_cellCount.y, volume.m_cellCount.z }, VK_FORMAT_R16G16B16A16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);
+		textureSdfAtlas = vulkanDevice->GetTextureStorage({ SDF_ATLAS_BRICKS_X * SDF_BRICK_SIZE, SDF_ATLAS_BRICKS_Y * SDF_BRICK_SIZE, SDF_ATLAS_BRICKS_Z * SDF_BRICK_SIZE }, VK_FORMAT_R16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);
+		uploadSdf(globalSdf.m_updatedCells);
+
+		uboSdf.boundsMin = glm::vec4(volume.m_boundsMin, volume.GetCellSize());
+		uboSdf.cellCount = glm::vec4(glm::vec3(volume.m_cellCount), SDF_BRICK_CELLS);
+		uboSdf.atlasSize = glm::vec4(SDF_ATLAS_BRICKS_X * SDF_BRICK_SIZE, SDF_ATLAS_BRICKS_Y * SDF_BRICK_SIZE, SDF_ATLAS_BRICKS_Z * SDF_BRICK_SIZE, volume.m_maxDistance);
+		sdfUniformBuffer = vulkanDevice->GetUniformBuffer(sizeof(uboSdf));
+		VK_CHECK_RESULT(sdfUniformBuffer->Map());
+		sdfUniformBuffer->MemCopy(&uboSdf, sizeof(uboSdf));
 	}
 
 	void setupDescriptorPool()
 	{
-		/*std::vector<VkDescriptorPoolSize> poolSizes = {
-			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
-			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
-			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
-			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2}
-		};
-		descriptorPool = vulkanDevice->CreateDescriptorSetsPool(poolSizes, 4);*/
 		descriptorPool = vulkanDevice->GetDescriptorPool({
-			{ render::DescriptorType::UNIFORM_BUFFER, 1 },
-			{render::DescriptorType::IMAGE_SAMPLER, 2 },
-			{render::DescriptorType::INPUT_STORAGE_BUFFER, 2 },
-			{render::DescriptorType::STORAGE_IMAGE, 2 }
-			}, 4);
+			{ render::DescriptorType::UNIFORM_BUFFER, 8 },
+			{render::DescriptorType::IMAGE_SAMPLER, 6 }
+			}, 6);
 	}
 
 	void init()
-	{	
+	{
 		vertexLayout = m_device->GetVertexLayout(
 			{
 				render::VERTEX_COMPONENT_POSITION,
@@ -239,40 +207,36 @@ public:
 
 			}, {});
 
+		threadPool.setThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+
 		setupDescriptorPool();
 		std::vector<render::MeshData*> pmd = plane.LoadGeometry(engine::tools::getAssetPath() + "models/plane.obj", vertexLayout, 1.1f, 1, glm::vec3(0.0f, 1.0f,0.0f));
-		//plane.LoadGeometry(engine::tools::getAssetPath() + "models/sphere.obj", &vertexLayout, 0.02f, 1, glm::vec3(-0.7f, 0.0f, 0.0f));
 		std::vector<render::MeshData*> pmd1 = plane.LoadGeometry(engine::tools::getAssetPath() + "models/venus.fbx", vertexLayout, 0.1f, 1, glm::vec3(-0.7f, 1.0f, 0.0f));
-		std::vector<render::MeshData*> pmd2 = plane.LoadGeometry(engine::tools::getAssetPath() + "models/teapot.dae", vertexLayout, 0.05f, 1, glm::vec3(0.7f, 0.0f, 0.0f));
+		std::vector<render::MeshData*> pmd2 = teapot.LoadGeometry(engine::tools::getAssetPath() + "models/teapot.dae", vertexLayout, 0.05f, 1, glm::vec3(0.7f, 0.0f, 0.0f));
+		bakeObject(pmd1, sdfMeshes[0], sdfVolumes[0]);
+		bakeObject(pmd2, sdfMeshes[1], sdfVolumes[1]);
 		pmd.insert(pmd.end(), pmd1.begin(), pmd1.end());
-		pmd.insert(pmd.end(), pmd2.begin(), pmd2.end());
 
 		for (auto geo : pmd)
 		{
-			//geo->SetIndexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_indexCount * sizeof(uint32_t), geo->m_indices),true);
-			//geo->SetVertexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_verticesSize * sizeof(float), geo->m_vertices),true);
 			plane.AddGeometry(vulkanDevice->GetMesh(geo, vertexLayout, nullptr));
-			//delete geo;
+			delete geo;
 		}
-
-		//model.LoadGeometry(engine::tools::getAssetPath() + "models/venus.fbx", &vertexLayout, 0.1f, 1);
-		//model.LoadGeometry(engine::tools::getAssetPath() + "models/oak_trunk.dae", &vertexLayout, 1.0f, 1);
-		//model.LoadGeometry(engine::tools::getAssetPath() + "models/teapot.dae", &vertexLayout, 0.08f, 1);
-		//model.LoadGeometry(engine::tools::getAssetPath() + "models/sphere.obj", &vertexLayout, 0.1f, 1);
-		//model.LoadGeometry(engine::tools::getAssetPath() + "models/cube.obj", &vertexLayout, 0.2f, 1);
-		/*for (auto geo : model.m_geometries)
-		{
-			geo->SetIndexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_indexCount * sizeof(uint32_t), geo->m_indices),true);
-			geo->SetVertexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_verticesSize * sizeof(float), geo->m_vertices),true);
-		}*/
-		std::vector<render::MeshData*> geos(pmd.begin()+1, pmd.end());
-		generateSSOs(geos);
-		for (auto geo : pmd)
+		for (auto geo : pmd2)
 		{
+			teapot.AddGeometry(vulkanDevice->GetMesh(geo, vertexLayout, nullptr));
 			delete geo;
 		}
 
-		textureDFS = vulkanDevice->GetTextureStorage({ TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH }, VK_FORMAT_R16G16B16A16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);
+		initSdf();
+
+		glm::mat4 identity(1.0f);
+		planeModelUniformBuffer = vulkanDevice->GetUniformBuffer(sizeof(identity));
+		VK_CHECK_RESULT(planeModelUniformBuffer->Map());
+		planeModelUniformBuffer->MemCopy(&identity, sizeof(identity));
+		teapotModelUniformBuffer = vulkanDevice->GetUniformBuffer(sizeof(identity));
+		VK_CHECK_RESULT(teapotModelUniformBuffer->Map());
+		teapotModelUniformBuffer->MemCopy(&identity, sizeof(identity));
 
 		uniform_manager.SetDescriptorPool(descriptorPool);
 		uniform_manager.SetEngineDevice(vulkanDevice);
@@ -281,173 +245,24 @@ public:
 		std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> modelbindings
 		{
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT}
 		};
-		plane.SetDescriptorSetLayout(vulkanDevice->GetDescriptorSetLayout(modelbindings));
-
-		/*plane.AddDescriptor(vulkanDevice->GetDescriptorSet(descriptorPool, { &sceneVertexUniformBuffer->m_descriptor }, { &textureDFS->m_descriptor },
-			plane._descriptorLayout->m_descriptorSetLayout, plane._descriptorLayout->m_setLayoutBindings));*/
-		plane.AddDescriptor(vulkanDevice->GetDescriptorSet(plane._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer }, { textureDFS }));
 		render::PipelineProperties props;
-		/*plane.AddPipeline(vulkanDevice->GetPipeline(plane._descriptorLayout->m_descriptorSetLayout, vertexLayout.m_vertexInputBindings, vertexLayout.m_vertexInputAttributes,
-			engine::tools::getAssetPath() + "shaders/basic/dfs.vert.spv", engine::tools::getAssetPath() + "shaders/basic/dfs.frag.spv", mainRenderPass->GetRenderPass(), pipelineCache, props));*/
+		plane.SetDescriptorSetLayout(vulkanDevice->GetDescriptorSetLayout(modelbindings));
+		plane.AddDescriptor(vulkanDevice->GetDescriptorSet(plane._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer, sdfUniformBuffer, planeModelUniformBuffer }, { textureSdfIndirection, textureSdfAtlas }));
 		plane.AddPipeline(vulkanDevice->GetPipeline(
 			engine::tools::getAssetPath() + "shaders/basic/dfs.vert.spv","", engine::tools::getAssetPath() + "shaders/basic/dfs.frag.spv","",
 			vertexLayout,plane._descriptorLayout, props, mainRenderPass));
+		teapot.SetDescriptorSetLayout(plane._descriptorLayout);
+		teapot.AddDescriptor(vulkanDevice->GetDescriptorSet(teapot._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer, sdfUniformBuffer, teapotModelUniformBuffer }, { textureSdfIndirection, textureSdfAtlas }));
+		teapot.AddPipeline(vulkanDevice->GetPipeline(
+			engine::tools::getAssetPath() + "shaders/basic/dfs.vert.spv", "", engine::tools::getAssetPath() + "shaders/basic/dfs.frag.spv", "",
+			vertexLayout, teapot._descriptorLayout, props, mainRenderPass));
 
-		/*textureCompute3dTargets[0] = vulkanDevice->GetTextureStorage({ TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH }, VK_FORMAT_R16G16B16A16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);
-		textureCompute3dTargets[1] = vulkanDevice->GetTextureStorage({ TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH }, VK_FORMAT_R16G16B16A16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);
-		textureCompute3dTargetRaymarch = vulkanDevice->GetTextureStorage({ TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH }, VK_FORMAT_R16G16B16A16_SFLOAT, queue, VK_IMAGE_VIEW_TYPE_3D);*/
-
-		/*scene.globalTextures.push_back(textureDFS);
-		scene._device = vulkanDevice;
-		scene.CreateShadow(queue);
-		scene.globalTextures.push_back(scene.shadowmap);
-		scene.globalTextures.push_back(scene.shadowmapColor);
-
-		scene.SetCamera(&camera);
-		scene.uniform_manager.SetEngineDevice(vulkanDevice);
-
-		scene.lightingVS = "dfs.vert.spv";
-		scene.lightingFS = "dfs.frag.spv";
-		scene.lightingTexturedFS = "phongtexturedshadowmap_vf.frag.spv";
-		scene.normalmapVS = "normalmapshadowmap.vert.spv";
-		scene.normalmapFS = "normalmapshadowmap_vf.frag.spv";
-		scene.sceneFragmentUniformBuffer = vulkanDevice->GetUniformBuffer(sizeof(uboFSscene));
-		VK_CHECK_RESULT(scene.sceneFragmentUniformBuffer->Map());
-		scene::ModelCreateInfo2 modelCreateInfo(3.0, 1.0f, glm::vec3(0.0,2.0,0.0));
-		scene_render_objects = scene.LoadFromFile2(engine::tools::getAssetPath() + "models/", "plane.obj", &modelCreateInfo, vulkanDevice, queue, mainRenderPass->GetRenderPass(), pipelineCache);
-		scene.light_pos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); 
-
-		scene.CreateShadowObjects(pipelineCache);*/
-
-		//textureColorMap = vulkanDevice->GetTexture(engine::tools::getAssetPath() + "textures/vulkan_11_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, queue, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, VK_FORMAT_R16G16B16A16_SFLOAT, &formatProperties);
-		// Check if requested image format supports image storage operations
-		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
-		
-		//scene.Update(timer * 0.05f, queue);
-
-		dbgtex.Init(vulkanDevice, descriptorPool, textureDFS, queue, mainRenderPass, pipelineCache);
-
-		initComputeObjects();
-	}
-
-	virtual void CreateAllCommandBuffers()
-	{
-		/*if (vulkanDevice->queueFamilyIndices.graphicsFamily == UINT32_MAX)
-			return;*/
-		// Create one command buffer for each swap chain image and reuse for rendering
-		
-		/*drawComputeCmdBuffers = vulkanDevice->CreatedrawCommandBuffers(swapChain.swapChainImageViews.size(), vulkanDevice->queueFamilyIndices.graphicsFamily);
-		drawCommandBuffers = vulkanDevice->CreatedrawCommandBuffers(swapChain.swapChainImageViews.size(), vulkanDevice->queueFamilyIndices.graphicsFamily);
-
-		allDrawCommandBuffers.push_back(drawComputeCmdBuffers);
-		allDrawCommandBuffers.push_back(drawCommandBuffers);*/
-
-		drawComputeCmdBuffers = CreateCommandBuffers();
-		m_drawCommandBuffers = CreateCommandBuffers();
-		
-	}
-
-	/*void buildShadowCommanBuffers()
-	{
-		VkCommandBufferBeginInfo cmdBufInfo{};
-		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-		for (int32_t i = 0; i < drawShadowCmdBuffers.size(); ++i)
-		{
-
-			VK_CHECK_RESULT(vkBeginCommandBuffer(drawShadowCmdBuffers[i], &cmdBufInfo));
-
-			scene.DrawShadowsInSeparatePass(drawShadowCmdBuffers[i]);
-
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawShadowCmdBuffers[i]));
-		}
-	}*/
-	/*void addBufferToComputeBarrier(VkCommandBuffer commandBuffer)
-	{
-		VkBufferMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-		barrier.buffer = myBuffer;
-		barrier.offset = 0;
-		barrier.size = VK_WHOLE_SIZE;
-
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			0,
-			0, nullptr,
-			1, &barrier,
-			0, nullptr
-		);
-	}*/
-
-	void addComputeToGraphicsBarriers(VkCommandBuffer commandBuffer)
-	{
-		VkBufferMemoryBarrier bufferBarrier{};
-		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-		bufferBarrier.size = VK_WHOLE_SIZE;
-		std::vector<VkBufferMemoryBarrier> bufferBarriers;
-		bufferBarrier.buffer = indexStorageBuffer->GetVkBuffer();
-		bufferBarriers.push_back(bufferBarrier);
-		bufferBarrier.buffer = vertexStorageBuffer->GetVkBuffer();
-		bufferBarriers.push_back(bufferBarrier);
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_FLAGS_NONE,
-			0, nullptr,
-			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
-			0, nullptr);
-	}
-
-	void buildComputeCommandBuffers()
-	{
-		VkCommandBufferBeginInfo cmdBufInfo{};
-		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		uint32_t read_idx = static_cast<uint32_t>(m_ct_ping_pong);
-		uint32_t write_idx = static_cast<uint32_t>(!m_ct_ping_pong);
-
-		for (int32_t i = 0; i < drawComputeCmdBuffers.size(); ++i)
-		{
-			//VK_CHECK_RESULT(vkBeginCommandBuffer(drawComputeCmdBuffers[i], &cmdBufInfo));
-			drawComputeCmdBuffers[i]->Begin();
-			VkCommandBuffer vkbuffer = ((render::VulkanCommandBuffer*)drawComputeCmdBuffers[i])->m_vkCommandBuffer;
-
-			addComputeToGraphicsBarriers(vkbuffer);
-			// Image memory barrier to make sure that compute shader writes are finished before sampling from the texture
-			/*scene.shadowmap->PipelineBarrier(drawComputeCmdBuffers[i],
-				VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-				);*/
-
-			lightinjectionpipeline->Draw(vkbuffer);
-			lightinjectiondescriptorSet->Draw(vkbuffer, lightinjectionpipeline->getPipelineLayout(), 0, VK_PIPELINE_BIND_POINT_COMPUTE);
-			vkCmdDispatch(vkbuffer, TEX_WIDTH / COMPUTE_GROUP_SIZE, TEX_HEIGHT / COMPUTE_GROUP_SIZE, TEX_DEPTH / COMPUTE_GROUP_SIZE_Z);
-
-			//VK_CHECK_RESULT(vkEndCommandBuffer(drawComputeCmdBuffers[i]));
-			drawComputeCmdBuffers[i]->End();
-		}
-
-		/*VkCommandBuffer cmdBuf = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		addComputeToGraphicsBarriers(cmdBuf);
-		lightinjectionpipeline->Draw(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE);
-		lightinjectiondescriptorSet->Draw(cmdBuf, lightinjectionpipeline->getPipelineLayout(), 0, VK_PIPELINE_BIND_POINT_COMPUTE);
-		vkCmdDispatch(cmdBuf, TEX_WIDTH / COMPUTE_GROUP_SIZE, TEX_HEIGHT / COMPUTE_GROUP_SIZE, TEX_DEPTH / COMPUTE_GROUP_SIZE_Z);
-		vulkanDevice->FlushCommandBuffer(cmdBuf, queue);
-		vkQueueWaitIdle(queue);*/
+		dbgtex.Init(vulkanDevice, descriptorPool, textureSdfAtlas, queue, mainRenderPass, pipelineCache);
 	}
 
 	virtual void BuildCommandBuffers()
@@ -457,24 +272,12 @@ public:
 
 		for (int32_t i = 0; i < m_drawCommandBuffers.size(); ++i)
 		{
-			//VK_CHECK_RESULT(vkBeginCommandBuffer(drawCommandBuffers[i], &cmdBufInfo));
 			m_drawCommandBuffers[i]->Begin();
-			VkCommandBuffer vkbuffer = ((render::VulkanCommandBuffer*)m_drawCommandBuffers[i])->m_vkCommandBuffer;
-
-			// Image memory barrier to make sure that compute shader writes are finished before sampling from the texture
-			textureDFS->PipelineBarrier(vkbuffer,
-				VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-				);
 
 			mainRenderPass->Begin(m_drawCommandBuffers[i], i);
 
 			plane.Draw(m_drawCommandBuffers[i]);
-
-			/*for (int j = 0; j < scene_render_objects.size(); j++) {
-				if(scene_render_objects[j])
-				scene_render_objects[j]->Draw(drawCommandBuffers[i]);
-			}*/
+			teapot.Draw(m_drawCommandBuffers[i]);
 
 			dbgtex.Draw(m_drawCommandBuffers[i]);
 
@@ -482,7 +285,6 @@ public:
 
 			mainRenderPass->End(m_drawCommandBuffers[i]);
 
-			//VK_CHECK_RESULT(vkEndCommandBuffer(drawCommandBuffers[i]));
 			m_drawCommandBuffers[i]->End();
 		}
 	}
@@ -507,129 +309,69 @@ public:
 
 	void Prepare()
 	{
-		
+
 		init();
 		PrepareUI();
-		//buildShadowCommanBuffers();
-		buildComputeCommandBuffers();
 		BuildCommandBuffers();
-		
+
 		prepared = true;
 	}
 
+	//only the cells around where the teapot was and where it is now are baked and uploaded again
+	void updateTeapot()
+	{
+		teapotTime += frameTimer;
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, sinf(teapotTime)));
+		globalSdf.SetTransform(teapotInstance, transform);
+		lastBake = globalSdf.Update(&threadPool);
+
+		//the frames in flight read the textures and the model matrix
+		vkQueueWaitIdle(queue);
+		teapotModelUniformBuffer->MemCopy(&transform, sizeof(transform));
+		uploadSdf(globalSdf.m_updatedCells);
+	}
+
 	virtual void update(float dt)
 	{
-		
+
 		depth += frameTimer * 0.15f;
 		if (depth > 1.0f)
 			depth = depth - 1.0f;
 
-		m_currentNoiseIndex++;
-		if (m_currentNoiseIndex > 15)
-			m_currentNoiseIndex = 0;
-
-		//scene.light_pos = glm::vec4(0.0f, sin(lightAngle) * 150, cos(lightAngle) * 150, 1.0f);
-		//scene.light_pos = glm::vec4(sin(lightAngle) * 80, -20.0f, cos(lightAngle) * 80, 1.0f);
+		if (moveTeapot)
+			updateTeapot();
 
 		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
 		glm::mat4 viewMatrix = camera.GetViewMatrix();
 
-		//uboCompute.view = viewMatrix;
-		//uboCompute.projection = perspectiveMatrix;
-		//uboCompute.inv_view_proj = glm::inverse(perspectiveMatrix * viewMatrix);
-		//uboCompute.prev_view_proj = previous_view_proj;
-		//uboCompute.bias_near_far_pow = glm::vec4(0.002f, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE, 1.0f);
-		//uboCompute.light_view_proj = scene.uboShadowOffscreenVS.depthMVP;
-		//uboCompute.camera_position = glm::vec4(-camera.GetPosition(), 1.0f);
-		//uboCompute.time = depth;
-		uboCompute.triangleCount = plane.m_geometries[1]->m_indexCount + plane.m_geometries[2]->m_indexCount;//m_currentNoiseIndex;
-		computeUniformBuffer->MemCopy(&uboCompute, sizeof(uboCompute));
-
-		previous_view_proj = perspectiveMatrix * viewMatrix;
-
-		/*uboFSscene.view_proj = perspectiveMatrix * viewMatrix;
-		uboFSscene.bias_near_far_pow = glm::vec4(0.002f, scene.m_camera->getNearClip(), scene.m_camera->getFarClip(), 1.0f);
-		scene.sceneFragmentUniformBuffer->MemCopy(&uboFSscene, sizeof(uboFSscene));*/
-
 		glm::mat4 transM = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,-6.0f,0.0f));
 
 		dbgtex.UpdateUniformBuffers(perspectiveMatrix, viewMatrix * transM, depth);
 
-		//uint32_t read_idx = static_cast<uint32_t>(m_ct_ping_pong);
-		//uint32_t write_idx = static_cast<uint32_t>(!m_ct_ping_pong);
-
-		//vkWaitForFences(device, submitFences.size(), submitFences.data(), VK_TRUE, UINT64_MAX);
-
-		//lightinjectiondescriptorSet->Update(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &textureCompute3dTargets[read_idx]->m_descriptor);
-		//lightinjectiondescriptorSet->Update(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, nullptr, &textureCompute3dTargets[write_idx]->m_descriptor);
-		//raymarchdescriptorSet->Update(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &textureCompute3dTargets[write_idx]->m_descriptor);
-		//buildComputeCommandBuffers();
-		//m_ct_ping_pong = !m_ct_ping_pong;
-
 		updateUniformBuffers();
 	}
 
 	virtual void ViewChanged()
-	{		
-		//updateUniformBuffers();		
-		
-	}
-	int framesno = 0;
-	void Render()
 	{
-		if (!prepared)
-			return;
-
-		vkWaitForFences(device, 1, &submitFences[currentBuffer], VK_TRUE, UINT64_MAX);
-
-		VkResult result = swapChain.acquireNextImage(presentCompleteSemaphores[currentBuffer], &currentBuffer);
-		// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
-		if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
-			WindowResize();
-		}
-		else {
-			VK_CHECK_RESULT(result);
-		}
+		//updateUniformBuffers();
 
-		vkResetFences(device, 1, &submitFences[currentBuffer]);
-
-		framesno++;
-
-		int dif = framesno > 2 ? 1 : 0;
-
-		std::vector<VkCommandBuffer> submitCommandBuffers(allvkDrawCommandBuffers[currentBuffer].size() - dif);
-		for (int i = 0; i < submitCommandBuffers.size(); i++)
-		{
-			submitCommandBuffers[i] = allvkDrawCommandBuffers[currentBuffer][i + dif];
-		}
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentBuffer];
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentBuffer];
-		submitInfo.commandBufferCount = submitCommandBuffers.size();
-		submitInfo.pCommandBuffers = submitCommandBuffers.data();
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, submitFences[currentBuffer]));
-
-		//VulkanApplication::PresentFrame();
-		result = swapChain.queuePresent(presentationQueue, currentBuffer, renderCompleteSemaphores[currentBuffer]);
-		if (!((result == VK_SUCCESS) || (result == VK_SUBOPTIMAL_KHR))) {
-			if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-				// Swap chain is no longer compatible with the surface and needs to be recreated
-				WindowResize();
-				return;
-			}
-			else {
-				VK_CHECK_RESULT(result);
-			}
-		}
-		currentBuffer = (currentBuffer + 1) % swapChain.swapChainImageViews.size();
 	}
 
 	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
 			ImGui::SliderAngle("Sun Angle", &lightAngle, 0.0f, -180.0f);
+			overlay->checkBox("Move teapot", &moveTeapot);
+		}
+		if (overlay->header("Distance field")) {
+			const scene::SparseSdf& volume = globalSdf.m_volume;
+			overlay->text("%u of %u cells have a brick, %u atlas slots", volume.GetBrickCount(), volume.GetCellTotal(), volume.GetBrickSlots());
+			overlay->text("last bake: %u cells %u bricks in %.2f ms", lastBake.cellsBaked, lastBake.bricksBaked, lastBake.microseconds / 1000.0f);
+			if (lastBake.bricksDropped > 0)
+				overlay->text("%u bricks over the atlas capacity", lastBake.bricksDropped);
 		}
 	}
 
 };
 
-VULKAN_EXAMPLE_MAIN()
\ No newline at end of file
+VULKAN_EXAMPLE_MAIN()
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "VulkanApplication.h"
+#include "scene/SimpleModel.h"
+#include "scene/UniformBuffersManager.h"
+#include "scene/MeshOptimizer.h"
+#include "scene/Meshlets.h"
+#include "scene/Timer.h"
+
+using namespace engine;
+
+#define BENCHMARK_VIEWS 64
+
+class VulkanExample : public VulkanApplication
+{
+public:
+
+	render::VertexLayout* vertexLayout = nullptr;
+
+	engine::scene::SimpleModel model;
+	render::Texture* colorMap;
+
+	render::Buffer* sceneVertexUniformBuffer;
+	scene::UniformBuffersManager uniform_manager;
+
+	glm::vec4 light_pos = glm::vec4(0.0f, -5.0f, 0.0f, 1.0f);
+
+	render::DescriptorPool* descriptorPool = nullptr;
+
+	std::vector<scene::MeshletData> meshlets;
+	std::vector<scene::MeshletCulling> culling;
+	std::vector<std::vector<render::MeshPart>> visibleParts;
+
+	bool gpuCulling = true;
+	bool cullingEnabled = true;
+	uint64_t triangles = 0;
+	uint32_t meshletsCount = 0;
+	scene::MeshletCullStatistics cullStats;
+	uint64_t timeCull = 0;
+	uint64_t timeBuild = 0;
+	float benchmarkCulledPercent = 0.0f;
+
+	VulkanExample() : VulkanApplication(true)
+	{
+		zoom = -3.75f;
+		rotationSpeed = 0.5f;
+		rotation = glm::vec3(15.0f, 0.f, 0.0f);
+		title = "Render Engine Meshlets";
+		settings.overlay = true;
+		camera.movementSpeed = 20.5f;
+		camera.SetFlipY(true);
+		camera.SetPerspective(60.0f, (float)width / (float)height, 0.1f, 1024.0f);
+		camera.SetRotation(glm::vec3(0.0f, 0.0f, 0.0f));
+		camera.SetPosition(glm::vec3(0.0f, 0.0f, -3.0f));
+	}
+
+	~VulkanExample()
+	{
+		// Clean up used Vulkan resources
+		// Note : Inherited destructor cleans up resources stored in base class
+	}
+
+	void setupGeometry()
+	{
+		vertexLayout = m_device->GetVertexLayout(
+		{
+			render::VERTEX_COMPONENT_POSITION,
+			render::VERTEX_COMPONENT_NORMAL,
+			render::VERTEX_COMPONENT_UV
+		}, {});
+
+		std::vector<render::MeshData*> mdatas = model.LoadGeometry(engine::tools::getAssetPath() + "models/chinesedragon.dae", vertexLayout, 0.1f, 1);
+		meshlets.resize(mdatas.size());
+		culling.resize(mdatas.size());
+		visibleParts.resize(mdatas.size());
+		Timer timer;
+		for (size_t i = 0; i < mdatas.size(); i++)
+		{
+			render::MeshData* geo = mdatas[i];
+			scene::MeshOptimizer::Optimize(geo, vertexLayout, scene::MeshOptimizer::STAGE_WELD | scene::MeshOptimizer::STAGE_VERTEX_CACHE | scene::MeshOptimizer::STAGE_VERTEX_FETCH);
+			timer.start();
+			scene::MeshletBuilder::Build(geo, vertexLayout, meshlets[i]);
+			timer.stop();
+			timeBuild += timer.elapsedMicroseconds();
+			if (!scene::MeshletBuilder::Validate(geo, vertexLayout, meshlets[i]))
+				engine::tools::exitFatal("The meshlets of geometry " + std::to_string(i) + " don't cover its triangles", -1);
+
+			triangles += geo->m_indexCount / 3;
+			meshletsCount += static_cast<uint32_t>(meshlets[i].m_meshlets.size());
+
+			model.AddGeometry(m_device->GetMesh(geo, vertexLayout, m_loadingCommandBuffer));
+			delete geo;
+		}
+		RunBenchmark();
+	}
+
+	//culls the meshlets for views orbiting the model, the same views every run
+	void RunBenchmark()
+	{
+		uint64_t culled = 0;
+		uint64_t total = 0;
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)width / (float)height, 0.1f, 1024.0f);
+		for (int v = 0; v < BENCHMARK_VIEWS; v++)
+		{
+			float angle = glm::two_pi<float>() * v / BENCHMARK_VIEWS;
+			float y = sinf(angle * 3.0f) * 1.5f;
+			glm::vec3 eye = glm::vec3(cosf(angle) * 3.0f, y, sinf(angle) * 3.0f);
+			//look a bit off center so part of the model leaves the frustum
+			glm::vec3 target = glm::vec3(cosf(angle * 5.0f), 0.0f, sinf(angle * 5.0f)) * 0.5f;
+			scene::Frustum frustum;
+			frustum.update(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+			for (auto& data : meshlets)
+			{
+				std::vector<render::MeshPart> parts;
+				scene::MeshletCullStatistics stats = scene::MeshletBuilder::Cull(data, frustum, eye, parts);
+				culled += stats.trianglesCulled;
+				total += stats.trianglesCulled + stats.trianglesVisible;
+			}
+		}
+		benchmarkCulledPercent = total > 0 ? 100.0f * culled / total : 0.0f;
+		std::cout << "Meshlets benchmark: " << benchmarkCulledPercent << "% of the triangles culled over " << BENCHMARK_VIEWS << " views" << std::endl;
+	}
+
+	void SetupTextures()
+	{
+		render::Texture2DData tdata;
+		tdata.LoadFromFile("./../data/textures/compass.jpg", render::GfxFormat::R8G8B8A8_UNORM);
+		colorMap = m_device->GetTexture(&tdata, descriptorPool, m_loadingCommandBuffer);
+	}
+
+	void SetupUniforms()
+	{
+		uniform_manager.SetEngineDevice(m_device);
+		uniform_manager.SetDescriptorPool(descriptorPool);
+		sceneVertexUniformBuffer = uniform_manager.GetGlobalUniformBuffer({ scene::UNIFORM_PROJECTION ,scene::UNIFORM_VIEW ,scene::UNIFORM_LIGHT0_POSITION, scene::UNIFORM_CAMERA_POSITION });
+	}
+
+	//one set for the model, one for the culling of each geometry and the ui sampler
+	void setupDescriptorPool()
+	{
+		descriptorPool = m_device->GetDescriptorPool(
+			{{render::DescriptorType::UNIFORM_BUFFER, 8},
+			{render::DescriptorType::INPUT_STORAGE_BUFFER, 8},
+			{render::DescriptorType::OUTPUT_STORAGE_BUFFER, 8},
+			{render::DescriptorType::IMAGE_SAMPLER, 2} }, 10);
+	}
+
+	void SetupDescriptors()
+	{
+		render::DescriptorSetLayout* pdsl = m_device->GetDescriptorSetLayout({
+						{render::DescriptorType::UNIFORM_BUFFER, render::ShaderStage::VERTEX},
+						{render::DescriptorType::IMAGE_SAMPLER, render::ShaderStage::FRAGMENT}
+			});
+		model.SetDescriptorSetLayout(pdsl);
+		model.AddDescriptor(m_device->GetDescriptorSet(model._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer }, { colorMap }));
+	}
+
+	void setupPipelines()
+	{
+		render::PipelineProperties props;
+		model.AddPipeline(m_device->GetPipeline(
+			GetShadersPath() + "basic/phong" + GetVertexShadersExt(), "VSMain", GetShadersPath() + "basic/phongtextured" + GetFragShadersExt(), "PSMainTextured",
+			vertexLayout, model._descriptorLayout, props, m_mainRenderPass));
+	}
+
+	void prepareCulling()
+	{
+		std::string fileName = GetShadersPath() + "meshlets/meshletcull" + GetComputeShadersExt();
+		for (size_t i = 0; i < meshlets.size(); i++)
+		{
+			if (!culling[i].Init(m_device, descriptorPool, meshlets[i], fileName, m_loadingCommandBuffer))
+				engine::tools::exitFatal("The device can't draw indirectly", -1);
+		}
+	}
+
+	void init()
+	{
+		if (m_loadingCommandBuffer)
+			m_loadingCommandBuffer->Begin();
+
+		setupDescriptorPool();
+		setupGeometry();
+		SetupTextures();
+		SetupUniforms();
+		SetupDescriptors();
+		setupPipelines();
+		prepareCulling();
+		updateUniformBuffers();
+		PrepareUI();
+
+		if (m_loadingCommandBuffer)
+		{
+			m_loadingCommandBuffer->End();
+			SubmitOnQueue(m_loadingCommandBuffer);
+		}
+
+		WaitForDevice();
+
+		m_device->FreeLoadStaggingBuffers();
+	}
+
+	void BuildCommandBuffers()
+	{
+		for (int32_t i = 0; i < m_drawCommandBuffers.size(); ++i)
+		{
+			m_drawCommandBuffers[i]->Begin();
+
+			if (cullingEnabled && gpuCulling)
+			{
+				std::vector<render::Buffer*> drawBuffers;
+				for (auto& cull : culling)
+				{
+					cull.Prepare(m_drawCommandBuffers[i]);
+					DispatchCompute(m_drawCommandBuffers[i], cull.GetGroupCount(), 1, 1);
+					drawBuffers.push_back(cull.m_drawsBuffer);
+				}
+				PipelineBarrier(m_drawCommandBuffers[i], drawBuffers, {});
+			}
+
+			m_mainRenderPass->Begin(m_drawCommandBuffers[i], i);
+
+			descriptorPool->Draw(m_drawCommandBuffers[i]);
+			if (!cullingEnabled)
+			{
+				model.Draw(m_drawCommandBuffers[i]);
+			}
+			else
+			{
+				model._pipeline->Draw(m_drawCommandBuffers[i]);
+				model.m_descriptorSets[0]->Draw(m_drawCommandBuffers[i], model._pipeline, 0);
+				for (size_t j = 0; j < model.m_geometries.size(); j++)
+				{
+					if (gpuCulling)
+						culling[j].Draw(m_drawCommandBuffers[i], model.m_geometries[j]);
+					else if (!visibleParts[j].empty())
+						model.m_geometries[j]->Draw(m_drawCommandBuffers[i], visibleParts[j]);
+				}
+			}
+
+			DrawUI(m_drawCommandBuffers[i]);
+
+			m_mainRenderPass->End(m_drawCommandBuffers[i], i);
+
+			m_drawCommandBuffers[i]->End();
+		}
+	}
+
+	void updateCulling()
+	{
+		scene::Frustum* frustum = camera.GetFrustum();
+		glm::vec3 cameraPosition = -camera.GetPosition();
+
+		//the cpu path is always run, it gives the statistics for both paths
+		cullStats = scene::MeshletCullStatistics();
+		Timer timer;
+		timer.start();
+		for (size_t i = 0; i < meshlets.size(); i++)
+		{
+			visibleParts[i].clear();
+			scene::MeshletCullStatistics stats = scene::MeshletBuilder::Cull(meshlets[i], *frustum, cameraPosition, visibleParts[i]);
+			cullStats.meshletsVisible += stats.meshletsVisible;
+			cullStats.meshletsFrustumCulled += stats.meshletsFrustumCulled;
+			cullStats.meshletsBackfaceCulled += stats.meshletsBackfaceCulled;
+			cullStats.trianglesVisible += stats.trianglesVisible;
+			cullStats.trianglesCulled += stats.trianglesCulled;
+		}
+		timer.stop();
+		timeCull = timer.elapsedMicroseconds();
+
+		for (auto& cull : culling)
+			cull.Update(*frustum, cameraPosition);
+	}
+
+	void updateUniformBuffers()
+	{
+		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
+		glm::mat4 viewMatrix = camera.GetViewMatrix();
+
+		uniform_manager.UpdateGlobalParams(scene::UNIFORM_PROJECTION, &perspectiveMatrix, 0, sizeof(perspectiveMatrix));
+		uniform_manager.UpdateGlobalParams(scene::UNIFORM_VIEW, &viewMatrix, 0, sizeof(viewMatrix));
+		uniform_manager.UpdateGlobalParams(scene::UNIFORM_LIGHT0_POSITION, &light_pos, 0, sizeof(light_pos));
+		glm::vec3 cucu = -camera.GetPosition();
+		uniform_manager.UpdateGlobalParams(scene::UNIFORM_CAMERA_POSITION, &cucu, 0, sizeof(cucu));
+
+		uniform_manager.Update(nullptr);
+
+		updateCulling();
+	}
+
+	void Prepare()
+	{
+		init();
+		BuildCommandBuffers();
+		prepared = true;
+	}
+
+	virtual void update(float dt)
+	{
+
+	}
+
+	virtual void ViewChanged()
+	{
+		updateUniformBuffers();
+		//the cpu path bakes the visible parts in the command buffers
+		if (cullingEnabled && !gpuCulling)
+		{
+			WaitForDevice();
+			BuildCommandBuffers();
+		}
+	}
+
+	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			if (overlay->checkBox("Meshlet culling", &cullingEnabled)) {
+				WaitForDevice();
+				BuildCommandBuffers();
+			}
+			if (overlay->checkBox("GPU culling", &gpuCulling)) {
+				WaitForDevice();
+				BuildCommandBuffers();
+			}
+		}
+		if (overlay->header("Meshlets")) {
+			ImGui::Text("%llu triangles in %u meshlets", (unsigned long long)triangles, meshletsCount);
+			ImGui::Text("%llu us build time", (unsigned long long)timeBuild);
+			ImGui::Text("%u visible meshlets", cullStats.meshletsVisible);
+			ImGui::Text("%u frustum culled", cullStats.meshletsFrustumCulled);
+			ImGui::Text("%u backface culled", cullStats.meshletsBackfaceCulled);
+			ImGui::Text("%llu triangles culled", (unsigned long long)cullStats.trianglesCulled);
+			ImGui::Text("%llu us cpu cull time", (unsigned long long)timeCull);
+			ImGui::Text("%.1f%% culled over %d benchmark views", benchmarkCulledPercent, BENCHMARK_VIEWS);
+			ImGui::Text("%.3f ms frame time", frameTimer * 1000.0f);
+		}
+	}
+
+};
+
+VULKAN_EXAMPLE_MAIN()
@@ -6,12 +6,14 @@
 #include <vector>
 #include <time.h> 
 #include <random>
+#include <atomic>
+#include <mutex>
 
 #include "VulkanApplication.h"
 #include "scene/SimpleModel.h"
-#include "scene/UniformBuffersManager.h"
 #include "threadpool.hpp"
 #include "scene/SpacePartitionTree.h"
+#include "scene/CollisionEngine.h"
 #include "scene/Timer.h"
 #include "scene/DrawDebug.h"
 #include "render/vulkan/VulkanCommandBuffer.h"
@@ -52,13 +54,15 @@ public:
 
 	struct ThreadData {
 		render::CommandPool* commandPool;
-		// One command buffer per render object
+		// One command buffer per frame in flight
 		std::vector<render::CommandBuffer*> commandBuffer;
 		std::vector<engine::scene::SimpleModel*> objects;
 	};
 	std::vector<ThreadData> threadData;
 	ThreadData threadUIData;
 	engine::ThreadPool threadPool;
+	// The simulation thread has its own workers, the render ones wait for the frame jobs only
+	engine::ThreadPool simulationPool;
 	// Number of animated objects to be renderer
 	// by using threads and secondary command buffers
 	uint32_t numObjectsPerThread;
@@ -70,18 +74,26 @@ public:
 	std::vector<engine::scene::SimpleModel> objects;
 	render::VulkanTexture* colorMap;
 
-	render::Buffer* sceneVertexUniformBuffer;
-	scene::UniformBuffersManager uniform_manager;
-
 	glm::vec4 light_pos = glm::vec4(0.0f, -50.0f, 0.0f, 1.0f);
 
+	struct UBOScene {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec4 lightPos;
+		glm::vec3 cameraPos;
+	} uboScene;
+
+	// One copy of the scene uniforms per frame in flight, a frame writes its own while the others render
+	std::vector<render::VulkanBuffer*> sceneVertexUniformBuffers;
+
 	struct UBOVS {
 		glm::mat4 projection;
 		glm::mat4 view;
 		glm::mat4 model;
 	};
 
-	std::vector<render::VulkanBuffer*> vert_uniform_buffers;
+	// One set of object uniforms per frame in flight
+	std::vector<std::vector<render::VulkanBuffer*>> vert_uniform_buffers;
 	std::vector<UBOVS*> vert_ram_uniform_buffers;
 
 	render::DescriptorSetLayout *objectslayout;
@@ -89,6 +101,8 @@ public:
 
 	std::vector<scene::BoundingSphere*> balls;
 	std::vector<glm::vec3> balls_positions;
+	// Positions of the last tick, owned by the simulation
+	std::vector<glm::vec3> balls_simulated_positions;
 	int objectsNo = 500;
 	struct CubeLmitation
 	{
@@ -100,12 +114,39 @@ public:
 	std::vector<CubeLmitation> cube_limitations;
 
 	scene::SpacePartitionTree* tree = new scene::SpacePartitionTree;
+	//the tree is still used for the visibility, the collisions are done by the engine unless disabled
+	scene::CollisionEngine collisions;
+	bool useCollisionEngine = true;
+	//the option picked in the overlay and the one the simulation runs with, it copies the balls into the engine when switching to it
+	std::atomic<bool> collisionEngineRequest{ true };
+	bool simulatedCollisionEngine = true;
+
+	// What the simulation hands to the renderer every tick
+	struct BallsSnapshot
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> visibleObjects;
+		std::vector<float> treeColors;
+		scene::VisibilityStatistics visibilityStatistics;
+		scene::CollisionStatistics collisionStatistics;
+		uint64_t timeadvance = 0;
+		uint64_t timeupdate = 0;
+	};
+	scene::SimulationSnapshots<BallsSnapshot> snapshots;
+	// The frustum of the last frame, the simulation culls with it
+	std::mutex frustumMutex;
+	glm::vec4 simulationFrustum[6];
 
 	Timer timer;
+	Timer simulationTimer;
 	uint64_t timeadvance = 0;
 	uint64_t timeupdate = 0;
 	uint64_t timerender = 0;
 	int visible_objects = 0;
+	std::vector<uint32_t> visibleObjects;
+	scene::VisibilityStatistics visibilityStatistics;
+	scene::CollisionStatistics collisionStatistics;
+	float maxBallRadius = 0.0f;
 
 	scene::DrawDebugBBs dbgbb;
 
@@ -116,6 +157,7 @@ public:
 		rotation = glm::vec3(15.0f, 0.f, 0.0f);
 		title = "Render Engine Empty Scene";
 		settings.overlay = true;
+		settings.frameResourcesPerSlot = true;
 		camera.movementSpeed = 20.5f;
 		camera.SetPerspective(60.0f, (float)width / (float)height, 0.1f, 1024.0f);
 		camera.SetRotation(glm::vec3(0.0f, 0.0f, 0.0f));
@@ -184,6 +226,7 @@ public:
 		balls.resize(objectsNo);
 
 		balls_positions.resize(objectsNo);
+		balls_simulated_positions.resize(objectsNo);
 
 		vert_ram_uniform_buffers.resize(objectsNo);
 
@@ -199,8 +242,12 @@ public:
 					8.0 * randomFloat()),
 				radius);
 
+			ball->SetIndex(i);
+			maxBallRadius = std::max(maxBallRadius, radius);
 			balls_positions[i] = ball->GetCenter();
+			balls_simulated_positions[i] = ball->GetCenter();
 			balls[i] = ball;
+			collisions.AddSphere(ball->GetCenter(), ball->GetVelocity(), radius);
 
 			UBOVS* ubovs = new UBOVS;
 			vert_ram_uniform_buffers[i] = ubovs;
@@ -213,6 +260,8 @@ public:
 		cube_limitations.push_back(CubeLmitation(glm::vec3(0, -10, 0), glm::vec4(0, 0, -1, 10)));
 
 		glm::vec3 bound1(-10.0f,-10.0f,-10.0f), bound2(10.0f,10.0f,10.0f);
+		collisions.SetBounds(bound1, bound2);
+		collisions.m_gravity = glm::vec3(0.0f, GRAVITY, 0.0f);
 		tree->m_boundries.push_back(bound1);
 		tree->m_boundries.push_back(bound2);
 		tree->CreateChildren();
@@ -248,18 +297,23 @@ public:
 	void SetupUniforms()
 	{
 		//uniforms
-		uniform_manager.SetDescriptorPool(descriptorPool);
-		uniform_manager.SetEngineDevice(vulkanDevice);
-		sceneVertexUniformBuffer = uniform_manager.GetGlobalUniformBuffer({ scene::UNIFORM_PROJECTION ,scene::UNIFORM_VIEW ,scene::UNIFORM_LIGHT0_POSITION, scene::UNIFORM_CAMERA_POSITION });
+		sceneVertexUniformBuffers.resize(GetFramesInFlight());
+		for (auto& sceneBuffer : sceneVertexUniformBuffers)
+		{
+			sceneBuffer = vulkanDevice->GetUniformBuffer(sizeof(UBOScene));
+			sceneBuffer->Map();
+		}
 
-		vert_uniform_buffers.resize(objectsNo);
-		
-		for (int i = 0;i < objectsNo;i++)
+		vert_uniform_buffers.resize(GetFramesInFlight());
+		for (auto& frameBuffers : vert_uniform_buffers)
 		{
-			vert_uniform_buffers[i] = vulkanDevice->GetUniformBuffer(sizeof(UBOVS));
-			vert_uniform_buffers[i]->Map();
+			frameBuffers.resize(objectsNo);
+			for (int i = 0;i < objectsNo;i++)
+			{
+				frameBuffers[i] = vulkanDevice->GetUniformBuffer(sizeof(UBOVS));
+				frameBuffers[i]->Map();
+			}
 		}
-		updateglobalUniformBuffers();
 		updateUniformBuffers();
 	}
 
@@ -271,9 +325,10 @@ public:
 			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * static_cast<uint32_t>(objectsNo)}
 		};
 		descriptorPool = vulkanDevice->CreateDescriptorSetsPool(poolSizes, 2 * objectsNo+2);*/
+		//the sets of the objects are transient, see SetupFrameDescriptors
 		descriptorPool = vulkanDevice->GetDescriptorPool(
-			{ {render::DescriptorType::UNIFORM_BUFFER, 2 * static_cast<uint32_t>(objectsNo) + 2},
-			{render::DescriptorType::IMAGE_SAMPLER, 2 * static_cast<uint32_t>(objectsNo)} }, 2 * objectsNo + 2);
+			{ {render::DescriptorType::UNIFORM_BUFFER, 2},
+			{render::DescriptorType::IMAGE_SAMPLER, 2} }, 2);
 	}
 
 	void SetupDescriptors()
@@ -292,7 +347,26 @@ public:
 			objects[i].SetDescriptorSetLayout(objectslayout);
 			/*objects[i].AddDescriptor(vulkanDevice->GetDescriptorSet(descriptorPool, { &sceneVertexUniformBuffer->m_descriptor, &vert_uniform_buffers[i]->m_descriptor }, { &colorMap->m_descriptor },
 				objects[i]._descriptorLayout->m_descriptorSetLayout, objects[i]._descriptorLayout->m_setLayoutBindings));*/
-			objects[i].AddDescriptor(vulkanDevice->GetDescriptorSet(objects[i]._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer, vert_uniform_buffers[i] }, { colorMap }));
+			//drawn with the set of the frame being recorded, filled by SetupFrameDescriptors
+			objects[i].m_descriptorSets.resize(GetFramesInFlight(), nullptr);
+		}
+	}
+
+	//the pools of the frame slot were reset in BeginFrame after its fence, only the objects recorded this frame get a set
+	void SetupFrameDescriptors()
+	{
+		uint32_t frame = GetFrameIndex();
+		render::Buffer* sceneBuffer = GetFrameResource(sceneVertexUniformBuffers);
+		std::vector<render::VulkanBuffer*>& frameBuffers = GetFrameResource(vert_uniform_buffers);
+		if (multithreaded)
+		{
+			for (uint32_t i : visibleObjects)
+				objects[i].m_descriptorSets[frame] = m_device->GetTransientDescriptorSet(objectslayout, { sceneBuffer, frameBuffers[i] }, { colorMap }, frame);
+		}
+		else
+		{
+			for (int i = 0; i < objectsNo; i++)
+				objects[i].m_descriptorSets[frame] = m_device->GetTransientDescriptorSet(objectslayout, { sceneBuffer, frameBuffers[i] }, { colorMap }, frame);
 		}
 	}
 
@@ -312,6 +386,7 @@ public:
 	}
 
 	std::vector<float> constants;
+	size_t treeNodesNo = 0;
 
 	void init()
 	{	
@@ -324,9 +399,11 @@ public:
 
 		std::vector <std::vector<glm::vec3>> boundries;
 		tree->GatherAllBoundries(boundries);
-		dbgbb.Init(boundries, vulkanDevice, descriptorPool, sceneVertexUniformBuffer, queue, mainRenderPass, pipelineCache, sizeof(float));
+		//drawn by the single threaded path only, see updateglobalUniformBuffers
+		dbgbb.Init(boundries, vulkanDevice, descriptorPool, sceneVertexUniformBuffers[0], queue, mainRenderPass, pipelineCache, sizeof(float));
 		
-		constants.resize(boundries.size());
+		treeNodesNo = boundries.size();
+		constants.resize(treeNodesNo);
 		std::fill(constants.begin(), constants.end(), 1.0f);
 		dbgbb.InitGeometriesPushConstants(sizeof(float), constants.size(), constants.data());
 	}
@@ -347,7 +424,7 @@ public:
 			//draw here
 			for (int j = 0;j < objectsNo;j++)
 			{
-				objects[j].Draw(m_drawCommandBuffers[i]);
+				objects[j].Draw(m_drawCommandBuffers[i], GetFrameIndex());
 			}
 			dbgbb.Draw(m_drawCommandBuffers[i]);
 
@@ -387,8 +464,8 @@ public:
 
 			thread->commandPool = m_device->GetCommandPool(vulkanDevice->queueFamilyIndices.graphicsFamily, false);
 
-			// One secondary command buffer per object that is updated by this thread
-			thread->commandBuffer.resize(numObjectsPerThread);
+			// One secondary command buffer per frame in flight that is updated by this thread
+			thread->commandBuffer.resize(GetFramesInFlight());
 			for (int i = 0; i < thread->commandBuffer.size(); i++)
 			{
 				thread->commandBuffer[i] = m_device->GetCommandBuffer(thread->commandPool,false);
@@ -406,8 +483,8 @@ public:
 		VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolCreateInfo, nullptr, &threadUIData.commandPool));*/
 		threadUIData.commandPool = m_device->GetCommandPool(vulkanDevice->queueFamilyIndices.graphicsFamily, false);
 
-		// One secondary command buffer per object that is updated by this thread
-		threadUIData.commandBuffer.resize(numObjectsPerThread);
+		// One secondary command buffer per frame in flight
+		threadUIData.commandBuffer.resize(GetFramesInFlight());
 		// Generate secondary command buffers for each thread
 		for (int i = 0; i < threadUIData.commandBuffer.size(); i++)
 		{
@@ -439,13 +516,13 @@ public:
 		for (auto object : thread->objects)
 		{
 			if(object)
-				object->Draw(thread->commandBuffer[cmdBufferIndex]);
+				object->Draw(thread->commandBuffer[cmdBufferIndex], cmdBufferIndex);
 		}
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
 
-	void threadRenderUICode(VkCommandBufferInheritanceInfo inheritanceInfo)
+	void threadRenderUICode(uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
 	{
 		ThreadData* thread = &threadUIData;
 
@@ -455,11 +532,11 @@ public:
 		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
 		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 		//VkCommandBuffer cmdBuffer = thread->commandBuffer[0];
-		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)thread->commandBuffer[0])->m_vkCommandBuffer;
+		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)thread->commandBuffer[cmdBufferIndex])->m_vkCommandBuffer;
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
 
-		DrawUI(thread->commandBuffer[0]);
+		DrawUI(thread->commandBuffer[cmdBufferIndex]);
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
@@ -469,7 +546,9 @@ public:
 		VkCommandBufferBeginInfo commandBufferBeginInfo{};
 		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)m_drawCommandBuffers[0])->m_vkCommandBuffer;
+		//the buffers of this frame slot, the other slots can still be rendering
+		uint32_t frame = GetFrameIndex();
+		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)GetFrameResource(m_frameCommandBuffers))->m_vkCommandBuffer;
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
 
@@ -485,53 +564,27 @@ public:
 		// Secondary command buffer also use the currently active framebuffer
 		cmdBufferInheritanceInfo.framebuffer = mainRenderPass->m_frameBuffers[i]->m_vkFrameBuffer;
 
-		numObjectsPerThread = visible_objects / numDrawThreads;
-		int restofjobs = visible_objects % numDrawThreads;
-
 		for (uint32_t t = 0; t < numDrawThreads; t++)
 		{
 			threadData[t].objects.clear();
 		}
 
-		int thread_index = 0;
-
-		int o = 0;
-		for (o = 0; o<objects.size();o++ )
-		{
-			if (balls[o]->IsVisible())
-			{
-				if (thread_index == threadData.size())
-					break;
-
-				threadData[thread_index].objects.push_back(&objects[o]);
-
-				if (threadData[thread_index].objects.size() >= numObjectsPerThread)
-				{
-					thread_index++;
-				}
-			}
-		}
-
-		thread_index = 0;
-		//distribute the remaining jobs
-		for (int oo = o; oo < objects.size();oo++)
+		//a contiguous slice of the visible objects per thread
+		for (size_t v = 0; v < visibleObjects.size(); v++)
 		{
-			if (thread_index == threadData.size())
-				thread_index = 0;
-			threadData[thread_index].objects.push_back(&objects[oo]);
-			thread_index++;
+			threadData[v * numDrawThreads / visibleObjects.size()].objects.push_back(&objects[visibleObjects[v]]);
 		}
 
 		for (uint32_t t = 0; t < numDrawThreads; t++)
 		{
 			if(threadData[t].objects.size() != 0)
 			{
-				threadPool.threads[t]->addJob([=] { threadRenderCode(t, 0, cmdBufferInheritanceInfo); });
+				threadPool.threads[t]->addJob([=] { threadRenderCode(t, frame, cmdBufferInheritanceInfo); });
 			}
 		}
 
 		auto lastpos = threadPool.threads.size() - 1;
-		threadPool.threads[lastpos-1]->addJob([=] { threadRenderUICode(cmdBufferInheritanceInfo); });
+		threadPool.threads[lastpos-1]->addJob([=] { threadRenderUICode(frame, cmdBufferInheritanceInfo); });
 		threadPool.threads[lastpos]->addJob([=] { updateUniformBuffers(); });
 
 		threadPool.wait();
@@ -544,13 +597,13 @@ public:
 				{
 					
 					//commandBuffers.push_back(threadData[t].commandBuffer[0]);
-					commandBuffers.push_back(((render::VulkanCommandBuffer*)threadData[t].commandBuffer[0])->m_vkCommandBuffer);
+					commandBuffers.push_back(((render::VulkanCommandBuffer*)threadData[t].commandBuffer[frame])->m_vkCommandBuffer);
 					
 				}
 			}
 		}
 		//commandBuffers.push_back(threadUIData.commandBuffer[0]);
-		commandBuffers.push_back(((render::VulkanCommandBuffer*)threadUIData.commandBuffer[0])->m_vkCommandBuffer);
+		commandBuffers.push_back(((render::VulkanCommandBuffer*)threadUIData.commandBuffer[frame])->m_vkCommandBuffer);
 
 		// Execute render commands from the secondary command buffer
 		vkCmdExecuteCommands(cmdBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
@@ -559,18 +612,17 @@ public:
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
+	//only the copy of the frame being recorded, the fence of its slot was waited for in BeginFrame
 	void updateglobalUniformBuffers()
 	{
-		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
-		glm::mat4 viewMatrix = camera.GetViewMatrix();
-
-		uniform_manager.UpdateGlobalParams(scene::UNIFORM_PROJECTION, &perspectiveMatrix, 0, sizeof(perspectiveMatrix));
-		uniform_manager.UpdateGlobalParams(scene::UNIFORM_VIEW, &viewMatrix, 0, sizeof(viewMatrix));
-		uniform_manager.UpdateGlobalParams(scene::UNIFORM_LIGHT0_POSITION, &light_pos, 0, sizeof(light_pos));
-		glm::vec3 cucu = -camera.GetPosition();
-		uniform_manager.UpdateGlobalParams(scene::UNIFORM_CAMERA_POSITION, &cucu, 0, sizeof(camera.GetPosition()));
-
-		uniform_manager.Update(nullptr);
+		uboScene.projection = camera.GetPerspectiveMatrix();
+		uboScene.view = camera.GetViewMatrix();
+		uboScene.lightPos = light_pos;
+		uboScene.cameraPos = -camera.GetPosition();
+		GetFrameResource(sceneVertexUniformBuffers)->MemCopy(&uboScene, sizeof(uboScene));
+		//the debug boxes read the first copy, the single threaded path waits for every frame before it records
+		if (!multithreaded)
+			sceneVertexUniformBuffers[0]->MemCopy(&uboScene, sizeof(uboScene));
 	}
 
 	void updateUniformBuffers()
@@ -578,40 +630,34 @@ public:
 		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
 		glm::mat4 viewMatrix = camera.GetViewMatrix();
 
-		for (int i = 0; i < vert_uniform_buffers.size(); i++)
+		updateglobalUniformBuffers();
+
+		std::vector<render::VulkanBuffer*>& frameBuffers = GetFrameResource(vert_uniform_buffers);
+		for (int i = 0; i < frameBuffers.size(); i++)
 		{
 			vert_ram_uniform_buffers[i]->projection = perspectiveMatrix;
 			vert_ram_uniform_buffers[i]->view = viewMatrix;
 			vert_ram_uniform_buffers[i]->model = glm::translate(glm::mat4(1.0f), balls_positions[i]);
-			vert_uniform_buffers[i]->MemCopy(vert_ram_uniform_buffers[i], sizeof(UBOVS));
+			frameBuffers[i]->MemCopy(vert_ram_uniform_buffers[i], sizeof(UBOVS));
 		}
 		
 		for (int i = 0;i < objectsNo;i++)
 		{		
-			vert_uniform_buffers[i]->MemCopy(&vert_ram_uniform_buffers[i]->model,sizeof(vert_ram_uniform_buffers[i]->model));
+			frameBuffers[i]->MemCopy(&vert_ram_uniform_buffers[i]->model,sizeof(vert_ram_uniform_buffers[i]->model));
 		}
 	}
 	bool multithreaded = true;
 	void draw()
 	{
-		vkWaitForFences(device, 1, &submitFences[multithreaded ? 0 : currentBuffer], VK_TRUE, UINT64_MAX);
+		//the single threaded path rebuilds the command buffers of every image
+		if (!multithreaded)
+			WaitForFramesInFlight();
 
-		uint32_t mcb = 0;
-		uint32_t* cb = multithreaded ? &mcb : &currentBuffer;
-		// Acquire the next image from the swap chain
-		VkResult result = swapChain.acquireNextImage(presentCompleteSemaphores[multithreaded ? 0 : currentBuffer], cb);
-		// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
-		/*if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
-			WindowResize();
-		}
-		else {
-			VK_CHECK_RESULT(result);
-		}*/
-
-		vkResetFences(device, 1, &submitFences[multithreaded ? 0 : currentBuffer]);
+		if (!BeginFrame())
+			return;
 
-		//TODO add fences
 		timer.start();
+		SetupFrameDescriptors();
 		if(multithreaded)
 			updateCommandBuffers(currentBuffer);
 		else
@@ -624,16 +670,10 @@ public:
 		timer.stop();
 		timerender = timer.elapsedMicroseconds();
 
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[multithreaded ? 0 : currentBuffer];
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[multithreaded ? 0 : currentBuffer];
-		submitInfo.commandBufferCount = 1;
-		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)m_drawCommandBuffers[multithreaded ? 0 : currentBuffer])->m_vkCommandBuffer;
-		submitInfo.pCommandBuffers = &cmdBuffer;
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, submitFences[multithreaded ? 0 : currentBuffer]));
-
-		//VulkanApplication::PresentFrame();
-		result = swapChain.queuePresent(presentationQueue, currentBuffer, renderCompleteSemaphores[multithreaded ? 0 : currentBuffer]);
-		currentBuffer = (currentBuffer + 1) % swapChain.swapChainImageViews.size();
+		render::CommandBuffer* commandBuffer = multithreaded ? GetFrameResource(m_frameCommandBuffers) : m_drawCommandBuffers[currentBuffer];
+		VkCommandBuffer cmdBuffer = ((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer;
+		CountSubmittedCommands({ commandBuffer });
+		EndFrame(&cmdBuffer, 1);
 	}
 
 	void Prepare()
@@ -642,10 +682,13 @@ public:
 		init();
 		
 		PrepareUI();
+		//the single threaded path records in draw, once the sets of the frame exist
 		if (multithreaded)
 			prepareMultiThreadedRenderer();
-		else
-			BuildCommandBuffers();
+
+		simulationPool.setThreadCount(4);
+		updateSimulationFrustum();
+		StartSimulation(60.0f);
 		
 		prepared = true;
 	}
@@ -657,55 +700,101 @@ public:
 		draw();
 	}
 
-	void SetTreeColors(scene::SpacePartitionTree* root, int &index)
+	void SetTreeColors(scene::SpacePartitionTree* root, std::vector<float>& colors, int &index)
 	{
 		if (root->m_objects.size() > 0)
 		{
-			constants[index] = 1.0f;
+			colors[index] = 1.0f;
 		}
 		else
-			constants[index] = 0.0f;
+			colors[index] = 0.0f;
 		index++;
 		for (int i = 0; i < root->m_children.size(); i++)
 		{
-			SetTreeColors(root->m_children[i], index);
+			SetTreeColors(root->m_children[i], colors, index);
 		}
 	}
 
-	virtual void update(float dt)
+	void updateSimulationFrustum()
 	{
-		timer.start();
+		std::lock_guard<std::mutex> lock(frustumMutex);
+		memcpy(simulationFrustum, camera.GetFrustum()->m_planes.data(), sizeof(glm::vec4) * 6);
+	}
 
-		for (int i = 0; i < objectsNo; i++)
+	virtual void simulate(float dt, double time)
+	{
+		BallsSnapshot& snapshot = snapshots.Write();
+		simulationTimer.start();
+
+		if (collisionEngineRequest != simulatedCollisionEngine)
 		{
-			balls[i]->AddToVelocity(glm::vec3(0, GRAVITY * dt * 0.5f, 0));
-			balls[i]->AddToPosition(balls[i]->GetVelocity() * dt * 0.5f);
-			balls_positions[i] = balls[i]->GetCenter();
+			simulatedCollisionEngine = collisionEngineRequest;
+			//the engine continues from where the tree integration left the balls
+			if (simulatedCollisionEngine)
+			{
+				for (int i = 0; i < objectsNo; i++)
+				{
+					glm::vec3 center = balls[i]->GetCenter(), velocity = balls[i]->GetVelocity();
+					collisions.m_positionsX[i] = center.x; collisions.m_positionsY[i] = center.y; collisions.m_positionsZ[i] = center.z;
+					collisions.m_velocitiesX[i] = velocity.x; collisions.m_velocitiesY[i] = velocity.y; collisions.m_velocitiesZ[i] = velocity.z;
+				}
+			}
+		}
 
-			for (auto climit : cube_limitations)
+		if (simulatedCollisionEngine)
+		{
+			//same half step integration as below
+			collisions.Step(dt * 0.5f, multithreaded ? &simulationPool : nullptr);
+			for (int i = 0; i < objectsNo; i++)
 			{
-				glm::vec3 plane_normal = climit.plane_eq;
-				float res = balls[i]->GetCenter().x * climit.plane_eq.x + balls[i]->GetCenter().y * climit.plane_eq.y + balls[i]->GetCenter().z * climit.plane_eq.z + climit.plane_eq.w;
+				balls[i]->SetCenter(collisions.GetPosition(i));
+				balls[i]->SetVelocity(collisions.GetVelocity(i));
+				tree->AdvanceObject(balls[i]);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < objectsNo; i++)
+			{
+				balls[i]->AddToVelocity(glm::vec3(0, GRAVITY * dt * 0.5f, 0));
+				balls[i]->AddToPosition(balls[i]->GetVelocity() * dt * 0.5f);
 
-				if (res <= 0.0f)
+				for (auto climit : cube_limitations)
 				{
-					plane_normal *= 2 * glm::dot(balls[i]->GetVelocity(), plane_normal);
-					balls[i]->AddToVelocity(-plane_normal);
-				}
-				int q = 2;
+					glm::vec3 plane_normal = climit.plane_eq;
+					float res = balls[i]->GetCenter().x * climit.plane_eq.x + balls[i]->GetCenter().y * climit.plane_eq.y + balls[i]->GetCenter().z * climit.plane_eq.z + climit.plane_eq.w;
+
+					if (res <= 0.0f)
+					{
+						plane_normal *= 2 * glm::dot(balls[i]->GetVelocity(), plane_normal);
+						balls[i]->AddToVelocity(-plane_normal);
+					}
+					int q = 2;
 				
+				}
+				tree->AdvanceObject(balls[i]);		
 			}
-			tree->AdvanceObject(balls[i]);		
+		}
+		//the balls are drawn between the previous and these positions, the culling margin covers the move
+		float maxMove = 0.0f;
+		snapshot.positions.resize(objectsNo);
+		for (int i = 0; i < objectsNo; i++)
+		{
+			snapshot.positions[i] = balls[i]->GetCenter();
+			maxMove = std::max(maxMove, glm::length(snapshot.positions[i] - balls_simulated_positions[i]));
+			balls_simulated_positions[i] = snapshot.positions[i];
 		}
 
-		timer.stop();
-		timeadvance = timer.elapsedMicroseconds();
-		timer.start();
+		simulationTimer.stop();
+		snapshot.timeadvance = simulationTimer.elapsedMicroseconds();
+		simulationTimer.start();
 
 		int ind = 0;
-		SetTreeColors(tree, ind);
+		snapshot.treeColors.resize(treeNodesNo);
+		SetTreeColors(tree, snapshot.treeColors, ind);
 
-		tree->TestCollisions();
+		if (!simulatedCollisionEngine)
+			tree->TestCollisions();
 
 		/*for (int i = 0; i < objectsNo - 1; i++)
 		{
@@ -718,24 +807,36 @@ public:
 				}
 			}
 		}*/
-		visible_objects = 0;
 		glm::vec4 frustumPlanes[6];
-		memcpy(frustumPlanes, camera.GetFrustum()->m_planes.data(), sizeof(glm::vec4) * 6);
-		tree->ResetVisibility();
-		tree->TestVisibility(frustumPlanes);
-
-		for (int i = 0; i < objectsNo; i++)
 		{
-			visible_objects += balls[i]->IsVisible();
+			std::lock_guard<std::mutex> lock(frustumMutex);
+			memcpy(frustumPlanes, simulationFrustum, sizeof(glm::vec4) * 6);
 		}
+		snapshot.visibilityStatistics = scene::VisibilityStatistics();
+		tree->GetVisibleObjects(frustumPlanes, snapshot.visibleObjects, maxBallRadius + maxMove, multithreaded ? &simulationPool : nullptr, &snapshot.visibilityStatistics);
+		snapshot.collisionStatistics = collisions.m_statistics;
 
-		timer.stop();
-		timeupdate = timer.elapsedMicroseconds();
+		simulationTimer.stop();
+		snapshot.timeupdate = simulationTimer.elapsedMicroseconds();
+		snapshots.Publish(time);
 	}
 
-	virtual void ViewChanged()
+	virtual void update(float dt)
 	{
-		updateglobalUniformBuffers();
+		updateSimulationFrustum();
+		//the balls between the last two ticks, the simulation runs at its own rate
+		snapshots.Read(m_simulation.GetRenderTime(), [this](const BallsSnapshot& previous, const BallsSnapshot& current, float alpha)
+		{
+			for (int i = 0; i < objectsNo; i++)
+				balls_positions[i] = glm::mix(previous.positions[i], current.positions[i], alpha);
+			visibleObjects = current.visibleObjects;
+			constants = current.treeColors;
+			visibilityStatistics = current.visibilityStatistics;
+			collisionStatistics = current.collisionStatistics;
+			timeadvance = current.timeadvance;
+			timeupdate = current.timeupdate;
+		});
+		visible_objects = static_cast<int>(visibleObjects.size());
 	}
 
 	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay *overlay)
@@ -745,6 +846,16 @@ public:
 			ImGui::Text("%ld time update", timeupdate);
 			ImGui::Text("%ld time render", timerender);
 			ImGui::Text("%.2d visible objects", visible_objects);
+			ImGui::Text("%u nodes visited, %u inside", visibilityStatistics.nodesVisited, visibilityStatistics.nodesInside);
+			ImGui::Text("%u objects tested", visibilityStatistics.objectsTested);
+			//the simulation switches at its next tick
+			if (overlay->checkBox("Collision engine", &useCollisionEngine))
+				collisionEngineRequest = useCollisionEngine;
+			if (useCollisionEngine)
+			{
+				ImGui::Text("%llu pairs tested", (unsigned long long)collisionStatistics.pairsTested);
+				ImGui::Text("%u contacts", collisionStatistics.contacts);
+			}
 		}
 	}
 
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "VulkanApplication.h"
+#include "scene/SceneLoaderGltf.h"
+#include "scene/OcclusionCulling.h"
+#include "scene/Timer.h"
+
+//resolution of the software depth buffer used by the cpu path
+#define SOFTWARE_DEPTH_WIDTH 256
+
+using namespace engine;
+using namespace engine::render;
+
+class VulkanExample : public VulkanApplication
+{
+public:
+
+	scene::SceneLoaderGltf scene;
+	std::vector<scene::RenderObject*> scene_render_objects;
+
+	render::RenderPass* scenepass = nullptr;
+	render::Texture* scenedepth = nullptr;
+
+	render::DescriptorPool* descriptorPoolPostEffects;
+	render::DescriptorPool* descriptorPoolPostEffectsRTV;
+	render::DescriptorPool* descriptorPoolPostEffectsDSV;
+	render::DescriptorPool* descriptorPoolCulling;
+
+	render::Pipeline* blackandwhitepipeline = nullptr;
+
+	render::DescriptorSet* pfdesc = nullptr;
+
+	scene::OcclusionCulling occlusion;
+	scene::DepthRasterizer rasterizer;
+	scene::DepthPyramid pyramid;
+
+	bool occlusionEnabled = true;
+	bool gpuCulling = true;
+	bool gpuCullingAvailable = false;
+	scene::OcclusionCullStatistics cullStats;
+	uint64_t timeRasterize = 0;
+	uint64_t timeCull = 0;
+
+	VulkanExample() : VulkanApplication(true)
+	{
+		zoom = -3.75f;
+		rotationSpeed = 0.5f;
+		rotation = glm::vec3(15.0f, 0.f, 0.0f);
+		title = "Render Engine Occlusion Culling";
+		settings.overlay = true;
+		camera.movementSpeed = 20.5f;
+		camera.SetFlipY(true);
+		camera.SetPerspective(60.0f, (float)width / (float)height, 0.1f, 1024.0f);
+		camera.SetRotation(glm::vec3(0.0f, 0.0f, 0.0f));
+		glm::vec3 campos = glm::vec3(0.0f, -2.6f, -0.0f);
+		if (camera.GetFlipY() != 0) campos.y = -campos.y;
+		camera.SetPosition(campos);
+	}
+
+	~VulkanExample()
+	{
+		// Clean up used Vulkan resources
+		// Note : Inherited destructor cleans up resources stored in base class
+		for (auto obj : scene_render_objects)
+			for (auto data : obj->m_meshesData)
+				delete data;
+	}
+
+	//the pyramid set reads the depth and writes the pyramid, the cull set reads objects and pyramid and writes the draws
+	void setupDescriptorPool()
+	{
+		descriptorPoolPostEffects = m_device->GetDescriptorPool({ {render::DescriptorType::IMAGE_SAMPLER, 1} }, 1);
+		descriptorPoolPostEffectsRTV = m_device->GetDescriptorPool({ {render::DescriptorType::RTV, 1} }, 1);
+		descriptorPoolPostEffectsDSV = m_device->GetDescriptorPool({ {render::DescriptorType::DSV, 1} }, 1);
+		descriptorPoolCulling = m_device->GetDescriptorPool(
+			{ {render::DescriptorType::IMAGE_SAMPLER, 1},
+			{render::DescriptorType::INPUT_STORAGE_BUFFER, 2},
+			{render::DescriptorType::OUTPUT_STORAGE_BUFFER, 2},
+			{render::DescriptorType::UNIFORM_BUFFER, 1} }, 2);
+	}
+
+	void init()
+	{
+		if (m_loadingCommandBuffer)
+			m_loadingCommandBuffer->Begin();
+
+		setupDescriptorPool();
+		scene.SetCamera(&camera);
+		scene.uniform_manager.SetEngineDevice(m_device);
+
+		render::Texture* scenecolor = m_device->GetRenderTarget(width, height, render::GfxFormat::R8G8B8A8_UNORM, descriptorPoolPostEffects, descriptorPoolPostEffectsRTV, m_loadingCommandBuffer);
+		//the depth is read back by the pyramid build
+		scenedepth = m_device->GetDepthRenderTarget(width, height, render::GfxFormat::D32_FLOAT, descriptorPoolCulling, descriptorPoolPostEffectsDSV, m_loadingCommandBuffer, true, false);
+
+		scenepass = m_device->GetRenderPass(width, height, { scenecolor }, scenedepth);
+
+		scene.m_loadingCommandBuffer = m_loadingCommandBuffer;
+		scene.forwardShadersFolder = GetShadersPath() + "scene/";
+		scene.lightingVS = "pbrsm" + GetVertexShadersExt();
+		scene.lightingFS = "pbrtexturedsm" + GetFragShadersExt();
+		scene.normalmapVS = "pbrnormalmapsm" + GetVertexShadersExt();
+		scene.shadowmapVS = GetShadersPath() + "shadowmapping/offscreen" + GetVertexShadersExt();
+		scene.shadowmapFS = GetShadersPath() + "shadowmapping/offscreen" + GetFragShadersExt();
+		scene.shadowmapFSColored = GetShadersPath() + "shadowmapping/offscreencolor" + GetFragShadersExt();
+
+		scene._device = m_device;
+		scene.keepMeshData = true;
+		scene_render_objects = scene.LoadFromFile(engine::tools::getAssetPath() + "models/tavern/", "tavern.gltf", 10.0, m_device, scenepass, false, true);
+
+		render::DescriptorSetLayout* blur_layout = m_device->GetDescriptorSetLayout({
+						{render::DescriptorType::IMAGE_SAMPLER,render::ShaderStage::FRAGMENT }
+			});
+
+		render::PipelineProperties props;
+		render::VertexLayout* emptylayout = m_device->GetVertexLayout({}, {});
+		blackandwhitepipeline = m_device->GetPipeline(
+			GetShadersPath() + "posteffects/screenquad" + GetVertexShadersExt(), "VSMain", GetShadersPath() + "posteffects/simpletexture" + GetFragShadersExt(), "PSMainTextured",
+			emptylayout, blur_layout, props, m_mainRenderPass);
+
+		pfdesc = m_device->GetDescriptorSet(blur_layout, descriptorPoolPostEffects, {  }, { scenecolor });
+
+		prepareCulling();
+
+		PrepareUI();
+
+		if (m_loadingCommandBuffer)
+		{
+			m_loadingCommandBuffer->End();
+			SubmitOnQueue(m_loadingCommandBuffer);
+		}
+
+		WaitForDevice();
+
+		m_device->FreeLoadStaggingBuffers();
+	}
+
+	void prepareCulling()
+	{
+		for (auto obj : scene_render_objects)
+			occlusion.AddObject(obj);
+		gpuCullingAvailable = occlusion.Init(m_device, descriptorPoolCulling, scenedepth, width, height,
+			GetShadersPath() + "occlusion/hizbuild" + GetComputeShadersExt(), GetShadersPath() + "occlusion/hizcull" + GetComputeShadersExt(), m_loadingCommandBuffer);
+		gpuCulling &= gpuCullingAvailable;
+		if (!gpuCulling || !occlusionEnabled)
+			occlusion.Disable();
+		rasterizer.Init(SOFTWARE_DEPTH_WIDTH, SOFTWARE_DEPTH_WIDTH * height / width);
+	}
+
+	void BuildCommandBuffers()
+	{
+		bool gpu = occlusionEnabled && gpuCulling;
+		for (int32_t i = 0; i < m_drawCommandBuffers.size(); ++i)
+		{
+			m_drawCommandBuffers[i]->Begin();
+			scene.DrawShadowsInSeparatePass(m_drawCommandBuffers[i]);
+
+			//test against the pyramid of the previous frame
+			if (gpu)
+			{
+				occlusion.PrepareCull(m_drawCommandBuffers[i]);
+				DispatchCompute(m_drawCommandBuffers[i], occlusion.GetCullGroupCount(), 1, 1);
+				PipelineBarrier(m_drawCommandBuffers[i], { occlusion.m_drawsBuffer }, {});
+			}
+
+			scenepass->Begin(m_drawCommandBuffers[i], 0);
+
+			scene.descriptorPool->Draw(m_drawCommandBuffers[i]);
+			//with -bindless all objects share the table, it is bound once and only the pipelines change
+			render::Pipeline* currentPipeline = nullptr;
+			render::DescriptorSet* currentSet = nullptr;
+			for (int j = 0; j < scene_render_objects.size(); j++) {
+				if (scene_render_objects[j]->Draw(m_drawCommandBuffers[i], 0, currentPipeline, currentSet))
+				{
+					currentPipeline = scene_render_objects[j]->_pipeline;
+					currentSet = scene_render_objects[j]->m_descriptorSets[0];
+				}
+			}
+
+			scenepass->End(m_drawCommandBuffers[i]);
+
+			//build the pyramid for the next frame
+			if (gpu)
+			{
+				PipelineBarrier(m_drawCommandBuffers[i], {}, { scenedepth });
+				for (uint32_t p = 0; p < occlusion.GetPyramidPassCount(); p++)
+				{
+					occlusion.PreparePyramidPass(m_drawCommandBuffers[i], p);
+					glm::uvec2 groups = occlusion.GetPyramidGroupCount(p);
+					DispatchCompute(m_drawCommandBuffers[i], groups.x, groups.y, 1);
+					PipelineBarrier(m_drawCommandBuffers[i], { occlusion.m_pyramidBuffer }, {});
+				}
+			}
+
+			m_mainRenderPass->Begin(m_drawCommandBuffers[i], i);
+
+			descriptorPoolPostEffects->Draw(m_drawCommandBuffers[i]);
+			blackandwhitepipeline->Draw(m_drawCommandBuffers[i]);
+			pfdesc->Draw(m_drawCommandBuffers[i], blackandwhitepipeline);
+			DrawFullScreenQuad(m_drawCommandBuffers[i]);
+
+			DrawUI(m_drawCommandBuffers[i]);
+
+			m_mainRenderPass->End(m_drawCommandBuffers[i], i);
+
+			m_drawCommandBuffers[i]->End();
+		}
+	}
+
+	//rasterizes the whole scene in software and culls against it, the visibility is baked in the command buffers
+	void cullOnCPU(const glm::mat4& viewProjection)
+	{
+		Timer timer;
+		timer.start();
+		rasterizer.Clear();
+		for (auto obj : scene_render_objects)
+			for (auto data : obj->m_meshesData)
+				rasterizer.RasterizeMesh(data, obj->_vertexLayout, viewProjection);
+		pyramid.Build(rasterizer.m_depth.data(), rasterizer.m_width, rasterizer.m_height);
+		timer.stop();
+		timeRasterize = timer.elapsedMicroseconds();
+
+		timer.start();
+		bool changed = occlusion.Cull(pyramid, viewProjection, *camera.GetFrustum(), &cullStats);
+		timer.stop();
+		timeCull = timer.elapsedMicroseconds();
+
+		if (changed)
+		{
+			WaitForDevice();
+			BuildCommandBuffers();
+		}
+	}
+
+	void updateCulling()
+	{
+		glm::mat4 viewProjection = camera.GetPerspectiveMatrix() * camera.GetViewMatrix();
+		occlusion.Update(viewProjection, *camera.GetFrustum());
+		if (occlusionEnabled && !gpuCulling)
+			cullOnCPU(viewProjection);
+	}
+
+	void switchCulling()
+	{
+		WaitForDevice();
+		if (occlusionEnabled && gpuCulling)
+			occlusion.Enable();
+		else
+			occlusion.Disable();
+		if (!occlusionEnabled || gpuCulling)
+		{
+			occlusion.ResetVisibility();
+			cullStats = scene::OcclusionCullStatistics();
+		}
+		BuildCommandBuffers();
+		updateCulling();
+	}
+
+	void updateUniformBuffers()
+	{
+		scene.Update(timer * 0.05f);
+	}
+
+	void Prepare()
+	{
+		init();
+		BuildCommandBuffers();
+		updateUniformBuffers();
+		updateCulling();
+		prepared = true;
+	}
+
+	virtual void update(float dt)
+	{
+
+	}
+
+	virtual void ViewChanged()
+	{
+		scene.UpdateView(timer * 0.05f);
+		updateCulling();
+	}
+
+	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay* overlay)
+	{
+		if (overlay->header("Settings")) {
+			if (overlay->checkBox("Occlusion culling", &occlusionEnabled)) {
+				switchCulling();
+			}
+			if (gpuCullingAvailable && overlay->checkBox("GPU culling", &gpuCulling)) {
+				switchCulling();
+			}
+		}
+		if (overlay->header("Occlusion")) {
+			ImGui::Text("%u geometries", (uint32_t)occlusion.m_objects.size());
+			if (occlusionEnabled && !gpuCulling)
+			{
+				ImGui::Text("%u frustum culled", cullStats.objectsFrustumCulled);
+				ImGui::Text("%u occluded of %u tested", cullStats.objectsOccluded, cullStats.objectsTested);
+				ImGui::Text("%llu us software rasterization", (unsigned long long)timeRasterize);
+				ImGui::Text("%llu us cpu cull time", (unsigned long long)timeCull);
+			}
+			ImGui::Text("%.3f ms frame time", frameTimer * 1000.0f);
+		}
+	}
+
+};
+
+VULKAN_EXAMPLE_MAIN()
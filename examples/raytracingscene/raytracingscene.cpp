@@ -10,13 +10,6 @@ class VulkanExample : public VulkanApplication
 {
 public:
 	// Function pointers for ray tracing related stuff
-	PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR;
-	PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR;
-	PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR;
-	PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR;
-	PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR;
-	PFN_vkBuildAccelerationStructuresKHR vkBuildAccelerationStructuresKHR;
-	PFN_vkCmdBuildAccelerationStructuresKHR vkCmdBuildAccelerationStructuresKHR;
 	PFN_vkCmdTraceRaysKHR vkCmdTraceRaysKHR;
 	PFN_vkGetRayTracingShaderGroupHandlesKHR vkGetRayTracingShaderGroupHandlesKHR;
 	PFN_vkCreateRayTracingPipelinesKHR vkCreateRayTracingPipelinesKHR;
@@ -30,24 +23,6 @@ public:
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR enabledRayTracingPipelineFeatures{};
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR enabledAccelerationStructureFeatures{};
 
-	// Holds information for a ray tracing scratch buffer that is used as a temporary storage
-	struct ScratchBuffer
-	{
-		uint64_t deviceAddress = 0;
-		render::VulkanBuffer* buffer;
-		//VkBuffer handle = VK_NULL_HANDLE;
-		//VkDeviceMemory memory = VK_NULL_HANDLE;
-	};
-
-	// Holds information for a ray tracing acceleration structure
-	struct AccelerationStructure {
-		VkAccelerationStructureKHR handle;
-		uint64_t deviceAddress = 0;
-		render::VulkanBuffer* buffer;
-		//VkDeviceMemory memory;
-		//VkBuffer buffer;
-	};
-
 	// Holds information for a storage image that the ray tracing shaders output to
 	render::VulkanTexture* storageImage = nullptr;
 
@@ -56,8 +31,10 @@ public:
 		VkStridedDeviceAddressRegionKHR stridedDeviceAddressRegion;
 	};
 
-	std::vector<AccelerationStructure> bottomLevelASs;
-	AccelerationStructure topLevelAS;
+	//bottom levels of the geometries built together and compacted, the top level is refitted every frame
+	render::VulkanAccelerationStructures* accelerationStructures = nullptr;
+	//a smaller copy of the building that circles the scene
+	uint32_t movingInstance = 0;
 
 	std::vector<VkRayTracingShaderGroupCreateInfoKHR> shaderGroups{};
 	struct ShaderBindingTables {
@@ -146,15 +123,6 @@ public:
 		enableExtensions();
 	}
 
-	void deleteScratchBuffer(ScratchBuffer& scratchBuffer)
-	{
-		vulkanDevice->DestroyBuffer(scratchBuffer.buffer);
-	}
-	void deleteAccelerationStructure(AccelerationStructure& accelerationStructure)
-	{
-		vulkanDevice->DestroyBuffer(accelerationStructure.buffer);
-		vkDestroyAccelerationStructureKHR(device, accelerationStructure.handle, nullptr);
-	}
 	void deleteStorageImage()
 	{
 		vulkanDevice->DestroyTexture(storageImage);
@@ -166,9 +134,6 @@ public:
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 		deleteStorageImage();
-		for(auto blas : bottomLevelASs)
-		deleteAccelerationStructure(blas);
-		deleteAccelerationStructure(topLevelAS);
 		vulkanDevice->DestroyBuffer(ubo);
 		for (auto& shaderModule : m_shaderModules)
 		{
@@ -196,35 +161,6 @@ public:
 		return shaderStage;
 	}
 
-	ScratchBuffer createScratchBuffer(VkDeviceSize size)
-	{
-		ScratchBuffer scratchBuffer{};
-		scratchBuffer.buffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size);
-
-		VkBufferDeviceAddressInfoKHR bufferDeviceAddresInfo{};
-		bufferDeviceAddresInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-		bufferDeviceAddresInfo.buffer = scratchBuffer.buffer->GetVkBuffer();
-		scratchBuffer.deviceAddress = vkGetBufferDeviceAddressKHR(vulkanDevice->logicalDevice, &bufferDeviceAddresInfo);
-		return scratchBuffer;
-	}
-
-	void createAccelerationStructure(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, VkAccelerationStructureBuildSizesInfoKHR buildSizeInfo)
-	{
-		accelerationStructure.buffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buildSizeInfo.accelerationStructureSize);
-		// Acceleration structure
-		VkAccelerationStructureCreateInfoKHR accelerationStructureCreate_info{};
-		accelerationStructureCreate_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-		accelerationStructureCreate_info.buffer = accelerationStructure.buffer->GetVkBuffer();
-		accelerationStructureCreate_info.size = buildSizeInfo.accelerationStructureSize;
-		accelerationStructureCreate_info.type = type;
-		vkCreateAccelerationStructureKHR(vulkanDevice->logicalDevice, &accelerationStructureCreate_info, nullptr, &accelerationStructure.handle);
-		// AS device address
-		VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
-		accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-		accelerationDeviceAddressInfo.accelerationStructure = accelerationStructure.handle;
-		accelerationStructure.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(vulkanDevice->logicalDevice, &accelerationDeviceAddressInfo);
-	}
-
 	void createStorageImage(VkFormat format, VkExtent3D extent)
 	{
 		// Release ressources if image is to be recreated
@@ -243,10 +179,7 @@ public:
 
 	uint64_t getBufferDeviceAddress(VkBuffer buffer)
 	{
-		VkBufferDeviceAddressInfoKHR bufferDeviceAI{};
-		bufferDeviceAI.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-		bufferDeviceAI.buffer = buffer;
-		return vkGetBufferDeviceAddressKHR(vulkanDevice->logicalDevice, &bufferDeviceAI);
+		return accelerationStructures->GetBufferAddress(buffer);
 	}
 
 	VkStridedDeviceAddressRegionKHR getSbtEntryStridedDeviceAddressRegion(VkBuffer buffer, uint32_t handleCount)
@@ -304,30 +237,19 @@ public:
 		/*scene::GeometryRT* geoRT = (scene::GeometryRT*)scene.m_geometries[1];
 		geoRT->m_materials[0].textureID = 0;
 		geoRT->m_textures.push_back("compass.jpg");*/
+		//the geometry is read by the builds and the shaders only, it stays in device local memory
+		const VkBufferUsageFlags geometryUsage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 		int txtOffset = 0;
 		for (auto geo : scene.m_geometriesRT)
 		{
 			scene::GeometryRT* geoRT = (scene::GeometryRT*)geo;
 
-			geo->SetIndexBuffer(vulkanDevice->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				geo->m_indexCount * sizeof(uint32_t), geo->m_indices
-
-			));
-			geo->SetVertexBuffer(vulkanDevice->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				geo->m_verticesSize * sizeof(float), geo->m_vertices)
-			);
-
-			
-			geoRT->materialsBuffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				geoRT->m_materials.size() * sizeof(scene::GeometryRT::MaterialObj), geoRT->m_materials.data()
-			);
-			geoRT->materialsIndexBuffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				geoRT->m_matIndx.size() * sizeof(int32_t), geoRT->m_matIndx.data()
-			);
+			geo->SetIndexBuffer(vulkanDevice->GetGeometryBuffer(geometryUsage, queue, geo->m_indexCount * sizeof(uint32_t), geo->m_indices));
+			geo->SetVertexBuffer(vulkanDevice->GetGeometryBuffer(geometryUsage, queue, geo->m_verticesSize * sizeof(float), geo->m_vertices));
+			geoRT->materialsBuffer = vulkanDevice->GetGeometryBuffer(geometryUsage, queue,
+				geoRT->m_materials.size() * sizeof(scene::GeometryRT::MaterialObj), geoRT->m_materials.data());
+			geoRT->materialsIndexBuffer = vulkanDevice->GetGeometryBuffer(geometryUsage, queue,
+				geoRT->m_matIndx.size() * sizeof(int32_t), geoRT->m_matIndx.data());
 
 			ObjDesc desc;
 			desc.txtOffset = txtOffset;
@@ -338,89 +260,23 @@ public:
 			desc.materialIndexAddress = getBufferDeviceAddress(geoRT->materialsIndexBuffer->GetVkBuffer());
 			m_objDesc.emplace_back(desc);
 
-			VkDeviceOrHostAddressConstKHR vertexBufferDeviceAddress{};
-			VkDeviceOrHostAddressConstKHR indexBufferDeviceAddress{};
-
-			vertexBufferDeviceAddress.deviceAddress = getBufferDeviceAddress(geo->_vertexBuffer->GetVkBuffer());
-			indexBufferDeviceAddress.deviceAddress = getBufferDeviceAddress(geo->_indexBuffer->GetVkBuffer());
-
-			uint32_t numTriangles = geo->m_indexCount / 3;
-			uint32_t maxVertex = static_cast<uint32_t>(geo->m_vertexCount);
-
-			// Build
-			//VkAccelerationStructureGeometryKHR accelerationStructureGeometry = engine::initializers::accelerationStructureGeometryKHR();
-			VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
-			accelerationStructureGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-			accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-			accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-			accelerationStructureGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-			accelerationStructureGeometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-			accelerationStructureGeometry.geometry.triangles.vertexData = vertexBufferDeviceAddress;
-			accelerationStructureGeometry.geometry.triangles.maxVertex = maxVertex;
-			accelerationStructureGeometry.geometry.triangles.vertexStride = vertexLayoutRT.GetVertexSize(0);
-			accelerationStructureGeometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-			accelerationStructureGeometry.geometry.triangles.indexData = indexBufferDeviceAddress;
-			accelerationStructureGeometry.geometry.triangles.transformData.deviceAddress = 0;
-			accelerationStructureGeometry.geometry.triangles.transformData.hostAddress = nullptr;
-
-			// Get size info
-			//VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo = engine::initializers::accelerationStructureBuildGeometryInfoKHR();
-			VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-			accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-			accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-			accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-			accelerationStructureBuildGeometryInfo.geometryCount = 1;
-			accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-			//VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo = engine::initializers::accelerationStructureBuildSizesInfoKHR();
-			VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-			accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-			vkGetAccelerationStructureBuildSizesKHR(
-				device,
-				VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-				&accelerationStructureBuildGeometryInfo,
-				&numTriangles,
-				&accelerationStructureBuildSizesInfo);
-
-			AccelerationStructure blas;
-			createAccelerationStructure(blas, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, accelerationStructureBuildSizesInfo);
-
-			// Create a small scratch buffer used during build of the bottom level acceleration structure
-			ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-			//VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo = engine::initializers::accelerationStructureBuildGeometryInfoKHR();
-			VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{};
-			accelerationBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-			accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-			accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-			accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-			accelerationBuildGeometryInfo.dstAccelerationStructure = blas.handle;
-			accelerationBuildGeometryInfo.geometryCount = 1;
-			accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-			accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
-			VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
-			accelerationStructureBuildRangeInfo.primitiveCount = numTriangles;
-			accelerationStructureBuildRangeInfo.primitiveOffset = 0;
-			accelerationStructureBuildRangeInfo.firstVertex = 0;
-			accelerationStructureBuildRangeInfo.transformOffset = 0;
-			std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-
-			// Build the acceleration structure on the device via a one-time command buffer submission
-			// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer device builds
-			VkCommandBuffer commandBuffer = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-			vkCmdBuildAccelerationStructuresKHR(
-				commandBuffer,
-				1,
-				&accelerationBuildGeometryInfo,
-				accelerationBuildStructureRangeInfos.data());
-			vulkanDevice->FlushCommandBuffer(commandBuffer, queue);
-
-			deleteScratchBuffer(scratchBuffer);
-
-			bottomLevelASs.push_back(blas);
-
+			render::VulkanAccelerationStructures::Triangles triangles;
+			triangles.vertices = static_cast<render::VulkanBuffer*>(geo->_vertexBuffer);
+			triangles.indices = static_cast<render::VulkanBuffer*>(geo->_indexBuffer);
+			triangles.vertexCount = static_cast<uint32_t>(geo->m_vertexCount);
+			triangles.vertexStride = vertexLayoutRT.GetVertexSize(0);
+			triangles.indexCount = geo->m_indexCount;
+			triangles.indexSize = sizeof(uint32_t);//uploaded as they were loaded above
+			accelerationStructures->AddBottomLevel(triangles);
 		}
+		//all geometries in one submit, then compacted
+		accelerationStructures->BuildBottomLevels(queue);
+		const render::AccelerationStructureStatistics& statistics = accelerationStructures->m_statistics;
+		std::cout << statistics.bottomLevels << " bottom level structures built in " << statistics.batches << " batches with " << statistics.scratchSize / 1024 << " KB of scratch memory, "
+			<< statistics.builtSize / 1024 << " KB compacted to " << statistics.compactedSize / 1024 << " KB\n";
+
+		//the shaders find the object of a hit by the instance index, the moving copy of the building repeats its description
+		m_objDesc.push_back(m_objDesc[0]);
 
 		VkDeviceSize bufferSize = m_objDesc.size() * sizeof(ObjDesc);
 		m_bObjDesc = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -435,108 +291,23 @@ public:
 		vulkanDevice->FlushCommandBuffer(copyCmd, queue, true);
 	}
 
+	glm::mat4 getMovingTransform()
+	{
+		glm::mat4 transform = glm::rotate(glm::mat4(1.0f), glm::radians(timer * 360.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		transform = glm::translate(transform, glm::vec3(1.5f, 0.0f, 0.0f));
+		return glm::scale(transform, glm::vec3(0.3f));
+	}
+
 	/*
 		The top level acceleration structure contains the scene's object instances
 	*/
 	void createTopLevelAccelerationStructure()
 	{
-		VkTransformMatrixKHR transformMatrix = {
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f };
-		VkTransformMatrixKHR othertransformMatrix = {
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f };
-
-		std::vector<VkAccelerationStructureInstanceKHR> instances;
-		instances.resize(bottomLevelASs.size());
-		for (int i = 0; i< bottomLevelASs.size();i++)
-		{	
-			instances[i].transform = i==0 ? transformMatrix : othertransformMatrix;
-			instances[i].instanceCustomIndex = 0;
-			instances[i].mask = 0xFF;
-			instances[i].instanceShaderBindingTableRecordOffset = 0;
-			instances[i].flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-			instances[i].accelerationStructureReference = bottomLevelASs[i].deviceAddress;
-		}
-
-		// Buffer for instance data
-		render::VulkanBuffer* instancesBuffer;
-		instancesBuffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			sizeof(VkAccelerationStructureInstanceKHR) * instances.size(), instances.data());
-
-		VkDeviceOrHostAddressConstKHR instanceDataDeviceAddress{};
-		instanceDataDeviceAddress.deviceAddress = getBufferDeviceAddress(instancesBuffer->GetVkBuffer());
-
-		//VkAccelerationStructureGeometryKHR accelerationStructureGeometry = engine::initializers::accelerationStructureGeometryKHR();
-		VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
-		accelerationStructureGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-		accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-		accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-		accelerationStructureGeometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-		accelerationStructureGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
-		accelerationStructureGeometry.geometry.instances.data = instanceDataDeviceAddress;
-
-		// Get size info
-		//VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo = engine::initializers::accelerationStructureBuildGeometryInfoKHR();
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-		accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = 1;
-		accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-		uint32_t primitive_count = static_cast<uint32_t>(bottomLevelASs.size());
-
-		//VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo = engine::initializers::accelerationStructureBuildSizesInfoKHR();
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-		accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-		vkGetAccelerationStructureBuildSizesKHR(
-			device,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			&primitive_count,
-			&accelerationStructureBuildSizesInfo);
-
-		// @todo: as return value?
-		createAccelerationStructure(topLevelAS, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, accelerationStructureBuildSizesInfo);
-
-		// Create a small scratch buffer used during build of the top level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		//VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo = engine::initializers::accelerationStructureBuildGeometryInfoKHR();
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{};
-		accelerationBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-		accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationBuildGeometryInfo.dstAccelerationStructure = topLevelAS.handle;
-		accelerationBuildGeometryInfo.geometryCount = 1;
-		accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-		accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
-		VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
-		accelerationStructureBuildRangeInfo.primitiveCount = static_cast<uint32_t>(bottomLevelASs.size());
-		accelerationStructureBuildRangeInfo.primitiveOffset = 0;
-		accelerationStructureBuildRangeInfo.firstVertex = 0;
-		accelerationStructureBuildRangeInfo.transformOffset = 0;
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-
-		// Build the acceleration structure on the device via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer device builds
-		VkCommandBuffer commandBuffer = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationBuildGeometryInfo,
-			accelerationBuildStructureRangeInfos.data());
-		vulkanDevice->FlushCommandBuffer(commandBuffer, queue);
-
-		deleteScratchBuffer(scratchBuffer);
-		//instancesBuffer.destroy();
-		vulkanDevice->DestroyBuffer(instancesBuffer);
+		uint32_t geometryCount = static_cast<uint32_t>(scene.m_geometriesRT.size());
+		for (uint32_t i = 0; i < geometryCount; i++)
+			accelerationStructures->AddInstance(i, glm::mat4(1.0f), i);
+		movingInstance = accelerationStructures->AddInstance(0, getMovingTransform(), geometryCount);
+		accelerationStructures->BuildTopLevel(queue);
 	}
 
 
@@ -619,7 +390,7 @@ public:
 		VkWriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructureInfo{};
 		descriptorAccelerationStructureInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
 		descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
-		descriptorAccelerationStructureInfo.pAccelerationStructures = &topLevelAS.handle;
+		descriptorAccelerationStructureInfo.pAccelerationStructures = &accelerationStructures->m_topLevel.handle;
 
 		VkWriteDescriptorSet accelerationStructureWrite{};
 		accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -814,6 +585,8 @@ public:
 			m_drawCommandBuffers[i]->Begin();
 
 			VkCommandBuffer vkbuffer = ((render::VulkanCommandBuffer*)m_drawCommandBuffers[i])->m_vkCommandBuffer;
+			//refit the top level from the instances written for this image
+			accelerationStructures->RecordTopLevelUpdate(vkbuffer, i);
 			/*
 				Dispatch the ray tracing commands
 			*/
@@ -924,18 +697,12 @@ public:
 		deviceFeatures2.pNext = &accelerationStructureFeatures;
 		vkGetPhysicalDeviceFeatures2(vulkanDevice->physicalDevice, &deviceFeatures2);
 		// Get the function pointers required for ray tracing
-		vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(device, "vkGetBufferDeviceAddressKHR"));
-		vkCmdBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(device, "vkCmdBuildAccelerationStructuresKHR"));
-		vkBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(device, "vkBuildAccelerationStructuresKHR"));
-		vkCreateAccelerationStructureKHR = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(vkGetDeviceProcAddr(device, "vkCreateAccelerationStructureKHR"));
-		vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(device, "vkDestroyAccelerationStructureKHR"));
-		vkGetAccelerationStructureBuildSizesKHR = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(vkGetDeviceProcAddr(device, "vkGetAccelerationStructureBuildSizesKHR"));
-		vkGetAccelerationStructureDeviceAddressKHR = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(vkGetDeviceProcAddr(device, "vkGetAccelerationStructureDeviceAddressKHR"));
 		vkCmdTraceRaysKHR = reinterpret_cast<PFN_vkCmdTraceRaysKHR>(vkGetDeviceProcAddr(device, "vkCmdTraceRaysKHR"));
 		vkGetRayTracingShaderGroupHandlesKHR = reinterpret_cast<PFN_vkGetRayTracingShaderGroupHandlesKHR>(vkGetDeviceProcAddr(device, "vkGetRayTracingShaderGroupHandlesKHR"));
 		vkCreateRayTracingPipelinesKHR = reinterpret_cast<PFN_vkCreateRayTracingPipelinesKHR>(vkGetDeviceProcAddr(device, "vkCreateRayTracingPipelinesKHR"));
 
-		// Create the acceleration structures used to render the ray traced scene
+		// Create the acceleration structures used to render the ray traced scene, with a copy of the instances per swap chain image
+		accelerationStructures = vulkanDevice->GetAccelerationStructures(static_cast<uint32_t>(m_drawCommandBuffers.size()));
 		createBottomLevelAccelerationStructure();
 		createTopLevelAccelerationStructure();
 
@@ -952,7 +719,22 @@ public:
 	virtual void update(float dt)
 	{
 		if (!paused /*|| camera.updated*/)
+		{
 			updateUniformBuffers();
+			accelerationStructures->SetTransform(movingInstance, getMovingTransform());
+		}
+	}
+
+	virtual void Render()
+	{
+		if (!prepared)
+			return;
+		if (!BeginFrame())
+			return;
+		//the frame that last refitted from this slot finished, BeginFrame waited for the fence in m_imageFences of the image
+		accelerationStructures->WriteInstances(currentBuffer);
+		CountSubmittedCommands(m_allDrawCommandBuffers[currentBuffer]);
+		EndFrame(allvkDrawCommandBuffers[currentBuffer].data(), static_cast<uint32_t>(allvkDrawCommandBuffers[currentBuffer].size()));
 	}
 };
 
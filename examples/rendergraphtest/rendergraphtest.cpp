@@ -0,0 +1,251 @@
+/*
+* Headless check of the RenderGraph compilation and memory planning, on a deferred frame with a debug view nothing reads
+*
+* rendergraphtest [-width N] [-height N]
+* Prints every check and exits with 1 when one of them fails: the culled passes, the barriers and layouts between the
+* passes, the load and store of the attachments and the transient textures that share memory.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "render/RenderGraph.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+static uint32_t failures = 0;
+
+void Check(bool condition, const char* description)
+{
+	printf("%-72s %s\n", description, condition ? "ok" : "FAILED");
+	if (!condition)
+		failures++;
+}
+
+const render::RenderGraphBarrier* FindBarrier(const render::RenderGraphPass& pass, uint32_t resource)
+{
+	for (const render::RenderGraphBarrier& barrier : pass.barriers)
+	{
+		if (barrier.resource == resource)
+			return &barrier;
+	}
+	return nullptr;
+}
+
+const render::RenderGraphUse* FindUse(const render::RenderGraphPass& pass, uint32_t resource)
+{
+	for (const render::RenderGraphUse& use : pass.uses)
+	{
+		if (use.resource == resource)
+			return &use;
+	}
+	return nullptr;
+}
+
+bool IsTransition(const render::RenderGraphBarrier* barrier, render::RenderGraphLayout oldLayout, render::RenderGraphLayout newLayout, render::RenderGraphAccess srcAccess)
+{
+	return barrier && barrier->oldLayout == oldLayout && barrier->newLayout == newLayout && barrier->srcAccess == srcAccess;
+}
+
+int RunTest(int argc, char** argv)
+{
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-width") == 0 && i + 1 < argc)
+			width = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-height") == 0 && i + 1 < argc)
+			height = std::max(atoi(argv[++i]), 1);
+	}
+
+	render::RenderGraph graph;
+	uint32_t albedo = graph.AddTexture("albedo", width, height, render::GfxFormat::R8G8B8A8_UNORM);
+	uint32_t normals = graph.AddTexture("normals", width, height, render::GfxFormat::R16G16B16A16_SFLOAT);
+	uint32_t depth = graph.AddTexture("depth", width, height, render::GfxFormat::D32_FLOAT);
+	uint32_t debug = graph.AddTexture("debug", width, height, render::GfxFormat::R8G8B8A8_UNORM);
+	uint32_t hdr = graph.AddTexture("hdr", width, height, render::GfxFormat::R16G16B16A16_SFLOAT);
+	uint32_t bloom = graph.AddTexture("bloom", std::max(width / 2, 1u), std::max(height / 2, 1u), render::GfxFormat::R16G16B16A16_SFLOAT);
+	//sampled by the overlay after the graph, it goes back to the layout it came in
+	uint32_t output = graph.ImportTexture("output", width, height, render::GfxFormat::R8G8B8A8_UNORM, render::RENDER_GRAPH_LAYOUT_SHADER_READ);
+
+	uint32_t gbufferPass = graph.AddPass("gbuffer", nullptr);
+	graph.Write(gbufferPass, albedo, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+	graph.Write(gbufferPass, normals, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+	graph.Write(gbufferPass, depth, render::RENDER_GRAPH_DEPTH_ATTACHMENT);
+
+	uint32_t debugPass = graph.AddPass("debug", nullptr);
+	graph.Read(debugPass, normals, render::RENDER_GRAPH_SAMPLED);
+	graph.Write(debugPass, debug, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+
+	uint32_t lightingPass = graph.AddPass("lighting", nullptr);
+	graph.Read(lightingPass, albedo, render::RENDER_GRAPH_SAMPLED);
+	graph.Read(lightingPass, normals, render::RENDER_GRAPH_SAMPLED);
+	graph.Read(lightingPass, depth, render::RENDER_GRAPH_DEPTH_READ);
+	graph.Write(lightingPass, hdr, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+
+	uint32_t bloomPass = graph.AddPass("bloom", nullptr);
+	graph.Read(bloomPass, hdr, render::RENDER_GRAPH_SAMPLED);
+	graph.Write(bloomPass, bloom, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+
+	uint32_t compositePass = graph.AddPass("composite", nullptr);
+	graph.Read(compositePass, hdr, render::RENDER_GRAPH_SAMPLED);
+	graph.Read(compositePass, bloom, render::RENDER_GRAPH_SAMPLED);
+	graph.Write(compositePass, output, render::RENDER_GRAPH_COLOR_ATTACHMENT);
+
+	graph.Compile();
+	const std::vector<render::RenderGraphPass>& passes = graph.m_passes;
+
+	printf("culling\n");
+	Check(passes[debugPass].culled, "the debug pass nothing reads is culled");
+	Check(!passes[gbufferPass].culled && !passes[lightingPass].culled && !passes[bloomPass].culled && !passes[compositePass].culled, "the passes the imported texture depends on are kept");
+	std::vector<uint32_t> schedule = { gbufferPass, lightingPass, bloomPass, compositePass };
+	Check(graph.m_schedule == schedule, "the schedule keeps the order the passes were added in");
+	Check(graph.m_statistics.passes == 4 && graph.m_statistics.culledPasses == 1, "the statistics count 4 passes and 1 culled");
+	Check(!graph.m_resources[debug].used, "the texture of the culled pass is not used");
+
+	printf("barriers and layouts\n");
+	const render::RenderGraphBarrier* barrier = FindBarrier(passes[gbufferPass], albedo);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_UNDEFINED, render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT, render::RENDER_GRAPH_NONE) && barrier->discard,
+		"gbuffer: albedo from undefined to color attachment, discarded");
+	barrier = FindBarrier(passes[gbufferPass], depth);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_UNDEFINED, render::RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT, render::RENDER_GRAPH_NONE) && barrier->discard,
+		"gbuffer: depth from undefined to depth attachment, discarded");
+	Check(passes[gbufferPass].barriers.size() == 3, "gbuffer: one barrier per attachment");
+	barrier = FindBarrier(passes[lightingPass], albedo);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT, render::RENDER_GRAPH_LAYOUT_SHADER_READ, render::RENDER_GRAPH_COLOR_ATTACHMENT),
+		"lighting: albedo waits for the color writes and becomes shader read");
+	barrier = FindBarrier(passes[lightingPass], normals);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT, render::RENDER_GRAPH_LAYOUT_SHADER_READ, render::RENDER_GRAPH_COLOR_ATTACHMENT),
+		"lighting: normals wait for the gbuffer, not for the culled debug pass");
+	barrier = FindBarrier(passes[lightingPass], depth);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_DEPTH_ATTACHMENT, render::RENDER_GRAPH_LAYOUT_DEPTH_READ_ONLY, render::RENDER_GRAPH_DEPTH_ATTACHMENT),
+		"lighting: depth becomes read only");
+	barrier = FindBarrier(passes[bloomPass], hdr);
+	Check(IsTransition(barrier, render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT, render::RENDER_GRAPH_LAYOUT_SHADER_READ, render::RENDER_GRAPH_COLOR_ATTACHMENT),
+		"bloom: hdr waits for the lighting and becomes shader read");
+	Check(FindBarrier(passes[compositePass], hdr) == nullptr, "composite: hdr is read in the same layout and stages, no barrier");
+	barrier = FindBarrier(passes[compositePass], output);
+	Check(barrier && barrier->oldLayout == render::RENDER_GRAPH_LAYOUT_SHADER_READ && barrier->newLayout == render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT && !barrier->discard,
+		"composite: the imported texture leaves its layout and keeps its contents");
+	Check(graph.m_finalBarriers.size() == 1 && graph.m_finalBarriers[0].resource == output && IsTransition(&graph.m_finalBarriers[0],
+		render::RENDER_GRAPH_LAYOUT_COLOR_ATTACHMENT, render::RENDER_GRAPH_LAYOUT_SHADER_READ, render::RENDER_GRAPH_COLOR_ATTACHMENT),
+		"end of the frame: the imported texture goes back to shader read");
+	uint32_t barriers = static_cast<uint32_t>(graph.m_finalBarriers.size());
+	for (uint32_t pass : graph.m_schedule)
+		barriers += static_cast<uint32_t>(passes[pass].barriers.size());
+	Check(graph.m_statistics.barriers == barriers && barriers == 12, "the statistics count the 12 barriers");
+
+	printf("load and store\n");
+	const render::RenderGraphUse* use = FindUse(passes[gbufferPass], albedo);
+	Check(use && use->clear && use->store, "gbuffer: albedo is cleared and stored for the lighting");
+	use = FindUse(passes[gbufferPass], depth);
+	Check(use && use->clear && use->store, "gbuffer: depth is cleared and stored for the lighting");
+	use = FindUse(passes[lightingPass], depth);
+	Check(use && !use->clear && !use->store, "lighting: depth is loaded and not stored, nothing reads it after");
+	use = FindUse(passes[lightingPass], hdr);
+	Check(use && use->clear && use->store, "lighting: hdr is cleared and stored for the bloom and the composite");
+	use = FindUse(passes[compositePass], output);
+	Check(use && !use->clear && use->store, "composite: the imported texture is loaded and stored");
+	use = FindUse(passes[compositePass], bloom);
+	Check(use && !use->store, "composite: bloom is not stored after its last read");
+
+	printf("memory\n");
+	graph.PlanMemory();
+	std::vector<uint32_t> transient;
+	for (uint32_t i = 0; i < graph.m_resources.size(); i++)
+	{
+		const render::RenderGraphResource& resource = graph.m_resources[i];
+		if (resource.used && !resource.imported && resource.texture)
+			transient.push_back(i);
+	}
+	Check(transient.size() == 5 && graph.m_statistics.transientTextures == 5, "5 transient textures, the debug one is not placed");
+
+	bool separate = true;
+	bool aligned = true;
+	uint64_t end = 0;
+	for (size_t a = 0; a < transient.size(); a++)
+	{
+		const render::RenderGraphResource& first = graph.m_resources[transient[a]];
+		aligned = aligned && first.offset % first.alignment == 0;
+		end = std::max(end, first.offset + first.size);
+		for (size_t b = a + 1; b < transient.size(); b++)
+		{
+			const render::RenderGraphResource& second = graph.m_resources[transient[b]];
+			bool alive = first.firstUse <= second.lastUse && second.firstUse <= first.lastUse;
+			bool sharing = first.offset < second.offset + second.size && second.offset < first.offset + first.size;
+			if (alive && sharing)
+			{
+				printf("  %s and %s are alive at the same time in the same memory\n", first.name.c_str(), second.name.c_str());
+				separate = false;
+			}
+		}
+	}
+	Check(separate, "no two textures are alive at the same time in the same memory");
+	Check(aligned, "every texture is placed at its alignment");
+	Check(end == graph.m_statistics.aliasedMemory, "the aliased memory ends with the last texture");
+	//the sum of the sizes leaves out the alignment padding, at small sizes the padding can be larger than what aliasing saves
+	bool reused = false;
+	for (uint32_t gbuffer : { albedo, normals, depth })
+	{
+		const render::RenderGraphResource& previous = graph.m_resources[gbuffer];
+		const render::RenderGraphResource& next = graph.m_resources[bloom];
+		reused = reused || (previous.offset < next.offset + next.size && next.offset < previous.offset + previous.size);
+	}
+	Check(reused, "the bloom texture reuses the memory of the gbuffer after the lighting");
+	printf("  %.1f MB with aliasing, %.1f MB without\n", graph.m_statistics.aliasedMemory / (1024.0 * 1024.0), graph.m_statistics.transientMemory / (1024.0 * 1024.0));
+
+	//the first write of a texture that got the memory of a dead one waits for its last use
+	bool waiting = true;
+	for (uint32_t pass : graph.m_schedule)
+	{
+		for (const render::RenderGraphBarrier& discard : passes[pass].barriers)
+		{
+			if (!discard.discard)
+				continue;
+			const render::RenderGraphResource& resource = graph.m_resources[discard.resource];
+			bool reused = false;
+			for (uint32_t other : transient)
+			{
+				const render::RenderGraphResource& previous = graph.m_resources[other];
+				reused = reused || (other != discard.resource && previous.lastUse < resource.firstUse &&
+					previous.offset < resource.offset + resource.size && resource.offset < previous.offset + previous.size);
+			}
+			if (reused != (discard.srcAccess != render::RENDER_GRAPH_NONE))
+			{
+				printf("  the first use of %s %s\n", resource.name.c_str(), reused ? "doesn't wait for the texture it aliases" : "waits without aliasing");
+				waiting = false;
+			}
+		}
+	}
+	Check(waiting, "aliased textures wait for the last use of the memory before them");
+
+	printf("%u checks failed\n", failures);
+	return failures > 0 ? 1 : 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunTest(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunTest(argc, argv);
+}
+#endif
@@ -110,6 +110,9 @@ public:
 		if (m_loadingCommandBuffer)
 			m_loadingCommandBuffer->Begin();
 
+		//the pipelines of the materials and passes are compiled together once everything is loaded
+		m_device->BeginPipelinePrewarm();
+
 		setupDescriptorPool();
 
 		scene.SetCamera(&camera);
@@ -150,6 +153,12 @@ public:
 		sceneroughnessmetallic = m_device->GetRenderTarget(width, height, render::GfxFormat::R8G8B8A8_UNORM, descriptorPoolPostEffects, descriptorPoolRTV, m_loadingCommandBuffer, cc);
 		sceneLightscolor = m_device->GetRenderTarget(width, height, render::GfxFormat::R8G8B8A8_UNORM, descriptorPoolPostEffects, descriptorPoolRTV, m_loadingCommandBuffer, cc);
 		render::Texture* scenedepth = m_device->GetDepthRenderTarget(width, height, render::GfxFormat::D32_FLOAT, descriptorPoolPostEffects, descriptorPoolPostEffectsDSV, m_loadingCommandBuffer, false, false);
+		//the g-buffer and the depth are only read as input attachments inside the pass, the lights color is blurred after it
+		scenecolor->m_allowTransient = true;
+		scenepositions->m_allowTransient = true;
+		scenenormals->m_allowTransient = true;
+		sceneroughnessmetallic->m_allowTransient = true;
+		scenedepth->m_allowTransient = true;
 		scenepass = m_device->GetRenderPass(width, height, { scenecolor ,scenepositions, scenenormals, sceneroughnessmetallic, sceneLightscolor }, scenedepth, { render::RenderSubpass({}, {0,1,2,3,5}), render::RenderSubpass({0,1,2,3}, {4}) });
 		
 		bool deferred = true;
@@ -165,7 +174,6 @@ public:
 		scene.lightingVS = "basic" + GetVertexShadersExt();
 		scene.lightingFS = "basic" + GetFragShadersExt();
 		scene.normalmapVS = "normalmap" + GetVertexShadersExt();
-		scene.normalmapFS = "normalmap" + GetFragShadersExt();
 		scene.shadowmapVS = GetShadersPath() + "shadowmapping/offscreen" + GetVertexShadersExt();
 		scene.shadowmapFS = GetShadersPath() + "shadowmapping/offscreen" + GetFragShadersExt();
 		scene.shadowmapFSColored = GetShadersPath() + "shadowmapping/offscreencolor" + GetFragShadersExt();
@@ -215,6 +223,9 @@ public:
 			SubmitOnQueue(m_loadingCommandBuffer);
 		}
 
+		//while the GPU uploads the resources
+		CompilePipelines();
+
 		WaitForDevice();
 
 		m_device->FreeLoadStaggingBuffers();
@@ -385,6 +396,11 @@ public:
 				}
 			}
 		}
+		if (overlay->header("G-buffer")) {
+			const render::RenderPassStatistics& statistics = scenepass->m_statistics;
+			overlay->text("%u transient attachments, %u lazily allocated", statistics.transientAttachments, statistics.lazilyAllocatedAttachments);
+			overlay->text("%.1f MB of stores saved per frame", statistics.savedBytesPerFrame / (1024.0f * 1024.0f));
+		}
 	}
 
 };
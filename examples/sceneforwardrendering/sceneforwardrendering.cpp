@@ -10,6 +10,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include <vulkan/vulkan.h>
 #include "VulkanApplication.h"
@@ -54,6 +55,16 @@ public:
 	render::Texture* envMap;
 	scene::SimpleModel skybox;
 
+	bool useLods = true;
+	bool flythrough = false;
+	float flythroughTime = 0.0f;
+	uint64_t trianglesFull = 0;
+	uint64_t trianglesDrawn = 0;
+	uint64_t flythroughFrames = 0;
+	uint64_t flythroughTrianglesFull = 0;
+	uint64_t flythroughTrianglesDrawn = 0;
+	uint32_t lodRebuilds = 0;
+
 	VulkanExample() : D3D12Application(true)
 	{
 		zoom = -3.75f;
@@ -93,6 +104,9 @@ public:
 		if (m_loadingCommandBuffer)
 			m_loadingCommandBuffer->Begin();
 
+		//the pipelines of the materials and passes are compiled together once everything is loaded
+		m_device->BeginPipelinePrewarm();
+
 		setupDescriptorPool();
 		scene.SetCamera(&camera);
 		scene.uniform_manager.SetEngineDevice(m_device);
@@ -111,7 +125,6 @@ public:
 		scene.lightingVS = "pbrsm" + GetVertexShadersExt();
 		scene.lightingFS = "pbrtexturedsm" + GetFragShadersExt();
 		scene.normalmapVS = "pbrnormalmapsm" + GetVertexShadersExt();
-		scene.normalmapFS = "pbrtexturednormalmapsm" + GetFragShadersExt();
 		scene.shadowmapVS = GetShadersPath() + "shadowmapping/offscreen" + GetVertexShadersExt();
 		scene.shadowmapFS = GetShadersPath() + "shadowmapping/offscreen" + GetFragShadersExt();
 		scene.shadowmapFSColored = GetShadersPath() + "shadowmapping/offscreencolor" + GetFragShadersExt();
@@ -121,6 +134,7 @@ public:
 		//scene.globalTextures.push_back(scene.shadowmap);
 
 		//scene_render_objects = scene.LoadFromFile(engine::tools::getAssetPath() + "models/castle/", "modular_fort_01_4k.gltf", 10.0, vulkanDevice, queue, scenepass->GetRenderPass(), pipelineCache);
+		scene.generateLods = true;
 		scene_render_objects = scene.LoadFromFile(engine::tools::getAssetPath() + "models/tavern/", "tavern.gltf", 10.0, m_device, scenepass, false, true);
 		//scene.light_pos = glm::vec4(0.0f, -3.0f, 0.0f, 1.0f);
 		//scene.light_pos = glm::vec4(.0f, .0f, .0f, 1.0f);
@@ -186,6 +200,9 @@ public:
 			SubmitOnQueue(m_loadingCommandBuffer);
 		}
 
+		//while the GPU uploads the resources
+		CompilePipelines();
+
 		WaitForDevice();
 
 		m_device->FreeLoadStaggingBuffers();
@@ -236,6 +253,37 @@ public:
 		scene.Update(timer * 0.05f);
 	}
 
+	void updateLods()
+	{
+		float projectionScale = (float)height / (2.0f * tanf(glm::radians(camera.getFOV()) * 0.5f));
+		glm::vec3 cameraPosition = -camera.GetPosition();
+		bool changed = false;
+		trianglesFull = 0;
+		trianglesDrawn = 0;
+		for (auto obj : scene_render_objects)
+		{
+			if (useLods)
+				changed |= obj->SelectLods(cameraPosition, projectionScale);
+			else
+			{
+				for (auto& chain : obj->m_lods)
+				{
+					changed |= chain.m_current != 0;
+					chain.m_current = 0;
+				}
+			}
+			trianglesFull += obj->GetTriangleCount(true);
+			trianglesDrawn += obj->GetTriangleCount();
+		}
+		//the levels are baked in the command buffers
+		if (changed)
+		{
+			WaitForDevice();
+			BuildCommandBuffers();
+			lodRebuilds++;
+		}
+	}
+
 	void Prepare()
 	{
 		init();
@@ -257,6 +305,22 @@ public:
 		);
 
 		scene.UpdateLights(0, glm::vec4(offset, 1.0f), glm::vec4(flicker),dt);
+
+		//orbit the tavern at growing distances, the statistics are averaged over the whole loop
+		if (flythrough)
+		{
+			const float duration = 30.0f;
+			flythroughTime += dt;
+			float t = fmod(flythroughTime, duration) / duration;
+			float radius = 5.0f + 200.0f * t;
+			float angle = glm::two_pi<float>() * t * 2.0f;
+			camera.SetPosition(glm::vec3(-cosf(angle) * radius, camera.GetPosition().y, -sinf(angle) * radius));
+			camera.SetRotation(glm::vec3(0.0f, glm::degrees(angle) + 90.0f, 0.0f));
+			viewUpdated = true;
+			flythroughFrames++;
+			flythroughTrianglesFull += trianglesFull;
+			flythroughTrianglesDrawn += trianglesDrawn;
+		}
 		//scene.Update(dt, queue);
 
 		glm::mat4 perspectiveMatrix = camera.GetPerspectiveMatrix();
@@ -271,10 +335,26 @@ public:
 	{
 		//updateUniformBuffers();
 		scene.UpdateView(timer * 0.05f);
+		updateLods();
 	}
 
 	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay* overlay)
 	{
+		if (overlay->header("LOD")) {
+			if (overlay->checkBox("Use LODs", &useLods)) {
+				updateLods();
+			}
+			if (overlay->checkBox("Flythrough", &flythrough)) {
+				flythroughTime = 0.0f;
+				flythroughFrames = 0;
+				flythroughTrianglesFull = 0;
+				flythroughTrianglesDrawn = 0;
+			}
+			ImGui::Text("%llu -> %llu triangles per frame", (unsigned long long)trianglesFull, (unsigned long long)trianglesDrawn);
+			if (flythroughFrames > 0)
+				ImGui::Text("Flythrough average %llu -> %llu", (unsigned long long)(flythroughTrianglesFull / flythroughFrames), (unsigned long long)(flythroughTrianglesDrawn / flythroughFrames));
+			ImGui::Text("%u command buffer rebuilds", lodRebuilds);
+		}
 		if (overlay->header("Settings")) {
 			for (int i = 0; i < scene.lightPositions.size(); i++)
 			{
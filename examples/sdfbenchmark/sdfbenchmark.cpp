@@ -0,0 +1,214 @@
+/*
+* Headless benchmark of the sparse signed distance field baker on the models of the dfs example
+*
+* sdfbenchmark [-voxel SIZE] [-samples N] [-threads N] [-save FILE]
+* Times the BVH build and the bakes on one and on many threads, checks the BVH distances and the baked bricks against
+* testing every triangle, and compares an incremental update of the global field after moving an object with a full rebuild.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <math.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "threadpool.hpp"
+#include "VulkanTools.h"
+#include "scene/SimpleModel.h"
+#include "scene/SparseSdf.h"
+#include "scene/Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+struct BenchmarkModel
+{
+	const char* name;
+	float scale;
+	glm::vec3 position;
+	scene::SdfMesh mesh;
+	scene::SparseSdf volume;
+};
+
+bool LoadMesh(BenchmarkModel& model, render::VertexLayout* vertexLayout)
+{
+	scene::SimpleModel loader;
+	std::vector<render::MeshData*> meshes = loader.LoadGeometry(engine::tools::getAssetPath() + "models/" + model.name, vertexLayout, model.scale, 1, model.position);
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	scene::Bvh::GetTriangles(meshes, vertexLayout, positions, indices);
+	for (auto mesh : meshes)
+		delete mesh;
+	if (indices.empty())
+		return false;
+
+	Timer timer;
+	timer.start();
+	model.mesh.Build(positions, indices);
+	timer.stop();
+	printf("%-12s %8u triangles, BVH of %u nodes built in %8.1f ms\n", model.name, model.mesh.m_bvh.GetTriangleCount(),
+		static_cast<uint32_t>(model.mesh.m_bvh.m_nodes.size()), timer.elapsedMicroseconds() / 1000.0);
+	return true;
+}
+
+void ValidateMesh(const BenchmarkModel& model, uint32_t samples, std::mt19937& generator)
+{
+	glm::vec3 boundsMin = model.volume.m_boundsMin;
+	glm::vec3 boundsMax = model.volume.GetBoundsMax();
+	std::uniform_real_distribution<float> x(boundsMin.x, boundsMax.x), y(boundsMin.y, boundsMax.y), z(boundsMin.z, boundsMax.z);
+
+	float maxError = 0.0f, maxSampleError = 0.0f;
+	uint32_t signMismatches = 0, nearSamples = 0;
+	double bvhTime = 0.0, bruteForceTime = 0.0;
+	Timer timer;
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		glm::vec3 p(x(generator), y(generator), z(generator));
+		timer.start();
+		float d = model.mesh.SignedDistance(p);
+		timer.stop();
+		bvhTime += timer.elapsedMicroseconds();
+		timer.start();
+		float reference = model.mesh.SignedDistanceBruteForce(p);
+		timer.stop();
+		bruteForceTime += timer.elapsedMicroseconds();
+
+		maxError = std::max(maxError, fabsf(fabsf(d) - fabsf(reference)));
+		signMismatches += (d < 0.0f) != (reference < 0.0f);
+		//the bricks are only exact near the surface, farther away they keep a bound
+		if (fabsf(reference) < model.volume.m_band)
+		{
+			maxSampleError = std::max(maxSampleError, fabsf(model.volume.Sample(p) - reference));
+			nearSamples++;
+		}
+	}
+	printf("%-12s BVH against brute force: max error %.6f, %u/%u sign mismatches, %.2f us vs %.2f us per query\n", model.name,
+		maxError, signMismatches, samples, bvhTime / samples, bruteForceTime / samples);
+	printf("%-12s bricks against brute force: max error %.4f (%.2f voxels) over %u samples near the surface\n", model.name,
+		maxSampleError, maxSampleError / model.volume.m_voxelSize, nearSamples);
+}
+
+void PrintBake(const char* name, uint32_t threads, const scene::SdfBakeStatistics& statistics, double reference)
+{
+	printf("%-12s %2u threads: %8.1f ms, %6u cells %6u bricks %6u freed %4u dropped, %6.2f Msamples/s (%.2fx)\n", name, threads,
+		statistics.microseconds / 1000.0, statistics.cellsBaked, statistics.bricksBaked, statistics.bricksFreed, statistics.bricksDropped,
+		statistics.samples / std::max<double>(statistics.microseconds, 1.0), reference / std::max<double>(statistics.microseconds, 1.0));
+}
+
+int RunBenchmark(int argc, char** argv)
+{
+	//the dfs example traces a 6 units cube with 128 voxels a side
+	float voxelSize = 6.0f / 126.0f;
+	uint32_t samples = 2000;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	const char* saveFile = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-voxel") == 0 && i + 1 < argc)
+			voxelSize = std::max((float)atof(argv[++i]), 0.001f);
+		else if (strcmp(argv[i], "-samples") == 0 && i + 1 < argc)
+			samples = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-save") == 0 && i + 1 < argc)
+			saveFile = argv[++i];
+	}
+
+	render::VertexLayout vertexLayout({ render::VERTEX_COMPONENT_POSITION, render::VERTEX_COMPONENT_NORMAL, render::VERTEX_COMPONENT_UV }, {});
+	BenchmarkModel models[2];
+	models[0].name = "venus.fbx";
+	models[0].scale = 0.1f;
+	models[0].position = glm::vec3(-0.7f, 1.0f, 0.0f);
+	models[1].name = "teapot.dae";
+	models[1].scale = 0.05f;
+	models[1].position = glm::vec3(0.7f, 0.0f, 0.0f);
+
+	ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+	std::mt19937 generator(1234);
+	printf("voxel size %.4f, %u validation samples, %u threads\n", voxelSize, samples, threadCount);
+
+	//the object volumes are twice as fine as the global one
+	for (auto& model : models)
+	{
+		if (!LoadMesh(model, &vertexLayout))
+		{
+			printf("could not load %s\n", model.name);
+			return 1;
+		}
+		glm::vec3 margin(2.0f * voxelSize * SDF_BRICK_CELLS);
+		model.volume.Init(model.mesh.GetBoundsMin() - margin, model.mesh.GetBoundsMax() + margin, voxelSize * 0.5f);
+		scene::SdfBakeStatistics single = model.volume.Bake(model.mesh);
+		PrintBake(model.name, 1, single, static_cast<double>(single.microseconds));
+		model.volume.Init(model.mesh.GetBoundsMin() - margin, model.mesh.GetBoundsMax() + margin, voxelSize * 0.5f);
+		PrintBake(model.name, threadCount, model.volume.Bake(model.mesh, &threadPool), static_cast<double>(single.microseconds));
+		printf("%-12s %u of %u cells have a brick, %.1f KB instead of %.1f KB dense\n", model.name, model.volume.GetBrickCount(), model.volume.GetCellTotal(),
+			model.volume.GetMemorySize() / 1024.0, model.volume.GetCellTotal() * SDF_BRICK_CELLS * SDF_BRICK_CELLS * SDF_BRICK_CELLS * sizeof(float) / 1024.0);
+		ValidateMesh(model, samples, generator);
+	}
+
+	//the teapot slides by a brick, only the cells around where it was and where it is are baked again
+	scene::GlobalSdf global;
+	global.Init(glm::vec3(-3.0f), glm::vec3(3.0f), voxelSize);
+	for (auto& model : models)
+		global.AddInstance(&model.volume, glm::mat4(1.0f));
+	scene::SdfBakeStatistics full = global.Update(&threadPool);
+	PrintBake("global", threadCount, full, static_cast<double>(full.microseconds));
+
+	glm::mat4 moved = glm::translate(glm::mat4(1.0f), glm::vec3(-voxelSize * SDF_BRICK_CELLS, 0.0f, 0.3f));
+	global.SetTransform(1, moved);
+	scene::SdfBakeStatistics incremental = global.Update(&threadPool);
+	PrintBake("incremental", threadCount, incremental, static_cast<double>(full.microseconds));
+
+	scene::GlobalSdf reference;
+	reference.Init(glm::vec3(-3.0f), glm::vec3(3.0f), voxelSize);
+	reference.AddInstance(&models[0].volume, glm::mat4(1.0f));
+	reference.AddInstance(&models[1].volume, moved);
+	reference.Update(&threadPool);
+
+	//the brick slots differ, the sampled values have to match
+	std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+	float maxDifference = 0.0f;
+	for (uint32_t i = 0; i < samples * 10; i++)
+	{
+		glm::vec3 p(position(generator), position(generator), position(generator));
+		maxDifference = std::max(maxDifference, fabsf(global.m_volume.Sample(p) - reference.m_volume.Sample(p)));
+	}
+	printf("incremental against rebuilt: max difference %.6f, %u of %u bricks\n", maxDifference, global.m_volume.GetBrickCount(), reference.m_volume.GetBrickCount());
+
+	if (saveFile)
+	{
+		bool saved = global.m_volume.Save(saveFile);
+		scene::SparseSdf loaded;
+		bool matching = saved && loaded.Load(saveFile) && loaded.m_bricks == global.m_volume.m_bricks && loaded.m_indirection == global.m_volume.m_indirection;
+		printf("saved to %s: %s\n", saveFile, matching ? "yes" : "NO");
+	}
+	return 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunBenchmark(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunBenchmark(argc, argv);
+}
+#endif
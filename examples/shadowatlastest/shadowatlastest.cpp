@@ -0,0 +1,334 @@
+/*
+* Headless check of the ShadowAtlas tiles and of the ShadowScheduler that keeps the shadows of many lights in them
+*
+* shadowatlastest [-seed N] [-steps N]
+* Prints every check and exits with 1 when one of them fails: tiles allocated, freed and joined again without overlapping,
+* the order lights lose their tiles in, lights keeping their tiles while their size changes a little and the number of
+* faces rendered every frame.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "scene/ShadowAtlas.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+static uint32_t failures = 0;
+
+void Check(bool condition, const char* description)
+{
+	printf("%-72s %s\n", description, condition ? "ok" : "FAILED");
+	if (!condition)
+		failures++;
+}
+
+//every tile is inside the atlas, aligned to its size and no texel belongs to two of them
+bool TilesAreDisjoint(const scene::ShadowAtlas& atlas, const std::vector<scene::ShadowAtlasTile>& tiles)
+{
+	uint32_t cells = atlas.GetSize() / atlas.GetMinTileSize();
+	std::vector<bool> used(cells * cells, false);
+	for (const scene::ShadowAtlasTile& tile : tiles)
+	{
+		if (!tile.IsValid() || tile.x % tile.size || tile.y % tile.size || tile.x + tile.size > atlas.GetSize() || tile.y + tile.size > atlas.GetSize())
+			return false;
+		uint32_t x0 = tile.x / atlas.GetMinTileSize();
+		uint32_t y0 = tile.y / atlas.GetMinTileSize();
+		uint32_t count = tile.size / atlas.GetMinTileSize();
+		for (uint32_t y = y0; y < y0 + count; y++)
+		{
+			for (uint32_t x = x0; x < x0 + count; x++)
+			{
+				if (used[y * cells + x])
+					return false;
+				used[y * cells + x] = true;
+			}
+		}
+	}
+	return true;
+}
+
+uint64_t GetArea(const std::vector<scene::ShadowAtlasTile>& tiles)
+{
+	uint64_t area = 0;
+	for (const scene::ShadowAtlasTile& tile : tiles)
+		area += uint64_t(tile.size) * tile.size;
+	return area;
+}
+
+bool SameTile(const scene::ShadowAtlasTile& a, const scene::ShadowAtlasTile& b)
+{
+	return a.x == b.x && a.y == b.y && a.size == b.size;
+}
+
+//a spot light with a range of 1, at distance from a camera in the origin its importance is projectionScale / distance
+scene::ShadowLight GetSpotLight(float distance)
+{
+	scene::ShadowLight light;
+	light.type = scene::SHADOW_LIGHT_SPOT;
+	light.position = glm::vec3(distance, 0.0f, 0.0f);
+	light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	light.range = 1.0f;
+	return light;
+}
+
+void TestAtlas(uint32_t seed, uint32_t steps)
+{
+	scene::ShadowAtlas atlas;
+	atlas.Init(3000, 50);
+	Check(atlas.GetSize() == 4096 && atlas.GetMinTileSize() == 64, "the atlas and its smallest tile are rounded up to powers of two");
+
+	std::vector<scene::ShadowAtlasTile> tiles;
+	scene::ShadowAtlasTile tile;
+	while (atlas.Allocate(64, tile))
+		tiles.push_back(tile);
+	Check(tiles.size() == 64 * 64, "the smallest tiles fill the whole atlas");
+	Check(TilesAreDisjoint(atlas, tiles), "the smallest tiles don't overlap");
+	Check(atlas.GetUsedArea() == uint64_t(4096) * 4096, "the used area is the whole atlas");
+
+	//two tiles of every quarter stay, no quarter can be joined
+	for (size_t i = 0; i < tiles.size(); i += 2)
+		atlas.Free(tiles[i]);
+	Check(!atlas.Allocate(128, tile), "a tile with some of its quarters taken isn't joined");
+	Check(atlas.Allocate(64, tile), "a freed tile is allocated again");
+	atlas.Free(tile);
+	for (size_t i = 1; i < tiles.size(); i += 2)
+		atlas.Free(tiles[i]);
+	Check(atlas.GetUsedArea() == 0, "the used area is 0 once every tile is freed");
+	Check(atlas.Allocate(4096, tile) && tile.x == 0 && tile.y == 0, "the freed tiles are joined back into the whole atlas");
+	atlas.Free(tile);
+
+	Check(atlas.Allocate(100, tile) && tile.size == 128, "a size is rounded up to the next power of two");
+	atlas.Free(tile);
+	Check(atlas.Allocate(10, tile) && tile.size == 64, "a size below the smallest tile gets the smallest tile");
+	atlas.Free(tile);
+	Check(!atlas.Allocate(5000, tile), "a tile bigger than the atlas isn't allocated");
+
+	Check(atlas.Allocate(2048, tile), "a quarter of the atlas is allocated");
+	scene::ShadowAtlasTile small;
+	Check(atlas.Allocate(512, small) && small.x % 2048 == 0 && small.y % 2048 == 0 && !SameTile(small, tile), "a smaller tile is split from another quarter");
+	glm::vec4 transform = atlas.GetUVTransform(small);
+	Check(transform.x == 0.125f && transform.y == 0.125f && transform.z == small.x / 4096.0f && transform.w == small.y / 4096.0f, "the uv transform scales and offsets into the tile");
+	atlas.Free(small);
+	atlas.Free(tile);
+
+	//random sizes allocated and freed in a random order
+	srand(seed);
+	tiles.clear();
+	bool disjoint = true;
+	bool areaMatches = true;
+	for (uint32_t s = 0; s < steps; s++)
+	{
+		if (!tiles.empty() && rand() % 2)
+		{
+			size_t index = rand() % tiles.size();
+			atlas.Free(tiles[index]);
+			tiles[index] = tiles.back();
+			tiles.pop_back();
+		}
+		else if (atlas.Allocate(64u << (rand() % 6), tile))
+			tiles.push_back(tile);
+		if (s % 64 == 0)
+			disjoint = disjoint && TilesAreDisjoint(atlas, tiles);
+		areaMatches = areaMatches && atlas.GetUsedArea() == GetArea(tiles);
+	}
+	Check(disjoint, "random allocations never overlap");
+	Check(areaMatches, "the used area follows the random allocations");
+	for (const scene::ShadowAtlasTile& allocated : tiles)
+		atlas.Free(allocated);
+	Check(atlas.GetUsedArea() == 0 && atlas.Allocate(4096, tile), "after the random allocations the atlas is joined back into one tile");
+}
+
+void TestEviction()
+{
+	//room for four tiles of 512, five lights want one
+	scene::ShadowScheduler scheduler;
+	scheduler.Init(1024, 64, 1024, 16);
+	const float distances[5] = { 4.0f, 5.0f, 6.0f, 7.0f, 7.5f };
+	for (float distance : distances)
+		scheduler.AddLight(GetSpotLight(distance));
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+
+	bool closestShadowed = true;
+	for (uint32_t i = 0; i < 4; i++)
+		closestShadowed = closestShadowed && scheduler.m_lights[i].resolution == 512;
+	Check(closestShadowed, "the closest lights take the atlas first");
+	Check(scheduler.m_lights[4].resolution == 0 && scheduler.m_statistics.lightsWithoutShadow == 1, "the farthest light doesn't fit and has no shadow");
+
+	scene::ShadowAtlasTile tiles[4];
+	for (uint32_t i = 0; i < 4; i++)
+		tiles[i] = scheduler.m_lights[i].faces[0].tile;
+
+	//the light without a shadow becomes the closest one, the least important light with tiles gives them up
+	scheduler.m_lights[4].position = glm::vec3(3.95f, 0.0f, 0.0f);
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(scheduler.m_lights[4].resolution == 512, "the light that came closest gets a tile");
+	Check(scheduler.m_lights[3].resolution == 0, "the farthest light with tiles is evicted");
+	Check(SameTile(scheduler.m_lights[4].faces[0].tile, tiles[3]), "the evicted tile is given to the closer light");
+	bool kept = true;
+	for (uint32_t i = 0; i < 3; i++)
+		kept = kept && SameTile(scheduler.m_lights[i].faces[0].tile, tiles[i]);
+	Check(kept, "the lights closer than the evicted one keep their tiles");
+}
+
+void TestHysteresis()
+{
+	scene::ShadowScheduler scheduler;
+	scheduler.Init(4096, 64, 1024, 16);
+	scheduler.AddLight(GetSpotLight(4.0f));
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	scene::ShadowLight& light = scheduler.m_lights[0];
+	scene::ShadowAtlasTile tile = light.faces[0].tile;
+	Check(light.resolution == 512 && scheduler.m_statistics.reallocations == 1, "a light gets a resolution from its size on the screen");
+
+	//wants 256, one size smaller isn't worth rendering again
+	light.position.x = 10.0f;
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(light.resolution == 512 && SameTile(light.faces[0].tile, tile) && scheduler.m_statistics.reallocations == 0, "a light one size smaller keeps its tile");
+
+	//wants 128
+	light.position.x = 20.0f;
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(light.resolution == 128 && scheduler.m_statistics.reallocations == 1, "a light two sizes smaller moves into a smaller tile");
+	Check(scheduler.m_atlas.GetUsedArea() == 128 * 128, "the bigger tile is given back");
+
+	light.position.x = 10.0f;
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(light.resolution == 256 && scheduler.m_statistics.reallocations == 1 && scheduler.m_atlas.GetUsedArea() == 256 * 256, "a light that got bigger moves into a free bigger tile");
+
+	//four lights of 256 fill an atlas of 512, the one that comes closer has no bigger tile to move into
+	scheduler.Init(512, 64, 512, 16);
+	const float distances[4] = { 8.0f, 8.5f, 9.0f, 9.5f };
+	for (float distance : distances)
+		scheduler.AddLight(GetSpotLight(distance));
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	bool full = scheduler.m_atlas.GetUsedArea() == 512 * 512;
+	for (const scene::ShadowLight& added : scheduler.m_lights)
+		full = full && added.resolution == 256;
+	Check(full, "four lights of 256 fill the atlas");
+	scene::ShadowAtlasTile tiles[4];
+	for (uint32_t i = 0; i < 4; i++)
+		tiles[i] = scheduler.m_lights[i].faces[0].tile;
+
+	scheduler.m_lights[3].position.x = 5.0f;
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	bool kept = scheduler.m_statistics.reallocations == 0;
+	for (uint32_t i = 0; i < 4; i++)
+		kept = kept && scheduler.m_lights[i].resolution == 256 && SameTile(scheduler.m_lights[i].faces[0].tile, tiles[i]);
+	Check(kept, "a light that got bigger keeps its tile when no bigger one is free");
+}
+
+void TestViewBudget()
+{
+	//three point lights of 256, 18 faces rendered 4 at a time
+	scene::ShadowScheduler scheduler;
+	scheduler.Init(4096, 64, 1024, 4);
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		scene::ShadowLight light;
+		light.type = scene::SHADOW_LIGHT_POINT;
+		light.position = glm::vec3(0.0f, 0.0f, 8.0f + float(i));
+		light.range = 1.0f;
+		scheduler.AddLight(light);
+	}
+
+	uint32_t updates[3][6] = {};
+	bool withinBudget = true;
+	uint32_t frames = 0;
+	for (; frames < 10; frames++)
+	{
+		scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+		withinBudget = withinBudget && scheduler.m_updates.size() <= 4 && scheduler.m_statistics.updatedViews == scheduler.m_updates.size();
+		for (const scene::ShadowView& view : scheduler.m_updates)
+			updates[view.light][view.face]++;
+		bool ready = true;
+		for (const scene::ShadowLight& light : scheduler.m_lights)
+			ready = ready && light.IsReady();
+		if (ready)
+			break;
+	}
+	Check(withinBudget, "no frame renders more faces than the budget");
+	Check(frames == 4, "18 new faces take 5 frames with 4 faces a frame");
+	bool once = true;
+	for (uint32_t l = 0; l < 3; l++)
+	{
+		for (uint32_t f = 0; f < 6; f++)
+			once = once && updates[l][f] == 1;
+	}
+	Check(once, "every face is rendered once");
+
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(scheduler.m_updates.empty() && scheduler.m_statistics.dirtyViews == 0, "nothing is rendered while nothing changes");
+
+	//a light that moved and a new one, the new tiles come first since they show nothing yet
+	scheduler.m_lights[0].position.y += 0.5f;
+	scene::ShadowLight added;
+	added.type = scene::SHADOW_LIGHT_POINT;
+	added.position = glm::vec3(0.0f, 0.0f, 20.0f);
+	added.range = 1.0f;
+	uint32_t addedIndex = scheduler.AddLight(added);
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	bool newFirst = scheduler.m_updates.size() == 4;
+	for (const scene::ShadowView& view : scheduler.m_updates)
+		newFirst = newFirst && view.light == addedIndex;
+	Check(scheduler.m_statistics.dirtyViews == 12, "the faces of a moved light and of a new one are dirty");
+	Check(newFirst, "the faces of a new light are rendered before the ones that moved");
+	Check(scheduler.m_lights[0].IsReady(), "a light that moved keeps its old shadow until it is rendered again");
+
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(scheduler.m_statistics.dirtyViews == 4 && scheduler.m_updates.size() == 4 && scheduler.m_lights[addedIndex].IsReady(), "the dirty faces are caught up with within the budget");
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(scheduler.m_updates.empty(), "nothing is left to render once they are caught up");
+
+	scheduler.m_lights[1].castersChanged = true;
+	scheduler.Schedule(glm::vec3(0.0f), 1000.0f);
+	Check(scheduler.m_statistics.dirtyViews == 6 && scheduler.m_updates.size() == 4, "changed casters make every face of their light dirty");
+}
+
+int RunTest(int argc, char** argv)
+{
+	uint32_t seed = 1;
+	uint32_t steps = 20000;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+			seed = static_cast<uint32_t>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "-steps") == 0 && i + 1 < argc)
+			steps = static_cast<uint32_t>(std::max(atoi(argv[++i]), 0));
+	}
+
+	TestAtlas(seed, steps);
+	TestEviction();
+	TestHysteresis();
+	TestViewBudget();
+
+	printf("%u checks failed\n", failures);
+	return failures > 0 ? 1 : 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunTest(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunTest(argc, argv);
+}
+#endif
@@ -3,17 +3,23 @@
 #include <string.h>
 #include <assert.h>
 #include <vector>
+#include <cfloat>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <vulkan/vulkan.h>
 #include "VulkanApplication.h"
 #include "render/vulkan/VulkanRenderPass.h"
+#include "render/vulkan/VulkanRenderGraph.h"
+#include "render/vulkan/VulkanTimestampQueries.h"
 #include "scene/SimpleModel.h"
 #include "scene/UniformBuffersManager.h"
+#include "scene/CascadedShadows.h"
 
 #define ENABLE_VALIDATION true
 
@@ -22,11 +28,16 @@
 
 // Shadowmap properties
 #if defined(__ANDROID__)
-#define SHADOWMAP_DIM 256
-#else
 #define SHADOWMAP_DIM 512
+#else
+#define SHADOWMAP_DIM 1024
 #endif
+// The split distances reach the shaders in one vec4
+#define SHADOW_CASCADES 4
 #define SHADOWMAP_FILTER VK_FILTER_LINEAR
+// The depth and the squared depth of the variance technique
+#define MOMENTS_FORMAT VK_FORMAT_R32G32_SFLOAT
+#define TECHNIQUE_VARIANCE 2
 
 // Offscreen frame buffer properties
 #define FB_COLOR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
@@ -50,20 +61,38 @@ public:
 	float depthBiasSlope = 0.75f;
 
 	glm::vec3 lightPos = glm::vec3();
-	float lightFOV = 45.0f;
+	//a moving sun moves every cascade, their static casters are rendered again every frame then
+	bool animateLight = false;
+
+	//the cascades end here, farther away nothing is shadowed
+	float shadowDistance = 80.0f;
+	bool cacheStatic = true;
+	bool cullCascades = true;
 
 	scene::UniformBuffersManager uniform_manager;
 
 	std::vector<scene::SimpleModel*> scenes;
-	std::vector<scene::SimpleModel*> offscreen_scenes;
 	std::vector<scene::SimpleModel*> trees;
 
+	//world space bounds of every geometry of the scenes, the scenes are static
+	struct Bounds {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+	};
+	std::vector<std::vector<Bounds>> geometryBounds;
+	std::vector<Bounds> sceneBounds;
+
+	//orbits the scene, the only caster drawn into every cascade every frame
+	scene::SimpleModel dynamicObject;
+	Bounds dynamicObjectBounds;//around its origin
+	glm::mat4 dynamicModel = glm::mat4(1.0f);
+
 	std::vector<std::string> sceneNames;
 	int32_t sceneIndex = 0;
 
 	struct {
 		VulkanBuffer *scene;
-		VulkanBuffer *offscreen;
+		VulkanBuffer *dynamic;
 		VulkanBuffer *debug;
 		VulkanBuffer *tree;
 	} uniformBuffers;
@@ -73,13 +102,14 @@ public:
 		glm::mat4 model;
 	} uboVSquad;
 
-	struct {
+	struct UboVS {
 		glm::mat4 projection;
 		glm::mat4 view;
 		glm::mat4 model;
-		glm::mat4 depthBiasMVP;
-		glm::vec3 lightPos;
-	} uboVSscene;
+		glm::vec4 lightDir;//towards the light
+	};
+	UboVS uboVSscene;
+	UboVS uboVSdynamic;
 
 	struct {
 		glm::mat4 depthMVP;
@@ -98,29 +128,53 @@ public:
 	struct {
 		VulkanPipeline *quad;
 		VulkanPipeline *offscreen;
+		VulkanPipeline *offscreenVariance;
 		VulkanPipeline *sceneShadow;
 		VulkanPipeline *sceneShadowPCF;
 		//VulkanPipeline* filterSM;
 	} pipelines;
 
 	struct {
-		DescriptorSet *offscreen;
 		DescriptorSet *scene;
+		DescriptorSet *dynamic;
 		DescriptorSet *tree;
 		//VulkanDescriptorSet *filterSM;
 	} descriptorSets;
 
 	VulkanTexture* trunktex;
 
-	VulkanTexture* shadowtex = nullptr;
-	VulkanTexture* shadowmapColor = nullptr;
-	//VulkanTexture* shadowmapColorFiltered = nullptr;
-
-	VulkanRenderPass *offscreenPass;
-	//VulkanRenderPass *filterPass;
+	scene::CascadedShadows cascades;
+
+	struct CascadeTarget {
+		VulkanTexture* staticDepth = nullptr;//the static casters, kept until the cascade moves
+		VulkanTexture* depth = nullptr;//a copy of the static casters with the dynamic ones on top, sampled by the scene
+		VulkanTexture* moments = nullptr;//the moments of the variance technique, every caster is drawn into them every frame
+		VulkanBuffer* staticBuffer = nullptr;
+		VulkanBuffer* dynamicBuffer = nullptr;
+		DescriptorSet* staticSet = nullptr;
+		DescriptorSet* dynamicSet = nullptr;
+		uint32_t staticPass = 0;
+		uint32_t copyPass = 0;
+		uint32_t dynamicPass = 0;
+		uint32_t variancePass = 0;
+		bool refreshStatic = true;
+		bool dynamicVisible = true;
+		std::vector<render::Mesh*> staticCasters;//the geometries of the scene inside the light frustum of the cascade
+	} cascadeTargets[SHADOW_CASCADES];
+
+	render::VulkanRenderGraph* graph = nullptr;
+	uint32_t scenePass = 0;
+
+	//from the start of the frame to the end of the last shadow pass
+	render::VulkanTimestampQueries* timestamps = nullptr;
+	std::vector<double> shadowIntervals;
+	double shadowTime = 0.0;
 
 	struct {
+		glm::mat4 cascadeViewProj[SHADOW_CASCADES];
+		glm::vec4 cascadeSplits;//the distance from the camera where every cascade ends
 		int32_t techniqueIndex = 0;
+		int32_t showCascades = 0;
 	} uboFS;
 	render::VulkanBuffer* uniformBufferFS = nullptr;
 
@@ -142,37 +196,133 @@ public:
 	{
 		for (auto scene : scenes)
 			delete scene;
-		for (auto scene : offscreen_scenes)
-			delete scene;
 
 		delete layouts.offscreen_vlayout;
 		delete layouts.scene_vlayout;
 	}
 
-	// Set up a separate render pass for the offscreen frame buffer
-	// This is necessary as the offscreen frame buffer attachments use formats different to those from the example render pass
-	void prepareOffscreenRenderpass()
+	// The shadow textures persist between frames, the graph only orders the passes that fill them and the barriers between them.
+	// Every cascade has three passes: the static casters into their own layer, only when the cascade moved, a copy of that
+	// layer into the texture the scene samples, and the dynamic casters drawn on top of the copy. The variance technique has a
+	// fourth pass instead, the moments can't be copied and drawn on top of like depth, so it draws all the casters again
+	void setupRenderGraph()
 	{
-		shadowtex = vulkanDevice->GetDepthRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, true);
-		shadowmapColor = vulkanDevice->GetColorRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, FB_COLOR_HDR_FORMAT);
-		/*shadowmapColorFiltered = vulkanDevice->GetColorRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, FB_COLOR_HDR_FORMAT);*/
-		offscreenPass = vulkanDevice->GetRenderPass({ { shadowmapColor->m_format, shadowmapColor->m_descriptor.imageLayout}, { shadowtex->m_format, shadowtex->m_descriptor.imageLayout }});
-		VulkanFrameBuffer *fb = vulkanDevice->GetFrameBuffer(offscreenPass->GetRenderPass(), SHADOWMAP_DIM, SHADOWMAP_DIM, { shadowmapColor->m_descriptor.imageView, shadowtex->m_descriptor.imageView });
-		offscreenPass->AddFrameBuffer(fb);
-
-		/*filterPass = vulkanDevice->GetRenderPass({ shadowmapColorFiltered }, 0);
-		fb = vulkanDevice->GetFrameBuffer(filterPass->GetRenderPass(), SHADOWMAP_DIM, SHADOWMAP_DIM, { shadowmapColorFiltered->m_descriptor.imageView }, { { 30.8f, 100.95f, 300.f, 1.0f } });
-		filterPass->AddFrameBuffer(fb);*/
+		graph = vulkanDevice->GetRenderGraph();
+
+		VkCommandBuffer layoutCmd = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			CascadeTarget& shadow = cascadeTargets[c];
+			shadow.staticDepth = vulkanDevice->GetRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, DEPTH_FORMAT,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			shadow.depth = vulkanDevice->GetRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, DEPTH_FORMAT,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			shadow.moments = vulkanDevice->GetRenderTarget(SHADOWMAP_DIM, SHADOWMAP_DIM, MOMENTS_FORMAT,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			//the graph expects the imported textures in their layouts from the first frame on
+			shadow.staticDepth->ChangeLayout(layoutCmd, VK_IMAGE_LAYOUT_UNDEFINED, shadow.staticDepth->m_descriptor.imageLayout);
+			shadow.depth->ChangeLayout(layoutCmd, VK_IMAGE_LAYOUT_UNDEFINED, shadow.depth->m_descriptor.imageLayout);
+			shadow.moments->ChangeLayout(layoutCmd, VK_IMAGE_LAYOUT_UNDEFINED, shadow.moments->m_descriptor.imageLayout);
+		}
+		vulkanDevice->FlushCommandBuffer(layoutCmd, queue, true);
+
+		std::vector<uint32_t> depthResources(SHADOW_CASCADES);
+		std::vector<uint32_t> momentResources(SHADOW_CASCADES);
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			CascadeTarget& shadow = cascadeTargets[c];
+			uint32_t staticDepth = graph->ImportTexture("static cascade " + std::to_string(c), shadow.staticDepth);
+			depthResources[c] = graph->ImportTexture("cascade " + std::to_string(c), shadow.depth);
+
+			//the imported layer is loaded, it is cleared here since every static caster is drawn again
+			shadow.staticPass = graph->AddPass("static casters " + std::to_string(c), [this, c](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+				VkClearAttachment clear{};
+				clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				clear.clearValue.depthStencil = { 1.0f, 0 };
+				VkClearRect rect{};
+				rect.rect.extent = { SHADOWMAP_DIM, SHADOWMAP_DIM };
+				rect.layerCount = 1;
+				vkCmdClearAttachments(((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer, 1, &clear, 1, &rect);
+				drawCasters(commandBuffer, pipelines.offscreen, cascadeTargets[c].staticSet, cascadeTargets[c].staticCasters);
+			});
+			graph->Write(shadow.staticPass, staticDepth, render::RENDER_GRAPH_DEPTH_ATTACHMENT);
+
+			shadow.copyPass = graph->AddPass("copy cascade " + std::to_string(c), [this, c](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+				VkImageCopy region{};
+				region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				region.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				region.extent = { SHADOWMAP_DIM, SHADOWMAP_DIM, 1 };
+				vkCmdCopyImage(((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer,
+					cascadeTargets[c].staticDepth->m_vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					cascadeTargets[c].depth->m_vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			});
+			graph->Read(shadow.copyPass, staticDepth, render::RENDER_GRAPH_TRANSFER_READ);
+			graph->Write(shadow.copyPass, depthResources[c], render::RENDER_GRAPH_TRANSFER_WRITE);
+
+			shadow.dynamicPass = graph->AddPass("dynamic casters " + std::to_string(c), [this, c](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+				drawCasters(commandBuffer, pipelines.offscreen, cascadeTargets[c].dynamicSet, dynamicObject.m_geometries);
+			});
+			graph->Write(shadow.dynamicPass, depthResources[c], render::RENDER_GRAPH_DEPTH_ATTACHMENT);
+
+			momentResources[c] = graph->ImportTexture("moments " + std::to_string(c), shadow.moments);
+			//the depth test needs a depth buffer that only lives in the pass, the graph clears it
+			uint32_t varianceDepth = graph->AddTexture("variance depth " + std::to_string(c), SHADOWMAP_DIM, SHADOWMAP_DIM, render::GfxFormat::D32_FLOAT);
+			shadow.variancePass = graph->AddPass("variance casters " + std::to_string(c), [this, c](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+				//nothing drawn is as far as the far plane of the cascade
+				VkClearAttachment clear{};
+				clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				clear.clearValue.color = { { 1.0f, 1.0f, 0.0f, 0.0f } };
+				VkClearRect rect{};
+				rect.rect.extent = { SHADOWMAP_DIM, SHADOWMAP_DIM };
+				rect.layerCount = 1;
+				vkCmdClearAttachments(((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer, 1, &clear, 1, &rect);
+				drawCasters(commandBuffer, pipelines.offscreenVariance, cascadeTargets[c].staticSet, cascadeTargets[c].staticCasters);
+				if (cascadeTargets[c].dynamicVisible)
+					drawCasters(commandBuffer, pipelines.offscreenVariance, cascadeTargets[c].dynamicSet, dynamicObject.m_geometries);
+			});
+			graph->Write(shadow.variancePass, momentResources[c], render::RENDER_GRAPH_COLOR_ATTACHMENT);
+			graph->Write(shadow.variancePass, varianceDepth, render::RENDER_GRAPH_DEPTH_ATTACHMENT);
+		}
+
+		//draws into the swapchain, which is outside of the graph
+		scenePass = graph->AddPass("scene", [this](render::CommandBuffer* commandBuffer, uint32_t frameBufferIndex) {
+			timestamps->Write(((render::VulkanCommandBuffer*)commandBuffer)->m_vkCommandBuffer, frameBufferIndex, 1);
+
+			mainRenderPass->Begin(commandBuffer, frameBufferIndex);
+			scenes[sceneIndex]->Draw(commandBuffer);
+			dynamicObject.Draw(commandBuffer);
+			DrawUI(commandBuffer);
+			mainRenderPass->End(commandBuffer);
+		});
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			graph->Read(scenePass, depthResources[c], render::RENDER_GRAPH_SAMPLED);
+			graph->Read(scenePass, momentResources[c], render::RENDER_GRAPH_SAMPLED);
+		}
+		graph->SetSideEffects(scenePass);
+
+		graph->Build(vulkanDevice);
 	}
 
-	// Setup the offscreen framebuffer for rendering the scene from light's point-of-view to
-	// The depth attachment of this framebuffer will then be used to sample from in the fragment shader of the shadowing pass
-	void prepareOffscreenFramebuffer()
+	void drawCasters(render::CommandBuffer* commandBuffer, VulkanPipeline* pipeline, DescriptorSet* descriptorSet, const std::vector<render::Mesh*>& casters)
 	{
-		prepareOffscreenRenderpass();
+		if (casters.empty())
+			return;
+		pipeline->Draw(commandBuffer);
+		descriptorSet->Draw(commandBuffer, pipeline);
+		for (auto caster : casters)
+			caster->Draw(commandBuffer);
 	}
 
-	
+	static void getBounds(const render::MeshData* data, uint32_t stride, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		for (uint64_t v = 0; v < data->m_vertexCount; v++)
+		{
+			glm::vec3 position = glm::make_vec3(&data->m_vertices[v * stride]);
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+	}
 
 	void loadAssets()
 	{
@@ -191,7 +341,14 @@ public:
 		{
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
 			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT}
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
 		};
 
 		std::vector<std::pair<VkDescriptorType, VkShaderStageFlags>> offscreenbindings
@@ -205,11 +362,8 @@ public:
 		};
 
 		scenes.resize(2);
-		offscreen_scenes.resize(2);
 		scenes[0] = new scene::SimpleModel;
 		scenes[1] = new scene::SimpleModel;
-		offscreen_scenes[0] = new scene::SimpleModel;
-		offscreen_scenes[1] = new scene::SimpleModel;
 
 		std::vector<std::vector<render::MeshData*>> meshdatas;
 		meshdatas.resize(2);
@@ -217,22 +371,21 @@ public:
 		meshdatas[0] = scenes[0]->LoadGeometry(engine::tools::getAssetPath() + "models/vulkanscene_shadow.dae", layouts.scene_vlayout, 4.0f,1);
 		//scenes[0]->LoadGeometry(engine::tools::getAssetPath() + "models/sponza/crytek-sponza-huge-vray.obj", layouts.scene_vlayout, 0.004f, 1);
 		meshdatas[1] = scenes[1]->LoadGeometry(engine::tools::getAssetPath() + "models/samplescene.dae", layouts.scene_vlayout, 0.25f, 1);
-
-		for (int r = 0; r < offscreen_scenes.size(); r++)
-		{
-			offscreen_scenes[r]->_vertexLayout = scenes[r]->_vertexLayout;
-		}
+		std::vector<render::MeshData*> dynamicmd = dynamicObject.LoadGeometry(engine::tools::getAssetPath() + "models/geosphere.obj", layouts.scene_vlayout, 1.0f, 1);
 
 		sceneNames = {"Vulkan scene", "Teapots and pillars" };
 
 		layouts.offscreen_layout = vulkanDevice->GetDescriptorSetLayout(offscreenbindings);
 		layouts.scene_layout = vulkanDevice->GetDescriptorSetLayout(bindings);
 		//layouts.filter_layout = vulkanDevice->GetDescriptorSetLayout(filterbindings);
-		for (auto off : offscreen_scenes)
-			off->SetDescriptorSetLayout(layouts.offscreen_layout);
 		for (auto scene : scenes)
 			scene->SetDescriptorSetLayout(layouts.scene_layout);
+		dynamicObject.SetDescriptorSetLayout(layouts.scene_layout);
 
+		//the geometries are loaded in world space, their bounds are found once for the culling against the cascades
+		uint32_t stride = layouts.scene_vlayout->GetVertexSize(0) / sizeof(float);
+		geometryBounds.resize(scenes.size());
+		sceneBounds.resize(scenes.size());
 		for (int i=0;i<scenes.size();i++)
 		{
 			for (auto geo : meshdatas[i])
@@ -240,19 +393,21 @@ public:
 				/*geo->SetIndexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_indexCount * sizeof(uint32_t), geo->m_indices));
 				geo->SetVertexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_verticesSize * sizeof(float), geo->m_vertices));
 			*/
+				Bounds bounds;
+				getBounds(geo, stride, bounds.min, bounds.max);
+				geometryBounds[i].push_back(bounds);
+				sceneBounds[i].min = glm::min(sceneBounds[i].min, bounds.min);
+				sceneBounds[i].max = glm::max(sceneBounds[i].max, bounds.max);
+
 				scenes[i]->AddGeometry(vulkanDevice->GetMesh(geo, layouts.scene_vlayout, nullptr));
 				delete geo;
 			}
 		}
-		
-		for (int i = 0;i < scenes.size();i++)
+		for (auto geo : dynamicmd)
 		{
-			for (auto geo : scenes[i]->m_geometries)
-			{
-				/*render::VulkanMesh* mygeo = new render::Mesh();
-				*mygeo = *geo;*/
-				offscreen_scenes[i]->m_geometries.push_back(geo);
-			}
+			getBounds(geo, stride, dynamicObjectBounds.min, dynamicObjectBounds.max);
+			dynamicObject.AddGeometry(vulkanDevice->GetMesh(geo, layouts.scene_vlayout, nullptr));
+			delete geo;
 		}
 
 		techniquesNames = { "Simple", "PCF", "Variance" };
@@ -268,25 +423,32 @@ public:
 
 		descriptorPool = vulkanDevice->CreateDescriptorSetsPool(poolSizes, 4);*/
 		descriptorPool = m_device->GetDescriptorPool(
-			{ {render::DescriptorType::UNIFORM_BUFFER, 12},
-			{render::DescriptorType::IMAGE_SAMPLER, 6} }, 4);
+			{ {render::DescriptorType::UNIFORM_BUFFER, 4 + 2 * SHADOW_CASCADES},
+			{render::DescriptorType::IMAGE_SAMPLER, 4 * SHADOW_CASCADES} }, 2 + 2 * SHADOW_CASCADES);
 	}
 
 	void setupDescriptorSets()
 	{
-		/*descriptorSets.offscreen = vulkanDevice->GetDescriptorSet(descriptorPool, {&uniformBuffers.offscreen->m_descriptor }, {},
-			layouts.offscreen_layout->m_descriptorSetLayout, layouts.offscreen_layout->m_setLayoutBindings);*/
-		descriptorSets.offscreen = vulkanDevice->GetDescriptorSet(layouts.offscreen_layout, descriptorPool, { uniformBuffers.offscreen }, {});
+		std::vector<render::Texture*> shadowMaps;
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			CascadeTarget& shadow = cascadeTargets[c];
+			shadow.staticSet = vulkanDevice->GetDescriptorSet(layouts.offscreen_layout, descriptorPool, { shadow.staticBuffer }, {});
+			shadow.dynamicSet = vulkanDevice->GetDescriptorSet(layouts.offscreen_layout, descriptorPool, { shadow.dynamicBuffer }, {});
+			shadowMaps.push_back(shadow.depth);
+		}
+		//after the uniform buffer of the fragment shader, the bindings of the moments follow the depth maps
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+			shadowMaps.push_back(cascadeTargets[c].moments);
 
 		/*descriptorSets.scene = vulkanDevice->GetDescriptorSet(descriptorPool, { &uniformBuffers.scene->m_descriptor, &uniformBufferFS->m_descriptor }, { &shadowmapColor->m_descriptor },
 			layouts.scene_layout->m_descriptorSetLayout, layouts.scene_layout->m_setLayoutBindings);*/
-		descriptorSets.scene = vulkanDevice->GetDescriptorSet(layouts.scene_layout, descriptorPool, { uniformBuffers.scene, uniformBufferFS }, { shadowmapColor });
+		descriptorSets.scene = vulkanDevice->GetDescriptorSet(layouts.scene_layout, descriptorPool, { uniformBuffers.scene, uniformBufferFS }, shadowMaps);
+		descriptorSets.dynamic = vulkanDevice->GetDescriptorSet(layouts.scene_layout, descriptorPool, { uniformBuffers.dynamic, uniformBufferFS }, shadowMaps);
 
 		for(auto scene:scenes)
 		scene->AddDescriptor(descriptorSets.scene);
-
-		for(auto off:offscreen_scenes)
-		off->AddDescriptor(descriptorSets.offscreen);
+		dynamicObject.AddDescriptor(descriptorSets.dynamic);
 
 		//descriptorSets.filterSM = vulkanDevice->GetDescriptorSet({}, { &shadowmapColor->m_descriptor }, layouts.filter_layout->m_descriptorSetLayout, layouts.filter_layout->m_setLayoutBindings);
 	}
@@ -296,10 +458,14 @@ public:
 		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes;
 		vertexInputAttributes.push_back(VkVertexInputAttributeDescription{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
 
+		//depth only, the passes of all cascades have compatible render passes
 		render::PipelineProperties props;
 		props.depthBias = true;
 		pipelines.offscreen = vulkanDevice->GetPipeline(layouts.offscreen_layout->m_descriptorSetLayout, layouts.scene_vlayout->m_vertexInputBindings, vertexInputAttributes,
-			engine::tools::getAssetPath() + "shaders/shadowmapping/offscreen.vert.spv", engine::tools::getAssetPath() + "shaders/shadowmapping/offscreenvariancecolor.frag.spv", offscreenPass->GetRenderPass(), pipelineCache, props);
+			engine::tools::getAssetPath() + "shaders/shadowmapping/offscreen.vert.spv", "", graph->GetRenderPass(cascadeTargets[0].staticPass), pipelineCache, props);
+		pipelines.offscreenVariance = vulkanDevice->GetPipeline(layouts.offscreen_layout->m_descriptorSetLayout, layouts.scene_vlayout->m_vertexInputBindings, vertexInputAttributes,
+			engine::tools::getAssetPath() + "shaders/shadowmapping/offscreen.vert.spv", engine::tools::getAssetPath() + "shaders/shadowmapping/offscreenvariancecolor.frag.spv",
+			graph->GetRenderPass(cascadeTargets[0].variancePass), pipelineCache, props);
 
 		props.depthBias = false;
 		pipelines.sceneShadow = vulkanDevice->GetPipeline(layouts.scene_layout->m_descriptorSetLayout, layouts.scene_vlayout->m_vertexInputBindings, layouts.scene_vlayout->m_vertexInputAttributes,
@@ -308,13 +474,10 @@ public:
 		/*pipelines.filterSM = vulkanDevice->GetPipeline(layouts.filter_layout->m_descriptorSetLayout, {}, {},
 			engine::tools::getAssetPath() + "shaders/posteffects/screenquad.vert.spv", engine::tools::getAssetPath() + "shaders/shadowmapping/gaussfilter.frag.spv",
 			filterPass->GetRenderPass(), pipelineCache, false, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);*/
-		
-
-		for (auto off : offscreen_scenes)
-			off->AddPipeline(pipelines.offscreen);
 
 		for (auto scene : scenes)
 			scene->AddPipeline(pipelines.sceneShadow);
+		dynamicObject.AddPipeline(pipelines.sceneShadow);
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -325,23 +488,35 @@ public:
 		uniform_manager.SetEngineDevice(vulkanDevice);	
 
 		//uniformBuffers.tree = uniform_manager.GetGlobalUniformBuffer({ scene::UNIFORM_PROJECTION ,scene::UNIFORM_VIEW });
-		uniformBuffers.offscreen = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			sizeof(uboOffscreenVS));
-		VK_CHECK_RESULT(uniformBuffers.offscreen->Map());
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			cascadeTargets[c].staticBuffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				sizeof(uboOffscreenVS));
+			VK_CHECK_RESULT(cascadeTargets[c].staticBuffer->Map());
+			cascadeTargets[c].dynamicBuffer = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				sizeof(uboOffscreenVS));
+			VK_CHECK_RESULT(cascadeTargets[c].dynamicBuffer->Map());
+		}
 
 		uniformBuffers.scene = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			sizeof(uboVSscene));
-	
 		VK_CHECK_RESULT(uniformBuffers.scene->Map());
 
+		uniformBuffers.dynamic = vulkanDevice->GetBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			sizeof(uboVSdynamic));
+		VK_CHECK_RESULT(uniformBuffers.dynamic->Map());
+
 		uniformBufferFS = vulkanDevice->GetUniformBuffer(sizeof(uboFS), true, queue);
 		uniformBufferFS->Map();
 
+		cascades.Init(SHADOW_CASCADES, SHADOWMAP_DIM);
 		updateLight();
-		updateUniformBufferOffscreen();
 		updateUniformBuffers();
+		updateCascades();
 	}
 
 	void updateLight()
@@ -364,31 +539,68 @@ public:
 
 		uboVSscene.model = glm::mat4(1.0f);
 
-		uboVSscene.lightPos = lightPos;
-
-		uboVSscene.depthBiasMVP = uboOffscreenVS.depthMVP;
+		//a directional light, from where lightPos is towards the origin
+		uboVSscene.lightDir = glm::vec4(glm::normalize(lightPos), 0.0f);
 
 		uniformBuffers.scene->MemCopy(&uboVSscene, sizeof(uboVSscene));
 
-		uniformBufferFS->MemCopy(&uboFS, sizeof(uboFS));
-
-		/*uniform_manager.UpdateGlobalParams(scene::UNIFORM_PROJECTION, &uboVSscene.projection, 0, sizeof(perspectiveMatrix));
-		uniform_manager.UpdateGlobalParams(scene::UNIFORM_VIEW, &uboVSscene.view, 0, sizeof(viewMatrix));
-		uniform_manager.Update();*/
-
+		//the dynamic object circles the middle of the scene
+		const Bounds& bounds = sceneBounds[sceneIndex];
+		glm::vec3 extent = bounds.max - bounds.min;
+		float orbit = 0.3f * std::max(extent.x, extent.z);
+		float angle = glm::radians(timer * 360.0f * 2.0f);
+		float scale = 0.05f * std::max(extent.x, extent.z) / std::max(glm::length(dynamicObjectBounds.max - dynamicObjectBounds.min) * 0.5f, 0.001f);
+		glm::vec3 position = (bounds.min + bounds.max) * 0.5f + glm::vec3(cos(angle) * orbit, 0.0f, sin(angle) * orbit);
+		dynamicModel = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(scale));
+
+		uboVSdynamic = uboVSscene;
+		uboVSdynamic.model = dynamicModel;
+		uniformBuffers.dynamic->MemCopy(&uboVSdynamic, sizeof(uboVSdynamic));
 	}
 
-	void updateUniformBufferOffscreen()
+	// Fits the cascades to the camera, culls the casters of every cascade and decides which ones render their static casters again
+	void updateCascades()
 	{
-		// Matrix from light's point of view
-		glm::mat4 depthProjectionMatrix = glm::perspective(glm::radians(lightFOV), 1.0f, zNear, zFar);
-		glm::mat4 depthViewMatrix = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0, 1, 0));
-		glm::mat4 depthModelMatrix = glm::mat4(1.0f);
+		cascades.Update(uboVSscene.view, glm::radians(45.0f), (float)width / (float)height, zNear, shadowDistance, -lightPos);
 
-		uboOffscreenVS.depthMVP = depthProjectionMatrix * depthViewMatrix * depthModelMatrix;
+		glm::vec3 dynamicMin = glm::vec3(dynamicModel * glm::vec4(dynamicObjectBounds.min, 1.0f));
+		glm::vec3 dynamicMax = glm::vec3(dynamicModel * glm::vec4(dynamicObjectBounds.max, 1.0f));
+		bool variance = uboFS.techniqueIndex == TECHNIQUE_VARIANCE;
 
-		uniformBuffers.offscreen->MemCopy(&uboOffscreenVS, sizeof(uboOffscreenVS));
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			const scene::ShadowCascade& cascade = cascades.m_cascades[c];
+			CascadeTarget& shadow = cascadeTargets[c];
 
+			shadow.refreshStatic = cascade.moved || !cacheStatic;
+			if (shadow.refreshStatic)
+			{
+				shadow.staticCasters.clear();
+				for (size_t g = 0; g < scenes[sceneIndex]->m_geometries.size(); g++)
+				{
+					const Bounds& bounds = geometryBounds[sceneIndex][g];
+					if (!cullCascades || cascades.IsVisible(c, bounds.min, bounds.max))
+						shadow.staticCasters.push_back(scenes[sceneIndex]->m_geometries[g]);
+				}
+				uboOffscreenVS.depthMVP = cascade.viewProjection;
+				shadow.staticBuffer->MemCopy(&uboOffscreenVS, sizeof(uboOffscreenVS));
+				cascades.MarkCached(c);
+			}
+			//the pass keeps its barriers, the layer keeps what was rendered into it before. The layers aren't
+			//rendered while the variance technique is on, they are invalidated when it is switched off
+			graph->SetEnabled(shadow.staticPass, shadow.refreshStatic && !variance);
+			graph->SetEnabled(shadow.copyPass, !variance);
+
+			shadow.dynamicVisible = !cullCascades || cascades.IsVisible(c, glm::min(dynamicMin, dynamicMax), glm::max(dynamicMin, dynamicMax));
+			graph->SetEnabled(shadow.dynamicPass, shadow.dynamicVisible && !variance);
+			graph->SetEnabled(shadow.variancePass, variance);
+			uboOffscreenVS.depthMVP = cascade.viewProjection * dynamicModel;
+			shadow.dynamicBuffer->MemCopy(&uboOffscreenVS, sizeof(uboOffscreenVS));
+
+			uboFS.cascadeViewProj[c] = cascade.viewProjection;
+			uboFS.cascadeSplits[c] = cascade.splitFar;
+		}
+		uniformBufferFS->MemCopy(&uboFS, sizeof(uboFS));
 	}
 
 	void BuildCommandBuffers()
@@ -401,57 +613,12 @@ public:
 			//VK_CHECK_RESULT(vkBeginCommandBuffer(drawCommandBuffers[i], &cmdBufInfo));
 			m_drawCommandBuffers[i]->Begin();
 
-			/*
-				First render pass: Generate shadow map by rendering the scene from light's POV
-			*/
-			{
-
-				offscreenPass->Begin(m_drawCommandBuffers[i], 0);
-
-				// Set depth bias (aka "Polygon offset")
-				// Required to avoid shadow mapping artefacts
-				/*vkCmdSetDepthBias(
-					drawCommandBuffers[i],
-					depthBiasConstant,
-					0.0f,
-					depthBiasSlope);*/
-
-				offscreen_scenes[sceneIndex]->Draw(m_drawCommandBuffers[i]);
-
-				offscreenPass->End(m_drawCommandBuffers[i]);
-			}
-
-		/*	filterPass->Begin(drawCmdBuffers[i], 0);
-
-			pipelines.filterSM->Draw(drawCmdBuffers[i]);
-			descriptorSets.filterSM->Draw(drawCmdBuffers[i], pipelines.filterSM->getPipelineLayout(),0);
-			vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
-
-			filterPass->End(drawCmdBuffers[i]);*/
-
-			/*
-				Note: Explicit synchronization is not required between the render pass, as this is done implicit via sub pass dependencies
-			*/
-
-			/*
-				Second pass: Scene rendering with applied shadow map
-			*/
-
-			{
-				mainRenderPass->Begin(m_drawCommandBuffers[i], i);
-
-				// Visualize shadow map
-				if (displayShadowMap) {
+			//the shadow passes are timed up to the scene pass, which writes the second timestamp
+			VkCommandBuffer vkbuffer = ((render::VulkanCommandBuffer*)m_drawCommandBuffers[i])->m_vkCommandBuffer;
+			timestamps->Reset(vkbuffer, i);
+			timestamps->Write(vkbuffer, i, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
 
-				}
-
-				// 3D scene							
-				scenes[sceneIndex]->Draw(m_drawCommandBuffers[i]);
-
-				DrawUI(m_drawCommandBuffers[i]);
-
-				mainRenderPass->End(m_drawCommandBuffers[i]);
-			}
+			graph->Execute(m_drawCommandBuffers[i], i);
 
 			//VK_CHECK_RESULT(vkEndCommandBuffer(drawCommandBuffers[i]));
 			m_drawCommandBuffers[i]->End();
@@ -462,39 +629,71 @@ public:
 	{
 		
 		loadAssets();
-		prepareOffscreenFramebuffer();
+		setupRenderGraph();
 		prepareUniformBuffers();
 		preparePipelines();
 		setupDescriptorPool();
 		PrepareUI();
 		setupDescriptorSets();
+		timestamps = vulkanDevice->GetTimestampQueries(2, static_cast<uint32_t>(m_drawCommandBuffers.size()));
 		BuildCommandBuffers();
 		prepared = true;
 	}
 
 	virtual void update(float dt)
 	{
-		if (!paused /*|| camera.updated*/)
-		{
+		//the uniform buffers and the command buffers are rewritten every frame
+		WaitForFramesInFlight();
+
+		if (animateLight)
 			updateLight();
-			updateUniformBufferOffscreen();
-			updateUniformBuffers();
-		}
+		updateUniformBuffers();
+		updateCascades();
+
+		//every frame is finished here, the timestamps of the last one can be read before its command buffer is recorded again
+		if (timestamps->GetIntervals(currentBuffer, shadowIntervals))
+			shadowTime = shadowTime * 0.9 + shadowIntervals[0] * 0.1;
+
+		BuildCommandBuffers();
 	}
 
 	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
 			if (overlay->comboBox("Scenes", &sceneIndex, sceneNames)) {
-				BuildCommandBuffers();
-			}
-			if (overlay->checkBox("Display shadow render target", &displayShadowMap)) {
-				BuildCommandBuffers();
+				//other static casters, none of the cached layers is valid and the command buffers are recorded again right after
+				WaitForFramesInFlight();
+				cascades.Invalidate();
+				updateUniformBuffers();
+				updateCascades();
 			}
 			if (overlay->comboBox("Technique", &uboFS.techniqueIndex, techniquesNames)) {
-				//buildCommandBuffers();
-				//uniformBufferFS->MemCopy(&uboFS, sizeof(uboFS));
+				//the cached layers missed the moves of the cascades while the variance technique was on
+				WaitForFramesInFlight();
+				cascades.Invalidate();
+				updateCascades();
+			}
+			overlay->checkBox("Animate light", &animateLight);
+		}
+		if (overlay->header("Cascaded shadows")) {
+			overlay->checkBox("Cache static casters", &cacheStatic);
+			overlay->checkBox("Cull per cascade", &cullCascades);
+			overlay->checkBox("Show cascades", &uboFS.showCascades);
+			overlay->sliderFloat("Shadow distance", &shadowDistance, 10.0f, 300.0f);
+
+			uint32_t draws = 0;
+			for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+			{
+				const CascadeTarget& shadow = cascadeTargets[c];
+				bool variance = uboFS.techniqueIndex == TECHNIQUE_VARIANCE;
+				uint32_t staticDraws = shadow.refreshStatic || variance ? static_cast<uint32_t>(shadow.staticCasters.size()) : 0;
+				uint32_t dynamicDraws = shadow.dynamicVisible ? static_cast<uint32_t>(dynamicObject.m_geometries.size()) : 0;
+				overlay->text("Cascade %u to %.1f: %u static, %u dynamic draws", c, cascades.m_cascades[c].splitFar, staticDraws, dynamicDraws);
+				draws += staticDraws + dynamicDraws;
 			}
+			overlay->text("%u shadow draws this frame", draws);
+			if (timestamps && timestamps->IsSupported())
+				overlay->text("GPU shadow passes %.3f ms", shadowTime);
 		}
 	}
 };
@@ -15,6 +15,8 @@
 #include "D3D12Application.h"
 #include "scene/SimpleModel.h"
 #include "scene/UniformBuffersManager.h"
+#include "scene/MeshOptimizer.h"
+#include "scene/Timer.h"
 
 using namespace engine;
 
@@ -23,8 +25,10 @@ class VulkanExample : public D3D12Application
 public:
 
 	render::VertexLayout* vertexLayout = nullptr;
+	render::VertexLayout* quantizedVertexLayout = nullptr;
 
 	engine::scene::SimpleModel plane;
+	engine::scene::SimpleModel planeQuantized;
 	render::Texture* colorMap;
 
 	render::Buffer* sceneVertexUniformBuffer;
@@ -34,6 +38,18 @@ public:
 
 	render::DescriptorPool* descriptorPool = nullptr;
 
+	bool optimizeMeshes = true;
+	uint64_t triangles = 0;
+	scene::VertexCacheStatistics statsBefore;
+	scene::VertexCacheStatistics statsAfter;
+	uint64_t verticesBefore = 0;
+	uint64_t verticesAfter = 0;
+	uint64_t timeOptimize = 0;
+
+	bool drawQuantized = true;
+	uint64_t bytesFull = 0;
+	uint64_t bytesQuantized = 0;
+
 	VulkanExample() : D3D12Application(true)
 	{
 		zoom = -3.75f;
@@ -66,13 +82,68 @@ public:
 
 		//Geometry
 		std::vector<render::MeshData*> mdatas = plane.LoadGeometry(engine::tools::getAssetPath() + "models/chinesedragon.dae", vertexLayout, 0.1f, 1);
+		Timer timer;
 		for (auto geo : mdatas)
 		{
+			scene::VertexCacheStatistics stats = scene::MeshOptimizer::AnalyzeVertexCache(geo->m_indices, geo->m_indexCount, geo->m_vertexCount);
+			statsBefore.verticesTransformed += stats.verticesTransformed;
+			verticesBefore += geo->m_vertexCount;
+			if (optimizeMeshes)
+			{
+				timer.start();
+				scene::MeshOptimizer::Optimize(geo, vertexLayout);
+				timer.stop();
+				timeOptimize += timer.elapsedMicroseconds();
+			}
+			stats = scene::MeshOptimizer::AnalyzeVertexCache(geo->m_indices, geo->m_indexCount, geo->m_vertexCount);
+			statsAfter.verticesTransformed += stats.verticesTransformed;
+			verticesAfter += geo->m_vertexCount;
+			triangles += geo->m_indexCount / 3;
+
 			plane.AddGeometry(m_device->GetMesh(geo, vertexLayout, m_loadingCommandBuffer));
 			delete geo;
 			//geo->SetIndexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_indexCount * sizeof(uint32_t), geo->m_indices));
 			//geo->SetVertexBuffer(vulkanDevice->GetGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue, geo->m_verticesSize * sizeof(float), geo->m_vertices));
 		}
+		if (triangles > 0)
+		{
+			statsBefore.acmr = (float)statsBefore.verticesTransformed / triangles;
+			statsBefore.atvr = (float)statsBefore.verticesTransformed / verticesBefore;
+			statsAfter.acmr = (float)statsAfter.verticesTransformed / triangles;
+			statsAfter.atvr = (float)statsAfter.verticesTransformed / verticesAfter;
+		}
+
+		//same model with 16 bit positions, octahedral normals and half uvs
+		quantizedVertexLayout = m_device->GetVertexLayout(
+		{
+			render::VERTEX_COMPONENT_POSITION_SNORM16,
+			render::VERTEX_COMPONENT_NORMAL_OCT16,
+			render::VERTEX_COMPONENT_UV_HALF
+		}, {});
+
+		mdatas = planeQuantized.LoadGeometry(engine::tools::getAssetPath() + "models/chinesedragon.dae", vertexLayout, 0.1f, 1);
+		std::vector<scene::QuantizationParams> dequantization;
+		for (auto geo : mdatas)
+		{
+			if (optimizeMeshes)
+				scene::MeshOptimizer::Optimize(geo, vertexLayout);
+
+			scene::QuantizationParams params;
+			if (!scene::MeshOptimizer::Quantize(geo, vertexLayout, quantizedVertexLayout, params))
+			{
+				printf("could not quantize the vertices of chinesedragon.dae\n");
+				delete geo;
+				continue;
+			}
+			bytesFull += geo->m_vertexCount * vertexLayout->GetVertexSize(0) + geo->m_indexCount * geo->m_indexSize;
+			dequantization.push_back(params);
+			bytesQuantized += geo->m_vertexCount * quantizedVertexLayout->GetVertexSize(0) + geo->m_indexCount * (geo->FitsShortIndices() ? sizeof(uint16_t) : geo->m_indexSize);
+
+			planeQuantized.AddGeometry(m_device->GetMesh(geo, quantizedVertexLayout, m_loadingCommandBuffer));
+			delete geo;
+		}
+		if (!dequantization.empty())
+			planeQuantized.InitGeometriesPushConstants(sizeof(scene::QuantizationParams), static_cast<uint32_t>(dequantization.size()), dequantization.data());
 	}
 
 	void SetupTextures()
@@ -117,8 +188,8 @@ public:
 			VkDescriptorPoolSize {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}
 		};*/
 		descriptorPool = m_device->GetDescriptorPool(
-			{{render::DescriptorType::UNIFORM_BUFFER, 1},
-			{render::DescriptorType::IMAGE_SAMPLER, 1} }, 1); 
+			{{render::DescriptorType::UNIFORM_BUFFER, 2},
+			{render::DescriptorType::IMAGE_SAMPLER, 2} }, 2); 
 	}
 
 	void SetupDescriptors()
@@ -139,6 +210,8 @@ public:
 		/*plane.AddDescriptor(vulkanDevice->GetDescriptorSet(descriptorPool, { &sceneVertexUniformBuffer->m_descriptor }, {&colorMap->m_descriptor},
 			plane._descriptorLayout->m_descriptorSetLayout, plane._descriptorLayout->m_setLayoutBindings));*/
 		plane.AddDescriptor(m_device->GetDescriptorSet(plane._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer }, { colorMap }));
+		planeQuantized.SetDescriptorSetLayout(pdsl);
+		planeQuantized.AddDescriptor(m_device->GetDescriptorSet(planeQuantized._descriptorLayout, descriptorPool, { sceneVertexUniformBuffer }, { colorMap }));
 	}
 
 	void setupPipelines()
@@ -150,6 +223,12 @@ public:
 		plane.AddPipeline(m_device->GetPipeline(
 			GetShadersPath() +"basic/phong" + GetVertexShadersExt(), "VSMain", GetShadersPath() + "basic/phongtextured" + GetFragShadersExt(), "PSMainTextured",
 			vertexLayout, plane._descriptorLayout, props, m_mainRenderPass));
+
+		render::PipelineProperties quantizedProps;
+		quantizedProps.vertexConstantBlockSize = sizeof(scene::QuantizationParams);
+		planeQuantized.AddPipeline(m_device->GetPipeline(
+			GetShadersPath() + "basic/phongquantized" + GetVertexShadersExt(), "VSMain", GetShadersPath() + "basic/phongtextured" + GetFragShadersExt(), "PSMainTextured",
+			quantizedVertexLayout, planeQuantized._descriptorLayout, quantizedProps, m_mainRenderPass));
 	}
 
 	void init()
@@ -188,7 +267,10 @@ public:
 
 			descriptorPool->Draw(m_drawCommandBuffers[i]);
 			//draw here
-			plane.Draw(m_drawCommandBuffers[i]);
+			if (drawQuantized)
+				planeQuantized.Draw(m_drawCommandBuffers[i]);
+			else
+				plane.Draw(m_drawCommandBuffers[i]);
 
 			DrawUI(m_drawCommandBuffers[i]);
 
@@ -233,7 +315,22 @@ public:
 	virtual void OnUpdateUIOverlay(engine::scene::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
-
+			if (overlay->checkBox("Quantized vertices", &drawQuantized)) {
+				BuildCommandBuffers();
+			}
+		}
+		if (overlay->header("Mesh optimizer")) {
+			ImGui::Text("%llu triangles", (unsigned long long)triangles);
+			ImGui::Text("%llu -> %llu vertices", (unsigned long long)verticesBefore, (unsigned long long)verticesAfter);
+			ImGui::Text("ACMR %.3f -> %.3f", statsBefore.acmr, statsAfter.acmr);
+			ImGui::Text("ATVR %.3f -> %.3f", statsBefore.atvr, statsAfter.atvr);
+			ImGui::Text("%llu us optimize time", (unsigned long long)timeOptimize);
+		}
+		if (overlay->header("Quantization")) {
+			ImGui::Text("%u -> %u bytes per vertex", vertexLayout->GetVertexSize(0), quantizedVertexLayout->GetVertexSize(0));
+			ImGui::Text("%llu -> %llu bytes", (unsigned long long)bytesFull, (unsigned long long)bytesQuantized);
+			ImGui::Text("%llu bytes saved", (unsigned long long)(bytesFull - bytesQuantized));
+			ImGui::Text("%.3f ms frame time", frameTimer * 1000.0f);
 		}
 	}
 
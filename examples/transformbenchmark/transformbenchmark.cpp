@@ -0,0 +1,170 @@
+/*
+* Headless benchmark of the TransformHierarchy
+*
+* transformbenchmark [-nodes N] [-changing PERCENT] [-frames N] [-threads N]
+* Every frame some random nodes get a new rotation. Compares the dirty update on one and many threads against recomputing every world matrix,
+* and the bytes uploaded against uploading all the matrices.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <math.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "threadpool.hpp"
+#include "render/Buffer.h"
+#include "scene/TransformHierarchy.h"
+#include "scene/Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+//stands in for the mapped storage buffer
+class CpuBuffer : public render::Buffer
+{
+	std::vector<char> m_data;
+public:
+	CpuBuffer(size_t size) : m_data(size)
+	{
+		m_size = size;
+		m_mapped = m_data.data();
+	}
+};
+
+//random parents among the previous nodes, 100 roots and a depth around ln(nodes)
+void CreateHierarchy(uint32_t nodesNo, scene::TransformHierarchy& hierarchy)
+{
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	for (uint32_t i = 0; i < nodesNo; i++)
+	{
+		int32_t parent = -1;
+		if (i >= 100)
+			parent = std::uniform_int_distribution<int32_t>(0, i - 1)(generator);
+		hierarchy.AddNode(parent, glm::vec3(offset(generator), offset(generator), offset(generator)));
+	}
+}
+
+int RunBenchmark(int argc, char** argv)
+{
+	uint32_t nodesNo = 100000;
+	float changing = 1.0f;
+	uint32_t frames = 200;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-nodes") == 0 && i + 1 < argc)
+			nodesNo = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-changing") == 0 && i + 1 < argc)
+			changing = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+			frames = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 1);
+	}
+	uint32_t changesPerFrame = std::max(static_cast<uint32_t>(nodesNo * changing / 100.0f), 1u);
+
+	ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+
+	//the same changes for every run
+	std::mt19937 generator(4321);
+	std::uniform_int_distribution<uint32_t> node(0, nodesNo - 1);
+	std::vector<uint32_t> changes(frames * changesPerFrame);
+	for (auto& change : changes)
+		change = node(generator);
+
+	scene::TransformHierarchy single, multi;
+	CreateHierarchy(nodesNo, single);
+	CreateHierarchy(nodesNo, multi);
+	uint32_t maxDepth = static_cast<uint32_t>(single.m_levels.size());
+	CpuBuffer singleBuffer(nodesNo * sizeof(glm::mat4)), multiBuffer(nodesNo * sizeof(glm::mat4));
+	single.m_worldBuffer = &singleBuffer;
+	multi.m_worldBuffer = &multiBuffer;
+	single.Update();
+	multi.Update(&threadPool);
+
+	printf("%u nodes, %u levels, %u changing per frame, %u frames, %u threads\n", nodesNo, maxDepth, changesPerFrame, frames, threadCount);
+
+	Timer timer;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		scene::TransformHierarchy& hierarchy = pass == 0 ? single : multi;
+		ThreadPool* pool = pass == 0 ? nullptr : &threadPool;
+		uint64_t changed = 0, uploaded = 0, updateTime = 0, uploadTime = 0;
+		for (uint32_t f = 0; f < frames; f++)
+		{
+			float angle = 0.01f * f;
+			for (uint32_t c = 0; c < changesPerFrame; c++)
+				hierarchy.SetRotation(changes[f * changesPerFrame + c], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+			timer.start();
+			changed += hierarchy.Update(pool);
+			timer.stop();
+			updateTime += timer.elapsedMicroseconds();
+			timer.start();
+			uploaded += hierarchy.UploadChanged();
+			timer.stop();
+			uploadTime += timer.elapsedMicroseconds();
+		}
+		printf("dirty update %2u threads: %8.1f us/frame update %8.1f us/frame upload %10.1f nodes changed/frame %10.1f KB uploaded/frame\n",
+			pool ? threadCount : 1, static_cast<double>(updateTime) / frames, static_cast<double>(uploadTime) / frames,
+			static_cast<double>(changed) / frames, uploaded / 1024.0 / frames);
+	}
+
+	//every world matrix again every frame, what the objects updating their own matrices amount to
+	std::vector<glm::mat4> worldMatrices(nodesNo);
+	timer.start();
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		for (uint32_t n = 0; n < nodesNo; n++)
+		{
+			int32_t parent = single.m_parents[n];
+			worldMatrices[n] = parent >= 0 ? worldMatrices[parent] * single.GetLocalMatrix(n) : single.GetLocalMatrix(n);
+		}
+		singleBuffer.MemCopy(worldMatrices.data(), nodesNo * sizeof(glm::mat4));
+	}
+	timer.stop();
+	printf("full update and upload:  %8.1f us/frame %10.1f KB uploaded/frame\n", static_cast<double>(timer.elapsedMicroseconds()) / frames, nodesNo * sizeof(glm::mat4) / 1024.0);
+
+	bool matching = true;
+	for (uint32_t n = 0; n < nodesNo; n++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			glm::vec4 difference = single.GetWorldMatrix(n)[c] - worldMatrices[n][c];
+			glm::vec4 threaded = single.GetWorldMatrix(n)[c] - multi.GetWorldMatrix(n)[c];
+			matching &= fabsf(difference.x) + fabsf(difference.y) + fabsf(difference.z) + fabsf(difference.w) < 1e-3f;
+			matching &= threaded.x == 0.0f && threaded.y == 0.0f && threaded.z == 0.0f && threaded.w == 0.0f;
+		}
+	}
+	printf("same matrices as the full update: %s\n", matching ? "yes" : "NO");
+	return 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunBenchmark(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunBenchmark(argc, argv);
+}
+#endif
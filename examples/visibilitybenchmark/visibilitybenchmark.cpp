@@ -0,0 +1,171 @@
+/*
+* Headless benchmark of the SpacePartitionTree visibility, the ball scene of the multithreaded example scaled up
+*
+* visibilitybenchmark [-objects N] [-depth N] [-frames N] [-threads N]
+* Compares ResetVisibility + TestVisibility against GetVisibleObjects on one and on many threads for a camera orbiting the scene.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <math.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "threadpool.hpp"
+#include "scene/SpacePartitionTree.h"
+#include "scene/frustum.hpp"
+#include "scene/Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace engine;
+
+void CreateChildren(scene::SpacePartitionTree* tree, int depth)
+{
+	if (depth == 0)
+		return;
+	tree->CreateChildren();
+	for (auto child : tree->m_children)
+	{
+		CreateChildren(child, depth - 1);
+	}
+}
+
+int RunBenchmark(int argc, char** argv)
+{
+	uint32_t objectsNo = 100000;
+	int depth = 3;
+	uint32_t frames = 100;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-objects") == 0 && i + 1 < argc)
+			objectsNo = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-depth") == 0 && i + 1 < argc)
+			depth = std::max(atoi(argv[++i]), 0);
+		else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+			frames = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 1);
+	}
+
+	//the multithreaded example has 500 balls in a 20 units cube, the cube grows to keep the density
+	float halfExtent = 10.0f * cbrtf(objectsNo / 500.0f);
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+	std::uniform_real_distribution<float> radius(0.005f, 0.015f);
+
+	scene::SpacePartitionTree* tree = new scene::SpacePartitionTree;
+	tree->m_boundries.push_back(glm::vec3(-halfExtent));
+	tree->m_boundries.push_back(glm::vec3(halfExtent));
+	CreateChildren(tree, depth);
+
+	std::vector<scene::BoundingSphere*> balls(objectsNo);
+	float maxRadius = 0.0f;
+	for (uint32_t i = 0; i < objectsNo; i++)
+	{
+		float r = radius(generator);
+		balls[i] = new scene::BoundingSphere(glm::vec3(position(generator), position(generator), position(generator)), glm::vec3(0.0f), r);
+		balls[i]->SetIndex(i);
+		maxRadius = std::max(maxRadius, r);
+		tree->AdvanceObject(balls[i]);
+	}
+
+	ThreadPool threadPool;
+	threadPool.setThreadCount(threadCount);
+
+	//a camera orbiting the cube, looking at points around its center
+	std::vector<scene::Frustum> frustums(frames);
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 4.0f * halfExtent);
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		float angle = 6.2831853f * f / frames;
+		glm::vec3 eye(cosf(angle) * 1.5f * halfExtent, 0.3f * halfExtent, sinf(angle) * 1.5f * halfExtent);
+		glm::vec3 target(sinf(angle * 3.0f) * 0.5f * halfExtent, 0.0f, cosf(angle * 2.0f) * 0.5f * halfExtent);
+		frustums[f].update(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+
+	printf("%u objects, tree depth %d, %u frames, %u threads\n", objectsNo, depth, frames, threadCount);
+
+	Timer timer;
+	uint64_t legacyVisible = 0;
+	timer.start();
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		tree->ResetVisibility();
+		tree->TestVisibility(frustums[f].m_planes.data());
+		for (auto ball : balls)
+			legacyVisible += ball->IsVisible();
+	}
+	timer.stop();
+	double legacyTime = static_cast<double>(timer.elapsedMicroseconds()) / frames;
+	printf("TestVisibility:              %10.1f us/frame %10.1f visible/frame\n", legacyTime, static_cast<double>(legacyVisible) / frames);
+
+	std::vector<uint32_t> visible;
+	bool matching = true;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		ThreadPool* pool = pass == 0 ? nullptr : &threadPool;
+		uint64_t visibleCount = 0, objectsTested = 0, nodesInside = 0;
+		timer.start();
+		for (uint32_t f = 0; f < frames; f++)
+		{
+			scene::VisibilityStatistics statistics;
+			tree->GetVisibleObjects(frustums[f].m_planes.data(), visible, maxRadius, pool, &statistics);
+			visibleCount += statistics.objectsVisible;
+			objectsTested += statistics.objectsTested;
+			nodesInside += statistics.nodesInside;
+		}
+		timer.stop();
+		double time = static_cast<double>(timer.elapsedMicroseconds()) / frames;
+		printf("GetVisibleObjects %2u threads: %10.1f us/frame %10.1f visible/frame %10.1f objects tested/frame %6.1f inside nodes/frame (%.2fx)\n",
+			pool ? threadCount : 1, time, static_cast<double>(visibleCount) / frames, static_cast<double>(objectsTested) / frames, static_cast<double>(nodesInside) / frames, legacyTime / std::max(time, 0.001));
+		matching &= visibleCount == legacyVisible;
+	}
+
+	//same objects as the flags of the old traversal, outside the timing
+	for (uint32_t f = 0; f < frames && matching; f++)
+	{
+		tree->ResetVisibility();
+		tree->TestVisibility(frustums[f].m_planes.data());
+		tree->GetVisibleObjects(frustums[f].m_planes.data(), visible, maxRadius, &threadPool);
+		uint32_t flagged = 0;
+		for (auto ball : balls)
+			flagged += ball->IsVisible();
+		for (uint32_t index : visible)
+			matching &= balls[index]->IsVisible();
+		matching &= flagged == visible.size();
+	}
+	printf("same objects as TestVisibility: %s\n", matching ? "yes" : "NO");
+
+	delete tree;
+	for (auto ball : balls)
+		delete ball;
+	return 0;
+}
+
+#if defined(_WIN32)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+{
+	//the examples are windows applications, the report goes to a console
+	AllocConsole();
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONIN$", "r", stdin);
+	int result = RunBenchmark(__argc, __argv);
+	printf("press enter to exit\n");
+	getchar();
+	return result;
+}
+#else
+int main(int argc, char** argv)
+{
+	return RunBenchmark(argc, argv);
+}
+#endif
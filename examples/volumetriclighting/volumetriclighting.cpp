@@ -16,9 +16,11 @@
 #include "render/vulkan/VulkanTexture.h"
 #include "render/vulkan/VulkanCommandBuffer.h"
 #include "render/vulkan/VulkanDescriptorPool.h"
+#include "render/vulkan/VulkanTimestampQueries.h"
 #include "scene/DrawDebug.h"
 #include "scene/SceneLoader.h"
 
+//size of the volumes, the froxels in use can be fewer
 #define TEX_WIDTH 160
 #define TEX_HEIGHT 80
 #define TEX_DEPTH 128
@@ -30,6 +32,9 @@
 
 #define NUM_BLUE_NOISE_TEXTURES 16
 
+//light injection start, light injection end, raymarch end
+#define GPU_TIMESTAMPS 3
+
 using namespace engine;
 
 class VulkanExample : public VulkanApplication
@@ -65,8 +70,11 @@ public:
 		glm::vec4 camera_position;
 		glm::vec4 bias_near_far_pow;
 		glm::vec4 light_color;
+		glm::vec4 grid_size;//w the weight of the new sample, 1 without history
+		glm::vec4 grid_scale;//w the frames it takes to update every froxel
 		float time;
 		int noise_index = 1;
+		int frame = 0;
 	} uboCompute;
 
 	render::VulkanBuffer* computeUniformBuffer;
@@ -76,6 +84,7 @@ public:
 	struct {
 		glm::mat4 view_proj;
 		glm::vec4 bias_near_far_pow;
+		glm::vec4 grid_scale;
 	} uboFSscene;
 	//render::VulkanBuffer* globalSceneFragmentUniformBuffer = nullptr;
 
@@ -87,6 +96,21 @@ public:
 
 	float lightAngle = glm::radians(-45.0f);
 
+	//temporal mode reprojects the last volume and blends a jittered update into it, without it every froxel is computed from scratch
+	bool temporal = true;
+	float newSampleWeight = 0.05f;
+	int32_t updateInterval = 1;
+	float froxelScale = 1.0f;
+	float depthPower = 1.0f;
+	glm::uvec3 gridSize = glm::uvec3(TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH);
+	bool historyValid = false;
+	uint32_t computeFrame = 0;
+
+	render::VulkanTimestampQueries* computeTimestamps = nullptr;
+	std::vector<double> computeIntervals;
+	double lightInjectionTime = 0.0;
+	double raymarchTime = 0.0;
+
 	std::vector<render::CommandBuffer*> drawShadowCmdBuffers;
 	std::vector<render::CommandBuffer*> drawComputeCmdBuffers;
 
@@ -179,6 +203,8 @@ public:
 
 		fileName = engine::tools::getAssetPath() + "shaders/computeshader/" + "raymarch" + ".comp.spv";
 		raymarchpipeline = vulkanDevice->GetComputePipeline(fileName, raymarchdescriptorSetLayout->m_descriptorSetLayout, pipelineCache);
+
+		computeTimestamps = vulkanDevice->GetTimestampQueries(GPU_TIMESTAMPS, static_cast<uint32_t>(drawComputeCmdBuffers.size()));
 	}
 
 	void init()
@@ -278,6 +304,9 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(vkbuffer, &cmdBufInfo));
 
+			computeTimestamps->Reset(vkbuffer, i);
+			computeTimestamps->Write(vkbuffer, i, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
 			// Image memory barrier to make sure that compute shader writes are finished before sampling from the texture
 			scene.shadowmap->PipelineBarrier(vkbuffer,
 				VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
@@ -287,7 +316,8 @@ public:
 
 			lightinjectionpipeline->Draw(vkbuffer);
 			lightinjectiondescriptorSet->Draw(vkbuffer, lightinjectionpipeline->getPipelineLayout(), 0, VK_PIPELINE_BIND_POINT_COMPUTE);
-			vkCmdDispatch(vkbuffer, TEX_WIDTH / COMPUTE_GROUP_SIZE, TEX_HEIGHT / COMPUTE_GROUP_SIZE, TEX_DEPTH / COMPUTE_GROUP_SIZE_Z);
+			vkCmdDispatch(vkbuffer, (gridSize.x + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, (gridSize.y + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, gridSize.z / COMPUTE_GROUP_SIZE_Z);
+			computeTimestamps->Write(vkbuffer, i, 1);
 
 			textureCompute3dTargets[write_idx]->PipelineBarrier(vkbuffer,
 				VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
@@ -297,7 +327,8 @@ public:
 
 			raymarchpipeline->Draw(vkbuffer);
 			raymarchdescriptorSet->Draw(vkbuffer, raymarchpipeline->getPipelineLayout(), 0, VK_PIPELINE_BIND_POINT_COMPUTE);
-			vkCmdDispatch(vkbuffer, TEX_WIDTH / COMPUTE_GROUP_SIZE, TEX_HEIGHT / COMPUTE_GROUP_SIZE, COMPUTE_GROUP_SIZE_Z);
+			vkCmdDispatch(vkbuffer, (gridSize.x + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, (gridSize.y + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, COMPUTE_GROUP_SIZE_Z);
+			computeTimestamps->Write(vkbuffer, i, 2);
 
 			VK_CHECK_RESULT(vkEndCommandBuffer(vkbuffer));
 		}
@@ -371,11 +402,24 @@ public:
 		glm::mat4 perspectiveMatrix = scene.m_camera->GetPerspectiveMatrix();
 		glm::mat4 viewMatrix = scene.m_camera->GetViewMatrix();
 
+		//the froxels fill the first texels of the volumes, a new resolution or slicing can't reuse the history
+		glm::uvec3 newGridSize = glm::max(glm::uvec3(glm::vec3(TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH) * froxelScale + 0.5f), glm::uvec3(1));
+		if (newGridSize != gridSize || depthPower != uboCompute.bias_near_far_pow.w)
+		{
+			gridSize = newGridSize;
+			historyValid = false;
+		}
+		glm::vec3 gridScale = glm::vec3(gridSize) / glm::vec3(TEX_WIDTH, TEX_HEIGHT, TEX_DEPTH);
+		uboCompute.grid_size = glm::vec4(glm::vec3(gridSize), temporal && historyValid ? newSampleWeight : 1.0f);
+		uboCompute.grid_scale = glm::vec4(gridScale, temporal ? static_cast<float>(updateInterval) : 1.0f);
+		uboCompute.frame = computeFrame++;
+		historyValid = true;
+
 		uboCompute.view = viewMatrix;
 		uboCompute.projection = perspectiveMatrix;
 		uboCompute.inv_view_proj = glm::inverse(perspectiveMatrix * viewMatrix);
 		uboCompute.prev_view_proj = previous_view_proj;
-		uboCompute.bias_near_far_pow = glm::vec4(0.002f, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE, 1.0f);
+		uboCompute.bias_near_far_pow = glm::vec4(0.002f, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE, depthPower);
 		uboCompute.light_view_proj = scene.uboShadowOffscreenVS.depthMVP;
 		uboCompute.camera_position = glm::vec4(-camera.GetPosition(), 1.0f);
 		uboCompute.time = depth;
@@ -385,7 +429,8 @@ public:
 		previous_view_proj = perspectiveMatrix * viewMatrix;
 
 		uboFSscene.view_proj = perspectiveMatrix * viewMatrix;
-		uboFSscene.bias_near_far_pow = glm::vec4(0.002f, scene.m_camera->getNearClip(), scene.m_camera->getFarClip(), 1.0f);
+		uboFSscene.bias_near_far_pow = glm::vec4(0.002f, scene.m_camera->getNearClip(), scene.m_camera->getFarClip(), depthPower);
+		uboFSscene.grid_scale = glm::vec4(gridScale, 1.0f);
 		scene.sceneFragmentUniformBuffer->MemCopy(&uboFSscene, sizeof(uboFSscene));
 
 		dbgtex.UpdateUniformBuffers(perspectiveMatrix, viewMatrix, depth);
@@ -393,7 +438,14 @@ public:
 		uint32_t read_idx = static_cast<uint32_t>(m_ct_ping_pong);
 		uint32_t write_idx = static_cast<uint32_t>(!m_ct_ping_pong);
 
-		vkWaitForFences(device, submitFences.size(), submitFences.data(), VK_TRUE, UINT64_MAX);
+		WaitForFramesInFlight();
+
+		//every frame is finished here, the timestamps of the last one can be read before its command buffer is recorded again
+		if (computeTimestamps->GetIntervals(currentBuffer, computeIntervals))
+		{
+			lightInjectionTime = lightInjectionTime * 0.9 + computeIntervals[0] * 0.1;
+			raymarchTime = raymarchTime * 0.9 + computeIntervals[1] * 0.1;
+		}
 
 		lightinjectiondescriptorSet->Update(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &textureCompute3dTargets[read_idx]->m_descriptor);
 		lightinjectiondescriptorSet->Update(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, nullptr, &textureCompute3dTargets[write_idx]->m_descriptor);
@@ -415,6 +467,19 @@ public:
 		if (overlay->header("Settings")) {
 			ImGui::SliderAngle("Sun Angle", &lightAngle, 0.0f, -180.0f);
 		}
+		if (overlay->header("Volumetrics")) {
+			overlay->checkBox("Temporal reprojection", &temporal);
+			if (temporal)
+			{
+				ImGui::SliderFloat("New sample weight", &newSampleWeight, 0.01f, 1.0f);
+				ImGui::SliderInt("Frames per froxel update", &updateInterval, 1, 8);
+			}
+			ImGui::SliderFloat("Froxel resolution", &froxelScale, 0.25f, 1.0f);
+			ImGui::SliderFloat("Depth slicing power", &depthPower, 1.0f, 4.0f);
+			overlay->text("%u x %u x %u froxels", gridSize.x, gridSize.y, gridSize.z);
+			if (computeTimestamps && computeTimestamps->IsSupported())
+				overlay->text("GPU light injection %.3f ms, raymarch %.3f ms", lightInjectionTime, raymarchTime);
+		}
 	}
 
 };